@@ -17,8 +17,8 @@ writer = generator.writer
 toolchain = generator.toolchain
 
 resource_lib = generator.lib(module = 'resource', sources = [
-  'bundle.c', 'change.c', 'compile.c', 'compiled.c', 'event.c', 'import.c', 'local.c', 'platform.c', 'remote.c',
-  'resource.c', 'source.c', 'sourced.c', 'stream.c', 'version.c'])
+  'bundle.c', 'change.c', 'compile.c', 'compiled.c', 'compress.c', 'event.c', 'import.c', 'local.c', 'platform.c',
+  'remote.c', 'resource.c', 'source.c', 'sourced.c', 'stream.c', 'version.c'])
 
 network_libs = []
 if target.is_windows():
@@ -30,6 +30,7 @@ if not target.is_ios() and not target.is_android() and not target.is_tizen():
     generator.bin('resource', ['main.c'], 'resource', basepath = 'tools', implicit_deps = [resource_lib], dependlibs = dependlibs, libs = network_libs, configs = configs)
     generator.bin('sourced', ['main.c', 'server.c'], 'sourced', basepath = 'tools', implicit_deps = [resource_lib], dependlibs = dependlibs, libs = network_libs, configs = configs)
     generator.bin('compiled', ['main.c', 'server.c'], 'compiled', basepath = 'tools', implicit_deps = [resource_lib], dependlibs = dependlibs, libs = network_libs, configs = configs)
+    generator.bin('bundle', ['main.c'], 'bundle', basepath = 'tools', implicit_deps = [resource_lib], dependlibs = dependlibs, libs = network_libs, configs = configs)
 
 #No test cases if we're a submodule
 if generator.is_subninja():
@@ -38,7 +39,7 @@ if generator.is_subninja():
 includepaths = generator.test_includepaths()
 
 test_cases = [
-  'source'
+  'source', 'remote', 'compress', 'local', 'bundle', 'compiled'
 ]
 if toolchain.is_monolithic() or target.is_ios() or target.is_android() or target.is_tizen():
   #Build one fat binary with all test cases
@@ -69,9 +69,55 @@
 /*! Initial size of change block string data */
 #define RESOURCE_CHANGE_BLOCK_DATA_SIZE 1024
 
+/*! Default number of worker threads servicing asynchronous stream requests */
+#define RESOURCE_STREAM_WORKER_THREADS 2
+
+/*! Default maximum total size in bytes of prefetched remote resources held in memory waiting to be opened */
+#define RESOURCE_STREAM_PREFETCH_LIMIT (64 * 1024 * 1024)
+
+/*! Default maximum size in bytes of a single prefetched remote resource held in memory */
+#define RESOURCE_STREAM_PREFETCH_RESOURCE_LIMIT (4 * 1024 * 1024)
+
+/*! Maximum size of a single read merged from adjacent asynchronous bundle reads */
+#define RESOURCE_BUNDLE_READ_MERGE_LIMIT (1024 * 1024)
+
+/*! Number of entries in the client side cache of remote sourced metadata, must be a power of two.
+The cache is direct mapped and does not hold a manifest of a whole source tree of more resources */
+#define RESOURCE_REMOTE_CACHE_SIZE 1024
+
+/*! Default timeout in milliseconds waiting for data on remote compiled resource streams */
+#define RESOURCE_REMOTE_STREAM_TIMEOUT (30 * 1000)
+
+/*! Size of the receive buffer used when reading remote compiled resource streams */
+#define RESOURCE_REMOTE_STREAM_BUFFER_SIZE (64 * 1024)
+
+/*! Default number of connections to the remote compile daemon */
+#define RESOURCE_REMOTE_COMPILED_CONNECTIONS 4
+
+/*! Default timeout in milliseconds waiting for the reply to a remote call */
+#define RESOURCE_REMOTE_CALL_TIMEOUT (10 * 1000)
+
+/*! Timeout in milliseconds waiting for the reply to a remote bundle open, which builds the bundle */
+#define RESOURCE_REMOTE_BUNDLE_TIMEOUT (10 * 60 * 1000)
+
+/*! Timeout in milliseconds waiting for the reply to a remote manifest, which hashes all listed resources */
+#define RESOURCE_REMOTE_MANIFEST_TIMEOUT (60 * 1000)
+
+/*! Average remote call round trip time in milliseconds above which the remote is considered degraded */
+#define RESOURCE_REMOTE_LATENCY_LIMIT 500
+
+/*! Time in milliseconds a degraded remote is bypassed before calls are attempted again */
+#define RESOURCE_REMOTE_DEGRADED_COOLDOWN (30 * 1000)
+
+/*! Size of independently compressed chunks in compressed resource data */
+#define RESOURCE_COMPRESS_CHUNK_SIZE 65536
+
 /*! Name of import map files */
 #define RESOURCE_IMPORT_MAP "import.map"
 
+/*! Name of local cache manifest files */
+#define RESOURCE_LOCAL_MANIFEST "resource.manifest"
+
 // Make sure we have at least one way of loading resources
 #if !RESOURCE_ENABLE_REMOTE_COMPILED && !RESOURCE_ENABLE_LOCAL_CACHE
 #error Invalid build configuration, no way of loading resources
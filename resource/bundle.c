@@ -22,46 +22,631 @@
 
 #include <foundation/foundation.h>
 
-bool
-resource_bundle_load(const uuid_t bundle) {
-#if RESOURCE_ENABLE_LOCAL_SOURCE
-	if (resource_module_config().enable_local_source) {
+#include <stdlib.h>
+
+/* Static part of a bundle is stored as a resource file
+
+   resource_header_t       type "bundle", version RESOURCE_BUNDLE_VERSION
+   uint32                  number of resources
+   uint32                  reserved
+   resource_bundle_entry_t table of contents, sorted by UUID
+   data                    static data of resources in load order
+
+   Header and table of contents are stored in native byte order. */
+
+#define RESOURCE_BUNDLE_VERSION 1
+
+typedef struct resource_bundle_request_t resource_bundle_request_t;
+
+struct resource_bundle_request_t {
+	resource_bundle_t* bundle;
+	uuid_t uuid;
+	size_t offset;
+	size_t size;
+	void* buffer;
+	int priority;
+	resource_bundle_read_fn callback;
+	void* data;
+};
+
+static thread_t resource_bundle_thread;
+//! I/O thread is started on the first asynchronous read, guarded by the requests lock
+static bool resource_bundle_thread_started;
+static resource_bundle_request_t* resource_bundle_requests;
+static mutex_t* resource_bundle_requests_lock;
+static mutex_t* resource_bundle_serve_lock;
+static semaphore_t resource_bundle_requests_signal;
+static atomic32_t resource_bundle_terminate;
+
+static hash_t
+resource_bundle_type(void) {
+	return hash(STRING_CONST("bundle"));
+}
+
+static int
+resource_bundle_entry_compare(const void* lhs, const void* rhs) {
+	const resource_bundle_entry_t* first = lhs;
+	const resource_bundle_entry_t* second = rhs;
+	if (first->uuid.word[0] != second->uuid.word[0])
+		return (first->uuid.word[0] < second->uuid.word[0]) ? -1 : 1;
+	if (first->uuid.word[1] != second->uuid.word[1])
+		return (first->uuid.word[1] < second->uuid.word[1]) ? -1 : 1;
+	return 0;
+}
+
+static stream_t*
+resource_bundle_open_stream(const uuid_t uuid, uint64_t platform, bool dynamic) {
+	stream_t* stream = nullptr;
+
+	if (resource_local_manifest_is_loaded()) {
+		return dynamic ? resource_local_manifest_open_dynamic(uuid, platform) :
+		                 resource_local_manifest_open_static(uuid, platform);
 	}
+
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	if (resource_module_config().enable_remote_compiled)
+		stream = dynamic ? resource_remote_open_dynamic(uuid, platform) : resource_remote_open_static(uuid, platform);
 #endif
 
 #if RESOURCE_ENABLE_LOCAL_CACHE
-	if (resource_module_config().enable_local_cache) {
-	}
+	if (!stream && resource_module_config().enable_local_cache)
+		stream = dynamic ? resource_local_open_dynamic(uuid, platform) : resource_local_open_static(uuid, platform);
 #endif
 
+	return stream;
+}
+
+static size_t
+resource_bundle_copy_stream(stream_t* source, stream_t* destination) {
+	char buffer[4096];
+	size_t total = 0;
+	while (!stream_eos(source)) {
+		size_t read = stream_read(source, buffer, sizeof(buffer));
+		if (!read)
+			break;
+		total += stream_write(destination, buffer, read);
+	}
+	return total;
+}
+
+static uint8_t*
+resource_bundle_append_data(uint8_t* data, const void* buffer, size_t size) {
+	size_t offset = array_size(data);
+	array_resize(data, offset + size);
+	memcpy(data + offset, buffer, size);
+	return data;
+}
+
+static resource_bundle_t*
+resource_bundle_read(const uuid_t uuid, uint64_t platform, stream_t* stream) {
+	resource_header_t header = resource_stream_read_header(stream);
+	if ((header.type != resource_bundle_type()) || (header.version != RESOURCE_BUNDLE_VERSION)) {
+		string_const_t uuidstr = string_from_uuid_static(uuid);
+		log_warnf(HASH_RESOURCE, WARNING_INVALID_VALUE,
+		          STRING_CONST("Invalid bundle: %.*s (platform 0x%" PRIx64 ") type %" PRIhash " version %u"),
+		          STRING_FORMAT(uuidstr), platform, header.type, header.version);
+		return nullptr;
+	}
+
+	// Read table of contents and all static data in one go
+	size_t size = stream_size(stream) - stream_tell(stream);
+	if (size < (sizeof(uint32_t) * 2))
+		return nullptr;
+	void* buffer = memory_allocate(HASH_RESOURCE, size, 8, MEMORY_PERSISTENT);
+	if (stream_read(stream, buffer, size) != size) {
+		memory_deallocate(buffer);
+		return nullptr;
+	}
+
+	size_t count = *(const uint32_t*)buffer;
+	size_t toc_size = (sizeof(uint32_t) * 2) + (sizeof(resource_bundle_entry_t) * count);
+	if (toc_size > size) {
+		memory_deallocate(buffer);
+		return nullptr;
+	}
+
+	resource_bundle_t* bundle =
+	    memory_allocate(HASH_RESOURCE, sizeof(resource_bundle_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	bundle->uuid = uuid;
+	bundle->platform = platform;
+	bundle->count = count;
+	bundle->entries = pointer_offset(buffer, sizeof(uint32_t) * 2);
+	bundle->data = pointer_offset(buffer, toc_size);
+	bundle->data_size = size - toc_size;
+	bundle->buffer = buffer;
+
+	for (size_t ientry = 0; ientry < count; ++ientry) {
+		const resource_bundle_entry_t* entry = bundle->entries + ientry;
+		if ((entry->static_offset > bundle->data_size) ||
+		    (entry->static_size > (bundle->data_size - entry->static_offset))) {
+			log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid bundle table of contents"));
+			resource_bundle_deallocate(bundle);
+			return nullptr;
+		}
+	}
+
+	return bundle;
+}
+
+resource_bundle_t*
+resource_bundle_load(const uuid_t bundle, uint64_t platform) {
+	stream_t* stream = resource_bundle_open_stream(bundle, platform, false);
+	if (!stream) {
+		string_const_t uuidstr = string_from_uuid_static(bundle);
+		log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+		          STRING_CONST("Unable to open bundle: %.*s (platform 0x%" PRIx64 ")"), STRING_FORMAT(uuidstr),
+		          platform);
+		return nullptr;
+	}
+
+	resource_bundle_t* loaded = resource_bundle_read(bundle, platform, stream);
+	stream_deallocate(stream);
+
+	return loaded;
+}
+
+resource_bundle_t*
+resource_bundle_fetch(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count) {
+	resource_bundle_t* fetched = nullptr;
+
 #if RESOURCE_ENABLE_REMOTE_COMPILED
-	if (resource_module_config().enable_remote_compiled) {
+	if (resource_module_config().enable_remote_compiled && !resource_local_manifest_is_loaded()) {
+		stream_t* stream = resource_remote_open_bundle(bundle, platform, roots, count);
+		if (stream) {
+			fetched = resource_bundle_read(bundle, platform, stream);
+			stream_deallocate(stream);
+		}
 	}
+#else
+	FOUNDATION_UNUSED(roots);
+	FOUNDATION_UNUSED(count);
 #endif
 
-	FOUNDATION_UNUSED(bundle);
+	if (!fetched)
+		fetched = resource_bundle_load(bundle, platform);
 
-	return false;
+	return fetched;
+}
+
+void
+resource_bundle_deallocate(resource_bundle_t* bundle) {
+	resource_bundle_request_t* cancelled = nullptr;
+
+	if (!bundle)
+		return;
+
+	if (resource_bundle_requests_lock) {
+		mutex_lock(resource_bundle_requests_lock);
+		for (size_t ireq = 0; ireq < array_size(resource_bundle_requests);) {
+			if (resource_bundle_requests[ireq].bundle == bundle) {
+				array_push(cancelled, resource_bundle_requests[ireq]);
+				array_erase_ordered_safe(resource_bundle_requests, ireq);
+			} else {
+				++ireq;
+			}
+		}
+		mutex_unlock(resource_bundle_requests_lock);
+
+		// Wait for any batch of reads from this bundle currently being served
+		mutex_lock(resource_bundle_serve_lock);
+		mutex_unlock(resource_bundle_serve_lock);
+	}
+
+	for (size_t ireq = 0, rsize = array_size(cancelled); ireq < rsize; ++ireq) {
+		if (cancelled[ireq].callback)
+			cancelled[ireq].callback(bundle, cancelled[ireq].uuid, cancelled[ireq].buffer, 0, cancelled[ireq].data);
+	}
+	array_deallocate(cancelled);
+
+	if (bundle->dynamic)
+		stream_deallocate(bundle->dynamic);
+	memory_deallocate(bundle->buffer);
+	memory_deallocate(bundle);
+}
+
+const resource_bundle_entry_t*
+resource_bundle_lookup(const resource_bundle_t* bundle, const uuid_t uuid) {
+	resource_bundle_entry_t key;
+	key.uuid = uuid;
+	size_t low = 0, high = bundle->count;
+	while (low < high) {
+		size_t mid = low + ((high - low) / 2);
+		int cmp = resource_bundle_entry_compare(&key, bundle->entries + mid);
+		if (!cmp)
+			return bundle->entries + mid;
+		if (cmp < 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return nullptr;
 }
 
 stream_t*
-resource_bundle_stream(const uuid_t bundle) {
-#if RESOURCE_ENABLE_LOCAL_SOURCE
-	if (resource_module_config().enable_local_source) {
+resource_bundle_open_static(const resource_bundle_t* bundle, const uuid_t uuid) {
+	const resource_bundle_entry_t* entry = resource_bundle_lookup(bundle, uuid);
+	if (!entry)
+		return nullptr;
+	// Buffer stream is read only, casting away const is safe
+	void* data = (void*)pointer_offset_const(bundle->data, entry->static_offset);
+	return buffer_stream_allocate(data, STREAM_IN | STREAM_BINARY, (size_t)entry->static_size,
+	                              (size_t)entry->static_size, false, false);
+}
+
+stream_t*
+resource_bundle_stream(const uuid_t bundle, uint64_t platform) {
+	return resource_bundle_open_stream(bundle, platform, true);
+}
+
+static int
+resource_bundle_request_compare(const void* lhs, const void* rhs) {
+	const resource_bundle_request_t* first = lhs;
+	const resource_bundle_request_t* second = rhs;
+	if (first->offset != second->offset)
+		return (first->offset < second->offset) ? -1 : 1;
+	return (first->size < second->size) ? -1 : ((first->size > second->size) ? 1 : 0);
+}
+
+static bool
+resource_bundle_seek_dynamic(resource_bundle_t* bundle, size_t offset) {
+	if (bundle->dynamic && bundle->dynamic->sequential && (stream_tell(bundle->dynamic) > offset)) {
+		// Sequential streams cannot seek backwards, reopen from start
+		stream_deallocate(bundle->dynamic);
+		bundle->dynamic = nullptr;
 	}
-#endif
+	if (!bundle->dynamic)
+		bundle->dynamic = resource_bundle_stream(bundle->uuid, bundle->platform);
+	if (!bundle->dynamic)
+		return false;
 
-#if RESOURCE_ENABLE_LOCAL_CACHE
-	if (resource_module_config().enable_local_cache) {
+	size_t position = stream_tell(bundle->dynamic);
+	if (position == offset)
+		return true;
+	if (!bundle->dynamic->sequential) {
+		stream_seek(bundle->dynamic, (ssize_t)offset, STREAM_SEEK_BEGIN);
+		return stream_tell(bundle->dynamic) == offset;
 	}
-#endif
 
-#if RESOURCE_ENABLE_REMOTE_COMPILED
-	if (resource_module_config().enable_remote_compiled) {
+	char skip[4096];
+	while (position < offset) {
+		size_t want = offset - position;
+		size_t read = stream_read(bundle->dynamic, skip, (want < sizeof(skip)) ? want : sizeof(skip));
+		if (!read)
+			return false;
+		position += read;
 	}
-#endif
+	return true;
+}
+
+/*! Serve a batch of reads from the same bundle, storing the number of bytes read in the size
+of each request. Callbacks are called by the caller once the bundle is no longer accessed */
+static void
+resource_bundle_serve(resource_bundle_request_t* batch) {
+	size_t count = array_size(batch);
+	resource_bundle_t* bundle = batch[0].bundle;
+	void* scratch = nullptr;
+	size_t scratch_size = 0;
 
-	FOUNDATION_UNUSED(bundle);
+	qsort(batch, count, sizeof(resource_bundle_request_t), resource_bundle_request_compare);
 
+	for (size_t first = 0; first < count;) {
+		// Merge requests overlapping or adjacent to the current range into a single read
+		size_t start = batch[first].offset;
+		size_t end = start + batch[first].size;
+		size_t last = first + 1;
+		while ((last < count) && (batch[last].offset <= end) &&
+		       ((batch[last].offset + batch[last].size - start) <= RESOURCE_BUNDLE_READ_MERGE_LIMIT)) {
+			if ((batch[last].offset + batch[last].size) > end)
+				end = batch[last].offset + batch[last].size;
+			++last;
+		}
+
+		size_t read = 0;
+		if (resource_bundle_seek_dynamic(bundle, start)) {
+			if (last == (first + 1)) {
+				read = stream_read(bundle->dynamic, batch[first].buffer, end - start);
+			} else {
+				if (scratch_size < (end - start)) {
+					memory_deallocate(scratch);
+					scratch_size = end - start;
+					scratch = memory_allocate(HASH_RESOURCE, scratch_size, 0, MEMORY_PERSISTENT);
+				}
+				read = stream_read(bundle->dynamic, scratch, end - start);
+				for (size_t ireq = first; ireq < last; ++ireq) {
+					size_t offset = batch[ireq].offset - start;
+					size_t size = (read > offset) ? (read - offset) : 0;
+					if (size > batch[ireq].size)
+						size = batch[ireq].size;
+					memcpy(batch[ireq].buffer, pointer_offset(scratch, offset), size);
+				}
+			}
+		}
+
+		for (size_t ireq = first; ireq < last; ++ireq) {
+			size_t offset = batch[ireq].offset - start;
+			size_t size = (read > offset) ? (read - offset) : 0;
+			if (size < batch[ireq].size)
+				batch[ireq].size = size;
+		}
+
+		first = last;
+	}
+
+	memory_deallocate(scratch);
+}
+
+static void*
+resource_bundle_io_thread(void* arg) {
+	FOUNDATION_UNUSED(arg);
+	resource_bundle_request_t* batch = nullptr;
+
+	while (semaphore_wait(&resource_bundle_requests_signal)) {
+		if (atomic_load32(&resource_bundle_terminate, memory_order_acquire))
+			break;
+
+		// Pick all requests for the bundle of the first highest priority request
+		mutex_lock(resource_bundle_serve_lock);
+		mutex_lock(resource_bundle_requests_lock);
+		size_t best = 0;
+		size_t rsize = array_size(resource_bundle_requests);
+		for (size_t ireq = 1; ireq < rsize; ++ireq) {
+			if (resource_bundle_requests[ireq].priority > resource_bundle_requests[best].priority)
+				best = ireq;
+		}
+		if (rsize) {
+			int priority = resource_bundle_requests[best].priority;
+			resource_bundle_t* bundle = resource_bundle_requests[best].bundle;
+			for (size_t ireq = 0; ireq < array_size(resource_bundle_requests);) {
+				if ((resource_bundle_requests[ireq].bundle == bundle) &&
+				    (resource_bundle_requests[ireq].priority == priority)) {
+					array_push(batch, resource_bundle_requests[ireq]);
+					array_erase_ordered_safe(resource_bundle_requests, ireq);
+				} else {
+					++ireq;
+				}
+			}
+		}
+		mutex_unlock(resource_bundle_requests_lock);
+
+		if (array_size(batch))
+			resource_bundle_serve(batch);
+
+		mutex_unlock(resource_bundle_serve_lock);
+
+		// Complete outside the serve lock, callbacks are free to deallocate the bundle
+		for (size_t ireq = 0, rsize = array_size(batch); ireq < rsize; ++ireq) {
+			resource_bundle_request_t* request = batch + ireq;
+			if (request->callback)
+				request->callback(request->bundle, request->uuid, request->buffer, request->size, request->data);
+		}
+		array_clear(batch);
+	}
+
+	array_deallocate(batch);
 	return nullptr;
 }
+
+int
+resource_bundle_initialize(void) {
+	resource_bundle_requests_lock = mutex_allocate(STRING_CONST("resource-bundle-requests"));
+	resource_bundle_serve_lock = mutex_allocate(STRING_CONST("resource-bundle-serve"));
+	semaphore_initialize(&resource_bundle_requests_signal, 0);
+	atomic_store32(&resource_bundle_terminate, 0, memory_order_release);
+	resource_bundle_thread_started = false;
+
+	return 0;
+}
+
+void
+resource_bundle_finalize(void) {
+	if (resource_bundle_thread_started) {
+		atomic_store32(&resource_bundle_terminate, 1, memory_order_release);
+		semaphore_post(&resource_bundle_requests_signal);
+		thread_finalize(&resource_bundle_thread);
+		resource_bundle_thread_started = false;
+	}
+
+	// Complete any reads still queued as failed
+	for (size_t ireq = 0, rsize = array_size(resource_bundle_requests); ireq < rsize; ++ireq) {
+		resource_bundle_request_t* request = resource_bundle_requests + ireq;
+		if (request->callback)
+			request->callback(request->bundle, request->uuid, request->buffer, 0, request->data);
+	}
+
+	array_deallocate(resource_bundle_requests);
+	mutex_deallocate(resource_bundle_requests_lock);
+	mutex_deallocate(resource_bundle_serve_lock);
+	semaphore_finalize(&resource_bundle_requests_signal);
+
+	resource_bundle_requests = nullptr;
+	resource_bundle_requests_lock = nullptr;
+	resource_bundle_serve_lock = nullptr;
+}
+
+bool
+resource_bundle_read_async(resource_bundle_t* bundle, const uuid_t uuid, size_t offset, size_t size, void* buffer,
+                           int priority, resource_bundle_read_fn callback, void* data) {
+	const resource_bundle_entry_t* entry = resource_bundle_lookup(bundle, uuid);
+	if (!entry || (offset > entry->dynamic_size) || !resource_bundle_requests_lock)
+		return false;
+	if (size > (entry->dynamic_size - offset))
+		size = (size_t)(entry->dynamic_size - offset);
+
+	resource_bundle_request_t request;
+	request.bundle = bundle;
+	request.uuid = uuid;
+	request.offset = (size_t)entry->dynamic_offset + offset;
+	request.size = size;
+	request.buffer = buffer;
+	request.priority = priority;
+	request.callback = callback;
+	request.data = data;
+
+	mutex_lock(resource_bundle_requests_lock);
+	array_push(resource_bundle_requests, request);
+	if (!resource_bundle_thread_started) {
+		thread_initialize(&resource_bundle_thread, resource_bundle_io_thread, nullptr,
+		                  STRING_CONST("resource-bundle-io"), THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&resource_bundle_thread);
+		resource_bundle_thread_started = true;
+	}
+	mutex_unlock(resource_bundle_requests_lock);
+
+	semaphore_post(&resource_bundle_requests_signal);
+
+	return true;
+}
+
+bool
+resource_bundle_write(const uuid_t bundle, uint64_t platform, const uuid_t* resources, size_t count) {
+	bool success = true;
+	stream_t* dynamic = nullptr;
+	uint8_t* data = nullptr;
+	size_t entries_size = sizeof(resource_bundle_entry_t) * (count ? count : 1);
+	resource_bundle_entry_t* entries =
+	    memory_allocate(HASH_RESOURCE, entries_size, 8, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	resource_local_publish_begin(bundle, platform);
+
+	for (size_t ires = 0; success && (ires < count); ++ires) {
+		resource_bundle_entry_t* entry = entries + ires;
+		stream_t* stream = resource_stream_open_static(resources[ires], platform);
+		if (!stream) {
+			success = false;
+			break;
+		}
+
+		char buffer[4096];
+		resource_header_t header = resource_stream_read_header(stream);
+		entry->uuid = resources[ires];
+		entry->type = header.type;
+		entry->source_hash = header.source_hash;
+		entry->static_offset = array_size(data);
+
+		stream_t* header_stream =
+		    buffer_stream_allocate(buffer, STREAM_OUT | STREAM_BINARY, 0, sizeof(buffer), false, false);
+		resource_stream_write_header(header_stream, header);
+		data = resource_bundle_append_data(data, buffer, stream_tell(header_stream));
+		stream_deallocate(header_stream);
+
+		while (!stream_eos(stream)) {
+			size_t read = stream_read(stream, buffer, sizeof(buffer));
+			if (!read)
+				break;
+			data = resource_bundle_append_data(data, buffer, read);
+		}
+		entry->static_size = array_size(data) - entry->static_offset;
+		stream_deallocate(stream);
+
+		stream = resource_bundle_open_stream(resources[ires], platform, true);
+		if (stream) {
+			if (!dynamic)
+				dynamic = resource_local_create_dynamic(bundle, platform);
+			if (dynamic) {
+				entry->dynamic_offset = stream_tell(dynamic);
+				entry->dynamic_size = resource_bundle_copy_stream(stream, dynamic);
+			} else {
+				success = false;
+			}
+			stream_deallocate(stream);
+		}
+	}
+
+	if (success) {
+		qsort(entries, count, sizeof(resource_bundle_entry_t), resource_bundle_entry_compare);
+
+		stream_t* stream = resource_local_create_static(bundle, platform);
+		if (stream) {
+			resource_header_t header;
+			memset(&header, 0, sizeof(header));
+			header.type = resource_bundle_type();
+			header.version = RESOURCE_BUNDLE_VERSION;
+			resource_stream_write_header(stream, header);
+			stream_write_uint32(stream, (uint32_t)count);
+			stream_write_uint32(stream, 0);
+			stream_write(stream, entries, sizeof(resource_bundle_entry_t) * count);
+			stream_write(stream, data, array_size(data));
+			stream_deallocate(stream);
+		} else {
+			success = false;
+		}
+	}
+
+	if (dynamic)
+		stream_deallocate(dynamic);
+
+	resource_local_publish_end(bundle, platform, success);
+
+	if (!success) {
+		string_const_t uuidstr = string_from_uuid_static(bundle);
+		log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+		          STRING_CONST("Unable to write bundle: %.*s (platform 0x%" PRIx64 ")"), STRING_FORMAT(uuidstr),
+		          platform);
+	}
+
+	memory_deallocate(entries);
+	array_deallocate(data);
+
+	return success;
+}
+
+static bool
+resource_bundle_has_uuid(const uuid_t* uuids, const uuid_t uuid) {
+	for (size_t iuuid = 0, usize = array_size(uuids); iuuid < usize; ++iuuid) {
+		if (uuid_equal(uuids[iuuid], uuid))
+			return true;
+	}
+	return false;
+}
+
+static void
+resource_bundle_collect(const uuid_t uuid, uint64_t platform, uuid_t** visited, uuid_t** order) {
+	if (resource_bundle_has_uuid(*visited, uuid))
+		return;
+	array_push(*visited, uuid);
+
+	resource_dependency_t localdeps[8];
+	size_t deps_capacity = sizeof(localdeps) / sizeof(localdeps[0]);
+	size_t deps_count = resource_source_dependencies_count(uuid, platform);
+	if (deps_count) {
+		resource_dependency_t* deps = localdeps;
+		if (deps_count > deps_capacity)
+			deps = memory_allocate(HASH_RESOURCE, sizeof(resource_dependency_t) * deps_count, 16, MEMORY_PERSISTENT);
+		resource_source_dependencies(uuid, platform, deps, deps_count);
+		for (size_t idep = 0; idep < deps_count; ++idep)
+			resource_bundle_collect(deps[idep].uuid, platform, visited, order);
+		if (deps != localdeps)
+			memory_deallocate(deps);
+	}
+
+	// Post order, dependencies are stored before the resources depending on them
+	array_push(*order, uuid);
+}
+
+bool
+resource_bundle_build(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count) {
+	uuid_t* visited = nullptr;
+	uuid_t* order = nullptr;
+	bool success = true;
+
+	for (size_t iroot = 0; iroot < count; ++iroot)
+		resource_bundle_collect(roots[iroot], platform, &visited, &order);
+
+	for (size_t ires = 0, rsize = array_size(order); ires < rsize; ++ires) {
+		if (resource_compile_need_update(order[ires], platform) && !resource_compile(order[ires], platform)) {
+			string_const_t uuidstr = string_from_uuid_static(order[ires]);
+			log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+			          STRING_CONST("Unable to compile bundle resource: %.*s (platform 0x%" PRIx64 ")"),
+			          STRING_FORMAT(uuidstr), platform);
+			success = false;
+		}
+	}
+
+	if (success)
+		success = resource_bundle_write(bundle, platform, order, array_size(order));
+
+	array_deallocate(visited);
+	array_deallocate(order);
+
+	return success;
+}
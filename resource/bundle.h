@@ -22,23 +22,106 @@
 /*! \file bundle.h
 \brief Resource bundles
 
-A resource bundle contains any number of resources of a single type.
-The static and dynamic parts of the bundle resources are stored in separate files. */
+A resource bundle contains any number of compiled resources for a platform. The static
+part of the bundle holds a table of contents followed by the static data of all resources,
+allowing the bundle to be loaded with a single read. The dynamic data of all resources is
+stored in a separate file. */
 
 #include <foundation/platform.h>
 
 #include <resource/types.h>
 
-/*! Load static part of bundle, creating and initializing all
-resources stored in the bundle
+/*! Load static part of bundle, reading the table of contents and static data of all
+resources stored in the bundle with a single read
 \param bundle Bundle UUID
-\return true if successful, false if error */
-RESOURCE_API bool
-resource_bundle_load(const uuid_t bundle);
+\param platform Platform
+\return Bundle, null if error */
+RESOURCE_API resource_bundle_t*
+resource_bundle_load(const uuid_t bundle, uint64_t platform);
 
-/*! Open stream of dynamic part of bundle, creating and initializing all
-resources stored in the bundle
+/*! Fetch a bundle built from the given roots by the remote compiled service in a single
+streamed response, falling back to loading a previously built bundle. If null is returned
+the bundle is not available and resources should be opened individually, for example with
+resource_stream_open_static. The dynamic data of a fetched bundle is read through
+resource_bundle_stream as for loaded bundles
 \param bundle Bundle UUID
+\param platform Platform
+\param roots Root resource UUIDs
+\param count Number of root resources
+\return Bundle, null if not available */
+RESOURCE_API resource_bundle_t*
+resource_bundle_fetch(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count);
+
+/*! Deallocate a loaded bundle, invalidating all streams opened from it. Queued asynchronous
+reads are completed with a size of 0, calling their callbacks from the calling thread
+\param bundle Bundle */
+RESOURCE_API void
+resource_bundle_deallocate(resource_bundle_t* bundle);
+
+/*! Find the table of contents entry for a resource in a bundle
+\param bundle Bundle
+\param uuid Resource UUID
+\return Entry, null if resource is not stored in bundle */
+RESOURCE_API const resource_bundle_entry_t*
+resource_bundle_lookup(const resource_bundle_t* bundle, const uuid_t uuid);
+
+/*! Open stream of static part of a resource stored in a bundle. The stream reads from
+the bundle memory and must be deallocated before the bundle
+\param bundle Bundle
+\param uuid Resource UUID
+\return Stream for static resource data, null if resource is not stored in bundle */
+RESOURCE_API stream_t*
+resource_bundle_open_static(const resource_bundle_t* bundle, const uuid_t uuid);
+
+/*! Open stream of dynamic part of bundle, holding the dynamic data of all resources
+stored in the bundle at the offsets given by the table of contents
+\param bundle Bundle UUID
+\param platform Platform
 \return Stream for dynamic resource data, null if error */
 RESOURCE_API stream_t*
-resource_bundle_stream(const uuid_t bundle);
+resource_bundle_stream(const uuid_t bundle, uint64_t platform);
+
+/*! Queue an asynchronous read from the dynamic data of a resource stored in a bundle.
+Reads are served by a dedicated I/O thread started on the first call, highest priority first
+and in order of file offset within a priority, with adjacent reads merged. The callback of a
+served read is called from the I/O thread with the number of bytes read, or 0 if the read
+failed. Reads still queued when the bundle is deallocated are cancelled and their callbacks
+are called with 0 from the thread calling resource_bundle_deallocate, or from the thread
+finalizing the module. The bundle is not accessed while callbacks are called, so a callback
+may deallocate the bundle. Callbacks of other reads from the same batch are then still called
+with the now deallocated bundle pointer, which must not be dereferenced
+\param bundle Bundle
+\param uuid Resource UUID
+\param offset Offset in resource dynamic data
+\param size Number of bytes to read, clamped to the resource dynamic data
+\param buffer Destination buffer, must be valid until the callback is called
+\param priority Priority, higher values are served first
+\param callback Callback
+\param data Callback data
+\return true if read was queued, false if resource is not stored in bundle or range is invalid */
+RESOURCE_API bool
+resource_bundle_read_async(resource_bundle_t* bundle, const uuid_t uuid, size_t offset, size_t size, void* buffer,
+                           int priority, resource_bundle_read_fn callback, void* data);
+
+/*! Write a bundle of compiled resources. Resources are stored in the given order, which
+should be the order in which they are loaded to allow the dynamic data to be read
+sequentially. Resources are stored as opened by resource_stream_open_static, use
+resource_bundle_build to compile stale resources before they are stored
+\param bundle Bundle UUID
+\param platform Platform
+\param resources Resource UUIDs
+\param count Number of resources
+\return true if successful, false if error */
+RESOURCE_API bool
+resource_bundle_write(const uuid_t bundle, uint64_t platform, const uuid_t* resources, size_t count);
+
+/*! Build a bundle from the dependency closure of the given root resources. Dependencies
+are stored before the resources depending on them, giving an order in which the bundle
+can be loaded and read sequentially. Stale resources are compiled before being stored
+\param bundle Bundle UUID
+\param platform Platform
+\param roots Root resource UUIDs
+\param count Number of root resources
+\return true if successful, false if error */
+RESOURCE_API bool
+resource_bundle_build(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count);
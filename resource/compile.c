@@ -213,10 +213,12 @@ resource_compile(const uuid_t uuid, uint64_t platform) {
 			type = change->value.value;
 		}
 
+		resource_local_publish_begin(uuid, platform);
 		for (icmp = 0, isize = array_size(resource_compilers); !success && (icmp != isize); ++icmp) {
 			success = (resource_compilers[icmp](uuid, platform, &source, source_hash, STRING_ARGS(type)) == 0);
 			++internal;
 		}
+		resource_local_publish_end(uuid, platform, success);
 	}
 	resource_source_finalize(&source);
 
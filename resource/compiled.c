@@ -21,10 +21,18 @@
 
 #include <foundation/foundation.h>
 #include <network/socket.h>
+#include <blake3/blake3.h>
 
 int
-compiled_write_open_static(socket_t* sock, uuid_t uuid, uint64_t platform) {
-	compiled_open_static_t msg = {COMPILED_OPEN_STATIC, (uint32_t)sizeof(uuid_t) + sizeof(uint64_t), uuid, platform};
+compiled_write_open_static(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform,
+                           blake3_hash_t source_hash) {
+	compiled_open_static_t msg = {COMPILED_OPEN_STATIC,
+	                              (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(blake3_hash_t)),
+	                              request,
+	                              0,
+	                              uuid,
+	                              platform,
+	                              source_hash};
 
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
@@ -32,14 +40,58 @@ compiled_write_open_static(socket_t* sock, uuid_t uuid, uint64_t platform) {
 }
 
 int
-compiled_write_open_dynamic(socket_t* sock, uuid_t uuid, uint64_t platform) {
-	compiled_open_dynamic_t msg = {COMPILED_OPEN_DYNAMIC, (uint32_t)sizeof(uuid_t) + sizeof(uint64_t), uuid, platform};
+compiled_write_open_dynamic(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform,
+                            blake3_hash_t source_hash) {
+	compiled_open_dynamic_t msg = {COMPILED_OPEN_DYNAMIC,
+	                               (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(blake3_hash_t)),
+	                               request,
+	                               0,
+	                               uuid,
+	                               platform,
+	                               source_hash};
 
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
 }
 
+int
+compiled_write_open_dynamic_range(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform, uint64_t offset,
+                                  uint64_t range) {
+	compiled_open_dynamic_range_t msg = {COMPILED_OPEN_DYNAMIC_RANGE,
+	                                     (uint32_t)sizeof(uuid_t) + sizeof(uint64_t) * 3,
+	                                     request,
+	                                     0,
+	                                     uuid,
+	                                     platform,
+	                                     offset,
+	                                     range};
+
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		return 0;
+	return -1;
+}
+
+int
+compiled_write_open_bundle(socket_t* sock, uint32_t request, uuid_t bundle, uint64_t platform, const uuid_t* roots,
+                           size_t count) {
+	if (count > COMPILED_BUNDLE_ROOTS_MAX)
+		return -1;
+
+	size_t roots_size = sizeof(uuid_t) * count;
+	compiled_open_bundle_t msg = {COMPILED_OPEN_BUNDLE,
+	                              (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + roots_size),
+	                              request,
+	                              0,
+	                              bundle,
+	                              platform};
+
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		if (!roots_size || (socket_write(sock, roots, roots_size) == roots_size))
+			return 0;
+	return -1;
+}
+
 int
 compiled_read_open_static_reply(socket_t* sock, size_t size, compiled_open_result_t* result) {
 	if ((size == sizeof(compiled_open_result_t)) && (socket_read(sock, result, size) == size))
@@ -55,9 +107,57 @@ compiled_read_open_dynamic_reply(socket_t* sock, size_t size, compiled_open_resu
 }
 
 int
-compiled_write_open_static_reply(socket_t* sock, bool success, size_t size) {
-	compiled_message_t msg = {COMPILED_OPEN_STATIC_RESULT, (uint32_t)sizeof(compiled_open_result_t)};
-	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, 0, size};
+compiled_read_open_dynamic_range_reply(socket_t* sock, size_t size, compiled_open_result_t* result) {
+	if ((size == sizeof(compiled_open_result_t)) && (socket_read(sock, result, size) == size))
+		return 0;
+	return -1;
+}
+
+int
+compiled_read_open_bundle_reply(socket_t* sock, size_t size, compiled_open_result_t* result) {
+	if ((size == sizeof(compiled_open_result_t)) && (socket_read(sock, result, size) == size))
+		return 0;
+	return -1;
+}
+
+int
+compiled_write_open_static_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size,
+                                 blake3_hash_t source_hash) {
+	compiled_message_t msg = {COMPILED_OPEN_STATIC_RESULT, (uint32_t)sizeof(compiled_open_result_t), request, 0};
+	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, flags, size, source_hash};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
+			return 0;
+	return -1;
+}
+
+int
+compiled_write_open_dynamic_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size,
+                                  blake3_hash_t source_hash) {
+	compiled_message_t msg = {COMPILED_OPEN_DYNAMIC_RESULT, (uint32_t)sizeof(compiled_open_result_t), request, 0};
+	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, flags, size, source_hash};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
+			return 0;
+	return -1;
+}
+
+int
+compiled_write_open_not_modified_reply(socket_t* sock, compiled_message_id id, uint32_t request,
+                                       blake3_hash_t source_hash) {
+	compiled_message_t msg = {id, (uint32_t)sizeof(compiled_open_result_t), request, 0};
+	compiled_open_result_t data = {COMPILED_NOT_MODIFIED, 0, 0, source_hash};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
+			return 0;
+	return -1;
+}
+
+int
+compiled_write_open_dynamic_range_reply(socket_t* sock, uint32_t request, bool success, size_t size) {
+	compiled_message_t msg = {COMPILED_OPEN_DYNAMIC_RANGE_RESULT, (uint32_t)sizeof(compiled_open_result_t), request,
+	                          0};
+	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, 0, size, blake3_hash_null()};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
 			return 0;
@@ -65,9 +165,9 @@ compiled_write_open_static_reply(socket_t* sock, bool success, size_t size) {
 }
 
 int
-compiled_write_open_dynamic_reply(socket_t* sock, bool success, size_t size) {
-	compiled_message_t msg = {COMPILED_OPEN_DYNAMIC_RESULT, (uint32_t)sizeof(compiled_open_result_t)};
-	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, 0, size};
+compiled_write_open_bundle_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size) {
+	compiled_message_t msg = {COMPILED_OPEN_BUNDLE_RESULT, (uint32_t)sizeof(compiled_open_result_t), request, 0};
+	compiled_open_result_t data = {success ? COMPILED_OK : COMPILED_FAILED, flags, size, blake3_hash_null()};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
 			return 0;
@@ -76,8 +176,8 @@ compiled_write_open_dynamic_reply(socket_t* sock, bool success, size_t size) {
 
 int
 compiled_write_notify(socket_t* sock, compiled_message_id id, uuid_t uuid, uint64_t platform, hash_t token) {
-	compiled_notify_t msg = {id, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(uint64_t)), uuid, platform,
-	                         token};
+	compiled_notify_t msg = {
+	    id, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(uint64_t)), 0, 0, uuid, platform, token};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
@@ -92,3 +192,54 @@ compiled_read_notify(socket_t* sock, size_t size, compiled_notify_t* notify) {
 		return 0;
 	return -1;
 }
+
+int
+compiled_write_hello(socket_t* sock, uint32_t request, uint32_t features) {
+	compiled_hello_t msg = {
+	    COMPILED_HELLO, (uint32_t)(sizeof(uint32_t) * 2), request, 0, COMPILED_PROTOCOL_VERSION, features};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		return 0;
+	return -1;
+}
+
+int
+compiled_write_hello_reply(socket_t* sock, uint32_t request, uint32_t features) {
+	compiled_message_t msg = {COMPILED_HELLO_RESULT, (uint32_t)sizeof(compiled_hello_result_t), request, 0};
+	compiled_hello_result_t data = {COMPILED_OK, 0, COMPILED_PROTOCOL_VERSION, features};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		if (socket_write(sock, &data, sizeof(data)) == sizeof(data))
+			return 0;
+	return -1;
+}
+
+int
+compiled_read_hello_reply(socket_t* sock, size_t size, compiled_hello_result_t* result) {
+	if ((size == sizeof(compiled_hello_result_t)) && (socket_read(sock, result, size) == size))
+		return 0;
+	return -1;
+}
+
+int
+compiled_write_open_path(socket_t* sock, const char* path, size_t length) {
+	uint32_t path_length = (uint32_t)length;
+	if (socket_write(sock, &path_length, sizeof(path_length)) == sizeof(path_length))
+		if (socket_write(sock, path, length) == length)
+			return 0;
+	return -1;
+}
+
+int
+compiled_read_open_path(socket_t* sock, char* buffer, size_t capacity) {
+	uint32_t path_length = 0;
+	if (socket_read(sock, &path_length, sizeof(path_length)) != sizeof(path_length))
+		return -1;
+	if (!path_length || (path_length >= capacity)) {
+		log_warnf(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid path length in open reply: %u"),
+		          path_length);
+		return -1;
+	}
+	if (socket_read(sock, buffer, path_length) != path_length)
+		return -1;
+	buffer[path_length] = 0;
+	return 0;
+}
@@ -22,7 +22,7 @@
 #include <foundation/types.h>
 #include <network/types.h>
 
-#define COMPILED_PROTOCOL_VERSION 1
+#define COMPILED_PROTOCOL_VERSION 7
 
 enum compiled_message_id {
 	COMPILED_OPEN_STATIC,
@@ -34,10 +34,39 @@ enum compiled_message_id {
 	COMPILED_NOTIFY_CREATE,
 	COMPILED_NOTIFY_MODIFY,
 	COMPILED_NOTIFY_DEPENDS,
-	COMPILED_NOTIFY_DELETE
+	COMPILED_NOTIFY_DELETE,
+
+	COMPILED_OPEN_DYNAMIC_RANGE,
+	COMPILED_OPEN_DYNAMIC_RANGE_RESULT,
+
+	COMPILED_OPEN_BUNDLE,
+	COMPILED_OPEN_BUNDLE_RESULT,
+
+	COMPILED_HELLO,
+	COMPILED_HELLO_RESULT
 };
 
-enum compiled_result_id { COMPILED_OK = 0, COMPILED_FAILED };
+enum compiled_result_id { COMPILED_OK = 0, COMPILED_FAILED, COMPILED_NOT_MODIFIED };
+
+//! Stream data is in compressed container format
+#define COMPILED_FLAG_COMPRESSED 1
+
+//! Stream data is sent as framed compressed chunks, stream size is the uncompressed size
+#define COMPILED_FLAG_FRAMED 2
+
+//! Stream data is not sent, the reply is followed by the path of the file holding the data, see
+//! compiled_write_open_path. Stream size is the size of the file
+#define COMPILED_FLAG_PATH 4
+
+//! Feature flag negotiated in hello messages, stream data may be sent as framed compressed chunks
+#define COMPILED_FEATURE_COMPRESSION 1
+
+//! Feature flag negotiated in hello messages, client is on the same host and can open files of
+//! the service directly, data held in files may be handed over by path
+#define COMPILED_FEATURE_PATH 2
+
+//! Maximum number of root resources in a bundle request
+#define COMPILED_BUNDLE_ROOTS_MAX 1024
 
 typedef enum compiled_message_id compiled_message_id;
 typedef enum compiled_result_id compiled_result_id;
@@ -45,12 +74,19 @@ typedef enum compiled_result_id compiled_result_id;
 typedef struct compiled_message_t compiled_message_t;
 typedef struct compiled_open_static_t compiled_open_static_t;
 typedef struct compiled_open_dynamic_t compiled_open_dynamic_t;
+typedef struct compiled_open_dynamic_range_t compiled_open_dynamic_range_t;
+typedef struct compiled_open_bundle_t compiled_open_bundle_t;
 typedef struct compiled_open_result_t compiled_open_result_t;
 typedef struct compiled_notify_t compiled_notify_t;
+typedef struct compiled_hello_t compiled_hello_t;
+typedef struct compiled_hello_result_t compiled_hello_result_t;
 
+//! Replies carry the request ID of the message they reply to, notifications have request ID 0
 #define COMPILED_DECLARE_MESSAGE \
 	uint32_t id;                 \
-	uint32_t size
+	uint32_t size;               \
+	uint32_t request;            \
+	uint32_t flags
 
 #define COMPILED_DECLARE_REPLY \
 	uint32_t result;           \
@@ -60,21 +96,43 @@ struct compiled_message_t {
 	COMPILED_DECLARE_MESSAGE;
 };
 
+//! Source hash of the copy held by the client, null if none. If the copy is current the service
+//! replies COMPILED_NOT_MODIFIED without opening the resource or sending any data
 struct compiled_open_static_t {
 	COMPILED_DECLARE_MESSAGE;
 	uuid_t uuid;
 	uint64_t platform;
+	blake3_hash_t source_hash;
 };
 
+//! Source hash of the copy held by the client, see compiled_open_static_t
 struct compiled_open_dynamic_t {
 	COMPILED_DECLARE_MESSAGE;
 	uuid_t uuid;
 	uint64_t platform;
+	blake3_hash_t source_hash;
 };
 
+struct compiled_open_dynamic_range_t {
+	COMPILED_DECLARE_MESSAGE;
+	uuid_t uuid;
+	uint64_t platform;
+	uint64_t offset;
+	uint64_t range;
+};
+
+//! Followed by the root resource UUIDs, up to COMPILED_BUNDLE_ROOTS_MAX
+struct compiled_open_bundle_t {
+	COMPILED_DECLARE_MESSAGE;
+	uuid_t bundle;
+	uint64_t platform;
+};
+
+//! Source hash the compiled data was built from, null hash if not known or not applicable
 struct compiled_open_result_t {
 	COMPILED_DECLARE_REPLY;
 	uint64_t stream_size;
+	blake3_hash_t source_hash;
 };
 
 struct compiled_notify_t {
@@ -84,11 +142,35 @@ struct compiled_notify_t {
 	uint64_t token;
 };
 
+//! Sent by clients on connect, with request ID 0, to negotiate optional features
+struct compiled_hello_t {
+	COMPILED_DECLARE_MESSAGE;
+	uint32_t version;
+	uint32_t features;
+};
+
+//! Features enabled for the connection, the subset of requested features supported by the service
+struct compiled_hello_result_t {
+	COMPILED_DECLARE_REPLY;
+	uint32_t version;
+	uint32_t features;
+};
+
 int
-compiled_write_open_static(socket_t* sock, uuid_t uuid, uint64_t platform);
+compiled_write_open_static(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform,
+                           blake3_hash_t source_hash);
 
 int
-compiled_write_open_dynamic(socket_t* sock, uuid_t uuid, uint64_t platform);
+compiled_write_open_dynamic(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform,
+                            blake3_hash_t source_hash);
+
+int
+compiled_write_open_dynamic_range(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform, uint64_t offset,
+                                  uint64_t range);
+
+int
+compiled_write_open_bundle(socket_t* sock, uint32_t request, uuid_t bundle, uint64_t platform, const uuid_t* roots,
+                           size_t count);
 
 int
 compiled_read_open_static_reply(socket_t* sock, size_t size, compiled_open_result_t* result);
@@ -97,13 +179,47 @@ int
 compiled_read_open_dynamic_reply(socket_t* sock, size_t size, compiled_open_result_t* result);
 
 int
-compiled_write_open_static_reply(socket_t* sock, bool success, size_t size);
+compiled_read_open_dynamic_range_reply(socket_t* sock, size_t size, compiled_open_result_t* result);
+
+int
+compiled_read_open_bundle_reply(socket_t* sock, size_t size, compiled_open_result_t* result);
+
+int
+compiled_write_open_static_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size,
+                                 blake3_hash_t source_hash);
+
+int
+compiled_write_open_dynamic_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size,
+                                  blake3_hash_t source_hash);
+
+//! Write a static or dynamic open reply telling the client its copy is current, id is the result message ID
+int
+compiled_write_open_not_modified_reply(socket_t* sock, compiled_message_id id, uint32_t request,
+                                       blake3_hash_t source_hash);
 
 int
-compiled_write_open_dynamic_reply(socket_t* sock, bool success, size_t size);
+compiled_write_open_dynamic_range_reply(socket_t* sock, uint32_t request, bool success, size_t size);
+
+int
+compiled_write_open_bundle_reply(socket_t* sock, uint32_t request, bool success, uint32_t flags, size_t size);
 
 int
 compiled_write_notify(socket_t* sock, compiled_message_id id, uuid_t uuid, uint64_t platform, hash_t token);
 
 int
 compiled_read_notify(socket_t* sock, size_t size, compiled_notify_t* notify);
+
+int
+compiled_write_hello(socket_t* sock, uint32_t request, uint32_t features);
+
+int
+compiled_write_hello_reply(socket_t* sock, uint32_t request, uint32_t features);
+
+int
+compiled_read_hello_reply(socket_t* sock, size_t size, compiled_hello_result_t* result);
+
+int
+compiled_write_open_path(socket_t* sock, const char* path, size_t length);
+
+int
+compiled_read_open_path(socket_t* sock, char* buffer, size_t capacity);
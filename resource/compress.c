@@ -0,0 +1,697 @@
+/* compress.c  -  Resource library  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform resource I/O library in C11 providing
+ * basic resource loading, saving and streaming functionality for projects based
+ * on our foundation library.
+ *
+ * The latest source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/resource_lib
+ *
+ * The foundation library source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any
+ * restrictions.
+ *
+ */
+
+#include <resource/resource.h>
+#include <resource/internal.h>
+
+#include <foundation/foundation.h>
+
+/* Compressed data is stored as a container of independently compressed chunks
+
+   uint32   magic
+   uint32   chunk size
+   uint64   uncompressed size
+   uint64   offset of chunk index from start of container, 0 if no index
+   chunks   uint32 compressed size, uint32 uncompressed size, data
+   index    uint64 offset of each chunk from start of container
+
+   Chunks with equal compressed and uncompressed size are stored uncompressed.
+   Chunk data is in LZ4 block format. */
+
+#define RESOURCE_COMPRESS_MAGIC 0x5a435352U
+#define RESOURCE_COMPRESS_MIN_MATCH 4
+#define RESOURCE_COMPRESS_LAST_LITERALS 5
+#define RESOURCE_COMPRESS_MATCH_LIMIT 12
+#define RESOURCE_COMPRESS_MAX_OFFSET 65535
+#define RESOURCE_COMPRESS_HASH_BITS 12
+#define RESOURCE_COMPRESS_PREFIX_MAX 64
+
+typedef struct resource_compress_stream_t resource_compress_stream_t;
+typedef struct resource_decompress_stream_t resource_decompress_stream_t;
+
+FOUNDATION_ALIGNED_STRUCT(resource_compress_stream_t, 8) {
+	FOUNDATION_DECLARE_STREAM;
+	stream_t* stream;
+	size_t start;
+	size_t raw_size;
+	size_t position;
+	size_t capacity;
+	uint8_t* data;
+};
+
+FOUNDATION_ALIGNED_STRUCT(resource_decompress_stream_t, 8) {
+	FOUNDATION_DECLARE_STREAM;
+	stream_t* stream;
+	size_t start;
+	size_t raw_size;
+	size_t chunk_size;
+	uint64_t* index;
+	size_t index_count;
+	size_t chunk_next;
+	size_t chunk_offset;
+	size_t chunk_fill;
+	uint8_t* chunk;
+	uint8_t* scratch;
+	size_t position;
+	size_t prefix_size;
+	uint8_t prefix[RESOURCE_COMPRESS_PREFIX_MAX];
+};
+
+static stream_vtable_t resource_compress_stream_vtable;
+static stream_vtable_t resource_decompress_stream_vtable;
+
+static FOUNDATION_FORCEINLINE uint32_t
+resource_compress_read32(const uint8_t* data) {
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static FOUNDATION_FORCEINLINE uint32_t
+resource_compress_hash(uint32_t sequence) {
+	return (sequence * 2654435761U) >> (32 - RESOURCE_COMPRESS_HASH_BITS);
+}
+
+static uint8_t*
+resource_compress_write_length(uint8_t* dst, size_t length) {
+	while (length >= 255) {
+		*dst++ = 255;
+		length -= 255;
+	}
+	*dst++ = (uint8_t)length;
+	return dst;
+}
+
+size_t
+resource_compress_bound(size_t size) {
+	return size + (size / 255) + 16;
+}
+
+size_t
+resource_compress_block(const void* source, size_t size, void* destination, size_t capacity) {
+	uint32_t table[1 << RESOURCE_COMPRESS_HASH_BITS];
+	const uint8_t* src = source;
+	const uint8_t* end = src + size;
+	const uint8_t* ip = src;
+	const uint8_t* anchor = src;
+	uint8_t* dst = destination;
+	uint8_t* dst_end = dst + capacity;
+
+	if (size > 0x7E000000U)
+		return 0;
+
+	memset(table, 0, sizeof(table));
+
+	if (size > RESOURCE_COMPRESS_MATCH_LIMIT) {
+		// Last match must start at least 12 bytes before end, and last 5 bytes are always literals
+		const uint8_t* match_start_limit = end - RESOURCE_COMPRESS_MATCH_LIMIT;
+		const uint8_t* match_end_limit = end - RESOURCE_COMPRESS_LAST_LITERALS;
+		while (ip < match_start_limit) {
+			uint32_t sequence = resource_compress_read32(ip);
+			uint32_t hash = resource_compress_hash(sequence);
+			const uint8_t* ref = src + table[hash];
+			table[hash] = (uint32_t)(ip - src);
+			if ((ref >= ip) || ((size_t)(ip - ref) > RESOURCE_COMPRESS_MAX_OFFSET) ||
+			    (resource_compress_read32(ref) != sequence)) {
+				++ip;
+				continue;
+			}
+
+			const uint8_t* match_end = ip + RESOURCE_COMPRESS_MIN_MATCH;
+			const uint8_t* ref_end = ref + RESOURCE_COMPRESS_MIN_MATCH;
+			while ((match_end < match_end_limit) && (*match_end == *ref_end)) {
+				++match_end;
+				++ref_end;
+			}
+
+			size_t literal_length = (size_t)(ip - anchor);
+			size_t match_length = (size_t)(match_end - ip) - RESOURCE_COMPRESS_MIN_MATCH;
+			size_t required = 1 + (literal_length / 255) + 1 + literal_length + 2 + (match_length / 255) + 1;
+			if ((size_t)(dst_end - dst) < required)
+				return 0;
+
+			uint8_t* token = dst++;
+			*token = (uint8_t)(((literal_length >= 15) ? 15 : literal_length) << 4);
+			if (literal_length >= 15)
+				dst = resource_compress_write_length(dst, literal_length - 15);
+			memcpy(dst, anchor, literal_length);
+			dst += literal_length;
+
+			size_t offset = (size_t)(ip - ref);
+			*dst++ = (uint8_t)(offset & 0xFF);
+			*dst++ = (uint8_t)(offset >> 8);
+
+			*token |= (uint8_t)((match_length >= 15) ? 15 : match_length);
+			if (match_length >= 15)
+				dst = resource_compress_write_length(dst, match_length - 15);
+
+			ip = match_end;
+			anchor = ip;
+		}
+	}
+
+	size_t literal_length = (size_t)(end - anchor);
+	if ((size_t)(dst_end - dst) < (1 + (literal_length / 255) + 1 + literal_length))
+		return 0;
+	*dst++ = (uint8_t)(((literal_length >= 15) ? 15 : literal_length) << 4);
+	if (literal_length >= 15)
+		dst = resource_compress_write_length(dst, literal_length - 15);
+	memcpy(dst, anchor, literal_length);
+	dst += literal_length;
+
+	return (size_t)(dst - (uint8_t*)destination);
+}
+
+size_t
+resource_decompress_block(const void* source, size_t size, void* destination, size_t capacity) {
+	const uint8_t* ip = source;
+	const uint8_t* end = ip + size;
+	uint8_t* op = destination;
+	uint8_t* op_end = op + capacity;
+
+	while (ip < end) {
+		unsigned int token = *ip++;
+		size_t length = token >> 4;
+		if (length == 15) {
+			unsigned int value;
+			do {
+				if (ip >= end)
+					return 0;
+				value = *ip++;
+				length += value;
+			} while (value == 255);
+		}
+		if (((size_t)(end - ip) < length) || ((size_t)(op_end - op) < length))
+			return 0;
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+
+		// Last sequence has no match part
+		if (ip >= end)
+			break;
+
+		if ((end - ip) < 2)
+			return 0;
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		if (!offset || (offset > (size_t)(op - (uint8_t*)destination)))
+			return 0;
+
+		length = token & 15;
+		if (length == 15) {
+			unsigned int value;
+			do {
+				if (ip >= end)
+					return 0;
+				value = *ip++;
+				length += value;
+			} while (value == 255);
+		}
+		length += RESOURCE_COMPRESS_MIN_MATCH;
+		if ((size_t)(op_end - op) < length)
+			return 0;
+
+		const uint8_t* match = op - offset;
+		if (offset >= length) {
+			memcpy(op, match, length);
+			op += length;
+		} else {
+			// Overlapping match, copy byte by byte to replicate pattern
+			while (length--)
+				*op++ = *match++;
+		}
+	}
+
+	return (size_t)(op - (uint8_t*)destination);
+}
+
+size_t
+resource_compress_chunk(const void* source, size_t size, void* destination, size_t capacity) {
+	uint32_t header[2];
+	if ((size > RESOURCE_COMPRESS_CHUNK_SIZE) || (capacity < (size + sizeof(header))))
+		return 0;
+
+	uint8_t* data = pointer_offset(destination, sizeof(header));
+	size_t compressed = resource_compress_block(source, size, data, size);
+	if (!compressed || (compressed >= size)) {
+		compressed = size;
+		memcpy(data, source, size);
+	}
+
+	header[0] = (uint32_t)compressed;
+	header[1] = (uint32_t)size;
+	memcpy(destination, header, sizeof(header));
+	return sizeof(header) + compressed;
+}
+
+static size_t
+resource_compress_stream_write(stream_t* rawstream, const void* buffer, size_t size) {
+	resource_compress_stream_t* stream = (resource_compress_stream_t*)rawstream;
+	if (!size)
+		return 0;
+	size_t end = stream->position + size;
+	if (end > stream->capacity) {
+		size_t capacity = stream->capacity ? stream->capacity : RESOURCE_COMPRESS_CHUNK_SIZE;
+		while (capacity < end)
+			capacity *= 2;
+		uint8_t* data = memory_allocate(HASH_RESOURCE, capacity, 0, MEMORY_PERSISTENT);
+		if (stream->raw_size)
+			memcpy(data, stream->data, stream->raw_size);
+		memory_deallocate(stream->data);
+		stream->data = data;
+		stream->capacity = capacity;
+	}
+	memcpy(stream->data + stream->position, buffer, size);
+	stream->position = end;
+	if (end > stream->raw_size)
+		stream->raw_size = end;
+	return size;
+}
+
+static bool
+resource_compress_stream_eos(stream_t* rawstream) {
+	resource_compress_stream_t* stream = (resource_compress_stream_t*)rawstream;
+	return stream->position >= stream->raw_size;
+}
+
+static size_t
+resource_compress_stream_size(stream_t* stream) {
+	return ((resource_compress_stream_t*)stream)->raw_size;
+}
+
+static size_t
+resource_compress_stream_tell(stream_t* stream) {
+	return ((resource_compress_stream_t*)stream)->position;
+}
+
+static void
+resource_compress_stream_seek(stream_t* rawstream, ssize_t offset, stream_seek_mode_t direction) {
+	resource_compress_stream_t* stream = (resource_compress_stream_t*)rawstream;
+	ssize_t position = offset;
+	if (direction == STREAM_SEEK_CURRENT)
+		position = (ssize_t)stream->position + offset;
+	else if (direction == STREAM_SEEK_END)
+		position = (ssize_t)stream->raw_size + offset;
+	if (position < 0)
+		position = 0;
+	else if ((size_t)position > stream->raw_size)
+		position = (ssize_t)stream->raw_size;
+	stream->position = (size_t)position;
+}
+
+static tick_t
+resource_compress_stream_last_modified(const stream_t* stream) {
+	return stream_last_modified(((const resource_compress_stream_t*)stream)->stream);
+}
+
+static void
+resource_compress_stream_finalize(stream_t* rawstream) {
+	resource_compress_stream_t* stream = (resource_compress_stream_t*)rawstream;
+	if (!stream->stream)
+		return;
+
+	// Data is compressed once complete, as it can be patched by seeking back while written
+	size_t chunks = (stream->raw_size + RESOURCE_COMPRESS_CHUNK_SIZE - 1) / RESOURCE_COMPRESS_CHUNK_SIZE;
+	uint64_t* index = memory_allocate(HASH_RESOURCE, sizeof(uint64_t) * (chunks ? chunks : 1), 0, MEMORY_PERSISTENT);
+	size_t bound = resource_compress_bound(RESOURCE_COMPRESS_CHUNK_SIZE);
+	uint8_t* scratch = memory_allocate(HASH_RESOURCE, bound, 0, MEMORY_PERSISTENT);
+	for (size_t ichunk = 0; ichunk < chunks; ++ichunk) {
+		const uint8_t* chunk = stream->data + (ichunk * RESOURCE_COMPRESS_CHUNK_SIZE);
+		size_t raw = stream->raw_size - (ichunk * RESOURCE_COMPRESS_CHUNK_SIZE);
+		if (raw > RESOURCE_COMPRESS_CHUNK_SIZE)
+			raw = RESOURCE_COMPRESS_CHUNK_SIZE;
+		size_t compressed = resource_compress_block(chunk, raw, scratch, bound);
+		const uint8_t* data = scratch;
+		if (!compressed || (compressed >= raw)) {
+			compressed = raw;
+			data = chunk;
+		}
+
+		index[ichunk] = stream_tell(stream->stream) - stream->start;
+		stream_write_uint32(stream->stream, (uint32_t)compressed);
+		stream_write_uint32(stream->stream, (uint32_t)raw);
+		stream_write(stream->stream, data, compressed);
+	}
+
+	uint64_t index_offset = stream_tell(stream->stream) - stream->start;
+	for (size_t ichunk = 0; ichunk < chunks; ++ichunk)
+		stream_write_uint64(stream->stream, index[ichunk]);
+	size_t end = stream_tell(stream->stream);
+
+	// Patch header with final sizes
+	stream_seek(stream->stream, (ssize_t)(stream->start + sizeof(uint32_t) * 2), STREAM_SEEK_BEGIN);
+	stream_write_uint64(stream->stream, stream->raw_size);
+	stream_write_uint64(stream->stream, index_offset);
+	stream_seek(stream->stream, (ssize_t)end, STREAM_SEEK_BEGIN);
+
+	stream_deallocate(stream->stream);
+	memory_deallocate(index);
+	memory_deallocate(scratch);
+	memory_deallocate(stream->data);
+
+	stream->stream = nullptr;
+	stream->data = nullptr;
+}
+
+static bool
+resource_decompress_stream_load_chunk(resource_decompress_stream_t* stream, size_t chunk) {
+	if (chunk != stream->chunk_next) {
+		if (!stream->index || (chunk >= stream->index_count))
+			return false;
+		stream_seek(stream->stream, (ssize_t)(stream->start + stream->index[chunk]), STREAM_SEEK_BEGIN);
+	}
+
+	uint32_t compressed = stream_read_uint32(stream->stream);
+	uint32_t raw = stream_read_uint32(stream->stream);
+	if (!raw || (raw > stream->chunk_size) || (compressed > resource_compress_bound(stream->chunk_size)))
+		return false;
+
+	if (compressed == raw) {
+		if (stream_read(stream->stream, stream->chunk, raw) != raw)
+			return false;
+	} else {
+		if (stream_read(stream->stream, stream->scratch, compressed) != compressed)
+			return false;
+		if (resource_decompress_block(stream->scratch, compressed, stream->chunk, stream->chunk_size) != raw)
+			return false;
+	}
+
+	stream->chunk_offset = chunk * stream->chunk_size;
+	stream->chunk_fill = raw;
+	stream->chunk_next = chunk + 1;
+	return true;
+}
+
+static size_t
+resource_decompress_stream_read(stream_t* rawstream, void* buffer, size_t size) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	size_t total = stream->prefix_size + stream->raw_size;
+	size_t read = 0;
+
+	if (size > (total - stream->position))
+		size = total - stream->position;
+
+	if (stream->position < stream->prefix_size) {
+		size_t copy = stream->prefix_size - stream->position;
+		if (copy > size)
+			copy = size;
+		memcpy(buffer, stream->prefix + stream->position, copy);
+		stream->position += copy;
+		read += copy;
+	}
+
+	while (read < size) {
+		size_t offset = stream->position - stream->prefix_size;
+		if ((offset < stream->chunk_offset) || (offset >= (stream->chunk_offset + stream->chunk_fill))) {
+			if (!resource_decompress_stream_load_chunk(stream, offset / stream->chunk_size)) {
+				log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Corrupt compressed resource data"));
+				break;
+			}
+		}
+		size_t chunk_position = offset - stream->chunk_offset;
+		size_t copy = stream->chunk_fill - chunk_position;
+		if (copy > (size - read))
+			copy = size - read;
+		memcpy(pointer_offset(buffer, read), stream->chunk + chunk_position, copy);
+		stream->position += copy;
+		read += copy;
+	}
+
+	return read;
+}
+
+static bool
+resource_decompress_stream_eos(stream_t* rawstream) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	return stream->position >= (stream->prefix_size + stream->raw_size);
+}
+
+static size_t
+resource_decompress_stream_size(stream_t* rawstream) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	return stream->prefix_size + stream->raw_size;
+}
+
+static void
+resource_decompress_stream_seek(stream_t* rawstream, ssize_t offset, stream_seek_mode_t direction) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	size_t total = stream->prefix_size + stream->raw_size;
+	ssize_t position = offset;
+	if (direction == STREAM_SEEK_CURRENT)
+		position = (ssize_t)stream->position + offset;
+	else if (direction == STREAM_SEEK_END)
+		position = (ssize_t)total + offset;
+	if (position < 0)
+		position = 0;
+	else if ((size_t)position > total)
+		position = (ssize_t)total;
+
+	if (!stream->index && ((size_t)position < stream->position)) {
+		log_warn(HASH_RESOURCE, WARNING_UNSUPPORTED,
+		         STRING_CONST("Backward seek not supported in sequential decompressing stream"));
+		return;
+	}
+	if (!stream->index) {
+		// Sequential, skip forward by reading
+		char buffer[1024];
+		while (stream->position < (size_t)position) {
+			size_t skip = (size_t)position - stream->position;
+			if (!resource_decompress_stream_read(rawstream, buffer, (skip < sizeof(buffer)) ? skip : sizeof(buffer)))
+				break;
+		}
+		return;
+	}
+	stream->position = (size_t)position;
+}
+
+static size_t
+resource_decompress_stream_tell(stream_t* stream) {
+	return ((resource_decompress_stream_t*)stream)->position;
+}
+
+static tick_t
+resource_decompress_stream_last_modified(const stream_t* stream) {
+	return stream_last_modified(((const resource_decompress_stream_t*)stream)->stream);
+}
+
+static size_t
+resource_decompress_stream_available_read(stream_t* rawstream) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	return (stream->prefix_size + stream->raw_size) - stream->position;
+}
+
+static void
+resource_decompress_stream_finalize(stream_t* rawstream) {
+	resource_decompress_stream_t* stream = (resource_decompress_stream_t*)rawstream;
+	if (stream->stream) {
+		if (stream->stream->sequential) {
+			// Consume any remaining data such as the chunk index to keep sequential sources in sync
+			char buffer[1024];
+			while (!stream_eos(stream->stream) && stream_read(stream->stream, buffer, sizeof(buffer)))
+				;
+		}
+		stream_deallocate(stream->stream);
+	}
+	memory_deallocate(stream->index);
+	memory_deallocate(stream->chunk);
+	memory_deallocate(stream->scratch);
+
+	stream->stream = nullptr;
+	stream->index = nullptr;
+}
+
+int
+resource_compress_initialize(void) {
+	memset(&resource_compress_stream_vtable, 0, sizeof(resource_compress_stream_vtable));
+	resource_compress_stream_vtable.write = resource_compress_stream_write;
+	resource_compress_stream_vtable.eos = resource_compress_stream_eos;
+	resource_compress_stream_vtable.size = resource_compress_stream_size;
+	resource_compress_stream_vtable.seek = resource_compress_stream_seek;
+	resource_compress_stream_vtable.tell = resource_compress_stream_tell;
+	resource_compress_stream_vtable.lastmod = resource_compress_stream_last_modified;
+	resource_compress_stream_vtable.finalize = resource_compress_stream_finalize;
+
+	memset(&resource_decompress_stream_vtable, 0, sizeof(resource_decompress_stream_vtable));
+	resource_decompress_stream_vtable.read = resource_decompress_stream_read;
+	resource_decompress_stream_vtable.eos = resource_decompress_stream_eos;
+	resource_decompress_stream_vtable.size = resource_decompress_stream_size;
+	resource_decompress_stream_vtable.seek = resource_decompress_stream_seek;
+	resource_decompress_stream_vtable.tell = resource_decompress_stream_tell;
+	resource_decompress_stream_vtable.lastmod = resource_decompress_stream_last_modified;
+	resource_decompress_stream_vtable.available_read = resource_decompress_stream_available_read;
+	resource_decompress_stream_vtable.finalize = resource_decompress_stream_finalize;
+
+	return 0;
+}
+
+void
+resource_compress_finalize(void) {
+}
+
+stream_t*
+resource_compress_stream_allocate(stream_t* source) {
+	resource_compress_stream_t* stream = memory_allocate(HASH_RESOURCE, sizeof(resource_compress_stream_t), 8,
+	                                                     MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	stream_initialize((stream_t*)stream, source->byteorder);
+
+	stream->type = STREAMTYPE_CUSTOM;
+	stream->mode = STREAM_OUT | STREAM_BINARY;
+	stream->vtable = &resource_compress_stream_vtable;
+	stream->path = string_clone(STRING_ARGS(source->path));
+	stream->stream = source;
+	stream->start = stream_tell(source);
+
+	stream_write_uint32(source, RESOURCE_COMPRESS_MAGIC);
+	stream_write_uint32(source, RESOURCE_COMPRESS_CHUNK_SIZE);
+	stream_write_uint64(source, 0);
+	stream_write_uint64(source, 0);
+
+	return (stream_t*)stream;
+}
+
+stream_t*
+resource_decompress_stream_allocate(stream_t* source, const void* prefix, size_t prefix_size) {
+	if (prefix_size > RESOURCE_COMPRESS_PREFIX_MAX)
+		return nullptr;
+
+	size_t start = source->sequential ? 0 : stream_tell(source);
+	uint32_t magic = stream_read_uint32(source);
+	uint32_t chunk_size = stream_read_uint32(source);
+	uint64_t raw_size = stream_read_uint64(source);
+	uint64_t index_offset = stream_read_uint64(source);
+	if ((magic != RESOURCE_COMPRESS_MAGIC) || !chunk_size || (chunk_size > RESOURCE_COMPRESS_CHUNK_SIZE))
+		return nullptr;
+
+	uint64_t* index = nullptr;
+	size_t chunks = 0;
+	if (!source->sequential && index_offset) {
+		// Load chunk index for random access. Header values are untrusted, the index must fit
+		// within the source and each chunk must start between the header and the index
+		size_t data_start = stream_tell(source);
+		size_t header_size = data_start - start;
+		size_t source_size = stream_size(source);
+		size_t available = (source_size > start) ? (source_size - start) : 0;
+		chunks = (size_t)((raw_size / chunk_size) + ((raw_size % chunk_size) ? 1 : 0));
+		if ((index_offset < header_size) || (index_offset > available) ||
+		    (chunks > ((available - index_offset) / sizeof(uint64_t)))) {
+			log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid compressed resource header"));
+			return nullptr;
+		}
+		index = memory_allocate(HASH_RESOURCE, sizeof(uint64_t) * (chunks ? chunks : 1), 0, MEMORY_PERSISTENT);
+		stream_seek(source, (ssize_t)(start + index_offset), STREAM_SEEK_BEGIN);
+		for (size_t ichunk = 0; ichunk < chunks; ++ichunk) {
+			index[ichunk] = stream_read_uint64(source);
+			if ((index[ichunk] < header_size) || (index[ichunk] >= index_offset)) {
+				log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid compressed resource index"));
+				memory_deallocate(index);
+				return nullptr;
+			}
+		}
+		stream_seek(source, (ssize_t)data_start, STREAM_SEEK_BEGIN);
+	}
+
+	resource_decompress_stream_t* stream = memory_allocate(HASH_RESOURCE, sizeof(resource_decompress_stream_t), 8,
+	                                                       MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	stream_initialize((stream_t*)stream, source->byteorder);
+
+	stream->type = STREAMTYPE_CUSTOM;
+	stream->mode = STREAM_IN | STREAM_BINARY;
+	stream->vtable = &resource_decompress_stream_vtable;
+	stream->path = string_clone(STRING_ARGS(source->path));
+	stream->stream = source;
+	stream->start = start;
+	stream->raw_size = (size_t)raw_size;
+	stream->chunk_size = chunk_size;
+	stream->chunk = memory_allocate(HASH_RESOURCE, chunk_size, 0, MEMORY_PERSISTENT);
+	stream->scratch = memory_allocate(HASH_RESOURCE, resource_compress_bound(chunk_size), 0, MEMORY_PERSISTENT);
+	stream->prefix_size = prefix_size;
+	if (prefix_size)
+		memcpy(stream->prefix, prefix, prefix_size);
+
+	stream->index = index;
+	stream->index_count = chunks;
+	stream->sequential = (stream->index == nullptr);
+
+	return (stream_t*)stream;
+}
+
+stream_t*
+resource_decompress_stream_detach(stream_t* stream, bool* compressed) {
+	if (!stream || (stream->vtable != &resource_decompress_stream_vtable) || stream->sequential) {
+		*compressed = false;
+		return stream;
+	}
+	resource_decompress_stream_t* decompress = (resource_decompress_stream_t*)stream;
+	stream_t* source = decompress->stream;
+	stream_seek(source, 0, STREAM_SEEK_BEGIN);
+	decompress->stream = nullptr;
+	stream_deallocate(stream);
+	*compressed = true;
+	return source;
+}
+
+stream_t*
+resource_decompress_static(stream_t* stream) {
+	uint8_t prefix[RESOURCE_COMPRESS_PREFIX_MAX];
+
+	resource_header_t header = resource_stream_read_header(stream);
+	if (!(header.flags & RESOURCE_HEADERFLAG_COMPRESSED) && !stream->sequential) {
+		stream_seek(stream, 0, STREAM_SEEK_BEGIN);
+		return stream;
+	}
+
+	// Present the header without the compressed flag, data read from the stream is decompressed
+	header.flags &= ~(uint32_t)RESOURCE_HEADERFLAG_COMPRESSED;
+	stream_t* prefix_stream =
+	    buffer_stream_allocate(prefix, STREAM_OUT | STREAM_BINARY, 0, sizeof(prefix), false, false);
+	stream_set_byteorder(prefix_stream, stream->byteorder);
+	resource_stream_write_header(prefix_stream, header);
+	size_t prefix_size = stream_tell(prefix_stream);
+	stream_deallocate(prefix_stream);
+
+	stream_t* decompress = resource_decompress_stream_allocate(stream, prefix, prefix_size);
+	if (decompress)
+		return decompress;
+
+	if (!stream->sequential) {
+		stream_seek(stream, 0, STREAM_SEEK_BEGIN);
+		return stream;
+	}
+
+	log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid compressed resource data"));
+	stream_deallocate(stream);
+	return nullptr;
+}
+
+stream_t*
+resource_decompress_dynamic(stream_t* stream, bool compressed) {
+	if (!compressed)
+		return stream;
+
+	stream_t* decompress = resource_decompress_stream_allocate(stream, nullptr, 0);
+	if (decompress)
+		return decompress;
+
+	log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid compressed resource data"));
+	stream_deallocate(stream);
+	return nullptr;
+}
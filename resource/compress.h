@@ -0,0 +1,109 @@
+/* compress.h  -  Resource library  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform resource I/O library in C11 providing
+ * basic resource loading, saving and streaming functionality for projects based
+ * on our foundation library.
+ *
+ * The latest source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/resource_lib
+ *
+ * The foundation library source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any
+ * restrictions.
+ *
+ */
+
+#pragma once
+
+#include <foundation/platform.h>
+
+#include <resource/types.h>
+
+/*! Get the worst case size of compressed data
+\param size Size of uncompressed data
+\return Maximum size of compressed data */
+RESOURCE_API size_t
+resource_compress_bound(size_t size);
+
+/*! Compress a block of data, output is in LZ4 block format
+\param source Uncompressed data
+\param size Size of uncompressed data
+\param destination Destination buffer
+\param capacity Capacity of destination buffer
+\return Size of compressed data, 0 if destination buffer was too small */
+RESOURCE_API size_t
+resource_compress_block(const void* source, size_t size, void* destination, size_t capacity);
+
+/*! Decompress a block of data in LZ4 block format
+\param source Compressed data
+\param size Size of compressed data
+\param destination Destination buffer
+\param capacity Capacity of destination buffer
+\return Size of decompressed data, 0 if data was malformed or destination buffer too small */
+RESOURCE_API size_t
+resource_decompress_block(const void* source, size_t size, void* destination, size_t capacity);
+
+/*! Compress a chunk of data into framed format, a uint32 compressed size and a uint32
+uncompressed size followed by the data, the same format as chunks in compressed streams.
+Data which does not compress is stored as is, with equal sizes in the frame header
+\param source Uncompressed data, at most RESOURCE_COMPRESS_CHUNK_SIZE bytes
+\param size Size of uncompressed data
+\param destination Destination buffer, at least size + 8 bytes
+\param capacity Capacity of destination buffer
+\return Size of framed chunk, 0 if source is too large or destination buffer too small */
+RESOURCE_API size_t
+resource_compress_chunk(const void* source, size_t size, void* destination, size_t capacity);
+
+/*! Allocate a stream compressing all written data in chunks and writing the result to the
+given stream at its current position. Compressing streams are write-only. Written data is held
+in memory and compressed when the stream is deallocated, so seeking back to patch data already
+written is supported. The given stream is owned by the compressing stream and deallocated with it
+\param stream Destination stream
+\return Compressing stream */
+RESOURCE_API stream_t*
+resource_compress_stream_allocate(stream_t* stream);
+
+/*! Allocate a stream decompressing chunked data read from the given stream at its current
+position. The optional prefix is presented before the decompressed data. Random access is
+supported if the given stream is seekable. The given stream is owned by the decompressing
+stream and deallocated with it
+\param stream Source stream
+\param prefix Prefix data
+\param prefix_size Size of prefix data
+\return Decompressing stream, null if the stream does not hold compressed data (in which case
+        the given stream is not deallocated) */
+RESOURCE_API stream_t*
+resource_decompress_stream_allocate(stream_t* stream, const void* prefix, size_t prefix_size);
+
+/*! Detach the compressed source stream from a decompressing stream, rewinding it to the
+start of the source data and deallocating the decompressing stream. Streams which are not
+decompressing streams are returned as is
+\param stream Stream
+\param compressed Set to true if the returned stream holds compressed data
+\return Source stream */
+RESOURCE_API stream_t*
+resource_decompress_stream_detach(stream_t* stream, bool* compressed);
+
+/*! Wrap a stream of the static part of a compiled resource, positioned at the resource
+header, in a decompressing stream if the header flags the data as compressed. The header
+presented by the decompressing stream has the compressed flag cleared. If not compressed
+the stream is rewound and returned as is. Sequential streams must be known to hold
+compressed data
+\param stream Stream
+\return Stream to read resource data from, null if failed */
+RESOURCE_API stream_t*
+resource_decompress_static(stream_t* stream);
+
+/*! Wrap a stream of the dynamic part of a compiled resource in a decompressing stream if
+it holds compressed data, otherwise return the stream as is. Dynamic data has no header, the
+compression is recorded where the data is stored (a .blobz suffix for local files, a flag
+in remote replies). The stream is deallocated if it does not hold valid compressed data
+\param stream Stream
+\param compressed Flag indicating the stream holds compressed data
+\return Stream to read resource data from, null if failed */
+RESOURCE_API stream_t*
+resource_decompress_dynamic(stream_t* stream, bool compressed);
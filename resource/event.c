@@ -49,6 +49,8 @@ resource_event_token(const event_t* event) {
 void
 resource_event_post(resource_event_id id, uuid_t uuid, uint64_t platform, hash_t token) {
 	resource_event_payload_t payload = {uuid, platform, token};
+	// Prefetched data of the resource is stale once the resource changes
+	resource_stream_invalidate(uuid);
 	event_post(resource_event_stream_current, (int)id, 0, 0, &payload, sizeof(payload));
 }
 
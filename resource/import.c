@@ -369,7 +369,7 @@ resource_import_map_lookup(const char* path, size_t length) {
 
 resource_signature_t
 resource_import_lookup(const char* path, size_t length) {
-	if (resource_remote_sourced_is_connected()) {
+	if (resource_remote_sourced_is_available()) {
 		string_const_t base_path = resource_import_base_path();
 		string_const_t subpath = string_null();
 		if (path_is_absolute(path, length) && base_path.length)
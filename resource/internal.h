@@ -40,6 +40,39 @@ resource_autoimport_initialize(void);
 RESOURCE_API void
 resource_autoimport_finalize(void);
 
+RESOURCE_API int
+resource_compress_initialize(void);
+
+RESOURCE_API void
+resource_compress_finalize(void);
+
+RESOURCE_API int
+resource_local_initialize(void);
+
+RESOURCE_API void
+resource_local_finalize(void);
+
+RESOURCE_API bool
+resource_local_stream_compressible(stream_t* stream);
+
+RESOURCE_API void
+resource_local_stream_compress(stream_t* stream);
+
+RESOURCE_API int
+resource_stream_initialize(void);
+
+RESOURCE_API void
+resource_stream_finalize(void);
+
+RESOURCE_API void
+resource_stream_invalidate(const uuid_t res);
+
+RESOURCE_API int
+resource_bundle_initialize(void);
+
+RESOURCE_API void
+resource_bundle_finalize(void);
+
 RESOURCE_API int
 resource_compile_initialize(void);
 
@@ -21,9 +21,48 @@
 
 #include <foundation/foundation.h>
 
+#include <stdlib.h>
+
 #if RESOURCE_ENABLE_LOCAL_CACHE
 
+#if FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_ANDROID || FOUNDATION_PLATFORM_MACOS || \
+    FOUNDATION_PLATFORM_IOS
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#define RESOURCE_MANIFEST_MAGIC 0x4e414d52U
+#define RESOURCE_MANIFEST_VERSION 2
+
+#define RESOURCE_MANIFEST_STATIC 1
+#define RESOURCE_MANIFEST_DYNAMIC 2
+//! Dynamic data is compressed, stored with a .blobz suffix
+#define RESOURCE_MANIFEST_DYNAMIC_COMPRESSED 4
+
+typedef struct resource_local_manifest_entry_t resource_local_manifest_entry_t;
+typedef struct resource_local_manifest_file_t resource_local_manifest_file_t;
+
+struct resource_local_manifest_entry_t {
+	uuid_t uuid;
+	uint64_t platform;
+	uint64_t static_platform;
+	uint64_t dynamic_platform;
+	uint32_t flags;
+};
+
+struct resource_local_manifest_file_t {
+	uuid_t uuid;
+	uint64_t platform;
+	bool dynamic;
+	bool compressed;
+};
+
 static string_t* resource_paths_local = 0;
+static resource_local_manifest_entry_t* resource_local_manifest;
+static size_t resource_local_manifest_capacity;
+static string_t resource_local_manifest_base;
 
 const string_const_t*
 resource_local_paths(void) {
@@ -49,6 +88,16 @@ resource_local_add_path(const char* path, size_t length) {
 	pathstr = path_absolute(STRING_ARGS(pathstr), sizeof(pathbuf));
 	pathstr = string_clone(STRING_ARGS(pathstr));
 	array_push(resource_paths_local, pathstr);
+
+#if BUILD_DEPLOY
+	// Deploy builds pick up the manifest of the first local path providing one
+	if (!resource_local_manifest) {
+		string_t manifest_path = path_concat(pathbuf, sizeof(pathbuf), STRING_ARGS(pathstr),
+		                                     STRING_CONST(RESOURCE_LOCAL_MANIFEST));
+		if (fs_is_file(STRING_ARGS(manifest_path)))
+			resource_local_manifest_load(STRING_ARGS(manifest_path));
+	}
+#endif
 }
 
 void
@@ -125,20 +174,445 @@ resource_local_open_stream(const uuid_t uuid, uint64_t platform, const char* suf
 	return stream;
 }
 
+static string_t
+resource_local_find_path(char* buffer, size_t capacity, const uuid_t uuid, uint64_t platform, const char* suffix,
+                         size_t suffix_length) {
+	size_t ipath, pathsize;
+	uint64_t full_platform = platform;
+	while (true) {
+		for (ipath = 0, pathsize = array_size(resource_paths_local); ipath < pathsize; ++ipath) {
+			string_t platformpath =
+			    resource_local_make_platform_path(buffer, capacity, ipath, uuid, platform, suffix, suffix_length);
+			if (fs_is_file(STRING_ARGS(platformpath)))
+				return platformpath;
+		}
+		if (!platform)
+			break;
+		platform = resource_platform_reduce(platform, full_platform);
+	}
+	return string(0, 0);
+}
+
+/*! Find the dynamic data file on the most specified platform level. Compressed data is stored
+with a .blobz suffix and uncompressed data with a .blob suffix. If both exist, which happens
+briefly while a resource is republished with another compression setting, the newest is used
+\param buffer Path buffer
+\param capacity Capacity of path buffer
+\param uuid Resource UUID
+\param platform Platform
+\param compressed Set to true if the data is compressed
+\return Path, empty if not found */
+static string_t
+resource_local_find_dynamic_path(char* buffer, size_t capacity, const uuid_t uuid, uint64_t platform,
+                                 bool* compressed) {
+	char altbuffer[BUILD_MAX_PATHLEN];
+	size_t ipath, pathsize;
+	uint64_t full_platform = platform;
+	while (true) {
+		for (ipath = 0, pathsize = array_size(resource_paths_local); ipath < pathsize; ++ipath) {
+			string_t platformpath =
+			    resource_local_make_platform_path(buffer, capacity, ipath, uuid, platform, STRING_CONST(".blob"));
+			string_t altpath = string_copy(altbuffer, sizeof(altbuffer), STRING_ARGS(platformpath));
+			altpath = string_append(STRING_ARGS(altpath), sizeof(altbuffer), STRING_CONST("z"));
+			bool has_raw = fs_is_file(STRING_ARGS(platformpath));
+			bool has_compressed = fs_is_file(STRING_ARGS(altpath));
+			if (has_raw && has_compressed)
+				has_raw = (fs_last_modified(STRING_ARGS(platformpath)) > fs_last_modified(STRING_ARGS(altpath)));
+			if (has_raw) {
+				*compressed = false;
+				return platformpath;
+			}
+			if (has_compressed) {
+				*compressed = true;
+				return string_copy(buffer, capacity, STRING_ARGS(altpath));
+			}
+		}
+		if (!platform)
+			break;
+		platform = resource_platform_reduce(platform, full_platform);
+	}
+	return string(0, 0);
+}
+
+static void
+resource_local_readahead(const char* path, size_t length) {
+#if FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_ANDROID || FOUNDATION_PLATFORM_MACOS || \
+    FOUNDATION_PLATFORM_IOS
+	char buffer[BUILD_MAX_PATHLEN];
+	string_t pathstr = string_copy(buffer, sizeof(buffer), path, length);
+	int fd = open(pathstr.str, O_RDONLY);
+	if (fd < 0)
+		return;
+#if FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_ANDROID
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#else
+	struct stat st;
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+		struct radvisory advisory;
+		advisory.ra_offset = 0;
+		advisory.ra_count = (st.st_size < INT_MAX) ? (int)st.st_size : INT_MAX;
+		fcntl(fd, F_RDADVISE, &advisory);
+	}
+#endif
+	close(fd);
+#else
+	FOUNDATION_UNUSED(path);
+	FOUNDATION_UNUSED(length);
+#endif
+}
+
 stream_t*
 resource_local_open_static(const uuid_t uuid, uint64_t platform) {
-	return resource_local_open_stream(uuid, platform, 0, 0, STREAM_IN | STREAM_BINARY);
+	stream_t* stream = resource_local_open_stream(uuid, platform, 0, 0, STREAM_IN | STREAM_BINARY);
+	return stream ? resource_decompress_static(stream) : nullptr;
 }
 
 stream_t*
 resource_local_open_dynamic(const uuid_t uuid, uint64_t platform) {
-	return resource_local_open_stream(uuid, platform, STRING_CONST(".blob"), STREAM_IN | STREAM_BINARY);
+	char buffer[BUILD_MAX_PATHLEN];
+	bool compressed = false;
+
+	if (!resource_module_config().enable_local_cache)
+		return nullptr;
+
+	string_t path = resource_local_find_dynamic_path(buffer, sizeof(buffer), uuid, platform, &compressed);
+	if (!path.length)
+		return nullptr;
+	stream_t* stream = stream_open(STRING_ARGS(path), STREAM_IN | STREAM_BINARY);
+	return stream ? resource_decompress_dynamic(stream, compressed) : nullptr;
+}
+
+static size_t
+resource_local_manifest_slot(const uuid_t uuid, uint64_t platform) {
+	uint64_t key[3];
+	memcpy(key, &uuid, sizeof(uuid_t));
+	key[2] = platform;
+	return (size_t)hash(key, sizeof(key)) & (resource_local_manifest_capacity - 1);
+}
+
+static resource_local_manifest_entry_t*
+resource_local_manifest_lookup(const uuid_t uuid, uint64_t platform) {
+	if (!resource_local_manifest)
+		return nullptr;
+	size_t slot = resource_local_manifest_slot(uuid, platform);
+	while (resource_local_manifest[slot].flags) {
+		resource_local_manifest_entry_t* entry = resource_local_manifest + slot;
+		if (uuid_equal(entry->uuid, uuid) && (entry->platform == platform))
+			return entry;
+		slot = (slot + 1) & (resource_local_manifest_capacity - 1);
+	}
+	return nullptr;
+}
+
+static void
+resource_local_manifest_insert(const resource_local_manifest_entry_t* entry) {
+	size_t slot = resource_local_manifest_slot(entry->uuid, entry->platform);
+	while (resource_local_manifest[slot].flags) {
+		if (uuid_equal(resource_local_manifest[slot].uuid, entry->uuid) &&
+		    (resource_local_manifest[slot].platform == entry->platform))
+			break;
+		slot = (slot + 1) & (resource_local_manifest_capacity - 1);
+	}
+	resource_local_manifest[slot] = *entry;
+}
+
+bool
+resource_local_manifest_load(const char* path, size_t length) {
+	stream_t* stream = stream_open(path, length, STREAM_IN | STREAM_BINARY);
+	if (!stream)
+		return false;
+
+	uint32_t magic = stream_read_uint32(stream);
+	uint32_t version = stream_read_uint32(stream);
+	uint64_t count = stream_read_uint64(stream);
+	if ((magic != RESOURCE_MANIFEST_MAGIC) || (version != RESOURCE_MANIFEST_VERSION) ||
+	    (count > (stream_size(stream) / (sizeof(uuid_t) + sizeof(uint64_t) * 3 + sizeof(uint32_t))))) {
+		log_warnf(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid resource manifest: %.*s"),
+		          (int)length, path);
+		stream_deallocate(stream);
+		return false;
+	}
+
+	resource_local_manifest_unload();
+
+	// Keep load factor at or below one half to bound probe lengths
+	resource_local_manifest_capacity = 16;
+	while (resource_local_manifest_capacity < (count * 2))
+		resource_local_manifest_capacity <<= 1;
+	resource_local_manifest =
+	    memory_allocate(HASH_RESOURCE, sizeof(resource_local_manifest_entry_t) * resource_local_manifest_capacity, 0,
+	                    MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	for (uint64_t ientry = 0; ientry < count; ++ientry) {
+		resource_local_manifest_entry_t entry;
+		stream_read(stream, &entry.uuid, sizeof(uuid_t));
+		entry.platform = stream_read_uint64(stream);
+		entry.static_platform = stream_read_uint64(stream);
+		entry.dynamic_platform = stream_read_uint64(stream);
+		entry.flags = stream_read_uint32(stream);
+		if (entry.flags)
+			resource_local_manifest_insert(&entry);
+	}
+	stream_deallocate(stream);
+
+	string_const_t base = path_directory_name(path, length);
+	resource_local_manifest_base = string_clone(STRING_ARGS(base));
+
+	log_infof(HASH_RESOURCE, STRING_CONST("Loaded resource manifest with %" PRIu64 " entries: %.*s"), count,
+	          (int)length, path);
+	return true;
+}
+
+void
+resource_local_manifest_unload(void) {
+	memory_deallocate(resource_local_manifest);
+	string_deallocate(resource_local_manifest_base.str);
+	resource_local_manifest = nullptr;
+	resource_local_manifest_capacity = 0;
+	resource_local_manifest_base = string(0, 0);
+}
+
+bool
+resource_local_manifest_is_loaded(void) {
+	return resource_local_manifest != nullptr;
+}
+
+static bool
+resource_local_manifest_parse_file(const string_t file, resource_local_manifest_file_t* parsed) {
+	// Files are stored as xx/yy/<uuid>/<platform>[.blob|.blobz], skipping temporary and unrelated files
+	string_const_t name = path_file_name(STRING_ARGS(file));
+	string_const_t dir = path_directory_name(STRING_ARGS(file));
+	string_const_t uuidstr = path_file_name(STRING_ARGS(dir));
+	parsed->dynamic = false;
+	parsed->compressed = false;
+	if (string_ends_with(STRING_ARGS(name), STRING_CONST(".blob"))) {
+		parsed->dynamic = true;
+		name.length -= 5;
+	} else if (string_ends_with(STRING_ARGS(name), STRING_CONST(".blobz"))) {
+		parsed->dynamic = true;
+		parsed->compressed = true;
+		name.length -= 6;
+	}
+	if (!name.length || (name.length > 16))
+		return false;
+	if (string_find_first_not_of(STRING_ARGS(name), STRING_CONST("0123456789abcdefABCDEF"), 0) != STRING_NPOS)
+		return false;
+	parsed->uuid = string_to_uuid(STRING_ARGS(uuidstr));
+	parsed->platform = string_to_uint64(STRING_ARGS(name), true);
+	return !uuid_is_null(parsed->uuid);
+}
+
+static int
+resource_local_manifest_file_compare(const void* lhs, const void* rhs) {
+	const resource_local_manifest_file_t* first = lhs;
+	const resource_local_manifest_file_t* second = rhs;
+	if (first->uuid.word[0] != second->uuid.word[0])
+		return (first->uuid.word[0] < second->uuid.word[0]) ? -1 : 1;
+	if (first->uuid.word[1] != second->uuid.word[1])
+		return (first->uuid.word[1] < second->uuid.word[1]) ? -1 : 1;
+	if (first->platform != second->platform)
+		return (first->platform < second->platform) ? -1 : 1;
+	if (first->dynamic != second->dynamic)
+		return first->dynamic ? 1 : -1;
+	return 0;
+}
+
+static int
+resource_local_manifest_platform_compare(const void* lhs, const void* rhs) {
+	uint64_t first = *(const uint64_t*)lhs;
+	uint64_t second = *(const uint64_t*)rhs;
+	return (first < second) ? -1 : ((first > second) ? 1 : 0);
+}
+
+//! Find a file in the array of files sorted by resource_local_manifest_file_compare
+static const resource_local_manifest_file_t*
+resource_local_manifest_find_file(const resource_local_manifest_file_t* files, const uuid_t uuid, uint64_t platform,
+                                  bool dynamic) {
+	resource_local_manifest_file_t key;
+	memset(&key, 0, sizeof(key));
+	key.uuid = uuid;
+	key.platform = platform;
+	key.dynamic = dynamic;
+	return bsearch(&key, files, array_size(files), sizeof(resource_local_manifest_file_t),
+	               resource_local_manifest_file_compare);
+}
+
+static const resource_local_manifest_file_t*
+resource_local_manifest_resolve(const resource_local_manifest_file_t* files, const uuid_t uuid, uint64_t platform,
+                                bool dynamic, uint64_t* resolved) {
+	uint64_t full_platform = platform;
+	while (true) {
+		const resource_local_manifest_file_t* file =
+		    resource_local_manifest_find_file(files, uuid, platform, dynamic);
+		if (file) {
+			*resolved = platform;
+			return file;
+		}
+		if (!platform)
+			break;
+		platform = resource_platform_reduce(platform, full_platform);
+	}
+	return nullptr;
+}
+
+bool
+resource_local_manifest_write(const char* path, size_t length, const uint64_t* platforms, size_t platforms_count) {
+	char buffer[BUILD_MAX_PATHLEN];
+	resource_local_manifest_file_t* files = nullptr;
+	uint64_t* keys = nullptr;
+	uuid_t* uuids = nullptr;
+
+	string_t* found = fs_matching_files(path, length, STRING_CONST("^.*$"), true);
+	for (size_t ifile = 0, fsize = array_size(found); ifile < fsize; ++ifile) {
+		resource_local_manifest_file_t file;
+		if (resource_local_manifest_parse_file(found[ifile], &file))
+			array_push(files, file);
+	}
+	string_array_deallocate(found);
+
+	// Files are sorted once so that lookups are binary searches and resources are grouped by UUID
+	size_t files_count = array_size(files);
+	if (files_count)
+		qsort(files, files_count, sizeof(resource_local_manifest_file_t), resource_local_manifest_file_compare);
+	for (size_t ifile = 0; ifile < files_count; ++ifile) {
+		if (!ifile || !uuid_equal(files[ifile - 1].uuid, files[ifile].uuid))
+			array_push(uuids, files[ifile].uuid);
+		array_push(keys, files[ifile].platform);
+	}
+
+	// Answer opens for the requested platforms as well as the exact platforms stored
+	for (size_t iplat = 0; iplat < platforms_count; ++iplat)
+		array_push(keys, platforms[iplat]);
+	size_t keys_count = array_size(keys);
+	if (keys_count)
+		qsort(keys, keys_count, sizeof(uint64_t), resource_local_manifest_platform_compare);
+	size_t unique = 0;
+	for (size_t ikey = 0; ikey < keys_count; ++ikey) {
+		if (!unique || (keys[unique - 1] != keys[ikey]))
+			keys[unique++] = keys[ikey];
+	}
+	if (keys)
+		array_resize(keys, unique);
+
+	resource_local_manifest_entry_t* entries = nullptr;
+	for (size_t iuuid = 0, usize = array_size(uuids); iuuid < usize; ++iuuid) {
+		for (size_t ikey = 0, ksize = array_size(keys); ikey < ksize; ++ikey) {
+			resource_local_manifest_entry_t entry;
+			memset(&entry, 0, sizeof(entry));
+			entry.uuid = uuids[iuuid];
+			entry.platform = keys[ikey];
+			if (resource_local_manifest_resolve(files, entry.uuid, entry.platform, false, &entry.static_platform))
+				entry.flags |= RESOURCE_MANIFEST_STATIC;
+			const resource_local_manifest_file_t* dynamic_file =
+			    resource_local_manifest_resolve(files, entry.uuid, entry.platform, true, &entry.dynamic_platform);
+			if (dynamic_file)
+				entry.flags |= RESOURCE_MANIFEST_DYNAMIC |
+				               (dynamic_file->compressed ? RESOURCE_MANIFEST_DYNAMIC_COMPRESSED : 0);
+			if (entry.flags)
+				array_push(entries, entry);
+		}
+	}
+
+	// Write to a temporary file and rename it into place, so a manifest being loaded is never partial
+	bool success = false;
+	char tempbuffer[BUILD_MAX_PATHLEN];
+	string_t manifest_path = path_concat(buffer, sizeof(buffer), path, length, STRING_CONST(RESOURCE_LOCAL_MANIFEST));
+	string_const_t tempsuffix = string_from_uint_static(random64(), true, 0, 0);
+	string_t temp_path = string_format(tempbuffer, sizeof(tempbuffer), STRING_CONST("%.*s.%.*s.tmp"),
+	                                   STRING_FORMAT(manifest_path), STRING_FORMAT(tempsuffix));
+	stream_t* stream =
+	    stream_open(STRING_ARGS(temp_path), STREAM_OUT | STREAM_CREATE | STREAM_TRUNCATE | STREAM_BINARY);
+	if (stream) {
+		stream_write_uint32(stream, RESOURCE_MANIFEST_MAGIC);
+		stream_write_uint32(stream, RESOURCE_MANIFEST_VERSION);
+		stream_write_uint64(stream, array_size(entries));
+		for (size_t ientry = 0, esize = array_size(entries); ientry < esize; ++ientry) {
+			stream_write(stream, &entries[ientry].uuid, sizeof(uuid_t));
+			stream_write_uint64(stream, entries[ientry].platform);
+			stream_write_uint64(stream, entries[ientry].static_platform);
+			stream_write_uint64(stream, entries[ientry].dynamic_platform);
+			stream_write_uint32(stream, entries[ientry].flags);
+		}
+		stream_deallocate(stream);
+		success = fs_move_file(STRING_ARGS(temp_path), STRING_ARGS(manifest_path));
+		if (success) {
+			log_infof(HASH_RESOURCE, STRING_CONST("Wrote resource manifest with %" PRIsize " entries: %.*s"),
+			          array_size(entries), STRING_FORMAT(manifest_path));
+		} else {
+			log_warnf(HASH_RESOURCE, WARNING_SUSPICIOUS, STRING_CONST("Unable to replace resource manifest: %.*s"),
+			          STRING_FORMAT(manifest_path));
+			fs_remove_file(STRING_ARGS(temp_path));
+		}
+	} else {
+		log_warnf(HASH_RESOURCE, WARNING_SUSPICIOUS, STRING_CONST("Unable to write resource manifest: %.*s"),
+		          STRING_FORMAT(manifest_path));
+	}
+
+	array_deallocate(entries);
+	array_deallocate(files);
+	array_deallocate(keys);
+	array_deallocate(uuids);
+
+	return success;
+}
+
+static stream_t*
+resource_local_manifest_open(const uuid_t uuid, uint64_t platform, bool dynamic) {
+	char buffer[BUILD_MAX_PATHLEN];
+	const resource_local_manifest_entry_t* entry = resource_local_manifest_lookup(uuid, platform);
+	if (!entry)
+		return nullptr;
+	if (!(entry->flags & (dynamic ? RESOURCE_MANIFEST_DYNAMIC : RESOURCE_MANIFEST_STATIC)))
+		return nullptr;
+
+	string_t path = resource_stream_make_path(buffer, sizeof(buffer), STRING_ARGS(resource_local_manifest_base), uuid);
+	string_const_t platformstr =
+	    string_from_uint_static(dynamic ? entry->dynamic_platform : entry->static_platform, true, 0, '0');
+	path = path_append(STRING_ARGS(path), sizeof(buffer), STRING_ARGS(platformstr));
+	bool compressed = dynamic && (entry->flags & RESOURCE_MANIFEST_DYNAMIC_COMPRESSED);
+	if (dynamic)
+		path = string_append(STRING_ARGS(path), sizeof(buffer),
+		                     compressed ? STRING_CONST(".blobz") : STRING_CONST(".blob"));
+
+	stream_t* stream = stream_open(STRING_ARGS(path), STREAM_IN | STREAM_BINARY);
+	if (!stream)
+		return nullptr;
+	return dynamic ? resource_decompress_dynamic(stream, compressed) : resource_decompress_static(stream);
+}
+
+stream_t*
+resource_local_manifest_open_static(const uuid_t uuid, uint64_t platform) {
+	stream_t* stream = resource_local_manifest_open(uuid, platform, false);
+	return stream ? stream : resource_local_open_static(uuid, platform);
+}
+
+stream_t*
+resource_local_manifest_open_dynamic(const uuid_t uuid, uint64_t platform) {
+	stream_t* stream = resource_local_manifest_open(uuid, platform, true);
+	return stream ? stream : resource_local_open_dynamic(uuid, platform);
+}
+
+void
+resource_local_prefetch(const uuid_t uuid, uint64_t platform) {
+	char buffer[BUILD_MAX_PATHLEN];
+	string_t path;
+
+	if (!resource_module_config().enable_local_cache)
+		return;
+
+	path = resource_local_find_path(buffer, sizeof(buffer), uuid, platform, 0, 0);
+	if (path.length)
+		resource_local_readahead(STRING_ARGS(path));
+	bool compressed = false;
+	path = resource_local_find_dynamic_path(buffer, sizeof(buffer), uuid, platform, &compressed);
+	if (path.length)
+		resource_local_readahead(STRING_ARGS(path));
 }
 
 #else
 
 const string_const_t*
-resource_paths_local(void) {
+resource_local_paths(void) {
 	return nullptr;
 }
 
@@ -178,24 +652,424 @@ resource_local_open_dynamic(const uuid_t uuid, uint64_t platform) {
 	return nullptr;
 }
 
+bool
+resource_local_manifest_load(const char* path, size_t length) {
+	FOUNDATION_UNUSED(path);
+	FOUNDATION_UNUSED(length);
+	return false;
+}
+
+void
+resource_local_manifest_unload(void) {
+}
+
+bool
+resource_local_manifest_is_loaded(void) {
+	return false;
+}
+
+bool
+resource_local_manifest_write(const char* path, size_t length, const uint64_t* platforms, size_t platforms_count) {
+	FOUNDATION_UNUSED(path);
+	FOUNDATION_UNUSED(length);
+	FOUNDATION_UNUSED(platforms);
+	FOUNDATION_UNUSED(platforms_count);
+	return false;
+}
+
+stream_t*
+resource_local_manifest_open_static(const uuid_t uuid, uint64_t platform) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+	return nullptr;
+}
+
+stream_t*
+resource_local_manifest_open_dynamic(const uuid_t uuid, uint64_t platform) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+	return nullptr;
+}
+
+void
+resource_local_prefetch(const uuid_t uuid, uint64_t platform) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+}
+
 #endif
 
 #if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
 
+typedef struct resource_local_stream_t resource_local_stream_t;
+typedef struct resource_local_file_t resource_local_file_t;
+typedef struct resource_local_publish_t resource_local_publish_t;
+
+FOUNDATION_ALIGNED_STRUCT(resource_local_stream_t, 8) {
+	FOUNDATION_DECLARE_STREAM;
+	stream_t* stream;
+	uuid_t uuid;
+	uint64_t platform;
+	string_t temp_path;
+	bool dynamic;
+	bool compress;
+	bool compressing;
+	size_t compress_offset;
+};
+
+struct resource_local_file_t {
+	string_t temp_path;
+	string_t path;
+	bool dynamic;
+};
+
+struct resource_local_publish_t {
+	uuid_t uuid;
+	uint64_t platform;
+	size_t ref;
+	resource_local_file_t* files;
+};
+
+static stream_vtable_t resource_local_stream_vtable;
+static resource_local_publish_t* resource_local_publish;
+static mutex_t* resource_local_publish_lock;
+
+//! Make the path of the dynamic data variant with the other compression setting
+static string_t
+resource_local_alternate_path(char* buffer, size_t capacity, const char* path, size_t length) {
+	if (string_ends_with(path, length, STRING_CONST(".blobz")))
+		return string_copy(buffer, capacity, path, length - 1);
+	string_t altpath = string_copy(buffer, capacity, path, length);
+	return string_append(STRING_ARGS(altpath), capacity, STRING_CONST("z"));
+}
+
+static void
+resource_local_move_file(const resource_local_file_t* file) {
+	char buffer[BUILD_MAX_PATHLEN];
+	if (!fs_move_file(STRING_ARGS(file->temp_path), STRING_ARGS(file->path))) {
+		log_warnf(HASH_RESOURCE, WARNING_SUSPICIOUS, STRING_CONST("Unable to publish compiled resource: %.*s"),
+		          STRING_FORMAT(file->path));
+		fs_remove_file(STRING_ARGS(file->temp_path));
+	} else if (file->dynamic) {
+		// Drop data stored with the other compression setting, readers prefer the newest until then
+		string_t altpath = resource_local_alternate_path(buffer, sizeof(buffer), STRING_ARGS(file->path));
+		if (fs_is_file(STRING_ARGS(altpath)))
+			fs_remove_file(STRING_ARGS(altpath));
+	}
+}
+
+static void
+resource_local_file_finalize(resource_local_file_t* file) {
+	string_deallocate(file->temp_path.str);
+	string_deallocate(file->path.str);
+}
+
+static void
+resource_local_publish_file(const uuid_t uuid, uint64_t platform, resource_local_file_t file) {
+	mutex_lock(resource_local_publish_lock);
+	for (size_t ipub = 0, pubsize = array_size(resource_local_publish); ipub < pubsize; ++ipub) {
+		resource_local_publish_t* publish = resource_local_publish + ipub;
+		if (uuid_equal(publish->uuid, uuid) && (publish->platform == platform)) {
+			// Deferred until the publish scope ends, to make static and dynamic data visible together
+			array_push(publish->files, file);
+			mutex_unlock(resource_local_publish_lock);
+			return;
+		}
+	}
+	mutex_unlock(resource_local_publish_lock);
+
+	resource_local_move_file(&file);
+	resource_local_file_finalize(&file);
+}
+
+static size_t
+resource_local_stream_read(stream_t* stream, void* buffer, size_t size) {
+	return stream_read(((resource_local_stream_t*)stream)->stream, buffer, size);
+}
+
+static size_t
+resource_local_stream_write(stream_t* stream, const void* buffer, size_t size) {
+	return stream_write(((resource_local_stream_t*)stream)->stream, buffer, size);
+}
+
+static bool
+resource_local_stream_eos(stream_t* stream) {
+	return stream_eos(((resource_local_stream_t*)stream)->stream);
+}
+
+static void
+resource_local_stream_flush(stream_t* stream) {
+	stream_flush(((resource_local_stream_t*)stream)->stream);
+}
+
+static void
+resource_local_stream_truncate(stream_t* stream, size_t size) {
+	stream_truncate(((resource_local_stream_t*)stream)->stream, size);
+}
+
+static size_t
+resource_local_stream_size(stream_t* stream) {
+	return stream_size(((resource_local_stream_t*)stream)->stream);
+}
+
+static void
+resource_local_stream_seek(stream_t* stream, ssize_t offset, stream_seek_mode_t direction) {
+	stream_seek(((resource_local_stream_t*)stream)->stream, offset, direction);
+}
+
+static size_t
+resource_local_stream_tell(stream_t* rawstream) {
+	resource_local_stream_t* stream = (resource_local_stream_t*)rawstream;
+	return stream->compress_offset + stream_tell(stream->stream);
+}
+
+static tick_t
+resource_local_stream_last_modified(const stream_t* stream) {
+	return stream_last_modified(((const resource_local_stream_t*)stream)->stream);
+}
+
+static size_t
+resource_local_stream_available_read(stream_t* stream) {
+	return stream_available_read(((resource_local_stream_t*)stream)->stream);
+}
+
+static void
+resource_local_stream_finalize(stream_t* rawstream) {
+	resource_local_stream_t* stream = (resource_local_stream_t*)rawstream;
+	if (!stream->stream)
+		return;
+
+	stream_deallocate(stream->stream);
+	stream->stream = nullptr;
+
+	resource_local_file_t file;
+	file.temp_path = stream->temp_path;
+	file.path = string_clone(STRING_ARGS(stream->path));
+	file.dynamic = stream->dynamic;
+	resource_local_publish_file(stream->uuid, stream->platform, file);
+	stream->temp_path = string(0, 0);
+}
+
+bool
+resource_local_stream_compressible(stream_t* rawstream) {
+	if (!rawstream || (rawstream->vtable != &resource_local_stream_vtable))
+		return false;
+	resource_local_stream_t* stream = (resource_local_stream_t*)rawstream;
+	return stream->compress && !stream->compressing && !stream_tell(stream->stream);
+}
+
+void
+resource_local_stream_compress(stream_t* rawstream) {
+	resource_local_stream_t* stream = (resource_local_stream_t*)rawstream;
+	if (stream->compressing)
+		return;
+	// Offsets reported by tell continue from the uncompressed prefix written so far
+	stream->compress_offset = stream_tell(stream->stream);
+	stream->stream = resource_compress_stream_allocate(stream->stream);
+	stream->compressing = true;
+}
+
+static stream_t*
+resource_local_stream_allocate(stream_t* file, const uuid_t uuid, uint64_t platform, string_t path,
+                               string_t temp_path, bool dynamic) {
+	resource_local_stream_t* stream = memory_allocate(HASH_RESOURCE, sizeof(resource_local_stream_t), 8,
+	                                                  MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	stream_initialize((stream_t*)stream, system_byteorder());
+
+	stream->type = STREAMTYPE_CUSTOM;
+	stream->mode = STREAM_OUT | STREAM_BINARY;
+	stream->vtable = &resource_local_stream_vtable;
+	stream->path = string_clone(STRING_ARGS(path));
+	stream->stream = file;
+	stream->uuid = uuid;
+	stream->platform = platform;
+	stream->temp_path = string_clone(STRING_ARGS(temp_path));
+	stream->dynamic = dynamic;
+	stream->compress = resource_module_config().enable_local_compression;
+
+	// Dynamic data has no header, compress from start. Static data is compressed
+	// after the resource header has been written, see resource_stream_write_header
+	if (stream->compress && dynamic)
+		resource_local_stream_compress((stream_t*)stream);
+
+	return (stream_t*)stream;
+}
+
+static string_t
+resource_local_create_path(char* buffer, size_t capacity, const uuid_t uuid, uint64_t platform, const char* suffix,
+                           size_t suffix_length) {
+	char altbuffer[BUILD_MAX_PATHLEN];
+	size_t ipath, pathsize;
+
+	// Replace an existing file on the most specified platform level in any local
+	// path, or create a new file in the first local path that succeeds. Dynamic data
+	// stored with the other compression setting counts as an existing file
+	for (ipath = 0, pathsize = array_size(resource_paths_local); ipath < pathsize; ++ipath) {
+		string_t platformpath =
+		    resource_local_make_platform_path(buffer, capacity, ipath, uuid, platform, suffix, suffix_length);
+		if (fs_is_file(STRING_ARGS(platformpath)))
+			return platformpath;
+		if (suffix_length) {
+			string_t altpath = resource_local_alternate_path(altbuffer, sizeof(altbuffer), STRING_ARGS(platformpath));
+			if (fs_is_file(STRING_ARGS(altpath)))
+				return platformpath;
+		}
+	}
+	for (ipath = 0, pathsize = array_size(resource_paths_local); ipath < pathsize; ++ipath) {
+		string_t platformpath =
+		    resource_local_make_platform_path(buffer, capacity, ipath, uuid, platform, suffix, suffix_length);
+		string_const_t path = path_directory_name(STRING_ARGS(platformpath));
+		if (fs_make_directory(STRING_ARGS(path)))
+			return platformpath;
+	}
+	return string(0, 0);
+}
+
+static stream_t*
+resource_local_create_stream(const uuid_t uuid, uint64_t platform, const char* suffix, size_t suffix_length) {
+	char buffer[BUILD_MAX_PATHLEN];
+	char tempbuffer[BUILD_MAX_PATHLEN];
+
+	if (!resource_module_config().enable_local_cache)
+		return nullptr;
+
+	string_t path = resource_local_create_path(buffer, sizeof(buffer), uuid, platform, suffix, suffix_length);
+	if (!path.length)
+		return nullptr;
+
+	// Write to a temporary file in the same directory and rename it into place once
+	// written, so readers never observe a partially written resource
+	string_const_t tempsuffix = string_from_uint_static(random64(), true, 0, 0);
+	string_t temp_path = string_format(tempbuffer, sizeof(tempbuffer), STRING_CONST("%.*s.%.*s.tmp"),
+	                                   STRING_FORMAT(path), STRING_FORMAT(tempsuffix));
+	stream_t* file =
+	    stream_open(STRING_ARGS(temp_path), STREAM_OUT | STREAM_CREATE | STREAM_TRUNCATE | STREAM_BINARY);
+	if (!file)
+		return nullptr;
+
+	return resource_local_stream_allocate(file, uuid, platform, path, temp_path, suffix_length > 0);
+}
+
+int
+resource_local_initialize(void) {
+	memset(&resource_local_stream_vtable, 0, sizeof(resource_local_stream_vtable));
+	resource_local_stream_vtable.read = resource_local_stream_read;
+	resource_local_stream_vtable.write = resource_local_stream_write;
+	resource_local_stream_vtable.eos = resource_local_stream_eos;
+	resource_local_stream_vtable.flush = resource_local_stream_flush;
+	resource_local_stream_vtable.truncate = resource_local_stream_truncate;
+	resource_local_stream_vtable.size = resource_local_stream_size;
+	resource_local_stream_vtable.seek = resource_local_stream_seek;
+	resource_local_stream_vtable.tell = resource_local_stream_tell;
+	resource_local_stream_vtable.lastmod = resource_local_stream_last_modified;
+	resource_local_stream_vtable.available_read = resource_local_stream_available_read;
+	resource_local_stream_vtable.finalize = resource_local_stream_finalize;
+
+	resource_local_publish_lock = mutex_allocate(STRING_CONST("resource-local-publish"));
+
+	return 0;
+}
+
+void
+resource_local_finalize(void) {
+	for (size_t ipub = 0, pubsize = array_size(resource_local_publish); ipub < pubsize; ++ipub) {
+		resource_local_publish_t* publish = resource_local_publish + ipub;
+		for (size_t ifile = 0, fsize = array_size(publish->files); ifile < fsize; ++ifile) {
+			fs_remove_file(STRING_ARGS(publish->files[ifile].temp_path));
+			resource_local_file_finalize(publish->files + ifile);
+		}
+		array_deallocate(publish->files);
+	}
+	array_deallocate(resource_local_publish);
+	mutex_deallocate(resource_local_publish_lock);
+
+	resource_local_publish = nullptr;
+	resource_local_publish_lock = nullptr;
+}
+
 stream_t*
 resource_local_create_static(const uuid_t uuid, uint64_t platform) {
-	return resource_local_open_stream(uuid, platform, 0, 0,
-	                                  STREAM_OUT | STREAM_CREATE | STREAM_TRUNCATE | STREAM_BINARY);
+	return resource_local_create_stream(uuid, platform, 0, 0);
 }
 
 stream_t*
 resource_local_create_dynamic(const uuid_t uuid, uint64_t platform) {
-	return resource_local_open_stream(uuid, platform, STRING_CONST(".blob"),
-	                                  STREAM_OUT | STREAM_CREATE | STREAM_TRUNCATE | STREAM_BINARY);
+	if (resource_module_config().enable_local_compression)
+		return resource_local_create_stream(uuid, platform, STRING_CONST(".blobz"));
+	return resource_local_create_stream(uuid, platform, STRING_CONST(".blob"));
+}
+
+void
+resource_local_publish_begin(const uuid_t uuid, uint64_t platform) {
+	mutex_lock(resource_local_publish_lock);
+	for (size_t ipub = 0, pubsize = array_size(resource_local_publish); ipub < pubsize; ++ipub) {
+		resource_local_publish_t* publish = resource_local_publish + ipub;
+		if (uuid_equal(publish->uuid, uuid) && (publish->platform == platform)) {
+			++publish->ref;
+			mutex_unlock(resource_local_publish_lock);
+			return;
+		}
+	}
+	resource_local_publish_t publish;
+	publish.uuid = uuid;
+	publish.platform = platform;
+	publish.ref = 1;
+	publish.files = nullptr;
+	array_push(resource_local_publish, publish);
+	mutex_unlock(resource_local_publish_lock);
+}
+
+void
+resource_local_publish_end(const uuid_t uuid, uint64_t platform, bool commit) {
+	resource_local_file_t* files = nullptr;
+	bool found = false;
+
+	mutex_lock(resource_local_publish_lock);
+	for (size_t ipub = 0, pubsize = array_size(resource_local_publish); ipub < pubsize; ++ipub) {
+		resource_local_publish_t* publish = resource_local_publish + ipub;
+		if (uuid_equal(publish->uuid, uuid) && (publish->platform == platform)) {
+			if (--publish->ref == 0) {
+				files = publish->files;
+				found = true;
+				array_erase(resource_local_publish, ipub);
+			}
+			break;
+		}
+	}
+	mutex_unlock(resource_local_publish_lock);
+
+	if (!found)
+		return;
+
+	// Publish dynamic data first, so that once the static data (which carries the
+	// source hash used for up-to-date checks) is visible the dynamic data is as well
+	size_t ifile, fsize;
+	for (ifile = 0, fsize = array_size(files); ifile < fsize; ++ifile) {
+		if (commit && files[ifile].dynamic)
+			resource_local_move_file(files + ifile);
+	}
+	for (ifile = 0, fsize = array_size(files); ifile < fsize; ++ifile) {
+		if (commit && !files[ifile].dynamic)
+			resource_local_move_file(files + ifile);
+		else if (!commit)
+			fs_remove_file(STRING_ARGS(files[ifile].temp_path));
+		resource_local_file_finalize(files + ifile);
+	}
+	array_deallocate(files);
 }
 
 #else
 
+int
+resource_local_initialize(void) {
+	return 0;
+}
+
+void
+resource_local_finalize(void) {
+}
+
 stream_t*
 resource_local_create_static(const uuid_t uuid, uint64_t platform) {
 	FOUNDATION_UNUSED(uuid);
@@ -210,4 +1084,28 @@ resource_local_create_dynamic(const uuid_t uuid, uint64_t platform) {
 	return nullptr;
 }
 
+void
+resource_local_publish_begin(const uuid_t uuid, uint64_t platform) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+}
+
+void
+resource_local_publish_end(const uuid_t uuid, uint64_t platform, bool commit) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(commit);
+}
+
+bool
+resource_local_stream_compressible(stream_t* stream) {
+	FOUNDATION_UNUSED(stream);
+	return false;
+}
+
+void
+resource_local_stream_compress(stream_t* stream) {
+	FOUNDATION_UNUSED(stream);
+}
+
 #endif
@@ -44,8 +44,85 @@ resource_local_open_static(const uuid_t uuid, uint64_t platform);
 RESOURCE_API stream_t*
 resource_local_open_dynamic(const uuid_t uuid, uint64_t platform);
 
+/*! Hint the operating system to start reading the locally stored compiled files
+for the given resource into the page cache
+\param uuid Resource UUID
+\param platform Resource platform */
+RESOURCE_API void
+resource_local_prefetch(const uuid_t uuid, uint64_t platform);
+
+/*! Load a manifest mapping resources to locally stored compiled files, replacing any
+previously loaded manifest. While a manifest is loaded streams are opened directly from the
+local cache by a single lookup, without any remote, import or compile checks. Should be
+called before any streams are opened. Deploy builds automatically load the manifest
+found in the first local path providing one
+\param path Manifest file path
+\param length Length of path
+\return true if loaded, false if failed */
+RESOURCE_API bool
+resource_local_manifest_load(const char* path, size_t length);
+
+/*! Unload the currently loaded manifest */
+RESOURCE_API void
+resource_local_manifest_unload(void);
+
+/*! Query if a manifest is loaded
+\return true if a manifest is loaded, false if not */
+RESOURCE_API bool
+resource_local_manifest_is_loaded(void);
+
+/*! Scan a local path for compiled resources and write a manifest to the local path
+\param path Local path
+\param length Length of path
+\param platforms Platforms to resolve resources for, in addition to the stored platforms
+\param platforms_count Number of platforms
+\return true if written, false if failed */
+RESOURCE_API bool
+resource_local_manifest_write(const char* path, size_t length, const uint64_t* platforms, size_t platforms_count);
+
+/*! Open the static part of a compiled resource by manifest lookup, falling back to
+searching the local paths for resources not in the manifest
+\param uuid Resource UUID
+\param platform Resource platform
+\return Stream, null if not found */
+RESOURCE_API stream_t*
+resource_local_manifest_open_static(const uuid_t uuid, uint64_t platform);
+
+/*! Open the dynamic part of a compiled resource by manifest lookup, see
+resource_local_manifest_open_static
+\param uuid Resource UUID
+\param platform Resource platform
+\return Stream, null if not found */
+RESOURCE_API stream_t*
+resource_local_manifest_open_dynamic(const uuid_t uuid, uint64_t platform);
+
+/*! Create the static part of a compiled resource. Data is written to a temporary file which
+is renamed into place when the stream is deallocated, or when the enclosing publish scope
+ends if one is active for the resource
+\param uuid Resource UUID
+\param platform Resource platform
+\return Stream, null if failed */
 RESOURCE_API stream_t*
 resource_local_create_static(const uuid_t uuid, uint64_t platform);
 
+/*! Create the dynamic part of a compiled resource, see resource_local_create_static
+\param uuid Resource UUID
+\param platform Resource platform
+\return Stream, null if failed */
 RESOURCE_API stream_t*
 resource_local_create_dynamic(const uuid_t uuid, uint64_t platform);
+
+/*! Begin a publish scope for the given resource. Compiled data created for the resource
+is held back until the scope ends, so that the static and dynamic parts are published
+together. Scopes can be nested, data is published when the outermost scope ends
+\param uuid Resource UUID
+\param platform Resource platform */
+RESOURCE_API void
+resource_local_publish_begin(const uuid_t uuid, uint64_t platform);
+
+/*! End a publish scope for the given resource
+\param uuid Resource UUID
+\param platform Resource platform
+\param commit Flag to publish data, if false all data written in the scope is discarded */
+RESOURCE_API void
+resource_local_publish_end(const uuid_t uuid, uint64_t platform, bool commit);
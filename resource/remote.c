@@ -27,18 +27,31 @@
 
 #include <network/network.h>
 
+#include <stdlib.h>
+
 #if FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_ANDROID
 #include <sys/epoll.h>
 #elif FOUNDATION_PLATFORM_MACOS || FOUNDATION_PLATFORM_IOS
 #include <sys/poll.h>
 #endif
 
+#if FOUNDATION_PLATFORM_POSIX
+#include <netinet/in.h>
+#elif FOUNDATION_PLATFORM_WINDOWS
+#include <ws2tcpip.h>
+#endif
+
 #define REMOTE_CONNECT_BACKOFF_MIN (2 * 1000)
 #define REMOTE_CONNECT_BACKOFF_MAX (60 * 1000)
 
+//! Maximum number of requests written to the remote without having received a reply
+#define REMOTE_REQUEST_PIPELINE_DEPTH 64
+
 #define REMOTE_MESSAGE_NONE 0
 #define REMOTE_MESSAGE_TERMINATE 1
 #define REMOTE_MESSAGE_WAKEUP 2
+//! Stream reading directly from the remote socket has finished, resume polling
+#define REMOTE_MESSAGE_RESUME 13
 
 #if RESOURCE_ENABLE_REMOTE_SOURCED
 #define REMOTE_MESSAGE_LOOKUP 3
@@ -57,18 +70,34 @@
 #define REMOTE_MESSAGE_READ_BLOB 10
 #endif
 
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+#define REMOTE_MESSAGE_OPEN_DYNAMIC_RANGE 11
+#define REMOTE_MESSAGE_OPEN_BUNDLE 12
+#endif
+
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+#define REMOTE_MESSAGE_LOOKUP_BATCH 14
+#define REMOTE_MESSAGE_HASH_BATCH 15
+#define REMOTE_MESSAGE_DEPENDENCIES_BATCH 16
+#define REMOTE_MESSAGE_MANIFEST 18
+#endif
+
 typedef struct remote_header_t remote_header_t;
 typedef struct remote_message_t remote_message_t;
+typedef struct remote_request_t remote_request_t;
 typedef struct remote_poll_t remote_poll_t;
 typedef struct remote_context_t remote_context_t;
 
 struct remote_header_t {
 	uint32_t id;
 	uint32_t size;
+	uint32_t request;
+	uint32_t flags;
 };
 
 struct remote_message_t {
 	int message;
+	uint32_t request;
 	const void* data;
 	size_t size;
 	uuid_t uuid;
@@ -77,6 +106,36 @@ struct remote_message_t {
 	hash_t checksum;
 	void* store;
 	size_t capacity;
+	uint64_t offset;
+	uint64_t range;
+	size_t* counts;
+	blake3_hash_t hash;
+	tick_t since;
+};
+
+#define REMOTE_REQUEST_PENDING 0
+#define REMOTE_REQUEST_CLAIMED 1
+#define REMOTE_REQUEST_ABANDONED 2
+
+/*! Request submitted by a caller thread. Owned by the caller until completed, unless the caller
+abandons it when the deadline expires in which case it is owned and deallocated by the comm thread.
+The comm thread claims the request while accessing caller memory, which prevents it from being
+abandoned until released */
+struct remote_request_t {
+	remote_message_t message;
+	//! Next request in submission stack
+	remote_request_t* next;
+	//! Reply destination, size of stored reply is set on completion
+	void* reply;
+	size_t reply_size;
+	//! Signalled by comm thread on completion
+	semaphore_t done;
+	//! Request state, pending, claimed by comm thread or abandoned by caller
+	atomic32_t state;
+	//! Time the caller gives up waiting for the reply
+	tick_t deadline;
+	//! Time the request was written to the remote
+	tick_t written;
 };
 
 struct remote_poll_t {
@@ -89,30 +148,263 @@ struct remote_context_t {
 	socket_t* remote;
 	socket_t* control;
 	socket_t* client;
-	int (*read)(remote_context_t*, remote_header_t, remote_message_t);
-	int (*write)(remote_context_t*, remote_message_t);
+	//! Lock free stack of requests submitted by callers, taken in full by the comm thread
+	atomicptr_t submitted;
+	//! Set while the comm thread accepts requests
+	atomic32_t active;
+	//! Number of callers currently using the context
+	atomic32_t users;
+	//! Number of open streams reading directly from the remote socket
+	atomic32_t streams;
+	//! Optional features negotiated with the remote service, set by the comm thread
+	uint32_t features;
+	//! Moving average of request round trip time in milliseconds, 0 if not yet measured
+	atomic32_t latency;
+	//! Time until which the remote is considered degraded and calls fail without being submitted
+	atomic64_t degraded_until;
+	int (*read)(remote_context_t*, remote_header_t, remote_request_t*);
+	int (*write)(remote_context_t*, remote_request_t*);
+	//! Called by comm thread when a connection to the remote is established, optional
+	void (*connected)(remote_context_t*);
 };
 
-static void*
-resource_remote_comm(void* arg) {
-	remote_context_t* context = (remote_context_t*)arg;
+//! Claim a request for access by the comm thread, fails if the caller has abandoned it
+static bool
+resource_remote_claim(remote_request_t* request) {
+	if (atomic_cas32(&request->state, REMOTE_REQUEST_CLAIMED, REMOTE_REQUEST_PENDING, memory_order_acquire,
+	                 memory_order_relaxed))
+		return true;
+	return atomic_load32(&request->state, memory_order_acquire) == REMOTE_REQUEST_CLAIMED;
+}
+
+//! Release a claimed request, allowing the caller to abandon it
+static void
+resource_remote_unclaim(remote_request_t* request) {
+	atomic_store32(&request->state, REMOTE_REQUEST_PENDING, memory_order_release);
+}
+
+static void
+resource_remote_request_deallocate(remote_request_t* request) {
+	semaphore_finalize(&request->done);
+	memory_deallocate(request);
+}
+
+static void
+resource_remote_complete(remote_request_t* request, const void* reply, size_t size) {
+	// Abandoned requests are owned by the comm thread and the reply destination is gone
+	if (!resource_remote_claim(request)) {
+		resource_remote_request_deallocate(request);
+		return;
+	}
+	if (size > request->reply_size)
+		size = request->reply_size;
+	if (size)
+		memcpy(request->reply, reply, size);
+	request->reply_size = size;
+	// Request is owned by the caller and must not be touched after this
+	semaphore_post(&request->done);
+}
+
+/*! Mark the remote as degraded, calls will fail without being submitted until the cooldown
+has passed, making callers fall back to local sources
+\param context Remote context
+\param reason Reason for degrading, for logging
+\param length Length of reason */
+static void
+resource_remote_degrade(remote_context_t* context, const char* reason, size_t length) {
+	tick_t now = time_system();
+	if (atomic_load64(&context->degraded_until, memory_order_acquire) > now)
+		return;
+	atomic_store64(&context->degraded_until, now + RESOURCE_REMOTE_DEGRADED_COOLDOWN, memory_order_release);
+	// Measure again from scratch when the cooldown has passed
+	atomic_store32(&context->latency, 0, memory_order_release);
+	log_warnf(HASH_RESOURCE, WARNING_PERFORMANCE, STRING_CONST("Remote %.*s degraded, %.*s"),
+	          STRING_FORMAT(context->url), (int)length, reason);
+}
+
+static bool
+resource_remote_is_available(remote_context_t* context) {
+	return atomic_load32(&context->active, memory_order_acquire) &&
+	       (atomic_load64(&context->degraded_until, memory_order_acquire) <= time_system());
+}
+
+//! Update the round trip time average with a completed request, called by comm thread
+static void
+resource_remote_measure(remote_context_t* context, tick_t written) {
+	int32_t sample = (int32_t)(time_system() - written);
+	if (sample < 1)
+		sample = 1;
+	int32_t latency = atomic_load32(&context->latency, memory_order_relaxed);
+	latency = latency ? ((latency * 7) + sample) / 8 : sample;
+	atomic_store32(&context->latency, latency, memory_order_release);
+	if (latency > RESOURCE_REMOTE_LATENCY_LIMIT) {
+		char buffer[64];
+		string_t reason = string_format(buffer, sizeof(buffer), STRING_CONST("latency %d ms"), latency);
+		resource_remote_degrade(context, STRING_ARGS(reason));
+	}
+}
+
+static remote_request_t**
+resource_remote_take_submitted(remote_context_t* context, remote_request_t** pending) {
+	remote_request_t* head;
+	do {
+		head = atomic_load_ptr(&context->submitted, memory_order_acquire);
+	} while (head && !atomic_cas_ptr(&context->submitted, nullptr, head, memory_order_acquire, memory_order_relaxed));
+
+	// Stack is in reverse submission order
+	size_t base = array_size(pending);
+	for (; head; head = head->next)
+		array_push(pending, head);
+	for (size_t ifirst = base, ilast = array_size(pending); ifirst + 1 < ilast; ++ifirst, --ilast) {
+		remote_request_t* swap = pending[ifirst];
+		pending[ifirst] = pending[ilast - 1];
+		pending[ilast - 1] = swap;
+	}
+	return pending;
+}
+
+static void
+resource_remote_fail_submitted(remote_context_t* context) {
+	remote_request_t** failed = resource_remote_take_submitted(context, nullptr);
+	for (size_t ireq = 0, rsize = array_size(failed); ireq < rsize; ++ireq)
+		resource_remote_complete(failed[ireq], nullptr, 0);
+	array_deallocate(failed);
+}
+
+/*! Submit a request to the comm thread and wait for the reply. Requests are pushed on a lock
+free stack, and the comm thread is only woken up with a datagram on the control socket when
+the stack goes from empty to non-empty, since the comm thread always takes all submitted
+requests when woken up. Safe to call from any number of threads concurrently, also while
+the remote is being disconnected in which case the request fails. If no reply is received
+before the timeout the request is abandoned, the remote is marked as degraded and the call fails
+\param context Remote context
+\param message Request message
+\param reply Reply destination
+\param size Size of reply destination
+\param timeout Timeout in milliseconds, 0 for configured default
+\return Size of stored reply, 0 if request failed */
+static size_t
+resource_remote_call(remote_context_t* context, const remote_message_t* message, void* reply, size_t size,
+                     unsigned int timeout) {
+	atomic_incr32(&context->users, memory_order_acquire);
+	if (!resource_remote_is_available(context)) {
+		atomic_decr32(&context->users, memory_order_release);
+		return 0;
+	}
+
+	if (!timeout)
+		timeout = resource_module_config().remote_call_timeout;
+	if (!timeout)
+		timeout = RESOURCE_REMOTE_CALL_TIMEOUT;
+
+	// Heap allocated since the comm thread takes ownership of abandoned requests
+	remote_request_t* request = memory_allocate(HASH_RESOURCE, sizeof(remote_request_t), 0, MEMORY_PERSISTENT);
+	request->message = *message;
+	request->reply = reply;
+	request->reply_size = size;
+	request->deadline = time_system() + timeout;
+	request->written = 0;
+	atomic_store32(&request->state, REMOTE_REQUEST_PENDING, memory_order_relaxed);
+	semaphore_initialize(&request->done, 0);
+
+	remote_request_t* head;
+	do {
+		head = atomic_load_ptr(&context->submitted, memory_order_relaxed);
+		request->next = head;
+	} while (!atomic_cas_ptr(&context->submitted, request, head, memory_order_seq_cst, memory_order_relaxed));
+
+	if (!head) {
+		remote_message_t wakeup;
+		memset(&wakeup, 0, sizeof(wakeup));
+		wakeup.message = REMOTE_MESSAGE_WAKEUP;
+		udp_socket_sendto(context->client, &wakeup, sizeof(wakeup), socket_address_local(context->control));
+	}
+
+	// Comm thread might have exited without taking the request, in which case fail it here
+	if (!atomic_load32(&context->active, memory_order_seq_cst))
+		resource_remote_fail_submitted(context);
+
+	size_t stored = 0;
+	bool abandoned = false;
+	tick_t deadline = request->deadline;
+	tick_t remain = deadline - time_system();
+	while (!semaphore_try_wait(&request->done, (remain > 0) ? (unsigned int)remain : 0)) {
+		remain = deadline - time_system();
+		if (remain > 0)
+			continue;
+		// Request can only be abandoned while not claimed by the comm thread, which only holds
+		// the claim while reading or writing the request data
+		if (atomic_cas32(&request->state, REMOTE_REQUEST_ABANDONED, REMOTE_REQUEST_PENDING, memory_order_acq_rel,
+		                 memory_order_relaxed)) {
+			abandoned = true;
+			break;
+		}
+		remain = 10;
+	}
+
+	if (abandoned) {
+		resource_remote_degrade(context, STRING_CONST("request timed out"));
+	} else {
+		stored = request->reply_size;
+		resource_remote_request_deallocate(request);
+	}
+
+	atomic_decr32(&context->users, memory_order_release);
+
+	return stored;
+}
+
+/*! Stop accepting requests and wait for all callers to return. Must be called after the comm
+thread has been terminated and before the context sockets are finalized
+\param context Remote context */
+static void
+resource_remote_drain(remote_context_t* context) {
+	atomic_store32(&context->active, 0, memory_order_seq_cst);
+	resource_remote_fail_submitted(context);
+	while (atomic_load32(&context->users, memory_order_acquire)) {
+		thread_yield();
+		resource_remote_fail_submitted(context);
+	}
+}
+
+/*! Check if the URL uses a transport the remote connections support. Only TCP host URLs are
+supported, unix:// domain socket URLs are rejected since the network library has no local
+socket type to run the comm thread on
+\param url URL
+\param length Length of URL
+\return true if supported, false if not */
+static bool
+resource_remote_url_is_supported(const char* url, size_t length) {
+	if (string_equal(url, (length > 7) ? 7 : length, STRING_CONST("unix://"))) {
+		log_warnf(HASH_RESOURCE, WARNING_UNSUPPORTED,
+		          STRING_CONST("Unix domain socket transport is not supported, use a TCP host URL: %.*s"), (int)length,
+		          url);
+		return false;
+	}
+	return true;
+}
+
+static void
+resource_remote_comm_run(remote_context_t* context) {
 	char addrbuf[NETWORK_ADDRESS_NUMERIC_MAX_LENGTH];
 
 	if (socket_fd(context->control) == NETWORK_SOCKET_INVALID)
-		return nullptr;
+		return;
 	if (!context->url.length)
-		return nullptr;
+		return;
 
 	network_address_t** address = network_address_resolve(STRING_ARGS(context->url));
 	if (!address) {
 		log_warnf(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Unable to resolve remote URL: %.*s"),
 		          STRING_FORMAT(context->url));
-		return nullptr;
+		return;
 	}
 
 	socket_t remote;
 	tcp_socket_initialize(&remote);
 	socket_set_blocking(&remote, true);
+	// Requests are small and latency bound, do not hold them back waiting for outstanding acks
+	tcp_socket_set_delay(&remote, false);
 	context->remote = &remote;
 
 	remote_poll_t fixedpoll;
@@ -131,10 +423,12 @@ resource_remote_comm(void* arg) {
 	size_t iaddr = 0;
 	size_t lastaddr = 0;
 
-	remote_message_t pending;
-	remote_message_t waiting;
-	memset(&pending, 0, sizeof(pending));
-	memset(&waiting, 0, sizeof(waiting));
+	// Requests not yet written to the remote, and requests written and waiting for a reply
+	remote_request_t** pending = nullptr;
+	remote_request_t** waiting = nullptr;
+	uint32_t next_request = 0;
+	uint32_t stashed_request = 0;
+	uint32_t stashed_flags = 0;
 
 	while (!terminate) {
 		size_t ievt;
@@ -149,14 +443,21 @@ resource_remote_comm(void* arg) {
 					continue;
 				if (!network_address_equal(addr, socket_address_local(context->client)))
 					continue;
-				if ((message.message == REMOTE_MESSAGE_NONE) || (message.message == REMOTE_MESSAGE_WAKEUP)) {
-					break;
-				}
 				if (message.message == REMOTE_MESSAGE_TERMINATE) {
 					terminate = true;
 					break;
 				}
-				pending = message;
+				if (message.message == REMOTE_MESSAGE_RESUME)
+					network_poll_add_socket(poll, context->remote);
+				// Doorbell, take all submitted requests
+				size_t first = array_size(pending);
+				pending = resource_remote_take_submitted(context, pending);
+				for (size_t ireq = first, rsize = array_size(pending); ireq < rsize; ++ireq) {
+					// Request ID 0 is reserved for notifications
+					if (!++next_request)
+						++next_request;
+					pending[ireq]->message.request = next_request;
+				}
 			} else {
 				socket_t* sock = events[ievt].socket;
 				if (sock != &remote)
@@ -166,6 +467,8 @@ resource_remote_comm(void* arg) {
 					connected = true;
 					reconnect = false;
 					backoff = 0;
+					if (context->connected)
+						context->connected(context);
 
 					string_t addrstr =
 					    network_address_to_string(addrbuf, sizeof(addrbuf), socket_address_remote(&remote), true);
@@ -186,10 +489,14 @@ resource_remote_comm(void* arg) {
 					connected = false;
 					reconnect = true;
 				} else if (events[ievt].event == NETWORKEVENT_DATAIN) {
-					remote_header_t msg = {(uint32_t)remote.data.header.id, (uint32_t)remote.data.header.size};
+					remote_header_t msg = {(uint32_t)remote.data.header.id, (uint32_t)remote.data.header.size,
+					                       stashed_request, stashed_flags};
 					bool had_header = (msg.id != 0);
 
+					// Stashed header is consumed, stashed again below if the payload is still incomplete
 					remote.data.header.id = 0;
+					stashed_request = 0;
+					stashed_flags = 0;
 
 					if (!had_header) {
 						size_t read = socket_read(&remote, &msg, sizeof(msg));
@@ -200,10 +507,33 @@ resource_remote_comm(void* arg) {
 							network_poll_update_socket(poll, &remote);
 							connected = false;
 							reconnect = true;
+							continue;
 						}
 					}
 
-					int result = context->read(context, msg, waiting);
+					// Match reply to the request it answers, unmatched replies and replies to abandoned
+					// requests are read and discarded
+					remote_request_t discard;
+					remote_request_t* reply_to = &discard;
+					remote_request_t* abandoned = nullptr;
+					tick_t written = 0;
+					size_t iwait = 0;
+					size_t wsize = array_size(waiting);
+					while ((iwait < wsize) && (!msg.request || (waiting[iwait]->message.request != msg.request)))
+						++iwait;
+					if ((iwait < wsize) && resource_remote_claim(waiting[iwait])) {
+						reply_to = waiting[iwait];
+						written = reply_to->written;
+					} else {
+						if (iwait < wsize)
+							abandoned = waiting[iwait];
+						memset(&discard, 0, sizeof(discard));
+						discard.message.message = REMOTE_MESSAGE_NONE;
+					}
+
+					int result = context->read(context, msg, reply_to);
+					if ((reply_to != &discard) && (result != 0))
+						resource_remote_unclaim(reply_to);
 					if (result < 0) {
 						if (had_header) {
 							log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL,
@@ -215,25 +545,58 @@ resource_remote_comm(void* arg) {
 						} else {
 							remote.data.header.id = msg.id;
 							remote.data.header.size = msg.size;
+							stashed_request = msg.request;
+							stashed_flags = msg.flags;
 						}
-					} else if (result == 0) {
-						waiting.message = REMOTE_MESSAGE_NONE;
+					} else if ((result == 0) && (iwait < wsize)) {
+						// Completed requests are owned by the caller again and must not be touched
+						array_erase_ordered_safe(waiting, iwait);
+						if (abandoned)
+							resource_remote_request_deallocate(abandoned);
+						else
+							resource_remote_measure(context, written);
 					}
 				}
 			}
 		}
 
-		if (connected && !waiting.message && pending.message) {
-			waiting = pending;
-			pending.message = REMOTE_MESSAGE_NONE;
+		// Keep writing requests without waiting for replies, up to the pipeline depth
+		while (connected && array_size(pending) && (array_size(waiting) < REMOTE_REQUEST_PIPELINE_DEPTH)) {
+			remote_request_t* request = pending[0];
+			array_erase_ordered_safe(pending, 0);
+			if (!resource_remote_claim(request)) {
+				resource_remote_request_deallocate(request);
+				continue;
+			}
+			request->written = time_system();
+			if (context->write(context, request) >= 0) {
+				resource_remote_unclaim(request);
+				array_push(waiting, request);
+			}
+		}
 
-			context->write(context, waiting);
+		// Oldest request passed its deadline without a reply, assume the remote is hung and reconnect
+		// which writes the remaining requests again. Never close the socket under an open stream
+		if (connected && array_size(waiting) && !atomic_load32(&context->streams, memory_order_acquire) &&
+		    (waiting[0]->deadline < time_system())) {
+			log_warnf(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Remote not responding: %.*s"),
+			          STRING_FORMAT(context->url));
+			socket_close(&remote);
+			network_poll_update_socket(poll, &remote);
+			connected = false;
+			reconnect = true;
 		}
 
 		if (reconnect) {
-			if (waiting.message)
-				pending = waiting;
-			waiting.message = REMOTE_MESSAGE_NONE;
+			// Requests in flight were lost with the connection, write them again first when reconnected
+			if (array_size(waiting)) {
+				for (size_t imsg = 0, msize = array_size(pending); imsg < msize; ++imsg)
+					array_push(waiting, pending[imsg]);
+				array_clear(pending);
+				remote_request_t** requeue = waiting;
+				waiting = pending;
+				pending = requeue;
+			}
 
 			if (time_system() > next_reconnect) {
 				if (!backoff)
@@ -246,6 +609,11 @@ resource_remote_comm(void* arg) {
 				connected = false;
 				next_reconnect = time_system() + backoff;
 
+				// Discard any header stashed from the previous connection
+				remote.data.header.id = 0;
+				stashed_request = 0;
+				stashed_flags = 0;
+
 				string_t addrstr = network_address_to_string(addrbuf, sizeof(addrbuf), address[iaddr], true);
 				log_infof(HASH_RESOURCE, STRING_CONST("Connecting to remote address: %.*s"), STRING_FORMAT(addrstr));
 
@@ -261,6 +629,8 @@ resource_remote_comm(void* arg) {
 						log_infof(HASH_RESOURCE, STRING_CONST("Connected to remote address: %.*s"),
 						          STRING_FORMAT(addrstr));
 						backoff = 0;
+						if (context->connected)
+							context->connected(context);
 					}
 				}
 
@@ -274,20 +644,47 @@ resource_remote_comm(void* arg) {
 			if (nextwait < 0)
 				nextwait = 0;
 			wait = (unsigned int)nextwait;
+		} else if (array_size(waiting) && !atomic_load32(&context->streams, memory_order_acquire)) {
+			// Wake up when the oldest request expires to detect a hung remote
+			tick_t nextwait = waiting[0]->deadline - time_system();
+			if (nextwait < 0)
+				nextwait = 0;
+			wait = (unsigned int)nextwait + 1;
 		} else {
 			wait = NETWORK_TIMEOUT_INFINITE;
 		}
 	}
 
-	uint32_t dummy = 0;
-	if (waiting.message)
-		udp_socket_sendto(context->control, &dummy, sizeof(dummy), socket_address_local(context->client));
-	if (pending.message)
-		udp_socket_sendto(context->control, &dummy, sizeof(dummy), socket_address_local(context->client));
+	// Fail all outstanding requests
+	for (size_t ireq = 0, rsize = array_size(waiting); ireq < rsize; ++ireq)
+		resource_remote_complete(waiting[ireq], nullptr, 0);
+	for (size_t ireq = 0, rsize = array_size(pending); ireq < rsize; ++ireq)
+		resource_remote_complete(pending[ireq], nullptr, 0);
+	array_deallocate(waiting);
+	array_deallocate(pending);
+
+	// Open streams read directly from the remote socket, it must outlive them
+	if (atomic_load32(&context->streams, memory_order_acquire)) {
+		log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS, STRING_CONST("Disconnecting from remote with open streams"));
+		while (atomic_load32(&context->streams, memory_order_acquire))
+			thread_sleep(10);
+	}
 
 	socket_finalize(&remote);
 	network_poll_finalize(poll);
 	network_address_array_deallocate(address);
+}
+
+static void*
+resource_remote_comm(void* arg) {
+	remote_context_t* context = (remote_context_t*)arg;
+
+	resource_remote_comm_run(context);
+
+	// Stop accepting requests and fail any submitted but not yet taken, callers racing with
+	// this will see the context as inactive after submitting and fail their own requests
+	atomic_store32(&context->active, 0, memory_order_seq_cst);
+	resource_remote_fail_submitted(context);
 
 	return nullptr;
 }
@@ -305,42 +702,431 @@ static socket_t sourced_client;
 static socket_t sourced_proxy;
 static remote_context_t sourced_context;
 
+#define REMOTE_CACHE_HASH 1
+#define REMOTE_CACHE_DEPENDENCIES 2
+#define REMOTE_CACHE_REVERSE_DEPENDENCIES 4
+#define REMOTE_CACHE_READ 8
+
+//! Read status when the cached read the reply was based on is gone, the read must be repeated in full
+#define REMOTE_READ_STALE 2
+
+typedef struct remote_cache_entry_t remote_cache_entry_t;
+
+//! Cached metadata for a resource, valid until a notify for the resource arrives
+struct remote_cache_entry_t {
+	uuid_t uuid;
+	uint64_t platform;
+	unsigned int flags;
+	//! Resource hash includes the hashes of all dependencies, dropped on notify of any resource it may depend on
+	blake3_hash_t hash;
+	//! Reverse dependencies change when any resource changes dependencies
+	uint32_t reverse_generation;
+	resource_dependency_t* dependencies;
+	resource_dependency_t* reverse_dependencies;
+	//! Last read of the source, kept across notifies as reads are conditional on the source hash
+	sourced_read_result_t* read;
+	size_t read_size;
+	tick_t read_since;
+};
+
+static mutex_t* sourced_cache_lock;
+static remote_cache_entry_t sourced_cache[RESOURCE_REMOTE_CACHE_SIZE];
+//! Incremented on each notify and connection, results of requests spanning a change are not cached
+static uint32_t sourced_cache_generation;
+static uint32_t sourced_cache_reverse_generation;
+
+static remote_cache_entry_t*
+resource_sourced_cache_entry(const uuid_t uuid, uint64_t platform) {
+	size_t slot = (size_t)(uuid.word[0] ^ uuid.word[1] ^ platform) & (RESOURCE_REMOTE_CACHE_SIZE - 1);
+	return sourced_cache + slot;
+}
+
+static void
+resource_sourced_cache_clear(remote_cache_entry_t* entry, unsigned int flags) {
+	if (flags & REMOTE_CACHE_DEPENDENCIES) {
+		array_deallocate(entry->dependencies);
+		entry->dependencies = nullptr;
+	}
+	if (flags & REMOTE_CACHE_REVERSE_DEPENDENCIES) {
+		array_deallocate(entry->reverse_dependencies);
+		entry->reverse_dependencies = nullptr;
+	}
+	if (flags & REMOTE_CACHE_READ) {
+		memory_deallocate(entry->read);
+		entry->read = nullptr;
+		entry->read_size = 0;
+	}
+	entry->flags &= ~flags;
+}
+
+//! Get the entry for the resource, replacing any other resource in the slot. Must hold lock
+static remote_cache_entry_t*
+resource_sourced_cache_store(const uuid_t uuid, uint64_t platform) {
+	remote_cache_entry_t* entry = resource_sourced_cache_entry(uuid, platform);
+	if (!uuid_equal(entry->uuid, uuid) || (entry->platform != platform)) {
+		resource_sourced_cache_clear(entry,
+		                             REMOTE_CACHE_DEPENDENCIES | REMOTE_CACHE_REVERSE_DEPENDENCIES | REMOTE_CACHE_READ);
+		entry->flags = 0;
+		entry->uuid = uuid;
+		entry->platform = platform;
+	}
+	return entry;
+}
+
+static void
+resource_sourced_cache_flush(unsigned int flags) {
+	mutex_lock(sourced_cache_lock);
+	++sourced_cache_generation;
+	++sourced_cache_reverse_generation;
+	for (size_t ientry = 0; ientry < RESOURCE_REMOTE_CACHE_SIZE; ++ientry)
+		resource_sourced_cache_clear(sourced_cache + ientry, flags | REMOTE_CACHE_HASH);
+	mutex_unlock(sourced_cache_lock);
+}
+
+static void
+resource_sourced_cache_invalidate(const uuid_t uuid, uint32_t notify) {
+	mutex_lock(sourced_cache_lock);
+	++sourced_cache_generation;
+	if (notify != SOURCED_NOTIFY_MODIFY) {
+		// Dependencies of the resource changed, drop them for all platforms
+		++sourced_cache_reverse_generation;
+		for (size_t ientry = 0; ientry < RESOURCE_REMOTE_CACHE_SIZE; ++ientry) {
+			if (uuid_equal(sourced_cache[ientry].uuid, uuid))
+				resource_sourced_cache_clear(sourced_cache + ientry, REMOTE_CACHE_DEPENDENCIES);
+		}
+	}
+	// A cached hash is kept only if the cached dependency tree of the resource is complete and does not
+	// contain the notified resource. Mark entries with cached dependencies as unaffected, then repeatedly
+	// drop the mark from entries with a dependency that is not marked until no more marks are dropped
+	bool unaffected[RESOURCE_REMOTE_CACHE_SIZE];
+	for (size_t ientry = 0; ientry < RESOURCE_REMOTE_CACHE_SIZE; ++ientry) {
+		const remote_cache_entry_t* entry = sourced_cache + ientry;
+		unaffected[ientry] = (entry->flags & REMOTE_CACHE_DEPENDENCIES) && !uuid_equal(entry->uuid, uuid);
+	}
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t ientry = 0; ientry < RESOURCE_REMOTE_CACHE_SIZE; ++ientry) {
+			if (!unaffected[ientry])
+				continue;
+			const remote_cache_entry_t* entry = sourced_cache + ientry;
+			for (size_t idep = 0, count = array_size(entry->dependencies); idep < count; ++idep) {
+				const uuid_t depuuid = entry->dependencies[idep].uuid;
+				const remote_cache_entry_t* depentry = resource_sourced_cache_entry(depuuid, entry->platform);
+				if (!uuid_equal(depentry->uuid, depuuid) || (depentry->platform != entry->platform) ||
+				    !unaffected[depentry - sourced_cache]) {
+					unaffected[ientry] = false;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+	for (size_t ientry = 0; ientry < RESOURCE_REMOTE_CACHE_SIZE; ++ientry) {
+		if (!unaffected[ientry])
+			resource_sourced_cache_clear(sourced_cache + ientry, REMOTE_CACHE_HASH);
+	}
+	mutex_unlock(sourced_cache_lock);
+}
+
+static bool
+resource_sourced_cache_hash(const uuid_t uuid, uint64_t platform, blake3_hash_t* hash, uint32_t* generation) {
+	bool found = false;
+	mutex_lock(sourced_cache_lock);
+	remote_cache_entry_t* entry = resource_sourced_cache_entry(uuid, platform);
+	if ((entry->flags & REMOTE_CACHE_HASH) && uuid_equal(entry->uuid, uuid) && (entry->platform == platform)) {
+		*hash = entry->hash;
+		found = true;
+	}
+	*generation = sourced_cache_generation;
+	mutex_unlock(sourced_cache_lock);
+	return found;
+}
+
+static uint32_t
+resource_sourced_cache_generation(void) {
+	mutex_lock(sourced_cache_lock);
+	uint32_t generation = sourced_cache_generation;
+	mutex_unlock(sourced_cache_lock);
+	return generation;
+}
+
+static void
+resource_sourced_cache_set_hash(const uuid_t uuid, uint64_t platform, const blake3_hash_t hash, uint32_t generation) {
+	mutex_lock(sourced_cache_lock);
+	if (generation == sourced_cache_generation) {
+		remote_cache_entry_t* entry = resource_sourced_cache_store(uuid, platform);
+		entry->hash = hash;
+		entry->flags |= REMOTE_CACHE_HASH;
+	}
+	mutex_unlock(sourced_cache_lock);
+}
+
+//! Copy cached dependencies, returns true and the total number of dependencies if cached
+static bool
+resource_sourced_cache_dependencies(const uuid_t uuid, uint64_t platform, unsigned int flag,
+                                    resource_dependency_t* deps, size_t capacity, size_t* count,
+                                    uint32_t* generation) {
+	bool found = false;
+	mutex_lock(sourced_cache_lock);
+	remote_cache_entry_t* entry = resource_sourced_cache_entry(uuid, platform);
+	if ((entry->flags & flag) && uuid_equal(entry->uuid, uuid) && (entry->platform == platform) &&
+	    ((flag != REMOTE_CACHE_REVERSE_DEPENDENCIES) ||
+	     (entry->reverse_generation == sourced_cache_reverse_generation))) {
+		resource_dependency_t* cached =
+		    (flag == REMOTE_CACHE_DEPENDENCIES) ? entry->dependencies : entry->reverse_dependencies;
+		*count = array_size(cached);
+		memcpy(deps, cached, sizeof(resource_dependency_t) * ((*count < capacity) ? *count : capacity));
+		found = true;
+	}
+	*generation = sourced_cache_generation;
+	mutex_unlock(sourced_cache_lock);
+	return found;
+}
+
+//! Store dependencies, only complete results (count not exceeding capacity) can be cached
+static void
+resource_sourced_cache_set_dependencies(const uuid_t uuid, uint64_t platform, unsigned int flag,
+                                        const resource_dependency_t* deps, size_t count, uint32_t generation) {
+	mutex_lock(sourced_cache_lock);
+	if (generation == sourced_cache_generation) {
+		remote_cache_entry_t* entry = resource_sourced_cache_store(uuid, platform);
+		resource_sourced_cache_clear(entry, flag);
+		resource_dependency_t* cached = nullptr;
+		array_reserve(cached, count ? count : 1);
+		for (size_t idep = 0; idep < count; ++idep)
+			array_push(cached, deps[idep]);
+		if (flag == REMOTE_CACHE_DEPENDENCIES) {
+			entry->dependencies = cached;
+		} else {
+			entry->reverse_dependencies = cached;
+			entry->reverse_generation = sourced_cache_reverse_generation;
+		}
+		entry->flags |= flag;
+	}
+	mutex_unlock(sourced_cache_lock);
+}
+
+//! Get the source hash and latest change timestamp of the cached read of the resource
+static bool
+resource_sourced_cache_read_base(const uuid_t uuid, blake3_hash_t* hash, tick_t* since) {
+	bool found = false;
+	mutex_lock(sourced_cache_lock);
+	remote_cache_entry_t* entry = resource_sourced_cache_entry(uuid, 0);
+	if ((entry->flags & REMOTE_CACHE_READ) && uuid_equal(entry->uuid, uuid) && !entry->platform) {
+		*hash = entry->read->hash;
+		*since = entry->read_since;
+		found = true;
+	}
+	mutex_unlock(sourced_cache_lock);
+	return found;
+}
+
+static void
+resource_sourced_read_apply(resource_source_t* source, const sourced_read_result_t* result) {
+	const sourced_change_t* change = result->payload;
+	for (uint32_t ich = 0; ich < result->changes_count; ++ich, ++change) {
+		if (change->flags & RESOURCE_SOURCEFLAG_BLOB)
+			resource_source_set_blob(source, change->timestamp, change->hash, change->platform,
+			                         change->value.blob.checksum, change->value.blob.size);
+		else if (change->flags & RESOURCE_SOURCEFLAG_VALUE)
+			resource_source_set(source, change->timestamp, change->hash, change->platform,
+			                    pointer_offset_const(result->payload, change->value.value.offset),
+			                    change->value.value.length);
+		else
+			resource_source_unset(source, change->timestamp, change->hash, change->platform);
+	}
+}
+
+static tick_t
+resource_sourced_read_latest(const sourced_read_result_t* result, tick_t since) {
+	for (uint32_t ich = 0; ich < result->changes_count; ++ich) {
+		if (result->payload[ich].timestamp > since)
+			since = result->payload[ich].timestamp;
+	}
+	return since;
+}
+
+typedef struct {
+	const sourced_change_t* change;
+	const char* values;
+	uint32_t order;
+} remote_read_change_t;
+
+static int
+resource_sourced_read_change_compare(const void* lhs, const void* rhs) {
+	const remote_read_change_t* first = lhs;
+	const remote_read_change_t* second = rhs;
+	if (first->change->hash != second->change->hash)
+		return (first->change->hash < second->change->hash) ? -1 : 1;
+	if (first->change->platform != second->change->platform)
+		return (first->change->platform < second->change->platform) ? -1 : 1;
+	if (first->change->timestamp != second->change->timestamp)
+		return (first->change->timestamp < second->change->timestamp) ? -1 : 1;
+	return (first->order < second->order) ? -1 : ((first->order > second->order) ? 1 : 0);
+}
+
+static bool
+resource_sourced_read_change_is_value(const sourced_change_t* change) {
+	return (change->flags & RESOURCE_SOURCEFLAG_VALUE) && !(change->flags & RESOURCE_SOURCEFLAG_BLOB);
+}
+
+/*! Merge the changes of a delta reply into a cached read, returning the combined read. Changes are
+collapsed to the latest change of each key and platform with delta changes replacing cached ones, and
+keys where the latest change is an unset are dropped, so the cached read does not grow with each delta */
+static sourced_read_result_t*
+resource_sourced_read_merge(const sourced_read_result_t* base, const sourced_read_result_t* delta, size_t* size) {
+	uint32_t total = base->changes_count + delta->changes_count;
+	remote_read_change_t* sorted =
+	    memory_allocate(HASH_RESOURCE, sizeof(remote_read_change_t) * (total ? total : 1), 0, MEMORY_TEMPORARY);
+	for (uint32_t ich = 0; ich < base->changes_count; ++ich)
+		sorted[ich] = (remote_read_change_t){base->payload + ich, (const char*)base->payload, ich};
+	for (uint32_t ich = 0; ich < delta->changes_count; ++ich)
+		sorted[base->changes_count + ich] =
+		    (remote_read_change_t){delta->payload + ich, (const char*)delta->payload, base->changes_count + ich};
+	qsort(sorted, total, sizeof(remote_read_change_t), resource_sourced_read_change_compare);
+
+	// Keep the last change of each key and platform, which is the latest and for equal timestamps the delta one
+	uint32_t count = 0;
+	size_t values_size = 0;
+	for (uint32_t ich = 0; ich < total; ++ich) {
+		const sourced_change_t* change = sorted[ich].change;
+		if ((ich + 1 < total) && (sorted[ich + 1].change->hash == change->hash) &&
+		    (sorted[ich + 1].change->platform == change->platform))
+			continue;
+		if (!(change->flags & (RESOURCE_SOURCEFLAG_VALUE | RESOURCE_SOURCEFLAG_BLOB)))
+			continue;
+		if (resource_sourced_read_change_is_value(change))
+			values_size += change->value.value.length;
+		sorted[count++] = sorted[ich];
+	}
+
+	size_t values_offset = sizeof(sourced_change_t) * count;
+	*size = sizeof(sourced_read_result_t) + values_offset + values_size;
+	sourced_read_result_t* merged = memory_allocate(HASH_RESOURCE, *size, 0, MEMORY_PERSISTENT);
+	merged->result = SOURCED_OK;
+	merged->flags = 0;
+	merged->hash = delta->hash;
+	merged->changes_count = count;
+
+	// Value offsets are relative to the start of the change array, rebase them into the new value area
+	char* values = pointer_offset(merged->payload, values_offset);
+	size_t offset = values_offset;
+	for (uint32_t ich = 0; ich < count; ++ich) {
+		sourced_change_t* change = merged->payload + ich;
+		*change = *sorted[ich].change;
+		if (resource_sourced_read_change_is_value(change)) {
+			memcpy(values, sorted[ich].values + change->value.value.offset, change->value.value.length);
+			values += change->value.value.length;
+			change->value.value.offset = offset;
+			offset += change->value.value.length;
+		}
+	}
+
+	memory_deallocate(sorted);
+	return merged;
+}
+
+/*! Apply a read reply to the source and update the cached read of the resource. Not modified and
+delta replies are based on the cached read the request was made with, if it has since been
+replaced the read must be repeated in full. Takes ownership of the reply if it is cached
+\return 1 if applied, REMOTE_READ_STALE if the read must be repeated, 0 if failed */
+static uint32_t
+resource_sourced_read_update(const remote_message_t* waiting, sourced_read_result_t** reply, size_t reply_size) {
+	sourced_read_result_t* result = *reply;
+	resource_source_t* source = waiting->store;
+	uint32_t status = 0;
+
+	mutex_lock(sourced_cache_lock);
+	remote_cache_entry_t* entry = resource_sourced_cache_entry(waiting->uuid, 0);
+	bool based = !blake3_hash_is_null(waiting->hash) && (entry->flags & REMOTE_CACHE_READ) &&
+	             uuid_equal(entry->uuid, waiting->uuid) && !entry->platform &&
+	             blake3_hash_equal(entry->read->hash, waiting->hash);
+	if (result->result == SOURCED_NOT_MODIFIED) {
+		if (based) {
+			resource_sourced_read_apply(source, entry->read);
+			status = 1;
+		} else {
+			status = REMOTE_READ_STALE;
+		}
+	} else if (result->flags & SOURCED_READ_FLAG_DELTA) {
+		if (based) {
+			size_t merged_size = 0;
+			sourced_read_result_t* merged = resource_sourced_read_merge(entry->read, result, &merged_size);
+			memory_deallocate(entry->read);
+			entry->read = merged;
+			entry->read_size = merged_size;
+			entry->read_since = resource_sourced_read_latest(result, entry->read_since);
+			resource_sourced_read_apply(source, merged);
+			status = 1;
+		} else {
+			status = REMOTE_READ_STALE;
+		}
+	} else {
+		resource_sourced_read_apply(source, result);
+		if (!blake3_hash_is_null(result->hash)) {
+			entry = resource_sourced_cache_store(waiting->uuid, 0);
+			resource_sourced_cache_clear(entry, REMOTE_CACHE_READ);
+			entry->read = result;
+			entry->read_size = reply_size;
+			entry->read_since = resource_sourced_read_latest(result, 0);
+			entry->flags |= REMOTE_CACHE_READ;
+			*reply = nullptr;
+		}
+		status = 1;
+	}
+	mutex_unlock(sourced_cache_lock);
+
+	return status;
+}
+
+static void
+resource_sourced_connected(remote_context_t* context) {
+	// Notifies may have been missed while disconnected, cached reads are verified by hash and can be kept
+	resource_sourced_cache_flush(REMOTE_CACHE_DEPENDENCIES | REMOTE_CACHE_REVERSE_DEPENDENCIES);
+	// Features are negotiated again for each connection, replies are uncompressed until the service enables them
+	context->features = 0;
+	sourced_write_hello(context->remote, 0, SOURCED_FEATURE_COMPRESSION);
+}
+
+static int
+resource_sourced_read_hello_result(remote_context_t* context, remote_header_t msg) {
+	sourced_hello_result_t result;
+	if (sourced_read_hello_reply(context->remote, msg.size, &result) < 0)
+		return -1;
+	context->features = result.features;
+	log_infof(HASH_RESOURCE, STRING_CONST("Remote sourced service protocol version %u, features 0x%x"),
+	          result.version, result.features);
+	return 1;  // Not a reply to a waiting request
+}
+
 static int
-resource_sourced_read_lookup_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_sourced_read_lookup_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	sourced_lookup_result_t reply;
 	log_info(HASH_RESOURCE, STRING_CONST("Read lookup result from remote sourced service"));
 	int ret = sourced_read_lookup_reply(context->remote, msg.size, &reply);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_LOOKUP)) {
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_LOOKUP)) {
 		resource_signature_t sig = {reply.uuid, reply.hash};
-		udp_socket_sendto(context->control, &sig, sizeof(sig), socket_address_local(context->client));
+		resource_remote_complete(request, &sig, sizeof(sig));
 	}
 	return ret;
 }
 
 static int
-resource_sourced_read_read_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
-	sourced_read_result_t* reply = memory_allocate(HASH_RESOURCE, msg.size, 0, MEMORY_PERSISTENT);
+resource_sourced_read_read_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	sourced_read_result_t* reply = nullptr;
+	size_t reply_size = 0;
 	log_info(HASH_RESOURCE, STRING_CONST("Read read result from remote sourced service"));
-	int ret = sourced_read_read_reply(context->remote, msg.size, reply);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_READ)) {
+	int ret = sourced_read_read_reply(context->remote, msg.size, msg.flags, &reply, &reply_size);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_READ)) {
 		uint32_t status = 0;
-		if ((reply->result == SOURCED_OK) && (msg.size >= sizeof(sourced_read_result_t))) {
-			sourced_change_t* change = reply->payload;
-			resource_source_t* source = waiting.store;
-			for (uint32_t ich = 0; ich < reply->changes_count; ++ich, ++change) {
-				if (change->flags & RESOURCE_SOURCEFLAG_BLOB)
-					resource_source_set_blob(source, change->timestamp, change->hash, change->platform,
-					                         change->value.blob.checksum, change->value.blob.size);
-				else if (change->flags & RESOURCE_SOURCEFLAG_VALUE)
-					resource_source_set(source, change->timestamp, change->hash, change->platform,
-					                    pointer_offset(reply->payload, change->value.value.offset),
-					                    change->value.value.length);
-				else
-					resource_source_unset(source, change->timestamp, change->hash, change->platform);
-			}
-			status = 1;
-		}
-		udp_socket_sendto(context->control, &status, sizeof(status), socket_address_local(context->client));
+		if ((reply_size >= sizeof(sourced_read_result_t)) &&
+		    (reply_size >= sizeof(sourced_read_result_t) + (sizeof(sourced_change_t) * reply->changes_count)) &&
+		    ((reply->result == SOURCED_OK) || (reply->result == SOURCED_NOT_MODIFIED)))
+			status = resource_sourced_read_update(waiting, &reply, reply_size);
+		resource_remote_complete(request, &status, sizeof(status));
 	}
 	memory_deallocate(reply);
 
@@ -348,55 +1134,124 @@ resource_sourced_read_read_result(remote_context_t* context, remote_header_t msg
 }
 
 static int
-resource_sourced_read_hash_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_sourced_read_hash_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	sourced_hash_result_t result;
 	log_info(HASH_RESOURCE, STRING_CONST("Read hash result from remote sourced service"));
 	int ret = sourced_read_hash_reply(context->remote, msg.size, &result);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_HASH))
-		udp_socket_sendto(context->control, &result.hash, sizeof(result.hash), socket_address_local(context->client));
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_HASH))
+		resource_remote_complete(request, &result.hash, sizeof(result.hash));
 	return ret;
 }
 
 static int
-resource_sourced_read_dependencies_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_sourced_read_dependencies_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	uint64_t count = 0;
 	log_info(HASH_RESOURCE, STRING_CONST("Read dependencies result from remote sourced service"));
-	int ret = sourced_read_dependencies_reply(context->remote, msg.size, waiting.store, waiting.capacity, &count);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_DEPENDENCIES))
-		udp_socket_sendto(context->control, &count, sizeof(count), socket_address_local(context->client));
+	int ret = sourced_read_dependencies_reply(context->remote, msg.size, waiting->store, waiting->capacity, &count);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_DEPENDENCIES))
+		resource_remote_complete(request, &count, sizeof(count));
 	return ret;
 }
 
 static int
 resource_sourced_read_reverse_dependencies_result(remote_context_t* context, remote_header_t msg,
-                                                  remote_message_t waiting) {
+                                                  remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	uint64_t count = 0;
 	log_info(HASH_RESOURCE, STRING_CONST("Read reverse dependencies result from remote sourced service"));
 	int ret =
-	    sourced_read_reverse_dependencies_reply(context->remote, msg.size, waiting.store, waiting.capacity, &count);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_REVERSE_DEPENDENCIES))
-		udp_socket_sendto(context->control, &count, sizeof(count), socket_address_local(context->client));
+	    sourced_read_reverse_dependencies_reply(context->remote, msg.size, waiting->store, waiting->capacity, &count);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_REVERSE_DEPENDENCIES))
+		resource_remote_complete(request, &count, sizeof(count));
 	return ret;
 }
 
 static int
-resource_sourced_read_read_blob_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_sourced_read_read_blob_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	log_info(HASH_RESOURCE, STRING_CONST("Read read blob result from remote sourced service"));
 	sourced_read_blob_reply_t reply;
-	int ret = sourced_read_read_blob_reply(context->remote, msg.size, &reply, waiting.store, waiting.capacity);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_READ_BLOB)) {
-		uint32_t status = ((waiting.checksum == reply.checksum) && (waiting.capacity >= reply.size)) ? 1 : 0;
-		udp_socket_sendto(context->control, &status, sizeof(status), socket_address_local(context->client));
+	int ret = sourced_read_read_blob_reply(context->remote, msg.size, msg.flags, &reply, waiting->store,
+	                                       waiting->capacity);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_READ_BLOB)) {
+		uint32_t status = ((waiting->checksum == reply.checksum) && (waiting->capacity >= reply.size)) ? 1 : 0;
+		resource_remote_complete(request, &status, sizeof(status));
 	}
 	return ret;
 }
 
+static int
+resource_sourced_read_lookup_batch_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	uint64_t count = 0;
+	log_info(HASH_RESOURCE, STRING_CONST("Read lookup batch result from remote sourced service"));
+	resource_signature_t* store = (waiting->message == REMOTE_MESSAGE_LOOKUP_BATCH) ? waiting->store : nullptr;
+	size_t capacity = store ? waiting->capacity : 0;
+	int ret = sourced_read_lookup_batch_reply(context->remote, msg.size, store, capacity, &count);
+	if ((ret >= 0) && store)
+		resource_remote_complete(request, &count, sizeof(count));
+	return ret;
+}
+
+static int
+resource_sourced_read_hash_batch_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	uint64_t count = 0;
+	log_info(HASH_RESOURCE, STRING_CONST("Read hash batch result from remote sourced service"));
+	blake3_hash_t* store = (waiting->message == REMOTE_MESSAGE_HASH_BATCH) ? waiting->store : nullptr;
+	size_t capacity = store ? waiting->capacity : 0;
+	int ret = sourced_read_hash_batch_reply(context->remote, msg.size, store, capacity, &count);
+	if ((ret >= 0) && store)
+		resource_remote_complete(request, &count, sizeof(count));
+	return ret;
+}
+
+static int
+resource_sourced_read_dependencies_batch_result(remote_context_t* context, remote_header_t msg,
+                                                remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	uint64_t total = 0;
+	log_info(HASH_RESOURCE, STRING_CONST("Read dependencies batch result from remote sourced service"));
+	bool match = (waiting->message == REMOTE_MESSAGE_DEPENDENCIES_BATCH);
+	int ret = sourced_read_dependencies_batch_reply(context->remote, msg.size, match ? waiting->counts : nullptr,
+	                                                match ? waiting->size : 0, match ? waiting->store : nullptr,
+	                                                match ? waiting->capacity : 0, &total);
+	if ((ret >= 0) && match)
+		resource_remote_complete(request, &total, sizeof(total));
+	return ret;
+}
+
+//! Reply to a manifest call, the signatures are stored in the destination given in the message
+struct remote_manifest_reply_t {
+	uint64_t count;
+	uint64_t token;
+	uint32_t flags;
+};
+
+typedef struct remote_manifest_reply_t remote_manifest_reply_t;
+
+static int
+resource_sourced_read_manifest_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	remote_manifest_reply_t reply = {0, 0, 0};
+	log_info(HASH_RESOURCE, STRING_CONST("Read manifest result from remote sourced service"));
+	bool match = (waiting->message == REMOTE_MESSAGE_MANIFEST);
+	int ret = sourced_read_manifest_reply(context->remote, msg.size, match ? waiting->store : nullptr,
+	                                      match ? waiting->capacity : 0, &reply.count, &reply.token, &reply.flags);
+	if ((ret >= 0) && match)
+		resource_remote_complete(request, &reply, sizeof(reply));
+	return ret;
+}
+
 static int
 resource_sourced_read_notify(remote_context_t* context, remote_header_t msg) {
 	log_info(HASH_RESOURCE, STRING_CONST("Read notify from remote sourced service"));
 	sourced_notify_t notify;
 	int ret = sourced_read_notify(context->remote, msg.size, &notify);
 	if (ret >= 0) {
+		resource_sourced_cache_invalidate(notify.uuid, msg.id);
 		switch (msg.id) {
 			case SOURCED_NOTIFY_CREATE:
 				resource_event_post(RESOURCEEVENT_CREATE, notify.uuid, notify.platform, notify.token);
@@ -417,25 +1272,37 @@ resource_sourced_read_notify(remote_context_t* context, remote_header_t msg) {
 }
 
 static int
-resource_sourced_read(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_sourced_read(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
 	switch (msg.id) {
 		case SOURCED_LOOKUP_RESULT:
-			return resource_sourced_read_lookup_result(context, msg, waiting);
+			return resource_sourced_read_lookup_result(context, msg, request);
 
 		case SOURCED_READ_RESULT:
-			return resource_sourced_read_read_result(context, msg, waiting);
+			return resource_sourced_read_read_result(context, msg, request);
 
 		case SOURCED_HASH_RESULT:
-			return resource_sourced_read_hash_result(context, msg, waiting);
+			return resource_sourced_read_hash_result(context, msg, request);
 
 		case SOURCED_DEPENDENCIES_RESULT:
-			return resource_sourced_read_dependencies_result(context, msg, waiting);
+			return resource_sourced_read_dependencies_result(context, msg, request);
 
 		case SOURCED_REVERSE_DEPENDENCIES_RESULT:
-			return resource_sourced_read_reverse_dependencies_result(context, msg, waiting);
+			return resource_sourced_read_reverse_dependencies_result(context, msg, request);
 
 		case SOURCED_READ_BLOB_RESULT:
-			return resource_sourced_read_read_blob_result(context, msg, waiting);
+			return resource_sourced_read_read_blob_result(context, msg, request);
+
+		case SOURCED_LOOKUP_BATCH_RESULT:
+			return resource_sourced_read_lookup_batch_result(context, msg, request);
+
+		case SOURCED_HASH_BATCH_RESULT:
+			return resource_sourced_read_hash_batch_result(context, msg, request);
+
+		case SOURCED_DEPENDENCIES_BATCH_RESULT:
+			return resource_sourced_read_dependencies_batch_result(context, msg, request);
+
+		case SOURCED_MANIFEST_RESULT:
+			return resource_sourced_read_manifest_result(context, msg, request);
 
 		case SOURCED_NOTIFY_CREATE:
 		case SOURCED_NOTIFY_MODIFY:
@@ -443,6 +1310,9 @@ resource_sourced_read(remote_context_t* context, remote_header_t msg, remote_mes
 		case SOURCED_NOTIFY_DELETE:
 			return resource_sourced_read_notify(context, msg);
 
+		case SOURCED_HELLO_RESULT:
+			return resource_sourced_read_hello_result(context, msg);
+
 		default:
 			break;
 	}
@@ -450,53 +1320,96 @@ resource_sourced_read(remote_context_t* context, remote_header_t msg, remote_mes
 }
 
 static int
-resource_sourced_write(remote_context_t* context, remote_message_t waiting) {
-	switch (waiting.message) {
+resource_sourced_write(remote_context_t* context, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	int ret = 0;
+	switch (waiting->message) {
 		case REMOTE_MESSAGE_LOOKUP:
 			log_info(HASH_RESOURCE, STRING_CONST("Write lookup message to remote sourced service"));
-			if (sourced_write_lookup(context->remote, waiting.data, waiting.size) < 0) {
+			if (sourced_write_lookup(context->remote, waiting->request, waiting->data, waiting->size) < 0) {
 				resource_signature_t sig = {uuid_null(), blake3_hash_null()};
-				udp_socket_sendto(context->control, &sig, sizeof(sig), socket_address_local(context->client));
+				resource_remote_complete(request, &sig, sizeof(sig));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_READ:
 			log_info(HASH_RESOURCE, STRING_CONST("Write read message to remote sourced service"));
-			if (sourced_write_read(context->remote, waiting.uuid) < 0) {
+			if (sourced_write_read(context->remote, waiting->request, waiting->uuid, waiting->hash, waiting->since) <
+			    0) {
 				uint32_t status = 0;
-				udp_socket_sendto(context->control, &status, sizeof(status), socket_address_local(context->client));
+				resource_remote_complete(request, &status, sizeof(status));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_HASH:
 			log_info(HASH_RESOURCE, STRING_CONST("Write hash message to remote sourced service"));
-			if (sourced_write_hash(context->remote, waiting.uuid, waiting.platform) < 0) {
+			if (sourced_write_hash(context->remote, waiting->request, waiting->uuid, waiting->platform) < 0) {
 				blake3_hash_t result = blake3_hash_null();
-				udp_socket_sendto(context->control, &result, sizeof(result), socket_address_local(context->client));
+				resource_remote_complete(request, &result, sizeof(result));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_DEPENDENCIES:
 			log_info(HASH_RESOURCE, STRING_CONST("Write dependencies message to remote sourced service"));
-			if (sourced_write_dependencies(context->remote, waiting.uuid, waiting.platform) < 0) {
+			if (sourced_write_dependencies(context->remote, waiting->request, waiting->uuid, waiting->platform) < 0) {
 				uint64_t count = 0;
-				udp_socket_sendto(context->control, &count, sizeof(count), socket_address_local(context->client));
+				resource_remote_complete(request, &count, sizeof(count));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_REVERSE_DEPENDENCIES:
 			log_info(HASH_RESOURCE, STRING_CONST("Write reverse dependencies message to remote sourced service"));
-			if (sourced_write_reverse_dependencies(context->remote, waiting.uuid, waiting.platform) < 0) {
+			if (sourced_write_reverse_dependencies(context->remote, waiting->request, waiting->uuid,
+			                                       waiting->platform) < 0) {
 				uint64_t count = 0;
-				udp_socket_sendto(context->control, &count, sizeof(count), socket_address_local(context->client));
+				resource_remote_complete(request, &count, sizeof(count));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_READ_BLOB:
 			log_info(HASH_RESOURCE, STRING_CONST("Write read blob message to remote sourced service"));
-			if (sourced_write_read_blob(context->remote, waiting.uuid, waiting.platform, waiting.key) < 0) {
+			if (sourced_write_read_blob(context->remote, waiting->request, waiting->uuid, waiting->platform,
+			                            waiting->key) < 0) {
 				uint32_t status = 0;
-				udp_socket_sendto(context->control, &status, sizeof(status), socket_address_local(context->client));
+				resource_remote_complete(request, &status, sizeof(status));
+				ret = -1;
+			}
+			break;
+
+		case REMOTE_MESSAGE_LOOKUP_BATCH:
+		case REMOTE_MESSAGE_HASH_BATCH:
+		case REMOTE_MESSAGE_DEPENDENCIES_BATCH: {
+			int written;
+			log_info(HASH_RESOURCE, STRING_CONST("Write batch message to remote sourced service"));
+			if (waiting->message == REMOTE_MESSAGE_LOOKUP_BATCH)
+				written = sourced_write_lookup_batch(context->remote, waiting->request, waiting->data, waiting->size);
+			else if (waiting->message == REMOTE_MESSAGE_HASH_BATCH)
+				written = sourced_write_hash_batch(context->remote, waiting->request, waiting->data, waiting->size,
+				                                   waiting->platform);
+			else
+				written = sourced_write_dependencies_batch(context->remote, waiting->request, waiting->data,
+				                                           waiting->size, waiting->platform);
+			if (written < 0) {
+				uint64_t count = 0;
+				resource_remote_complete(request, &count, sizeof(count));
+				ret = -1;
+			}
+			break;
+		}
+
+		case REMOTE_MESSAGE_MANIFEST:
+			log_info(HASH_RESOURCE, STRING_CONST("Write manifest message to remote sourced service"));
+			// Offset holds the since token, UUID the last resource of the previous part
+			if (sourced_write_manifest(context->remote, waiting->request, waiting->data, waiting->size,
+			                           waiting->platform, waiting->offset, waiting->uuid) < 0) {
+				remote_manifest_reply_t reply = {0, 0, 0};
+				resource_remote_complete(request, &reply, sizeof(reply));
+				ret = -1;
 			}
 			break;
 
@@ -504,7 +1417,7 @@ resource_sourced_write(remote_context_t* context, remote_message_t waiting) {
 			break;
 	}
 
-	return 0;
+	return ret;
 }
 
 static void
@@ -513,6 +1426,8 @@ resource_remote_sourced_initialize(const char* url, size_t length) {
 		return;
 	if (!resource_module_config().enable_remote_sourced)
 		return;
+	if (!resource_remote_url_is_supported(url, length))
+		return;
 
 	network_address_t** localaddr = network_address_local();
 	udp_socket_initialize(&sourced_client);
@@ -528,8 +1443,13 @@ resource_remote_sourced_initialize(const char* url, size_t length) {
 	sourced_context.url = string_to_const(sourced_url);
 	sourced_context.client = &sourced_client;
 	sourced_context.control = &sourced_proxy;
+	atomic_store_ptr(&sourced_context.submitted, nullptr, memory_order_release);
+	atomic_store32(&sourced_context.latency, 0, memory_order_release);
+	atomic_store64(&sourced_context.degraded_until, 0, memory_order_release);
+	atomic_store32(&sourced_context.active, 1, memory_order_release);
 	sourced_context.read = resource_sourced_read;
 	sourced_context.write = resource_sourced_write;
+	sourced_context.connected = resource_sourced_connected;
 
 	thread_initialize(&sourced_thread, resource_remote_comm, &sourced_context, STRING_CONST("sourced-client"),
 	                  THREAD_PRIORITY_NORMAL, 0);
@@ -542,12 +1462,15 @@ resource_remote_sourced_finalize(void) {
 		return;
 
 	sourced_initialized = false;
+	atomic_store32(&sourced_context.active, 0, memory_order_seq_cst);
 
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_TERMINATE;
 	udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy));
 
 	thread_finalize(&sourced_thread);
+	resource_remote_drain(&sourced_context);
+	resource_sourced_cache_flush(REMOTE_CACHE_DEPENDENCIES | REMOTE_CACHE_REVERSE_DEPENDENCIES | REMOTE_CACHE_READ);
 	string_deallocate(sourced_url.str);
 
 	socket_finalize(&sourced_client);
@@ -575,6 +1498,11 @@ resource_remote_sourced_is_connected(void) {
 	return sourced_url.length > 0;
 }
 
+bool
+resource_remote_sourced_is_available(void) {
+	return sourced_initialized && resource_remote_is_available(&sourced_context);
+}
+
 resource_signature_t
 resource_remote_sourced_lookup(const char* path, size_t length) {
 	resource_signature_t nullsig = {uuid_null(), blake3_hash_null()};
@@ -586,12 +1514,7 @@ resource_remote_sourced_lookup(const char* path, size_t length) {
 	message.message = REMOTE_MESSAGE_LOOKUP;
 	message.data = path;
 	message.size = length;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return sig;
-
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &sig, sizeof(sig), &addr) == sizeof(sig))
+	if (resource_remote_call(&sourced_context, &message, &sig, sizeof(sig), 0) == sizeof(sig))
 		return sig;
 
 	return nullsig;
@@ -603,17 +1526,19 @@ resource_remote_sourced_hash(uuid_t uuid, uint64_t platform) {
 	if (!sourced_initialized)
 		return ret;
 
+	uint32_t generation;
+	if (resource_sourced_cache_hash(uuid, platform, &ret, &generation))
+		return ret;
+
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_HASH;
 	message.uuid = uuid;
 	message.platform = platform;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return ret;
-
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &ret, sizeof(ret), &addr) == sizeof(ret))
+	if (resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) == sizeof(ret)) {
+		if (!blake3_hash_is_null(ret))
+			resource_sourced_cache_set_hash(uuid, platform, ret, generation);
 		return ret;
+	}
 
 	return blake3_hash_null();
 }
@@ -623,20 +1548,26 @@ resource_remote_sourced_dependencies(uuid_t uuid, uint64_t platform, resource_de
 	if (!sourced_initialized)
 		return 0;
 
+	size_t count;
+	uint32_t generation;
+	if (resource_sourced_cache_dependencies(uuid, platform, REMOTE_CACHE_DEPENDENCIES, deps, capacity, &count,
+	                                        &generation))
+		return count;
+
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_DEPENDENCIES;
 	message.uuid = uuid;
 	message.platform = platform;
 	message.store = deps;
 	message.capacity = capacity;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return 0;
 
 	uint64_t ret;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &ret, sizeof(ret), &addr) == sizeof(ret))
+	if (resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) == sizeof(ret)) {
+		if (ret <= capacity)
+			resource_sourced_cache_set_dependencies(uuid, platform, REMOTE_CACHE_DEPENDENCIES, deps, (size_t)ret,
+			                                        generation);
 		return (size_t)ret;
+	}
 
 	return 0;
 }
@@ -647,20 +1578,26 @@ resource_remote_sourced_reverse_dependencies(uuid_t uuid, uint64_t platform, res
 	if (!sourced_initialized)
 		return 0;
 
+	size_t count;
+	uint32_t generation;
+	if (resource_sourced_cache_dependencies(uuid, platform, REMOTE_CACHE_REVERSE_DEPENDENCIES, deps, capacity,
+	                                        &count, &generation))
+		return count;
+
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_REVERSE_DEPENDENCIES;
 	message.uuid = uuid;
 	message.platform = platform;
 	message.store = deps;
 	message.capacity = capacity;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return 0;
 
 	uint64_t ret;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &ret, sizeof(ret), &addr) == sizeof(ret))
+	if (resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) == sizeof(ret)) {
+		if (ret <= capacity)
+			resource_sourced_cache_set_dependencies(uuid, platform, REMOTE_CACHE_REVERSE_DEPENDENCIES, deps,
+			                                        (size_t)ret, generation);
 		return (size_t)ret;
+	}
 
 	return 0;
 }
@@ -674,16 +1611,25 @@ resource_remote_sourced_read(resource_source_t* source, uuid_t uuid) {
 	message.message = REMOTE_MESSAGE_READ;
 	message.store = source;
 	message.uuid = uuid;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return false;
+
+	// Only fetch changes newer than the cached read, if any
+	if (!resource_sourced_cache_read_base(uuid, &message.hash, &message.since)) {
+		message.hash = blake3_hash_null();
+		message.since = 0;
+	}
 
 	uint32_t status = 0;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &status, sizeof(status), &addr) == sizeof(status))
-		return status > 0;
+	if (resource_remote_call(&sourced_context, &message, &status, sizeof(status), 0) != sizeof(status))
+		return false;
+	if (status == REMOTE_READ_STALE) {
+		message.hash = blake3_hash_null();
+		message.since = 0;
+		status = 0;
+		if (resource_remote_call(&sourced_context, &message, &status, sizeof(status), 0) != sizeof(status))
+			return false;
+	}
 
-	return false;
+	return status == 1;
 }
 
 bool
@@ -700,18 +1646,205 @@ resource_remote_sourced_read_blob(const uuid_t uuid, hash_t key, uint64_t platfo
 	message.checksum = checksum;
 	message.store = data;
 	message.capacity = capacity;
-	if (udp_socket_sendto(&sourced_client, &message, sizeof(message), socket_address_local(&sourced_proxy)) !=
-	    sizeof(message))
-		return false;
 
 	uint32_t status = 0;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&sourced_client, &status, sizeof(status), &addr) == sizeof(status))
+	if (resource_remote_call(&sourced_context, &message, &status, sizeof(status), 0) == sizeof(status))
 		return status > 0;
 
 	return false;
 }
 
+size_t
+resource_remote_sourced_lookup_batch(const string_const_t* paths, size_t count, resource_signature_t* signatures) {
+	if (!sourced_initialized)
+		return 0;
+
+	size_t offset = 0;
+	while (offset < count) {
+		size_t batch = count - offset;
+		if (batch > SOURCED_BATCH_MAX)
+			batch = SOURCED_BATCH_MAX;
+
+		remote_message_t message;
+		message.message = REMOTE_MESSAGE_LOOKUP_BATCH;
+		message.data = paths + offset;
+		message.size = batch;
+		message.store = signatures + offset;
+		message.capacity = batch;
+
+		uint64_t ret = 0;
+		if ((resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) != sizeof(ret)) || (ret != batch))
+			break;
+		offset += batch;
+	}
+
+	return offset;
+}
+
+size_t
+resource_remote_sourced_hash_batch(const uuid_t* uuids, size_t count, uint64_t platform, blake3_hash_t* hashes) {
+	if (!sourced_initialized)
+		return 0;
+
+	// Answer what is possible from the cache and only request the rest
+	uint32_t generation = 0;
+	uuid_t* missing = nullptr;
+	size_t* missing_index = nullptr;
+	for (size_t iuuid = 0; iuuid < count; ++iuuid) {
+		if (!resource_sourced_cache_hash(uuids[iuuid], platform, hashes + iuuid, &generation)) {
+			array_push(missing, uuids[iuuid]);
+			array_push(missing_index, iuuid);
+		}
+	}
+
+	size_t failed = 0;
+	blake3_hash_t* result = nullptr;
+	size_t missing_count = array_size(missing);
+	if (missing_count)
+		array_resize(result, missing_count < SOURCED_BATCH_MAX ? missing_count : SOURCED_BATCH_MAX);
+	for (size_t offset = 0; offset < missing_count;) {
+		size_t batch = missing_count - offset;
+		if (batch > SOURCED_BATCH_MAX)
+			batch = SOURCED_BATCH_MAX;
+
+		remote_message_t message;
+		message.message = REMOTE_MESSAGE_HASH_BATCH;
+		message.data = missing + offset;
+		message.size = batch;
+		message.platform = platform;
+		message.store = result;
+		message.capacity = batch;
+
+		uint64_t ret = 0;
+		if ((resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) != sizeof(ret)) || (ret != batch)) {
+			for (size_t iuuid = 0; iuuid < batch; ++iuuid)
+				hashes[missing_index[offset + iuuid]] = blake3_hash_null();
+			failed += batch;
+		} else {
+			for (size_t iuuid = 0; iuuid < batch; ++iuuid) {
+				hashes[missing_index[offset + iuuid]] = result[iuuid];
+				if (!blake3_hash_is_null(result[iuuid]))
+					resource_sourced_cache_set_hash(missing[offset + iuuid], platform, result[iuuid], generation);
+			}
+		}
+		offset += batch;
+	}
+
+	array_deallocate(result);
+	array_deallocate(missing_index);
+	array_deallocate(missing);
+
+	return count - failed;
+}
+
+int
+resource_remote_sourced_dependencies_batch(const uuid_t* uuids, size_t count, uint64_t platform, size_t* deps_count,
+                                           resource_dependency_t* deps, size_t capacity, size_t* total) {
+	*total = 0;
+	if (!sourced_initialized)
+		return -1;
+
+	memset(deps_count, 0, sizeof(size_t) * count);
+
+	// Each request fills the destination after the dependencies stored by earlier requests
+	for (size_t offset = 0; offset < count;) {
+		size_t batch = count - offset;
+		if (batch > SOURCED_BATCH_MAX)
+			batch = SOURCED_BATCH_MAX;
+		size_t stored = (*total < capacity) ? *total : capacity;
+
+		remote_message_t message;
+		message.message = REMOTE_MESSAGE_DEPENDENCIES_BATCH;
+		message.data = uuids + offset;
+		message.size = batch;
+		message.platform = platform;
+		message.counts = deps_count + offset;
+		message.store = deps + stored;
+		message.capacity = capacity - stored;
+
+		uint64_t ret = 0;
+		if (resource_remote_call(&sourced_context, &message, &ret, sizeof(ret), 0) != sizeof(ret))
+			return -1;
+		*total += (size_t)ret;
+		offset += batch;
+	}
+
+	return 0;
+}
+
+size_t
+resource_remote_sourced_manifest(const uuid_t* uuids, size_t count, uint64_t platform, uint64_t since,
+                                 resource_signature_t* signatures, size_t capacity, uint64_t* token, bool* complete) {
+	*token = 0;
+	*complete = false;
+	if (!sourced_initialized || (count > SOURCED_BATCH_MAX))
+		return 0;
+
+	remote_message_t message;
+	message.message = REMOTE_MESSAGE_MANIFEST;
+	message.data = uuids;
+	message.size = count;
+	message.platform = platform;
+	message.offset = since;
+	message.uuid = uuid_null();
+	message.store = signatures;
+	message.capacity = capacity;
+
+	// Take generation before the call, hashes of resources changed during the call are not cached
+	uint32_t generation = resource_sourced_cache_generation();
+
+	// Manifest of all resources is received in parts, each part is stored in a separate buffer
+	// as the last UUID of a part is needed to request the next even if the destination is full
+	resource_signature_t* part = nullptr;
+	if (!count)
+		part = memory_allocate(HASH_RESOURCE, sizeof(resource_signature_t) * SOURCED_MANIFEST_REPLY_MAX, 0,
+		                       MEMORY_PERSISTENT);
+
+	uint64_t first_token = 0;
+	uint64_t total = 0;
+	bool all = true;
+	while (true) {
+		if (part) {
+			message.store = part;
+			message.capacity = SOURCED_MANIFEST_REPLY_MAX;
+		}
+
+		remote_manifest_reply_t reply = {0, 0, 0};
+		if (resource_remote_call(&sourced_context, &message, &reply, sizeof(reply),
+		                         RESOURCE_REMOTE_MANIFEST_TIMEOUT) != sizeof(reply)) {
+			total = 0;
+			first_token = 0;
+			break;
+		}
+
+		const resource_signature_t* received = message.store;
+		size_t stored = (reply.count < message.capacity) ? (size_t)reply.count : message.capacity;
+		for (size_t isig = 0; isig < stored; ++isig) {
+			if (!blake3_hash_is_null(received[isig].hash))
+				resource_sourced_cache_set_hash(received[isig].uuid, platform, received[isig].hash, generation);
+		}
+		if (part && (total < capacity)) {
+			size_t copy = ((capacity - total) < stored) ? (size_t)(capacity - total) : stored;
+			memcpy(signatures + total, part, sizeof(resource_signature_t) * copy);
+		}
+
+		// Token of the first part is passed on, changes made while receiving later parts are in the next manifest
+		if (!first_token)
+			first_token = reply.token;
+		total += reply.count;
+		all = all && ((reply.flags & SOURCED_MANIFEST_FLAG_COMPLETE) != 0);
+
+		if (!part || !(reply.flags & SOURCED_MANIFEST_FLAG_PARTIAL) || !stored)
+			break;
+		message.uuid = part[stored - 1].uuid;
+	}
+	memory_deallocate(part);
+
+	*token = first_token;
+	*complete = (first_token != 0) && all;
+	return (size_t)total;
+}
+
 #else
 
 string_const_t
@@ -734,6 +1867,11 @@ resource_remote_sourced_is_connected(void) {
 	return false;
 }
 
+bool
+resource_remote_sourced_is_available(void) {
+	return false;
+}
+
 resource_signature_t
 resource_remote_sourced_lookup(const char* path, size_t length) {
 	FOUNDATION_UNUSED(path);
@@ -787,18 +1925,92 @@ resource_remote_sourced_read_blob(const uuid_t uuid, hash_t key, uint64_t platfo
 	return false;
 }
 
+size_t
+resource_remote_sourced_lookup_batch(const string_const_t* paths, size_t count, resource_signature_t* signatures) {
+	FOUNDATION_UNUSED(paths);
+	FOUNDATION_UNUSED(count);
+	FOUNDATION_UNUSED(signatures);
+	return 0;
+}
+
+size_t
+resource_remote_sourced_hash_batch(const uuid_t* uuids, size_t count, uint64_t platform, blake3_hash_t* hashes) {
+	FOUNDATION_UNUSED(uuids);
+	FOUNDATION_UNUSED(count);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(hashes);
+	return 0;
+}
+
+int
+resource_remote_sourced_dependencies_batch(const uuid_t* uuids, size_t count, uint64_t platform, size_t* deps_count,
+                                           resource_dependency_t* deps, size_t capacity, size_t* total) {
+	FOUNDATION_UNUSED(uuids);
+	FOUNDATION_UNUSED(count);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(deps_count);
+	FOUNDATION_UNUSED(deps);
+	FOUNDATION_UNUSED(capacity);
+	*total = 0;
+	return -1;
+}
+
+size_t
+resource_remote_sourced_manifest(const uuid_t* uuids, size_t count, uint64_t platform, uint64_t since,
+                                 resource_signature_t* signatures, size_t capacity, uint64_t* token, bool* complete) {
+	FOUNDATION_UNUSED(uuids);
+	FOUNDATION_UNUSED(count);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(since);
+	FOUNDATION_UNUSED(signatures);
+	FOUNDATION_UNUSED(capacity);
+	*token = 0;
+	*complete = false;
+	return 0;
+}
+
 #endif
 
 #if RESOURCE_ENABLE_REMOTE_COMPILED
 
 #include <resource/compiled.h>
 
+typedef struct compiled_connection_t compiled_connection_t;
+
+//! Connection to the compile daemon, each with its own comm thread so streams can be open concurrently
+struct compiled_connection_t {
+	thread_t thread;
+	socket_t client;
+	socket_t proxy;
+	remote_context_t context;
+	//! Receive buffer for the stream currently reading from the connection
+	void* buffer;
+	//! Compressed chunk buffer for framed streams
+	void* scratch;
+};
+
+//! Number of notifications remembered to post each only once when received on all connections
+#define COMPILED_NOTIFY_HISTORY 256
+
+typedef struct compiled_notify_key_t compiled_notify_key_t;
+
+struct compiled_notify_key_t {
+	uint32_t id;
+	uuid_t uuid;
+	uint64_t platform;
+	hash_t token;
+};
+
 static bool compiled_initialized;
 static string_t compiled_url;
-static thread_t compiled_thread;
-static socket_t compiled_client;
-static socket_t compiled_proxy;
-static remote_context_t compiled_context;
+//! Allocated once for the module lifetime, callers may hold a connection across a reconnect
+static compiled_connection_t* compiled_connections;
+static size_t compiled_connections_count;
+static mutex_t* compiled_notify_lock;
+static compiled_notify_key_t compiled_notify_history[COMPILED_NOTIFY_HISTORY];
+static size_t compiled_notify_next;
+static atomic32_t compiled_connection_next;
+static string_t compiled_cache_path;
 
 static stream_vtable_t compiled_stream_vtable;
 
@@ -806,20 +2018,192 @@ typedef struct compiled_stream_t compiled_stream_t;
 
 FOUNDATION_ALIGNED_STRUCT(compiled_stream_t, 8) {
 	FOUNDATION_DECLARE_STREAM;
+	compiled_connection_t* connection;
 	socket_t* sock;
+	remote_poll_t poll;
 
 	size_t total_read;
 	size_t stream_size;
+	//! Stream data is sent as framed compressed chunks, decompressed into the receive buffer
+	bool framed;
+	//! Bytes of stream data received, including data still held in the receive buffer
+	size_t total_received;
+	size_t buffer_offset;
+	size_t buffer_size;
+	//! Cache file receiving a copy of the stream data, published when all data has been received
+	stream_t* cache;
+	string_t cache_path;
+	string_t cache_temp_path;
 };
 
+/*! Make path of a cached remote compiled resource, <cache>/<uuid>/<platform>.<source hash>[.blob|.blobz]
+where compressed dynamic data is stored with the .blobz suffix */
+static string_t
+resource_compiled_cache_make_path(char* buffer, size_t capacity, const uuid_t uuid, uint64_t platform,
+                                  const blake3_hash_t hash, bool dynamic, bool compressed) {
+	char hashbuffer[BLAKE3_HASH_STRING_LENGTH + 1];
+	string_const_t platformstr = string_from_uint_static(platform, true, 0, '0');
+	string_const_t hashstr = string_from_blake3_hash(hash, hashbuffer, sizeof(hashbuffer));
+	string_t path = resource_stream_make_path(buffer, capacity, STRING_ARGS(compiled_cache_path), uuid);
+	path = path_append(STRING_ARGS(path), capacity, STRING_ARGS(platformstr));
+	path = string_append(STRING_ARGS(path), capacity, STRING_CONST("."));
+	path = string_append(STRING_ARGS(path), capacity, STRING_ARGS(hashstr));
+	if (dynamic)
+		path = string_append(STRING_ARGS(path), capacity, compressed ? STRING_CONST(".blobz") : STRING_CONST(".blob"));
+	return path;
+}
+
+//! Remove cached copies of the resource built from other versions of the source
+static void
+resource_compiled_cache_prune(const char* path, size_t length) {
+	char buffer[BUILD_MAX_PATHLEN];
+	string_const_t directory = path_directory_name(path, length);
+	string_const_t filename = path_file_name(path, length);
+	size_t platform_end = string_find(STRING_ARGS(filename), '.', 0);
+	if (platform_end == STRING_NPOS)
+		return;
+	size_t key_end = string_find(STRING_ARGS(filename), '.', platform_end + 1);
+	size_t key_length = (key_end != STRING_NPOS) ? key_end : filename.length;
+
+	string_t* files = fs_files(STRING_ARGS(directory));
+	for (size_t ifile = 0, fsize = array_size(files); ifile < fsize; ++ifile) {
+		string_t file = files[ifile];
+		// Keep other platforms, files being written and both parts of the current version
+		if ((file.length <= platform_end) || !string_equal(file.str, platform_end + 1, filename.str, platform_end + 1))
+			continue;
+		if (string_ends_with(STRING_ARGS(file), STRING_CONST(".tmp")))
+			continue;
+		if ((file.length >= key_length) && string_equal(file.str, key_length, filename.str, key_length))
+			continue;
+		string_t filepath = path_concat(buffer, sizeof(buffer), STRING_ARGS(directory), STRING_ARGS(file));
+		fs_remove_file(STRING_ARGS(filepath));
+	}
+	string_array_deallocate(files);
+}
+
+static void
+resource_compiled_stream_cache_end(compiled_stream_t* stream, bool publish) {
+	if (!stream->cache)
+		return;
+	stream_deallocate(stream->cache);
+	stream->cache = nullptr;
+	if (publish && fs_move_file(STRING_ARGS(stream->cache_temp_path), STRING_ARGS(stream->cache_path)))
+		resource_compiled_cache_prune(STRING_ARGS(stream->cache_path));
+	else
+		fs_remove_file(STRING_ARGS(stream->cache_temp_path));
+	string_deallocate(stream->cache_path.str);
+	string_deallocate(stream->cache_temp_path.str);
+	stream->cache_path = string(0, 0);
+	stream->cache_temp_path = string(0, 0);
+}
+
+static void
+resource_compiled_stream_cache_write(compiled_stream_t* stream, const void* data, size_t size) {
+	if (stream->cache && (stream_write(stream->cache, data, size) != size)) {
+		log_warnf(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Unable to write remote compiled cache: %.*s"),
+		          STRING_FORMAT(stream->cache_temp_path));
+		resource_compiled_stream_cache_end(stream, false);
+	}
+}
+
+//! Receive available data, waiting for the socket to become readable if nothing is buffered
+static size_t
+resource_compiled_stream_receive(compiled_stream_t* stream, void* buffer, size_t size) {
+	unsigned int timeout = resource_module_config().remote_stream_timeout;
+	if (!timeout)
+		timeout = RESOURCE_REMOTE_STREAM_TIMEOUT;
+	tick_t deadline = time_system() + (tick_t)timeout;
+	network_poll_event_t events[2];
+	while (socket_state(stream->sock) == SOCKETSTATE_CONNECTED) {
+		// Only read when data is available, a read from the blocking socket would not honor the timeout
+		if (socket_available_read(stream->sock))
+			return socket_read(stream->sock, buffer, size);
+		tick_t wait = deadline - time_system();
+		if (wait <= 0) {
+			log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS, STRING_CONST("Remote compiled stream read timed out"));
+			// Stream data is left unread so the connection is out of sync, let the comm thread reconnect
+			socket_close(stream->sock);
+			break;
+		}
+		network_poll((network_poll_t*)&stream->poll, events, sizeof(events) / sizeof(events[0]), (unsigned int)wait);
+	}
+	return 0;
+}
+
+static bool
+resource_compiled_stream_receive_full(compiled_stream_t* stream, void* buffer, size_t size) {
+	size_t total = 0;
+	while (total < size) {
+		size_t read = resource_compiled_stream_receive(stream, pointer_offset(buffer, total), size - total);
+		if (!read)
+			return false;
+		total += read;
+	}
+	return true;
+}
+
+//! Receive the next chunk of a framed stream and decompress it into the receive buffer
+static bool
+resource_compiled_stream_receive_chunk(compiled_stream_t* stream) {
+	compiled_connection_t* connection = stream->connection;
+	uint32_t frame[2];
+	if (!resource_compiled_stream_receive_full(stream, frame, sizeof(frame)))
+		return false;
+	size_t compressed = frame[0];
+	size_t raw = frame[1];
+	bool valid = raw && (raw <= RESOURCE_REMOTE_STREAM_BUFFER_SIZE) &&
+	             (raw <= (stream->stream_size - stream->total_received)) &&
+	             (compressed <= resource_compress_bound(RESOURCE_REMOTE_STREAM_BUFFER_SIZE));
+	if (valid && (compressed == raw)) {
+		if (!resource_compiled_stream_receive_full(stream, connection->buffer, raw))
+			return false;
+	} else if (valid) {
+		if (!resource_compiled_stream_receive_full(stream, connection->scratch, compressed))
+			return false;
+		valid = (resource_decompress_block(connection->scratch, compressed, connection->buffer, raw) == raw);
+	}
+	if (!valid) {
+		log_warn(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid chunk in remote compiled stream"));
+		// Connection is out of sync, let the comm thread reconnect
+		socket_close(stream->sock);
+		return false;
+	}
+	resource_compiled_stream_cache_write(stream, connection->buffer, raw);
+	stream->buffer_offset = 0;
+	stream->buffer_size = raw;
+	stream->total_received += raw;
+	return true;
+}
+
 static void
 resource_compiled_stream_finish(compiled_stream_t* stream) {
 	if (!stream->sock)
 		return;
-	network_poll_add_socket(compiled_context.poll, stream->sock);
-	remote_message_t wakeup;
-	wakeup.message = REMOTE_MESSAGE_WAKEUP;
-	udp_socket_sendto(&compiled_client, &wakeup, sizeof(wakeup), socket_address_local(&compiled_proxy));
+	// Skip any unread stream data, the next message header follows it
+	while (stream->framed && (stream->total_received < stream->stream_size)) {
+		if (!resource_compiled_stream_receive_chunk(stream))
+			break;
+	}
+	while (stream->total_received < stream->stream_size) {
+		size_t remain = stream->stream_size - stream->total_received;
+		size_t read = resource_compiled_stream_receive(
+		    stream, stream->connection->buffer,
+		    (remain < RESOURCE_REMOTE_STREAM_BUFFER_SIZE) ? remain : RESOURCE_REMOTE_STREAM_BUFFER_SIZE);
+		if (!read)
+			break;
+		resource_compiled_stream_cache_write(stream, stream->connection->buffer, read);
+		stream->total_received += read;
+	}
+	resource_compiled_stream_cache_end(stream, stream->total_received == stream->stream_size);
+	stream->buffer_offset = stream->buffer_size = 0;
+	network_poll_finalize((network_poll_t*)&stream->poll);
+	// Poll is owned by the comm thread, let it add the socket back
+	remote_message_t resume;
+	memset(&resume, 0, sizeof(resume));
+	resume.message = REMOTE_MESSAGE_RESUME;
+	remote_context_t* context = &stream->connection->context;
+	udp_socket_sendto(context->client, &resume, sizeof(resume), socket_address_local(context->control));
+	atomic_decr32(&context->streams, memory_order_release);
 	stream->sock = 0;
 }
 
@@ -829,17 +2213,46 @@ resource_compiled_stream_read(stream_t* rawstream, void* buffer, size_t size) {
 	size_t total = 0;
 	if (!stream->sock)
 		return total;
-	do {
-		size_t read = socket_read(stream->sock, pointer_offset(buffer, total), size - total);
-		total += read;
-		if (total != size) {
-			if (socket_state(stream->sock) != SOCKETSTATE_CONNECTED)
+	// Never read past the end of the stream, the next message follows it
+	if (size > stream->stream_size - stream->total_read)
+		size = stream->stream_size - stream->total_read;
+	while (total < size) {
+		size_t buffered = stream->buffer_size - stream->buffer_offset;
+		if (buffered) {
+			size_t copy = (buffered < (size - total)) ? buffered : (size - total);
+			const void* source = pointer_offset(stream->connection->buffer, stream->buffer_offset);
+			memcpy(pointer_offset(buffer, total), source, copy);
+			stream->buffer_offset += copy;
+			total += copy;
+			continue;
+		}
+		if (stream->framed) {
+			if (!resource_compiled_stream_receive_chunk(stream))
 				break;
-			thread_yield();
+			continue;
+		}
+		size_t want = size - total;
+		size_t read;
+		if (want >= RESOURCE_REMOTE_STREAM_BUFFER_SIZE) {
+			// Large reads go directly to the destination
+			read = resource_compiled_stream_receive(stream, pointer_offset(buffer, total), want);
+			resource_compiled_stream_cache_write(stream, pointer_offset(buffer, total), read);
+			total += read;
+		} else {
+			size_t remain = stream->stream_size - stream->total_received;
+			read = resource_compiled_stream_receive(
+			    stream, stream->connection->buffer,
+			    (remain < RESOURCE_REMOTE_STREAM_BUFFER_SIZE) ? remain : RESOURCE_REMOTE_STREAM_BUFFER_SIZE);
+			resource_compiled_stream_cache_write(stream, stream->connection->buffer, read);
+			stream->buffer_offset = 0;
+			stream->buffer_size = read;
 		}
-	} while (total < size);
+		if (!read)
+			break;
+		stream->total_received += read;
+	}
 	stream->total_read += total;
-	if (stream->total_read >= stream->stream_size)
+	if ((stream->total_read >= stream->stream_size) || (socket_state(stream->sock) != SOCKETSTATE_CONNECTED))
 		resource_compiled_stream_finish(stream);
 	return total;
 }
@@ -849,6 +2262,8 @@ resource_compiled_stream_eos(stream_t* rawstream) {
 	compiled_stream_t* stream = (compiled_stream_t*)rawstream;
 	if (!stream->sock || (stream->total_read >= stream->stream_size))
 		return true;
+	if (stream->buffer_offset < stream->buffer_size)
+		return false;
 	return (socket_state(stream->sock) != SOCKETSTATE_CONNECTED) && (socket_available_read(stream->sock) == 0);
 }
 
@@ -875,7 +2290,7 @@ resource_compiled_stream_last_modified(const stream_t* stream) {
 }
 
 static stream_t*
-resource_compiled_stream_allocate(socket_t* sock, size_t size) {
+resource_compiled_stream_allocate(compiled_connection_t* connection, size_t size, uint32_t flags) {
 	compiled_stream_t* stream =
 	    memory_allocate(HASH_NETWORK, sizeof(compiled_stream_t), 8, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
 
@@ -886,9 +2301,13 @@ resource_compiled_stream_allocate(socket_t* sock, size_t size) {
 	stream->sequential = 1;
 	stream->mode = STREAM_IN | STREAM_BINARY;
 	stream->vtable = &compiled_stream_vtable;
-	stream->sock = sock;
+	stream->connection = connection;
+	stream->sock = connection->context.remote;
 	stream->total_read = 0;
 	stream->stream_size = size;
+	stream->framed = ((flags & COMPILED_FLAG_FRAMED) != 0);
+	network_poll_initialize((network_poll_t*)&stream->poll, 1);
+	network_poll_add_socket((network_poll_t*)&stream->poll, stream->sock);
 
 	return (stream_t*)stream;
 }
@@ -899,6 +2318,37 @@ resource_compiled_stream_finalize(stream_t* rawstream) {
 	resource_compiled_stream_finish(stream);
 }
 
+/*! Store a copy of the stream data in the client side cache as it is read, keyed by the source
+hash reported by the remote. Unread data is read when the stream is deallocated, so the copy is
+complete unless the connection failed, in which case it is discarded */
+static void
+resource_compiled_stream_cache(stream_t* rawstream, const uuid_t uuid, uint64_t platform, const blake3_hash_t hash,
+                               bool dynamic, bool compressed) {
+	compiled_stream_t* stream = (compiled_stream_t*)rawstream;
+	char buffer[BUILD_MAX_PATHLEN];
+	char tempbuffer[BUILD_MAX_PATHLEN];
+
+	if (!compiled_cache_path.length || blake3_hash_is_null(hash))
+		return;
+
+	string_t path =
+	    resource_compiled_cache_make_path(buffer, sizeof(buffer), uuid, platform, hash, dynamic, compressed);
+	string_const_t directory = path_directory_name(STRING_ARGS(path));
+	if (!fs_make_directory(STRING_ARGS(directory)))
+		return;
+
+	// Renamed into place once complete so readers never observe a partial copy
+	string_const_t tempsuffix = string_from_uint_static(random64(), true, 0, 0);
+	string_t temp_path = string_format(tempbuffer, sizeof(tempbuffer), STRING_CONST("%.*s.%.*s.tmp"),
+	                                   STRING_FORMAT(path), STRING_FORMAT(tempsuffix));
+	stream->cache =
+	    stream_open(STRING_ARGS(temp_path), STREAM_OUT | STREAM_CREATE | STREAM_TRUNCATE | STREAM_BINARY);
+	if (!stream->cache)
+		return;
+	stream->cache_path = string_clone(STRING_ARGS(path));
+	stream->cache_temp_path = string_clone(STRING_ARGS(temp_path));
+}
+
 static int
 resource_compiled_streams_initialize(void) {
 	memset(&compiled_stream_vtable, 0, sizeof(compiled_stream_vtable));
@@ -912,39 +2362,200 @@ resource_compiled_streams_initialize(void) {
 	return 0;
 }
 
+//! Called by comm thread when a reply followed by stream data has been read
+static void
+resource_compiled_stream_begin(remote_context_t* context) {
+	network_poll_remove_socket(context->poll, context->remote);
+	atomic_incr32(&context->streams, memory_order_acquire);
+}
+
+//! Skip stream data following a reply to an abandoned or unmatched open request, called by comm thread
+static void
+resource_compiled_stream_discard(remote_context_t* context, uint64_t size, uint32_t flags) {
+	compiled_connection_t* connection =
+	    pointer_offset(context, -(ssize_t)offsetof(compiled_connection_t, context));
+	resource_compiled_stream_begin(context);
+	stream_deallocate(resource_compiled_stream_allocate(connection, size, flags));
+}
+
+//! Read the path following an open reply handing over a file, into the request path buffer if matched
+static int
+resource_compiled_read_path(remote_context_t* context, const remote_message_t* waiting) {
+	char discard[BUILD_MAX_PATHLEN];
+	char* store = waiting ? waiting->store : discard;
+	size_t capacity = waiting ? waiting->capacity : sizeof(discard);
+	return compiled_read_open_path(context->remote, store, capacity);
+}
+
 static int
-resource_compiled_read_open_static_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_compiled_read_open_static_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	compiled_open_result_t result;
 	log_info(HASH_RESOURCE, STRING_CONST("Read open static result from remote compiled service"));
 	int ret = compiled_read_open_static_reply(context->remote, msg.size, &result);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_OPEN_STATIC)) {
-		uint64_t size = (result.result == COMPILED_OK) ? result.stream_size : 0;
-		if (size > 0)
-			network_poll_remove_socket(context->poll, context->remote);
-		udp_socket_sendto(context->control, &size, sizeof(uint64_t), socket_address_local(context->client));
+	bool match = (waiting->message == REMOTE_MESSAGE_OPEN_STATIC);
+	bool path = (ret >= 0) && (result.result == COMPILED_OK) && (result.flags & COMPILED_FLAG_PATH);
+	if (path)
+		ret = resource_compiled_read_path(context, match ? waiting : nullptr);
+	if ((ret >= 0) && match) {
+		if (result.result != COMPILED_OK)
+			result.stream_size = 0;
+		if ((result.stream_size > 0) && !path)
+			resource_compiled_stream_begin(context);
+		resource_remote_complete(request, &result, sizeof(result));
+	} else if ((ret >= 0) && !path && (result.result == COMPILED_OK) && (result.stream_size > 0)) {
+		resource_compiled_stream_discard(context, result.stream_size, result.flags);
 	}
 	return ret;
 }
 
 static int
-resource_compiled_read_open_dynamic_result(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_compiled_read_open_dynamic_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
 	compiled_open_result_t result;
 	log_info(HASH_RESOURCE, STRING_CONST("Read open dynamic result from remote compiled service"));
 	int ret = compiled_read_open_dynamic_reply(context->remote, msg.size, &result);
-	if ((ret >= 0) && (waiting.message == REMOTE_MESSAGE_OPEN_DYNAMIC)) {
-		uint64_t size = (result.result == COMPILED_OK) ? result.stream_size : 0;
+	bool match = (waiting->message == REMOTE_MESSAGE_OPEN_DYNAMIC);
+	bool path = (ret >= 0) && (result.result == COMPILED_OK) && (result.flags & COMPILED_FLAG_PATH);
+	if (path)
+		ret = resource_compiled_read_path(context, match ? waiting : nullptr);
+	if ((ret >= 0) && match) {
+		if (result.result != COMPILED_OK)
+			result.stream_size = 0;
+		if ((result.stream_size > 0) && !path)
+			resource_compiled_stream_begin(context);
+		resource_remote_complete(request, &result, sizeof(result));
+	} else if ((ret >= 0) && !path && (result.result == COMPILED_OK) && (result.stream_size > 0)) {
+		resource_compiled_stream_discard(context, result.stream_size, result.flags);
+	}
+	return ret;
+}
+
+static int
+resource_compiled_read_open_dynamic_range_result(remote_context_t* context, remote_header_t msg,
+                                                 remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	compiled_open_result_t result;
+	log_info(HASH_RESOURCE, STRING_CONST("Read open dynamic range result from remote compiled service"));
+	int ret = compiled_read_open_dynamic_range_reply(context->remote, msg.size, &result);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_OPEN_DYNAMIC_RANGE)) {
+		// Negative size signals failure, a zero size is a valid empty range
+		int64_t size = (result.result == COMPILED_OK) ? (int64_t)result.stream_size : -1;
 		if (size > 0)
-			network_poll_remove_socket(context->poll, context->remote);
-		udp_socket_sendto(context->control, &size, sizeof(uint64_t), socket_address_local(context->client));
+			resource_compiled_stream_begin(context);
+		resource_remote_complete(request, &size, sizeof(size));
+	} else if ((ret >= 0) && (result.result == COMPILED_OK) && (result.stream_size > 0)) {
+		resource_compiled_stream_discard(context, result.stream_size, 0);
 	}
 	return ret;
 }
 
+static int
+resource_compiled_read_open_bundle_result(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	compiled_open_result_t result;
+	log_info(HASH_RESOURCE, STRING_CONST("Read open bundle result from remote compiled service"));
+	int ret = compiled_read_open_bundle_reply(context->remote, msg.size, &result);
+	if ((ret >= 0) && (waiting->message == REMOTE_MESSAGE_OPEN_BUNDLE)) {
+		if (result.result != COMPILED_OK)
+			result.stream_size = 0;
+		if (result.stream_size > 0)
+			resource_compiled_stream_begin(context);
+		resource_remote_complete(request, &result, sizeof(result));
+	} else if ((ret >= 0) && (result.result == COMPILED_OK) && (result.stream_size > 0)) {
+		resource_compiled_stream_discard(context, result.stream_size, result.flags);
+	}
+	return ret;
+}
+
+/*! Check if an address is on the local host, ignoring port. Loopback addresses are all of
+127.0.0.0/8 and ::1, including IPv4 loopback addresses mapped to IPv6 */
+static bool
+resource_compiled_is_local_address(const network_address_t* address) {
+	bool local = false;
+	network_address_t* host = network_address_clone(address);
+	network_address_ip_set_port(host, 0);
+	if (network_address_family(host) == NETWORK_ADDRESSFAMILY_IPV4) {
+		uint32_t netmask = network_address_ipv4_make_ip(255, 0, 0, 0);
+		local = ((network_address_ipv4_ip(host) & netmask) == network_address_ipv4_make_ip(127, 0, 0, 0));
+	} else if (network_address_family(host) == NETWORK_ADDRESSFAMILY_IPV6) {
+		struct in6_addr ip = network_address_ipv6_ip(host);
+		local = IN6_IS_ADDR_LOOPBACK(&ip) || (IN6_IS_ADDR_V4MAPPED(&ip) && (ip.s6_addr[12] == 127));
+	}
+	network_address_t** localaddr = network_address_local();
+	for (size_t iaddr = 0, asize = array_size(localaddr); !local && (iaddr < asize); ++iaddr)
+		local = network_address_equal(host, localaddr[iaddr]);
+	network_address_array_deallocate(localaddr);
+	memory_deallocate(host);
+	return local;
+}
+
+static void
+resource_compiled_connected(remote_context_t* context) {
+	// Streams are sent uncompressed until the service enables compression for the connection
+	context->features = 0;
+	uint32_t features = COMPILED_FEATURE_COMPRESSION;
+	// A service on the same host can hand over files by path instead of sending the data, which
+	// is only accepted for files in the local paths or the cache of remote compiled resources
+	if ((array_size(resource_local_paths()) || compiled_cache_path.length) &&
+	    resource_compiled_is_local_address(socket_address_remote(context->remote)))
+		features |= COMPILED_FEATURE_PATH;
+	compiled_write_hello(context->remote, 0, features);
+}
+
+static int
+resource_compiled_read_hello_result(remote_context_t* context, remote_header_t msg) {
+	compiled_hello_result_t result;
+	if (compiled_read_hello_reply(context->remote, msg.size, &result) < 0)
+		return -1;
+	context->features = result.features;
+	log_infof(HASH_RESOURCE, STRING_CONST("Remote compiled service protocol version %u, features 0x%x"),
+	          result.version, result.features);
+	return 1;  // Not a reply to a waiting request
+}
+
+/*! Check if a notification was already received on another connection, otherwise remember it.
+Every connection receives the notifications, any of them may be disconnected at the time.
+Notifications without a token cannot be told apart and are taken from the first live connection */
+static bool
+resource_compiled_notify_is_duplicate(remote_context_t* context, uint32_t id, const uuid_t uuid, uint64_t platform,
+                                      hash_t token) {
+	if (!token) {
+		for (size_t iconn = 0; iconn < compiled_connections_count; ++iconn) {
+			if (resource_remote_is_available(&compiled_connections[iconn].context))
+				return (context != &compiled_connections[iconn].context);
+		}
+		return false;
+	}
+
+	bool duplicate = false;
+	mutex_lock(compiled_notify_lock);
+	for (size_t inotify = 0; !duplicate && (inotify < COMPILED_NOTIFY_HISTORY); ++inotify) {
+		const compiled_notify_key_t* key = compiled_notify_history + inotify;
+		duplicate = (key->id == id) && (key->token == token) && (key->platform == platform) &&
+		            uuid_equal(key->uuid, uuid);
+	}
+	if (!duplicate) {
+		compiled_notify_key_t* key = compiled_notify_history + compiled_notify_next;
+		key->id = id;
+		key->uuid = uuid;
+		key->platform = platform;
+		key->token = token;
+		compiled_notify_next = (compiled_notify_next + 1) % COMPILED_NOTIFY_HISTORY;
+	}
+	mutex_unlock(compiled_notify_lock);
+	return duplicate;
+}
+
 static int
 resource_compiled_read_notify(remote_context_t* context, remote_header_t msg) {
 	log_info(HASH_RESOURCE, STRING_CONST("Read notify from remote compiled service"));
 	compiled_notify_t notify;
 	int ret = compiled_read_notify(context->remote, msg.size, &notify);
+	// Post events once, from whichever connection reads the notification first
+	if ((ret >= 0) &&
+	    resource_compiled_notify_is_duplicate(context, msg.id, notify.uuid, notify.platform, notify.token))
+		return 1;
 	if (ret >= 0) {
 		switch (msg.id) {
 			case COMPILED_NOTIFY_CREATE:
@@ -966,13 +2577,19 @@ resource_compiled_read_notify(remote_context_t* context, remote_header_t msg) {
 }
 
 static int
-resource_compiled_read(remote_context_t* context, remote_header_t msg, remote_message_t waiting) {
+resource_compiled_read(remote_context_t* context, remote_header_t msg, remote_request_t* request) {
 	switch (msg.id) {
 		case COMPILED_OPEN_STATIC_RESULT:
-			return resource_compiled_read_open_static_result(context, msg, waiting);
+			return resource_compiled_read_open_static_result(context, msg, request);
 
 		case COMPILED_OPEN_DYNAMIC_RESULT:
-			return resource_compiled_read_open_dynamic_result(context, msg, waiting);
+			return resource_compiled_read_open_dynamic_result(context, msg, request);
+
+		case COMPILED_OPEN_DYNAMIC_RANGE_RESULT:
+			return resource_compiled_read_open_dynamic_range_result(context, msg, request);
+
+		case COMPILED_OPEN_BUNDLE_RESULT:
+			return resource_compiled_read_open_bundle_result(context, msg, request);
 
 		case COMPILED_NOTIFY_CREATE:
 		case COMPILED_NOTIFY_MODIFY:
@@ -980,6 +2597,9 @@ resource_compiled_read(remote_context_t* context, remote_header_t msg, remote_me
 		case COMPILED_NOTIFY_DELETE:
 			return resource_compiled_read_notify(context, msg);
 
+		case COMPILED_HELLO_RESULT:
+			return resource_compiled_read_hello_result(context, msg);
+
 		default:
 			break;
 	}
@@ -987,25 +2607,58 @@ resource_compiled_read(remote_context_t* context, remote_header_t msg, remote_me
 }
 
 static int
-resource_compiled_write(remote_context_t* context, remote_message_t waiting) {
-	switch (waiting.message) {
+resource_compiled_write(remote_context_t* context, remote_request_t* request) {
+	const remote_message_t* waiting = &request->message;
+	int ret = 0;
+	switch (waiting->message) {
 		case REMOTE_MESSAGE_OPEN_STATIC:
 			log_info(HASH_RESOURCE, STRING_CONST("Write open static message to remote compiled service"));
-			if (compiled_write_open_static(context->remote, waiting.uuid, waiting.platform) < 0) {
+			if (compiled_write_open_static(context->remote, waiting->request, waiting->uuid, waiting->platform,
+			                               waiting->hash) < 0) {
 				log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS,
 				         STRING_CONST("Failed writing open static message to remote compiled service"));
-				size_t size = 0;
-				udp_socket_sendto(context->control, &size, sizeof(size), socket_address_local(context->client));
+				compiled_open_result_t result;
+				memset(&result, 0, sizeof(result));
+				resource_remote_complete(request, &result, sizeof(result));
+				ret = -1;
 			}
 			break;
 
 		case REMOTE_MESSAGE_OPEN_DYNAMIC:
 			log_info(HASH_RESOURCE, STRING_CONST("Write open dynamic message to remote compiled service"));
-			if (compiled_write_open_dynamic(context->remote, waiting.uuid, waiting.platform) < 0) {
+			if (compiled_write_open_dynamic(context->remote, waiting->request, waiting->uuid, waiting->platform,
+			                                waiting->hash) < 0) {
 				log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS,
 				         STRING_CONST("Failed writing open dynamic message to remote compiled service"));
-				size_t size = 0;
-				udp_socket_sendto(context->control, &size, sizeof(size), socket_address_local(context->client));
+				compiled_open_result_t result;
+				memset(&result, 0, sizeof(result));
+				resource_remote_complete(request, &result, sizeof(result));
+				ret = -1;
+			}
+			break;
+
+		case REMOTE_MESSAGE_OPEN_DYNAMIC_RANGE:
+			log_info(HASH_RESOURCE, STRING_CONST("Write open dynamic range message to remote compiled service"));
+			if (compiled_write_open_dynamic_range(context->remote, waiting->request, waiting->uuid, waiting->platform,
+			                                      waiting->offset, waiting->range) < 0) {
+				log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS,
+				         STRING_CONST("Failed writing open dynamic range message to remote compiled service"));
+				int64_t size = -1;
+				resource_remote_complete(request, &size, sizeof(size));
+				ret = -1;
+			}
+			break;
+
+		case REMOTE_MESSAGE_OPEN_BUNDLE:
+			log_info(HASH_RESOURCE, STRING_CONST("Write open bundle message to remote compiled service"));
+			if (compiled_write_open_bundle(context->remote, waiting->request, waiting->uuid, waiting->platform,
+			                               waiting->data, waiting->size) < 0) {
+				log_warn(HASH_RESOURCE, WARNING_SUSPICIOUS,
+				         STRING_CONST("Failed writing open bundle message to remote compiled service"));
+				compiled_open_result_t result;
+				memset(&result, 0, sizeof(result));
+				resource_remote_complete(request, &result, sizeof(result));
+				ret = -1;
 			}
 			break;
 
@@ -1013,7 +2666,7 @@ resource_compiled_write(remote_context_t* context, remote_message_t waiting) {
 			break;
 	}
 
-	return 0;
+	return ret;
 }
 
 static void
@@ -1022,27 +2675,49 @@ resource_remote_compiled_initialize(const char* url, size_t length) {
 		return;
 	if (!resource_module_config().enable_remote_compiled)
 		return;
+	if (!resource_remote_url_is_supported(url, length))
+		return;
 
-	network_address_t** localaddr = network_address_local();
-	udp_socket_initialize(&compiled_client);
-	udp_socket_initialize(&compiled_proxy);
-	socket_bind(&compiled_client, localaddr[0]);
-	socket_bind(&compiled_proxy, localaddr[0]);
-	socket_set_blocking(&compiled_client, true);
-	network_address_array_deallocate(localaddr);
+	unsigned int count = resource_module_config().remote_compiled_connections;
+	if (!count)
+		count = RESOURCE_REMOTE_COMPILED_CONNECTIONS;
 
 	compiled_url = string_clone(url, length);
+	if (!compiled_connections) {
+		compiled_connections = memory_allocate(HASH_RESOURCE, sizeof(compiled_connection_t) * count, 0,
+		                                       MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+		compiled_connections_count = count;
+	}
+	count = (unsigned int)compiled_connections_count;
 	compiled_initialized = true;
 
-	compiled_context.url = string_to_const(compiled_url);
-	compiled_context.client = &compiled_client;
-	compiled_context.control = &compiled_proxy;
-	compiled_context.read = resource_compiled_read;
-	compiled_context.write = resource_compiled_write;
-
-	thread_initialize(&compiled_thread, resource_remote_comm, &compiled_context, STRING_CONST("compiled-client"),
-	                  THREAD_PRIORITY_NORMAL, 0);
-	thread_start(&compiled_thread);
+	network_address_t** localaddr = network_address_local();
+	for (size_t iconn = 0; iconn < count; ++iconn) {
+		compiled_connection_t* connection = compiled_connections + iconn;
+		udp_socket_initialize(&connection->client);
+		udp_socket_initialize(&connection->proxy);
+		socket_bind(&connection->client, localaddr[0]);
+		socket_bind(&connection->proxy, localaddr[0]);
+		socket_set_blocking(&connection->client, true);
+		connection->buffer = memory_allocate(HASH_RESOURCE, RESOURCE_REMOTE_STREAM_BUFFER_SIZE, 0, MEMORY_PERSISTENT);
+		size_t scratch_size = resource_compress_bound(RESOURCE_REMOTE_STREAM_BUFFER_SIZE);
+		connection->scratch = memory_allocate(HASH_RESOURCE, scratch_size, 0, MEMORY_PERSISTENT);
+
+		remote_context_t* context = &connection->context;
+		context->url = string_to_const(compiled_url);
+		context->client = &connection->client;
+		context->control = &connection->proxy;
+		atomic_store_ptr(&context->submitted, nullptr, memory_order_release);
+		atomic_store32(&context->active, 1, memory_order_release);
+		context->read = resource_compiled_read;
+		context->write = resource_compiled_write;
+		context->connected = resource_compiled_connected;
+
+		thread_initialize(&connection->thread, resource_remote_comm, context, STRING_CONST("compiled-client"),
+		                  THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&connection->thread);
+	}
+	network_address_array_deallocate(localaddr);
 }
 
 static void
@@ -1051,16 +2726,53 @@ resource_remote_compiled_finalize(void) {
 		return;
 
 	compiled_initialized = false;
+	for (size_t iconn = 0; iconn < compiled_connections_count; ++iconn) {
+		compiled_connection_t* connection = compiled_connections + iconn;
+		atomic_store32(&connection->context.active, 0, memory_order_seq_cst);
 
-	remote_message_t message;
-	message.message = REMOTE_MESSAGE_TERMINATE;
-	udp_socket_sendto(&compiled_client, &message, sizeof(message), socket_address_local(&compiled_proxy));
+		remote_message_t message;
+		message.message = REMOTE_MESSAGE_TERMINATE;
+		udp_socket_sendto(&connection->client, &message, sizeof(message), socket_address_local(&connection->proxy));
+	}
+
+	for (size_t iconn = 0; iconn < compiled_connections_count; ++iconn) {
+		compiled_connection_t* connection = compiled_connections + iconn;
+		thread_finalize(&connection->thread);
+		resource_remote_drain(&connection->context);
+
+		socket_finalize(&connection->client);
+		socket_finalize(&connection->proxy);
+		memory_deallocate(connection->buffer);
+		memory_deallocate(connection->scratch);
+	}
 
-	thread_finalize(&compiled_thread);
+	// Connections are kept, a caller may have selected one before the finalize. The user count
+	// of each connection stays valid and new calls fail until connected again
 	string_deallocate(compiled_url.str);
+	compiled_url = string(0, 0);
+}
 
-	socket_finalize(&compiled_client);
-	socket_finalize(&compiled_proxy);
+//! Select a connection for a call, preferring connections without an open stream and with few callers,
+//! and avoiding degraded connections
+static compiled_connection_t*
+resource_compiled_connection_select(void) {
+	size_t count = compiled_connections_count;
+	size_t start = (size_t)(uint32_t)atomic_incr32(&compiled_connection_next, memory_order_relaxed);
+	compiled_connection_t* selected = nullptr;
+	int32_t selected_load = 0;
+	for (size_t iconn = 0; iconn < count; ++iconn) {
+		compiled_connection_t* connection = compiled_connections + ((start + iconn) % count);
+		// An open stream blocks all replies on the connection until it has been read
+		int32_t load = atomic_load32(&connection->context.users, memory_order_relaxed) +
+		               (atomic_load32(&connection->context.streams, memory_order_relaxed) * 1024);
+		if (!resource_remote_is_available(&connection->context))
+			load += 1024 * 1024;
+		if (!selected || (load < selected_load)) {
+			selected = connection;
+			selected_load = load;
+		}
+	}
+	return selected;
 }
 
 string_const_t
@@ -1084,24 +2796,196 @@ resource_remote_compiled_is_connected(void) {
 	return compiled_url.length > 0;
 }
 
+void
+resource_remote_compiled_set_cache_path(const char* path, size_t length) {
+	string_deallocate(compiled_cache_path.str);
+	compiled_cache_path = length ? string_clone(path, length) : string(0, 0);
+}
+
+string_const_t
+resource_remote_compiled_cache_path(void) {
+	return string_to_const(compiled_cache_path);
+}
+
+//! Check if a clean absolute path is a file within a directory, the directory is cleaned for comparison
+static bool
+resource_compiled_path_in_directory(string_const_t path, const char* directory, size_t length) {
+	char buffer[BUILD_MAX_PATHLEN];
+	if (!length || (length >= sizeof(buffer)))
+		return false;
+	string_t dir = string_copy(buffer, sizeof(buffer), directory, length);
+	dir = path_clean(STRING_ARGS(dir), sizeof(buffer));
+	dir = path_absolute(STRING_ARGS(dir), sizeof(buffer));
+	while (dir.length && (dir.str[dir.length - 1] == '/'))
+		--dir.length;
+	return (path.length > dir.length + 1) && string_equal(path.str, dir.length, STRING_ARGS(dir)) &&
+	       (path.str[dir.length] == '/');
+}
+
+/*! Check if a path handed over by a service is within the local paths or the cache of remote
+compiled resources. Parent directory references are resolved before the path is compared */
+static bool
+resource_compiled_path_is_trusted(const char* path, size_t length) {
+	char buffer[BUILD_MAX_PATHLEN];
+	if (!length || (length >= sizeof(buffer)))
+		return false;
+	string_t clean = string_copy(buffer, sizeof(buffer), path, length);
+	clean = path_clean(STRING_ARGS(clean), sizeof(buffer));
+	if (!path_is_absolute(STRING_ARGS(clean)))
+		return false;
+	string_const_t cleanpath = string_to_const(clean);
+	if (resource_compiled_path_in_directory(cleanpath, STRING_ARGS(compiled_cache_path)))
+		return true;
+	const string_const_t* local_paths = resource_local_paths();
+	for (size_t ipath = 0, pathsize = array_size(local_paths); ipath < pathsize; ++ipath) {
+		if (resource_compiled_path_in_directory(cleanpath, STRING_ARGS(local_paths[ipath])))
+			return true;
+	}
+	return false;
+}
+
+/*! Open a file handed over by path from a service on the same host. The file must be in a trusted
+directory and have the expected size, and for static data a header with the expected source hash.
+Dynamic data has no header and is only checked by size
+\param path Path
+\param size Expected size
+\param hash Expected source hash
+\param dynamic Flag if dynamic data
+\return Stream positioned at the start of the file, null if rejected */
+static stream_t*
+resource_compiled_open_path(const char* path, uint64_t size, const blake3_hash_t hash, bool dynamic) {
+	size_t length = string_length(path);
+	if (!resource_compiled_path_is_trusted(path, length)) {
+		log_warnf(HASH_RESOURCE, WARNING_SUSPICIOUS,
+		          STRING_CONST("Rejected file outside local and cache paths from remote compiled service: %s"), path);
+		return nullptr;
+	}
+	stream_t* stream = stream_open(path, length, STREAM_IN | STREAM_BINARY);
+	// File might have been replaced after the reply was sent
+	if (stream && (stream_size(stream) != size)) {
+		stream_deallocate(stream);
+		stream = nullptr;
+	}
+	if (stream && !dynamic) {
+		resource_header_t header = resource_stream_read_header(stream);
+		if (!blake3_hash_equal(header.source_hash, hash)) {
+			stream_deallocate(stream);
+			stream = nullptr;
+		} else {
+			stream_seek(stream, 0, STREAM_SEEK_BEGIN);
+		}
+	}
+	if (!stream)
+		log_warnf(HASH_RESOURCE, WARNING_RESOURCE, STRING_CONST("Unable to open file from remote compiled service: %s"),
+		          path);
+	return stream;
+}
+
+/*! Find the source hash of the cached copy of a remote compiled resource, null hash if not cached.
+For dynamic data the compressed flag is set if the copy is stored compressed */
+static blake3_hash_t
+resource_compiled_cache_find(const uuid_t uuid, uint64_t platform, bool dynamic, bool* compressed) {
+	char buffer[BUILD_MAX_PATHLEN];
+	char hashbuffer[BLAKE3_HASH_STRING_LENGTH + 1];
+	blake3_hash_t found = blake3_hash_null();
+
+	if (!compiled_cache_path.length)
+		return found;
+
+	string_t directory = resource_stream_make_path(buffer, sizeof(buffer), STRING_ARGS(compiled_cache_path), uuid);
+	if (!fs_is_directory(STRING_ARGS(directory)))
+		return found;
+
+	// Pruning keeps a single version per platform, named <platform>.<source hash>[.blob|.blobz]
+	string_const_t platformstr = string_from_uint_static(platform, true, 0, '0');
+	size_t name_length = platformstr.length + 1 + BLAKE3_HASH_STRING_LENGTH + (dynamic ? 5 : 0);
+	string_t* files = fs_files(STRING_ARGS(directory));
+	for (size_t ifile = 0, fsize = array_size(files); ifile < fsize; ++ifile) {
+		string_t file = files[ifile];
+		bool is_compressed = dynamic && (file.length == name_length + 1) && (file.str[name_length] == 'z');
+		if (((file.length != name_length) && !is_compressed) ||
+		    !string_equal(file.str, platformstr.length, STRING_ARGS(platformstr)) ||
+		    (file.str[platformstr.length] != '.'))
+			continue;
+		if (dynamic && !string_equal(file.str + name_length - 5, 5, STRING_CONST(".blob")))
+			continue;
+		const char* hashstr = file.str + platformstr.length + 1;
+		blake3_hash_t hash;
+		for (size_t ibyte = 0; ibyte < sizeof(hash.data); ++ibyte)
+			hash.data[ibyte] = (uint8_t)string_to_uint(hashstr + (ibyte * 2), 2, true);
+		// Only trust names that format back to the same string
+		string_const_t check = string_from_blake3_hash(hash, hashbuffer, sizeof(hashbuffer));
+		if (string_equal(STRING_ARGS(check), hashstr, BLAKE3_HASH_STRING_LENGTH)) {
+			found = hash;
+			*compressed = is_compressed;
+			break;
+		}
+	}
+	string_array_deallocate(files);
+	return found;
+}
+
+//! Open the cached copy of a remote compiled resource built from the given source hash
+static stream_t*
+resource_compiled_cache_open(const uuid_t uuid, uint64_t platform, const blake3_hash_t hash, bool dynamic,
+                             bool compressed) {
+	char buffer[BUILD_MAX_PATHLEN];
+	string_t path =
+	    resource_compiled_cache_make_path(buffer, sizeof(buffer), uuid, platform, hash, dynamic, compressed);
+	return stream_open(STRING_ARGS(path), STREAM_IN | STREAM_BINARY);
+}
+
+bool
+resource_remote_compiled_is_available(void) {
+	if (!compiled_initialized)
+		return false;
+	for (size_t iconn = 0; iconn < compiled_connections_count; ++iconn) {
+		if (resource_remote_is_available(&compiled_connections[iconn].context))
+			return true;
+	}
+	return false;
+}
+
 stream_t*
 resource_remote_open_static(const uuid_t uuid, uint64_t platform) {
 	if (!compiled_initialized)
 		return nullptr;
 
+	// Service on the same host may reply with the path of the file holding the data
+	char path[BUILD_MAX_PATHLEN];
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_OPEN_STATIC;
 	message.uuid = uuid;
 	message.platform = platform;
-	if (udp_socket_sendto(&compiled_client, &message, sizeof(message), socket_address_local(&compiled_proxy)) !=
-	    sizeof(message))
-		return nullptr;
+	message.store = path;
+	message.capacity = sizeof(path);
+	// Service replies not modified without sending any data if the cached copy is current
+	bool cache_compressed = false;
+	message.hash = resource_compiled_cache_find(uuid, platform, false, &cache_compressed);
 
-	size_t size = 0;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&compiled_client, &size, sizeof(size), &addr) == sizeof(size)) {
-		if (size > 0)
-			return resource_compiled_stream_allocate(compiled_context.remote, size);
+	compiled_open_result_t result;
+	compiled_connection_t* connection = resource_compiled_connection_select();
+	size_t replied = resource_remote_call(&connection->context, &message, &result, sizeof(result), 0);
+	if ((replied == sizeof(result)) && (result.result == COMPILED_NOT_MODIFIED)) {
+		stream_t* cached = resource_compiled_cache_open(uuid, platform, message.hash, false, false);
+		if (cached)
+			return resource_decompress_static(cached);
+		// Cached copy was removed after the request was made, open again without it
+		message.hash = blake3_hash_null();
+		replied = resource_remote_call(&connection->context, &message, &result, sizeof(result), 0);
+	}
+	if (replied == sizeof(result)) {
+		if ((result.stream_size > 0) && (result.flags & COMPILED_FLAG_PATH)) {
+			stream_t* stream = resource_compiled_open_path(path, result.stream_size, result.source_hash, false);
+			return stream ? resource_decompress_static(stream) : nullptr;
+		}
+		if (result.stream_size > 0) {
+			stream_t* stream = resource_compiled_stream_allocate(connection, result.stream_size, result.flags);
+			resource_compiled_stream_cache(stream, uuid, platform, result.source_hash, false, false);
+			if (result.flags & COMPILED_FLAG_COMPRESSED)
+				stream = resource_decompress_static(stream);
+			return stream;
+		}
 	}
 
 	return nullptr;
@@ -1112,19 +2996,94 @@ resource_remote_open_dynamic(const uuid_t uuid, uint64_t platform) {
 	if (!compiled_initialized)
 		return nullptr;
 
+	// Service on the same host may reply with the path of the file holding the data
+	char path[BUILD_MAX_PATHLEN];
 	remote_message_t message;
 	message.message = REMOTE_MESSAGE_OPEN_DYNAMIC;
 	message.uuid = uuid;
 	message.platform = platform;
-	if (udp_socket_sendto(&compiled_client, &message, sizeof(message), socket_address_local(&compiled_proxy)) !=
-	    sizeof(message))
+	message.store = path;
+	message.capacity = sizeof(path);
+	// Service replies not modified without sending any data if the cached copy is current
+	bool cache_compressed = false;
+	message.hash = resource_compiled_cache_find(uuid, platform, true, &cache_compressed);
+
+	compiled_open_result_t result;
+	compiled_connection_t* connection = resource_compiled_connection_select();
+	size_t replied = resource_remote_call(&connection->context, &message, &result, sizeof(result), 0);
+	if ((replied == sizeof(result)) && (result.result == COMPILED_NOT_MODIFIED)) {
+		stream_t* cached = resource_compiled_cache_open(uuid, platform, message.hash, true, cache_compressed);
+		if (cached)
+			return resource_decompress_dynamic(cached, cache_compressed);
+		// Cached copy was removed after the request was made, open again without it
+		message.hash = blake3_hash_null();
+		replied = resource_remote_call(&connection->context, &message, &result, sizeof(result), 0);
+	}
+	if (replied == sizeof(result)) {
+		if ((result.stream_size > 0) && (result.flags & COMPILED_FLAG_PATH)) {
+			bool compressed = (result.flags & COMPILED_FLAG_COMPRESSED);
+			stream_t* stream = resource_compiled_open_path(path, result.stream_size, result.source_hash, true);
+			return stream ? resource_decompress_dynamic(stream, compressed) : nullptr;
+		}
+		if (result.stream_size > 0) {
+			bool compressed = (result.flags & COMPILED_FLAG_COMPRESSED);
+			stream_t* stream = resource_compiled_stream_allocate(connection, result.stream_size, result.flags);
+			resource_compiled_stream_cache(stream, uuid, platform, result.source_hash, true, compressed);
+			return resource_decompress_dynamic(stream, compressed);
+		}
+	}
+
+	return nullptr;
+}
+
+stream_t*
+resource_remote_open_dynamic_range(const uuid_t uuid, uint64_t platform, size_t offset, size_t size) {
+	if (!compiled_initialized)
 		return nullptr;
 
-	size_t size = 0;
-	const network_address_t* addr;
-	if (udp_socket_recvfrom(&compiled_client, &size, sizeof(size), &addr) == sizeof(size)) {
-		if (size > 0)
-			return resource_compiled_stream_allocate(compiled_context.remote, size);
+	remote_message_t message;
+	message.message = REMOTE_MESSAGE_OPEN_DYNAMIC_RANGE;
+	message.uuid = uuid;
+	message.platform = platform;
+	message.offset = offset;
+	message.range = size;
+
+	int64_t range = -1;
+	compiled_connection_t* connection = resource_compiled_connection_select();
+	if (resource_remote_call(&connection->context, &message, &range, sizeof(range), 0) == sizeof(range)) {
+		if (range > 0)
+			return resource_compiled_stream_allocate(connection, (size_t)range, 0);
+		if (range == 0)
+			return buffer_stream_allocate(nullptr, STREAM_IN | STREAM_BINARY, 0, 0, false, false);
+	}
+
+	return nullptr;
+}
+
+stream_t*
+resource_remote_open_bundle(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count) {
+	if (!compiled_initialized || (count > COMPILED_BUNDLE_ROOTS_MAX))
+		return nullptr;
+
+	// Roots are written to the remote by the comm thread while this thread waits for the result
+	remote_message_t message;
+	message.message = REMOTE_MESSAGE_OPEN_BUNDLE;
+	message.uuid = bundle;
+	message.platform = platform;
+	message.data = roots;
+	message.size = count;
+
+	compiled_open_result_t result;
+	compiled_connection_t* connection = resource_compiled_connection_select();
+	// Remote builds the bundle before replying, allow for a longer wait than other requests
+	if (resource_remote_call(&connection->context, &message, &result, sizeof(result),
+	                         RESOURCE_REMOTE_BUNDLE_TIMEOUT) == sizeof(result)) {
+		if (result.stream_size > 0) {
+			stream_t* stream = resource_compiled_stream_allocate(connection, result.stream_size, result.flags);
+			if (result.flags & COMPILED_FLAG_COMPRESSED)
+				stream = resource_decompress_static(stream);
+			return stream;
+		}
 	}
 
 	return nullptr;
@@ -1147,6 +3106,27 @@ void
 resource_remote_compiled_disconnect(void) {
 }
 
+bool
+resource_remote_compiled_is_connected(void) {
+	return false;
+}
+
+bool
+resource_remote_compiled_is_available(void) {
+	return false;
+}
+
+void
+resource_remote_compiled_set_cache_path(const char* path, size_t length) {
+	FOUNDATION_UNUSED(path);
+	FOUNDATION_UNUSED(length);
+}
+
+string_const_t
+resource_remote_compiled_cache_path(void) {
+	return string_empty();
+}
+
 stream_t*
 resource_remote_open_static(const uuid_t uuid, uint64_t platform) {
 	FOUNDATION_UNUSED(uuid);
@@ -1161,11 +3141,33 @@ resource_remote_open_dynamic(const uuid_t uuid, uint64_t platform) {
 	return nullptr;
 }
 
+stream_t*
+resource_remote_open_dynamic_range(const uuid_t uuid, uint64_t platform, size_t offset, size_t size) {
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(offset);
+	FOUNDATION_UNUSED(size);
+	return nullptr;
+}
+
+stream_t*
+resource_remote_open_bundle(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count) {
+	FOUNDATION_UNUSED(bundle);
+	FOUNDATION_UNUSED(platform);
+	FOUNDATION_UNUSED(roots);
+	FOUNDATION_UNUSED(count);
+	return nullptr;
+}
+
 #endif
 
 int
 resource_remote_initialize(void) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	sourced_cache_lock = mutex_allocate(STRING_CONST("resource-remote-cache"));
+#endif
 #if RESOURCE_ENABLE_REMOTE_COMPILED
+	compiled_notify_lock = mutex_allocate(STRING_CONST("resource-remote-notify"));
 	if (resource_compiled_streams_initialize() < 0)
 		return -1;
 #endif
@@ -1176,8 +3178,17 @@ void
 resource_remote_finalize(void) {
 #if RESOURCE_ENABLE_REMOTE_SOURCED
 	resource_remote_sourced_finalize();
+	mutex_deallocate(sourced_cache_lock);
+	sourced_cache_lock = nullptr;
 #endif
 #if RESOURCE_ENABLE_REMOTE_COMPILED
 	resource_remote_compiled_finalize();
+	memory_deallocate(compiled_connections);
+	compiled_connections = nullptr;
+	compiled_connections_count = 0;
+	mutex_deallocate(compiled_notify_lock);
+	compiled_notify_lock = nullptr;
+	string_deallocate(compiled_cache_path.str);
+	compiled_cache_path = string(0, 0);
 #endif
 }
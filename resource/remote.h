@@ -27,6 +27,10 @@
 RESOURCE_API string_const_t
 resource_remote_sourced(void);
 
+/*! Connect to the remote sourced service. Only TCP host URLs (host:port) are supported, unix://
+domain socket URLs are rejected with a warning and leave the service disconnected
+\param url URL
+\param length Length of URL */
 RESOURCE_API void
 resource_remote_sourced_connect(const char* url, size_t length);
 
@@ -36,6 +40,13 @@ resource_remote_sourced_disconnect(void);
 RESOURCE_API bool
 resource_remote_sourced_is_connected(void);
 
+/*! Query if the remote sourced service is connected and responsive. A remote which timed out
+on a request or has high latency is unavailable for a cooldown period, during which remote
+calls fail immediately and callers should fall back to local sources
+\return true if remote calls are attempted, false if not */
+RESOURCE_API bool
+resource_remote_sourced_is_available(void);
+
 RESOURCE_API resource_signature_t
 resource_remote_sourced_lookup(const char* path, size_t length);
 
@@ -56,9 +67,63 @@ RESOURCE_API bool
 resource_remote_sourced_read_blob(const uuid_t uuid, hash_t key, uint64_t platform, hash_t checksum, void* data,
                                   size_t capacity);
 
+/*! Lookup multiple resources by path in as few requests as possible
+\param paths Resource paths
+\param count Number of paths
+\param signatures Signature destination, one for each path
+\return Number of paths looked up, less than count if a request failed */
+RESOURCE_API size_t
+resource_remote_sourced_lookup_batch(const string_const_t* paths, size_t count, resource_signature_t* signatures);
+
+/*! Get the hash of multiple resources in as few requests as possible. Hashes held in the
+metadata cache are not requested again
+\param uuids Resource UUIDs
+\param count Number of resources
+\param platform Platform
+\param hashes Hash destination, one for each resource. Null hash for resources that failed
+\return Number of hashes successfully retrieved */
+RESOURCE_API size_t
+resource_remote_sourced_hash_batch(const uuid_t* uuids, size_t count, uint64_t platform, blake3_hash_t* hashes);
+
+/*! Get the dependencies of multiple resources in as few requests as possible
+\param uuids Resource UUIDs
+\param count Number of resources, split into requests of at most SOURCED_BATCH_MAX resources
+\param platform Platform
+\param deps_count Destination for number of dependencies of each resource
+\param deps Destination for all dependencies in resource order
+\param capacity Capacity of dependencies destination
+\param total Destination for total number of dependencies, can be larger than capacity
+\return 0 if successful, <0 if a request failed */
+RESOURCE_API int
+resource_remote_sourced_dependencies_batch(const uuid_t* uuids, size_t count, uint64_t platform, size_t* deps_count,
+                                           resource_dependency_t* deps, size_t capacity, size_t* total);
+
+/*! Get the source hashes of resources in one request. Pass a since token from an earlier manifest
+to only get the resources changed after it, if the remote no longer knows the changes since the
+token a complete manifest is returned. A manifest of all resources is requested in parts of at most
+SOURCED_MANIFEST_REPLY_MAX resources to let the remote serve other clients in between. The hashes
+are stored in the metadata cache, which holds at most RESOURCE_REMOTE_CACHE_SIZE entries and will
+not hold a manifest of a larger source tree
+\param uuids Resource UUIDs, null for all resources in the remote source tree
+\param count Number of resources, at most SOURCED_BATCH_MAX, zero for all resources
+\param platform Platform
+\param since Token from an earlier manifest, zero for a complete manifest
+\param signatures Destination for resource UUIDs and hashes, null hash for removed resources
+\param capacity Capacity of signatures destination
+\param token Destination for token to pass as since in the next manifest, zero if failed
+\param complete Destination for flag set if the manifest holds all requested resources
+\return Number of resources in manifest, can be larger than capacity */
+RESOURCE_API size_t
+resource_remote_sourced_manifest(const uuid_t* uuids, size_t count, uint64_t platform, uint64_t since,
+                                 resource_signature_t* signatures, size_t capacity, uint64_t* token, bool* complete);
+
 RESOURCE_API string_const_t
 resource_remote_compiled(void);
 
+/*! Connect to the remote compiled service. Only TCP host URLs (host:port) are supported, unix://
+domain socket URLs are rejected with a warning and leave the service disconnected
+\param url URL
+\param length Length of URL */
 RESOURCE_API void
 resource_remote_compiled_connect(const char* url, size_t length);
 
@@ -68,6 +133,26 @@ resource_remote_compiled_disconnect(void);
 RESOURCE_API bool
 resource_remote_compiled_is_connected(void);
 
+/*! Query if the remote compile daemon is connected and at least one connection is responsive,
+see resource_remote_sourced_is_available
+\return true if remote calls are attempted, false if not */
+RESOURCE_API bool
+resource_remote_compiled_is_available(void);
+
+/*! Set the path of the client side disk cache of resources read from the remote compile daemon.
+Static and dynamic data is stored as it is streamed from the remote, keyed by resource UUID,
+platform and the source hash reported by the remote. A cached copy is used instead of streaming
+the resource again if a hash query to the remote reports the same source hash
+\param path Cache path, empty to disable the cache
+\param length Length of path */
+RESOURCE_API void
+resource_remote_compiled_set_cache_path(const char* path, size_t length);
+
+/*! Get the path of the client side disk cache of remote compiled resources
+\return Cache path, empty if the cache is disabled */
+RESOURCE_API string_const_t
+resource_remote_compiled_cache_path(void);
+
 RESOURCE_API size_t
 resource_remote_compiled_dependencies(uuid_t uuid, uint64_t platform, resource_dependency_t* deps, size_t capacity);
 
@@ -80,3 +165,25 @@ resource_remote_open_static(const uuid_t uuid, uint64_t platform);
 
 RESOURCE_API stream_t*
 resource_remote_open_dynamic(const uuid_t uuid, uint64_t platform);
+
+/*! Open a byte range of the dynamic part of a resource from the remote compiled service.
+The returned stream only transfers the requested range, clamped to the size of the data
+\param uuid Resource UUID
+\param platform Resource platform
+\param offset Offset of range in dynamic data
+\param size Size of range
+\return Stream of range, empty if the range is past the end of the data, null if failed */
+RESOURCE_API stream_t*
+resource_remote_open_dynamic_range(const uuid_t uuid, uint64_t platform, size_t offset, size_t size);
+
+/*! Open the static part of a bundle from the remote compiled service, holding the table
+of contents and the static data of all resources in the bundle. The service builds the
+bundle from the given roots before replying. If no roots are given the last bundle built
+by the service is returned
+\param bundle Bundle UUID
+\param platform Platform
+\param roots Root resource UUIDs
+\param count Number of root resources
+\return Stream of static bundle data, null if failed or bundle not available */
+RESOURCE_API stream_t*
+resource_remote_open_bundle(const uuid_t bundle, uint64_t platform, const uuid_t* roots, size_t count);
@@ -63,6 +63,10 @@ resource_module_initialize(const resource_config_t config) {
 		           (iarg < (argsize - 1))) {
 			++iarg;
 			resource_remote_compiled_connect(STRING_ARGS(cmdline[iarg]));
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--resource-remote-cache-path")) &&
+		           (iarg < (argsize - 1))) {
+			++iarg;
+			resource_remote_compiled_set_cache_path(STRING_ARGS(cmdline[iarg]));
 		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--resource-source-path")) &&
 		           (iarg < (argsize - 1))) {
 			++iarg;
@@ -92,6 +96,10 @@ resource_module_initialize(const resource_config_t config) {
 			++iarg;
 			resource_import_register_path(STRING_ARGS(cmdline[iarg]));
 			resource_compile_register_path(STRING_ARGS(cmdline[iarg]));
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--resource-manifest")) &&
+		           (iarg < (argsize - 1))) {
+			++iarg;
+			resource_local_manifest_load(STRING_ARGS(cmdline[iarg]));
 		}
 	}
 
@@ -102,6 +110,18 @@ resource_module_initialize(const resource_config_t config) {
 		return -1;
 	}
 
+	if (resource_compress_initialize() < 0)
+		return -1;
+
+	if (resource_local_initialize() < 0)
+		return -1;
+
+	if (resource_stream_initialize() < 0)
+		return -1;
+
+	if (resource_bundle_initialize() < 0)
+		return -1;
+
 	if (resource_import_initialize() < 0)
 		return -1;
 
@@ -124,12 +144,18 @@ resource_module_finalize(void) {
 	if (!resource_module_initialized)
 		return;
 
-	resource_local_clear_paths();
+	// Queued stream jobs and bundle reads are drained first, they may still open local resources
+	resource_bundle_finalize();
+	resource_stream_finalize();
 
+	resource_local_clear_paths();
+	resource_local_manifest_unload();
 	resource_remote_finalize();
 	resource_autoimport_finalize();
 	resource_import_finalize();
 	resource_compile_finalize();
+	resource_local_finalize();
+	resource_compress_finalize();
 
 	event_stream_deallocate(resource_event_stream_current);
 
@@ -27,6 +27,7 @@
 
 #include <resource/event.h>
 #include <resource/stream.h>
+#include <resource/compress.h>
 #include <resource/bundle.h>
 #include <resource/compile.h>
 #include <resource/local.h>
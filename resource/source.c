@@ -130,6 +130,25 @@ resource_source_open_blob(const uuid_t uuid, hash_t key, uint64_t platform, hash
 	return stream;
 }
 
+uuid_t*
+resource_source_uuids(void) {
+	uuid_t* uuids = nullptr;
+	if (!resource_path_source.length)
+		return uuids;
+	// Sources are stored by UUID, other files have an extension
+	string_t* found = fs_matching_files(STRING_ARGS(resource_path_source), STRING_CONST("^.*$"), true);
+	for (size_t ifile = 0, fsize = array_size(found); ifile < fsize; ++ifile) {
+		string_const_t filename = path_file_name(STRING_ARGS(found[ifile]));
+		if (string_find(STRING_ARGS(filename), '.', 0) != STRING_NPOS)
+			continue;
+		uuid_t uuid = string_to_uuid(STRING_ARGS(filename));
+		if (!uuid_is_null(uuid))
+			array_push(uuids, uuid);
+	}
+	string_array_deallocate(found);
+	return uuids;
+}
+
 static string_t*
 resource_source_get_all_blobs(const uuid_t uuid) {
 	char buffer[BUILD_MAX_PATHLEN];
@@ -565,7 +584,7 @@ exit:
 
 bool
 resource_source_read(resource_source_t* source, const uuid_t uuid) {
-	if (source && resource_remote_sourced_is_connected() && resource_remote_sourced_read(source, uuid))
+	if (source && resource_remote_sourced_is_available() && resource_remote_sourced_read(source, uuid))
 		return true;
 
 	return resource_source_read_local(source, uuid);
@@ -646,7 +665,7 @@ blake3_hash_t
 resource_source_hash(const uuid_t uuid, uint64_t platform) {
 	blake3_hash_t hash = {0};
 
-	if (resource_remote_sourced_is_connected()) {
+	if (resource_remote_sourced_is_available()) {
 		hash = resource_remote_sourced_hash(uuid, platform);
 		if (!blake3_hash_is_null(hash))
 			return hash;
@@ -713,7 +732,7 @@ resource_source_map(resource_source_t* source, uint64_t platform, hashmap_t* map
 bool
 resource_source_read_blob(const uuid_t uuid, hash_t key, uint64_t platform, hash_t checksum, void* data,
                           size_t capacity) {
-	if (resource_remote_sourced_is_connected() &&
+	if (resource_remote_sourced_is_available() &&
 	    resource_remote_sourced_read_blob(uuid, key, platform, checksum, data, capacity))
 		return true;
 
@@ -749,8 +768,12 @@ resource_source_dependencies(const uuid_t uuid, uint64_t platform, resource_depe
 	size_t deps_stored = 0;
 	size_t deps_count = 0;
 
-	if (resource_remote_sourced_is_connected())
-		return resource_remote_sourced_dependencies(uuid, platform, deps, capacity);
+	if (resource_remote_sourced_is_available()) {
+		size_t count = resource_remote_sourced_dependencies(uuid, platform, deps, capacity);
+		// Remote which failed to reply in time is no longer available, use local source instead
+		if (count || resource_remote_sourced_is_available())
+			return count;
+	}
 
 	stream_t* stream = resource_source_open_deps(uuid, STREAM_IN);
 	while (stream && !stream_eos(stream)) {
@@ -855,8 +878,11 @@ resource_source_reverse_dependencies(const uuid_t uuid, uint64_t platform, resou
 	size_t deps_stored = 0;
 	size_t deps_count = 0;
 
-	if (resource_remote_sourced_is_connected())
-		return resource_remote_sourced_reverse_dependencies(uuid, platform, deps, capacity);
+	if (resource_remote_sourced_is_available()) {
+		size_t count = resource_remote_sourced_reverse_dependencies(uuid, platform, deps, capacity);
+		if (count || resource_remote_sourced_is_available())
+			return count;
+	}
 
 	stream_t* stream = resource_source_open_reverse_deps(uuid, STREAM_IN);
 	while (stream && !stream_eos(stream)) {
@@ -1053,6 +1079,11 @@ resource_source_hash(const uuid_t uuid, uint64_t platform) {
 	return blake3_hash_null();
 }
 
+uuid_t*
+resource_source_uuids(void) {
+	return nullptr;
+}
+
 resource_source_t*
 resource_source_allocate(void) {
 	return nullptr;
@@ -33,6 +33,11 @@ resource_source_set_path(const char* path, size_t length);
 RESOURCE_API blake3_hash_t
 resource_source_hash(const uuid_t uuid, uint64_t platform);
 
+/*! Get the UUIDs of all resources in the local source path
+\return Array of resource UUIDs, must be deallocated with array_deallocate */
+RESOURCE_API uuid_t*
+resource_source_uuids(void);
+
 RESOURCE_API blake3_hash_t
 resource_source_import_hash(const uuid_t uuid);
 
@@ -22,9 +22,145 @@
 #include <foundation/foundation.h>
 #include <network/socket.h>
 
+#include <stdlib.h>
+
+static size_t
+sourced_read_full(socket_t* sock, void* buffer, size_t size) {
+	size_t read = 0;
+	while (read < size) {
+		size_t this_read = socket_read(sock, pointer_offset(buffer, read), size - read);
+		read += this_read;
+		if (!this_read)
+			break;
+	}
+	return read;
+}
+
+static bool
+sourced_read_skip(socket_t* sock, size_t size) {
+	char buffer[256];
+	while (size) {
+		size_t want_read = (size > sizeof(buffer)) ? sizeof(buffer) : size;
+		if (sourced_read_full(sock, buffer, want_read) != want_read)
+			return false;
+		size -= want_read;
+	}
+	return true;
+}
+
+static size_t
+sourced_compress_part(const void* source, size_t size, void* destination, size_t capacity) {
+	size_t offset = 0;
+	size_t written = 0;
+	while (offset < size) {
+		size_t chunk = size - offset;
+		if (chunk > RESOURCE_COMPRESS_CHUNK_SIZE)
+			chunk = RESOURCE_COMPRESS_CHUNK_SIZE;
+		written += resource_compress_chunk(pointer_offset_const(source, offset), chunk,
+		                                   pointer_offset(destination, written), capacity - written);
+		offset += chunk;
+	}
+	return written;
+}
+
+//! Write a message with a payload given in two parts, compressed if negotiated and the payload is large enough
+static int
+sourced_write_payload(socket_t* sock, sourced_message_t msg, const void* header, size_t header_size,
+                      const void* data, size_t size, uint32_t features) {
+	const size_t raw_size = header_size + size;
+	void* compressed = nullptr;
+	size_t compressed_size = 0;
+	if ((features & SOURCED_FEATURE_COMPRESSION) && (raw_size >= SOURCED_COMPRESS_MIN_SIZE)) {
+		size_t chunks = ((header_size + RESOURCE_COMPRESS_CHUNK_SIZE - 1) / RESOURCE_COMPRESS_CHUNK_SIZE) +
+		                ((size + RESOURCE_COMPRESS_CHUNK_SIZE - 1) / RESOURCE_COMPRESS_CHUNK_SIZE);
+		size_t capacity = sizeof(uint64_t) + raw_size + (chunks * sizeof(uint32_t) * 2);
+		compressed = memory_allocate(HASH_RESOURCE, capacity, 0, MEMORY_PERSISTENT);
+		uint64_t uncompressed_size = raw_size;
+		memcpy(compressed, &uncompressed_size, sizeof(uint64_t));
+		compressed_size = sizeof(uint64_t);
+		compressed_size += sourced_compress_part(header, header_size, pointer_offset(compressed, compressed_size),
+		                                         capacity - compressed_size);
+		compressed_size += sourced_compress_part(data, size, pointer_offset(compressed, compressed_size),
+		                                         capacity - compressed_size);
+		if (compressed_size >= raw_size) {
+			memory_deallocate(compressed);
+			compressed = nullptr;
+		}
+	}
+
+	int ret = -1;
+	if (compressed) {
+		msg.size = (uint32_t)compressed_size;
+		msg.flags |= SOURCED_FLAG_COMPRESSED;
+		if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+			if (socket_write(sock, compressed, compressed_size) == compressed_size)
+				ret = 0;
+		}
+		memory_deallocate(compressed);
+	} else {
+		msg.size = (uint32_t)raw_size;
+		if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+			if ((socket_write(sock, header, header_size) == header_size) &&
+			    (!size || (socket_write(sock, data, size) == size)))
+				ret = 0;
+		}
+	}
+	return ret;
+}
+
+//! Read a compressed payload in full and decompress it, returning the allocated uncompressed payload
+static void*
+sourced_read_compressed(socket_t* sock, size_t size, size_t* raw_size) {
+	*raw_size = 0;
+	if (size < sizeof(uint64_t))
+		return nullptr;
+
+	void* compressed = memory_allocate(HASH_RESOURCE, size, 0, MEMORY_PERSISTENT);
+	void* raw = nullptr;
+	uint64_t total = 0;
+	bool valid = false;
+	if (sourced_read_full(sock, compressed, size) == size) {
+		memcpy(&total, compressed, sizeof(uint64_t));
+		// Compression ratio is bounded, reject sizes that cannot come from a valid payload
+		valid = (total / 256) <= size;
+	}
+	if (valid) {
+		raw = memory_allocate(HASH_RESOURCE, total ? (size_t)total : 1, 0, MEMORY_PERSISTENT);
+		size_t offset = sizeof(uint64_t);
+		size_t filled = 0;
+		while (valid && ((offset + (sizeof(uint32_t) * 2)) <= size)) {
+			uint32_t frame[2];
+			memcpy(frame, pointer_offset(compressed, offset), sizeof(frame));
+			offset += sizeof(frame);
+			size_t chunk_compressed = frame[0];
+			size_t chunk_raw = frame[1];
+			if (!chunk_raw || (chunk_raw > RESOURCE_COMPRESS_CHUNK_SIZE) || (chunk_compressed > (size - offset)) ||
+			    (chunk_raw > ((size_t)total - filled))) {
+				valid = false;
+			} else if (chunk_compressed == chunk_raw) {
+				memcpy(pointer_offset(raw, filled), pointer_offset(compressed, offset), chunk_raw);
+			} else {
+				valid = (resource_decompress_block(pointer_offset(compressed, offset), chunk_compressed,
+				                                   pointer_offset(raw, filled), chunk_raw) == chunk_raw);
+			}
+			offset += chunk_compressed;
+			filled += chunk_raw;
+		}
+		valid = valid && (offset == size) && (filled == total);
+	}
+	memory_deallocate(compressed);
+
+	if (!valid) {
+		memory_deallocate(raw);
+		return nullptr;
+	}
+	*raw_size = (size_t)total;
+	return raw;
+}
+
 int
-sourced_write_lookup(socket_t* sock, const char* path, size_t length) {
-	sourced_message_t msg = {SOURCED_LOOKUP, (uint32_t)length};
+sourced_write_lookup(socket_t* sock, uint32_t request, const char* path, size_t length) {
+	sourced_message_t msg = {SOURCED_LOOKUP, (uint32_t)length, request, 0};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
 		if (socket_write(sock, path, length) == length)
 			return 0;
@@ -33,8 +169,8 @@ sourced_write_lookup(socket_t* sock, const char* path, size_t length) {
 }
 
 int
-sourced_write_lookup_reply(socket_t* sock, uuid_t uuid, blake3_hash_t hash) {
-	sourced_message_t msg = {SOURCED_LOOKUP_RESULT, (uint32_t)sizeof(sourced_lookup_result_t)};
+sourced_write_lookup_reply(socket_t* sock, uint32_t request, uuid_t uuid, blake3_hash_t hash) {
+	sourced_message_t msg = {SOURCED_LOOKUP_RESULT, (uint32_t)sizeof(sourced_lookup_result_t), request, 0};
 	sourced_lookup_result_t reply = {!uuid_is_null(uuid) ? SOURCED_OK : SOURCED_FAILED, 0, uuid, hash};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
 		if (socket_write(sock, &reply, sizeof(reply)) == sizeof(reply))
@@ -57,8 +193,10 @@ sourced_read_lookup_reply(socket_t* sock, size_t size, sourced_lookup_result_t*
 }
 
 int
-sourced_write_read(socket_t* sock, uuid_t uuid) {
-	sourced_read_t msg = {SOURCED_READ, (uint32_t)(sizeof(uuid_t)), uuid};
+sourced_write_read(socket_t* sock, uint32_t request, uuid_t uuid, blake3_hash_t hash, tick_t since) {
+	sourced_read_t msg = {
+	    SOURCED_READ, (uint32_t)(sizeof(uuid_t) + sizeof(blake3_hash_t) + sizeof(tick_t)), request, 0, uuid, hash,
+	    since};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
@@ -70,11 +208,14 @@ typedef struct {
 	sourced_change_t* change;
 	char* payload;
 	size_t offset;
+	tick_t since;
 } sourced_walker_t;
 
 static int
 sourced_count_source(resource_change_t* change, void* data) {
 	sourced_walker_t* walker = data;
+	if (walker->since && (change->timestamp <= walker->since))
+		return 0;
 	++walker->count;
 	if (change->flags & RESOURCE_SOURCEFLAG_VALUE)
 		walker->size += change->value.value.length;
@@ -84,6 +225,8 @@ sourced_count_source(resource_change_t* change, void* data) {
 static int
 sourced_copy_source(resource_change_t* change, void* data) {
 	sourced_walker_t* walker = data;
+	if (walker->since && (change->timestamp <= walker->since))
+		return 0;
 	sourced_change_t* dest = &walker->change[walker->count++];
 	dest->timestamp = change->timestamp;
 	dest->hash = change->hash;
@@ -101,9 +244,21 @@ sourced_copy_source(resource_change_t* change, void* data) {
 	return 0;
 }
 
+//! Walk all changes in order including unsets, which a delta must carry to the client
+static void
+sourced_walk_changes(resource_source_t* source, sourced_walker_t* walker, resource_source_map_iterate_fn iterate) {
+	resource_change_block_t* block = &source->first;
+	while (block) {
+		for (size_t ichg = 0, chgsize = block->used; ichg < chgsize; ++ichg)
+			iterate(block->changes + ichg, walker);
+		block = block->next;
+	}
+}
+
 int
-sourced_write_read_reply(socket_t* sock, resource_source_t* source, blake3_hash_t hash) {
-	sourced_message_t msg = {SOURCED_READ_RESULT, 0};
+sourced_write_read_reply(socket_t* sock, uint32_t request, resource_source_t* source, blake3_hash_t hash,
+                         tick_t since, uint32_t features) {
+	sourced_message_t msg = {SOURCED_READ_RESULT, 0, request, 0};
 
 	void* allocated = nullptr;
 	void* reply = nullptr;
@@ -118,19 +273,23 @@ sourced_write_read_reply(socket_t* sock, resource_source_t* source, blake3_hash_
 		sourced_walker_t walker;
 		walker.count = 0;
 		walker.size = 0;
+		walker.since = since;
 
 		hashmap_fixed_t fixedmap;
 		hashmap_t* map = (hashmap_t*)&fixedmap;
-		hashmap_initialize(map, sizeof(fixedmap.bucket) / sizeof(fixedmap.bucket[0]), 0);
-
-		resource_source_map_all(source, map, true);
-		resource_source_map_iterate(source, map, &walker, sourced_count_source);
+		if (since) {
+			sourced_walk_changes(source, &walker, sourced_count_source);
+		} else {
+			hashmap_initialize(map, sizeof(fixedmap.bucket) / sizeof(fixedmap.bucket[0]), 0);
+			resource_source_map_all(source, map, true);
+			resource_source_map_iterate(source, map, &walker, sourced_count_source);
+		}
 
 		size = sizeof(sourced_read_result_t) + walker.size + (sizeof(sourced_change_t) * walker.count);
 
 		sourced_read_result_t* read_result = memory_allocate(HASH_RESOURCE, size, 0, MEMORY_PERSISTENT);
 		read_result->result = SOURCED_OK;
-		read_result->flags = 0;
+		read_result->flags = since ? SOURCED_READ_FLAG_DELTA : 0;
 		read_result->hash = hash;
 		read_result->changes_count = walker.count;
 
@@ -140,21 +299,18 @@ sourced_write_read_reply(socket_t* sock, resource_source_t* source, blake3_hash_
 		walker.payload = (void*)read_result->payload;
 		walker.offset = sizeof(sourced_change_t) * read_result->changes_count;
 
-		resource_source_map_iterate(source, map, &walker, sourced_copy_source);
-		resource_source_map_clear(map);
-		hashmap_finalize(map);
+		if (since) {
+			sourced_walk_changes(source, &walker, sourced_copy_source);
+		} else {
+			resource_source_map_iterate(source, map, &walker, sourced_copy_source);
+			resource_source_map_clear(map);
+			hashmap_finalize(map);
+		}
 
 		reply = allocated = read_result;
 	}
 
-	msg.size = (uint32_t)size;
-
-	int ret = -1;
-	size_t written;
-	if ((written = socket_write(sock, &msg, sizeof(msg))) == sizeof(msg)) {
-		if ((written = socket_write(sock, reply, size)) == size)
-			ret = 0;
-	}
+	int ret = sourced_write_payload(sock, msg, reply, size, nullptr, 0, features);
 
 	memory_deallocate(allocated);
 
@@ -162,19 +318,45 @@ sourced_write_read_reply(socket_t* sock, resource_source_t* source, blake3_hash_
 }
 
 int
-sourced_read_read_reply(socket_t* sock, size_t size, sourced_read_result_t* result) {
-	size_t read = socket_read(sock, result, size);
+sourced_write_read_not_modified_reply(socket_t* sock, uint32_t request, blake3_hash_t hash) {
+	sourced_message_t msg = {SOURCED_READ_RESULT, (uint32_t)sizeof(sourced_read_result_t), request, 0};
+	sourced_read_result_t reply = {SOURCED_NOT_MODIFIED, 0, hash, 0};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+		if (socket_write(sock, &reply, sizeof(reply)) == sizeof(reply))
+			return 0;
+	}
+	return -1;
+}
+
+int
+sourced_read_read_reply(socket_t* sock, size_t size, uint32_t flags, sourced_read_result_t** result,
+                        size_t* result_size) {
+	if (flags & SOURCED_FLAG_COMPRESSED) {
+		*result = sourced_read_compressed(sock, size, result_size);
+		if (*result)
+			return 0;
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read invalid compressed read reply"));
+		return -1;
+	}
+
+	*result = memory_allocate(HASH_RESOURCE, size, 0, MEMORY_PERSISTENT);
+	*result_size = size;
+	size_t read = socket_read(sock, *result, size);
 	if (read == size)
 		return 0;
 
+	memory_deallocate(*result);
+	*result = nullptr;
+	*result_size = 0;
 	log_warnf(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL,
 	          STRING_CONST("Read partial read reply: %" PRIsize " of %" PRIsize), read, size);
 	return -1;
 }
 
 int
-sourced_write_hash(socket_t* sock, uuid_t uuid, uint64_t platform) {
-	sourced_hash_t msg = {SOURCED_HASH, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t)), uuid, platform};
+sourced_write_hash(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform) {
+	sourced_hash_t msg = {SOURCED_HASH, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t)), request, 0, uuid,
+	                      platform};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
@@ -192,8 +374,8 @@ sourced_read_hash_reply(socket_t* sock, size_t size, sourced_hash_result_t* resu
 }
 
 int
-sourced_write_hash_reply(socket_t* sock, blake3_hash_t hash) {
-	sourced_message_t msg = {SOURCED_HASH_RESULT, (uint32_t)sizeof(sourced_hash_result_t)};
+sourced_write_hash_reply(socket_t* sock, uint32_t request, blake3_hash_t hash) {
+	sourced_message_t msg = {SOURCED_HASH_RESULT, (uint32_t)sizeof(sourced_hash_result_t), request, 0};
 	sourced_hash_result_t reply = {SOURCED_OK, 0, hash};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
 		if (socket_write(sock, &reply, sizeof(reply)) == sizeof(reply))
@@ -203,27 +385,31 @@ sourced_write_hash_reply(socket_t* sock, blake3_hash_t hash) {
 }
 
 static int
-sourced_write_dependencies_impl(socket_t* sock, uuid_t uuid, uint64_t platform, uint32_t msgid) {
-	sourced_dependencies_t msg = {msgid, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t)), uuid, platform};
+sourced_write_dependencies_impl(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform, uint32_t msgid) {
+	sourced_dependencies_t msg = {msgid, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t)), request, 0, uuid,
+	                              platform};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
 }
 
 static int
-sourced_write_dependencies_reply_impl(socket_t* sock, resource_dependency_t* deps, size_t deps_count, uint32_t msgid) {
+sourced_write_dependencies_reply_impl(socket_t* sock, uint32_t request, resource_dependency_t* deps, size_t deps_count,
+                                      uint32_t msgid) {
 	size_t reply_size = sizeof(sourced_dependencies_result_t) + sizeof(resource_dependency_t) * deps_count;
-	sourced_message_t msg = {msgid, (uint32_t)reply_size};
+	sourced_message_t msg = {msgid, (uint32_t)reply_size, request, 0};
 	sourced_dependencies_result_t* reply = memory_allocate(HASH_RESOURCE, reply_size, 0, MEMORY_PERSISTENT);
 	reply->result = SOURCED_OK;
 	reply->flags = 0;
 	reply->deps_count = deps_count;
 	memcpy(reply->deps, deps, sizeof(resource_dependency_t) * deps_count);
+	int ret = -1;
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
-		if (socket_write(sock, &reply, reply_size) == reply_size)
-			return 0;
+		if (socket_write(sock, reply, reply_size) == reply_size)
+			ret = 0;
 	}
-	return -1;
+	memory_deallocate(reply);
+	return ret;
 }
 
 static int
@@ -279,13 +465,13 @@ sourced_read_dependencies_reply_impl(socket_t* sock, size_t size, resource_depen
 }
 
 int
-sourced_write_dependencies(socket_t* sock, uuid_t uuid, uint64_t platform) {
-	return sourced_write_dependencies_impl(sock, uuid, platform, SOURCED_DEPENDENCIES);
+sourced_write_dependencies(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform) {
+	return sourced_write_dependencies_impl(sock, request, uuid, platform, SOURCED_DEPENDENCIES);
 }
 
 int
-sourced_write_dependencies_reply(socket_t* sock, resource_dependency_t* deps, size_t deps_count) {
-	return sourced_write_dependencies_reply_impl(sock, deps, deps_count, SOURCED_DEPENDENCIES_RESULT);
+sourced_write_dependencies_reply(socket_t* sock, uint32_t request, resource_dependency_t* deps, size_t deps_count) {
+	return sourced_write_dependencies_reply_impl(sock, request, deps, deps_count, SOURCED_DEPENDENCIES_RESULT);
 }
 
 int
@@ -295,13 +481,14 @@ sourced_read_dependencies_reply(socket_t* sock, size_t size, resource_dependency
 }
 
 int
-sourced_write_reverse_dependencies(socket_t* sock, uuid_t uuid, uint64_t platform) {
-	return sourced_write_dependencies_impl(sock, uuid, platform, SOURCED_REVERSE_DEPENDENCIES);
+sourced_write_reverse_dependencies(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform) {
+	return sourced_write_dependencies_impl(sock, request, uuid, platform, SOURCED_REVERSE_DEPENDENCIES);
 }
 
 int
-sourced_write_reverse_dependencies_reply(socket_t* sock, resource_dependency_t* deps, size_t deps_count) {
-	return sourced_write_dependencies_reply_impl(sock, deps, deps_count, SOURCED_REVERSE_DEPENDENCIES_RESULT);
+sourced_write_reverse_dependencies_reply(socket_t* sock, uint32_t request, resource_dependency_t* deps,
+                                         size_t deps_count) {
+	return sourced_write_dependencies_reply_impl(sock, request, deps, deps_count, SOURCED_REVERSE_DEPENDENCIES_RESULT);
 }
 
 int
@@ -311,31 +498,43 @@ sourced_read_reverse_dependencies_reply(socket_t* sock, size_t size, resource_de
 }
 
 int
-sourced_write_read_blob(socket_t* sock, uuid_t uuid, uint64_t platform, hash_t key) {
-	sourced_read_blob_t msg = {SOURCED_READ_BLOB, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) * 2), uuid, platform,
-	                           key};
+sourced_write_read_blob(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform, hash_t key) {
+	sourced_read_blob_t msg = {
+	    SOURCED_READ_BLOB, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) * 2), request, 0, uuid, platform, key};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
 }
 
 int
-sourced_write_read_blob_reply(socket_t* sock, hash_t checksum, void* store, size_t size) {
-	size_t reply_size = sizeof(sourced_read_blob_reply_t) + size;
-	sourced_message_t msg = {SOURCED_READ_BLOB_RESULT, (uint32_t)reply_size};
+sourced_write_read_blob_reply(socket_t* sock, uint32_t request, hash_t checksum, void* store, size_t size,
+                              uint32_t features) {
+	sourced_message_t msg = {SOURCED_READ_BLOB_RESULT, 0, request, 0};
 	sourced_read_blob_reply_t reply = {SOURCED_OK, 0, checksum, size};
-	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
-		if (socket_write(sock, &reply, sizeof(sourced_read_blob_reply_t)) == sizeof(sourced_read_blob_reply_t)) {
-			if (socket_write(sock, store, size) == size)
-				return 0;
-		}
-	}
-	return -1;
+	return sourced_write_payload(sock, msg, &reply, sizeof(reply), store, size, features);
 }
 
 int
-sourced_read_read_blob_reply(socket_t* sock, size_t size, sourced_read_blob_reply_t* reply, void* store,
-                             size_t capacity) {
+sourced_read_read_blob_reply(socket_t* sock, size_t size, uint32_t flags, sourced_read_blob_reply_t* reply,
+                             void* store, size_t capacity) {
+	if (flags & SOURCED_FLAG_COMPRESSED) {
+		size_t raw_size = 0;
+		void* raw = sourced_read_compressed(sock, size, &raw_size);
+		if (!raw || (raw_size < sizeof(sourced_read_blob_reply_t))) {
+			memory_deallocate(raw);
+			log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read invalid compressed read blob reply"));
+			return -1;
+		}
+		memcpy(reply, raw, sizeof(sourced_read_blob_reply_t));
+		size_t copy = raw_size - sizeof(sourced_read_blob_reply_t);
+		if (copy > capacity)
+			copy = capacity;
+		if (copy)
+			memcpy(store, pointer_offset(raw, sizeof(sourced_read_blob_reply_t)), copy);
+		memory_deallocate(raw);
+		return 0;
+	}
+
 	size_t read = socket_read(sock, reply, sizeof(sourced_read_blob_reply_t));
 	if (read != sizeof(sourced_read_blob_reply_t)) {
 		log_warnf(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL,
@@ -381,8 +580,8 @@ sourced_read_read_blob_reply(socket_t* sock, size_t size, sourced_read_blob_repl
 
 int
 sourced_write_notify(socket_t* sock, sourced_message_id id, uuid_t uuid, uint64_t platform, hash_t token) {
-	sourced_notify_t msg = {id, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(uint64_t)), uuid, platform,
-	                        token};
+	sourced_notify_t msg = {
+	    id, (uint32_t)(sizeof(uuid_t) + sizeof(uint64_t) + sizeof(uint64_t)), 0, 0, uuid, platform, token};
 	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
 		return 0;
 	return -1;
@@ -397,3 +596,368 @@ sourced_read_notify(socket_t* sock, size_t size, sourced_notify_t* notify) {
 		return 0;
 	return -1;
 }
+
+static int
+sourced_write_batch(socket_t* sock, uint32_t request, uint32_t msgid, uint64_t platform, size_t count,
+                    const void* payload, size_t payload_size) {
+	const size_t header_size = sizeof(sourced_batch_t) - sizeof(sourced_message_t);
+	sourced_batch_t msg = {msgid, (uint32_t)(header_size + payload_size), request, 0, platform, (uint32_t)count, 0};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+		if (socket_write(sock, payload, payload_size) == payload_size)
+			return 0;
+	}
+	return -1;
+}
+
+static int
+sourced_write_batch_reply(socket_t* sock, uint32_t request, uint32_t msgid, size_t count, const void* payload,
+                          size_t payload_size, const void* extra, size_t extra_size) {
+	const size_t header_size = sizeof(sourced_reply_t) + sizeof(uint64_t);
+	sourced_message_t msg = {msgid, (uint32_t)(header_size + payload_size + extra_size), request, 0};
+	struct {
+		SOURCED_DECLARE_REPLY;
+		uint64_t count;
+	} reply = {SOURCED_OK, 0, count};
+	if (socket_write(sock, &msg, sizeof(msg)) != sizeof(msg))
+		return -1;
+	if (socket_write(sock, &reply, header_size) != header_size)
+		return -1;
+	if (socket_write(sock, payload, payload_size) != payload_size)
+		return -1;
+	if (extra_size && (socket_write(sock, extra, extra_size) != extra_size))
+		return -1;
+	return 0;
+}
+
+//! Read batch reply header and the array of fixed size elements, elements exceeding capacity are discarded.
+//! A failed batch is read in full and reported as an empty result
+static int
+sourced_read_batch_reply(socket_t* sock, size_t* size, void* store, size_t element_size, size_t capacity,
+                         uint64_t* count) {
+	struct {
+		SOURCED_DECLARE_REPLY;
+		uint64_t count;
+	} reply;
+	*count = 0;
+	if ((*size < sizeof(reply)) || (sourced_read_full(sock, &reply, sizeof(reply)) != sizeof(reply))) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read partial batch reply header"));
+		return -1;
+	}
+	*size -= sizeof(reply);
+	if (reply.result != SOURCED_OK) {
+		bool skipped = sourced_read_skip(sock, *size);
+		*size = 0;
+		return skipped ? 0 : -1;
+	}
+	if (reply.count > (*size / element_size)) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Invalid batch reply size"));
+		return -1;
+	}
+
+	size_t limit = (reply.count < capacity) ? (size_t)reply.count : capacity;
+	size_t store_size = limit * element_size;
+	if (sourced_read_full(sock, store, store_size) != store_size) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read partial batch reply"));
+		return -1;
+	}
+	size_t discard = ((size_t)reply.count - limit) * element_size;
+	if (!sourced_read_skip(sock, discard))
+		return -1;
+	*size -= store_size + discard;
+	*count = reply.count;
+	return 0;
+}
+
+int
+sourced_write_lookup_batch(socket_t* sock, uint32_t request, const string_const_t* paths, size_t count) {
+	if (count > SOURCED_BATCH_MAX)
+		return -1;
+	size_t payload_size = sizeof(uint32_t) * count;
+	for (size_t ipath = 0; ipath < count; ++ipath)
+		payload_size += paths[ipath].length;
+	void* payload = memory_allocate(HASH_RESOURCE, payload_size, 0, MEMORY_TEMPORARY);
+	uint32_t* length = payload;
+	char* str = pointer_offset(payload, sizeof(uint32_t) * count);
+	for (size_t ipath = 0; ipath < count; ++ipath) {
+		length[ipath] = (uint32_t)paths[ipath].length;
+		memcpy(str, paths[ipath].str, paths[ipath].length);
+		str += paths[ipath].length;
+	}
+	int ret = sourced_write_batch(sock, request, SOURCED_LOOKUP_BATCH, 0, count, payload, payload_size);
+	memory_deallocate(payload);
+	return ret;
+}
+
+int
+sourced_write_lookup_batch_reply(socket_t* sock, uint32_t request, const resource_signature_t* signatures,
+                                 size_t count) {
+	return sourced_write_batch_reply(sock, request, SOURCED_LOOKUP_BATCH_RESULT, count, signatures,
+	                                 sizeof(resource_signature_t) * count, nullptr, 0);
+}
+
+int
+sourced_read_lookup_batch_reply(socket_t* sock, size_t size, resource_signature_t* signatures, size_t capacity,
+                                uint64_t* count) {
+	int ret = sourced_read_batch_reply(sock, &size, signatures, sizeof(resource_signature_t), capacity, count);
+	if ((ret < 0) || size)
+		return -1;
+	return 0;
+}
+
+int
+sourced_write_hash_batch(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count, uint64_t platform) {
+	if (count > SOURCED_BATCH_MAX)
+		return -1;
+	return sourced_write_batch(sock, request, SOURCED_HASH_BATCH, platform, count, uuids, sizeof(uuid_t) * count);
+}
+
+int
+sourced_write_hash_batch_reply(socket_t* sock, uint32_t request, const blake3_hash_t* hashes, size_t count) {
+	return sourced_write_batch_reply(sock, request, SOURCED_HASH_BATCH_RESULT, count, hashes,
+	                                 sizeof(blake3_hash_t) * count, nullptr, 0);
+}
+
+int
+sourced_read_hash_batch_reply(socket_t* sock, size_t size, blake3_hash_t* hashes, size_t capacity, uint64_t* count) {
+	int ret = sourced_read_batch_reply(sock, &size, hashes, sizeof(blake3_hash_t), capacity, count);
+	if ((ret < 0) || size)
+		return -1;
+	return 0;
+}
+
+int
+sourced_write_dependencies_batch(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count,
+                                 uint64_t platform) {
+	if (count > SOURCED_BATCH_MAX)
+		return -1;
+	return sourced_write_batch(sock, request, SOURCED_DEPENDENCIES_BATCH, platform, count, uuids,
+	                           sizeof(uuid_t) * count);
+}
+
+int
+sourced_write_dependencies_batch_reply(socket_t* sock, uint32_t request, const uint64_t* deps_count, size_t count,
+                                       const resource_dependency_t* deps) {
+	size_t total = 0;
+	for (size_t idx = 0; idx < count; ++idx)
+		total += (size_t)deps_count[idx];
+	return sourced_write_batch_reply(sock, request, SOURCED_DEPENDENCIES_BATCH_RESULT, count, deps_count,
+	                                 sizeof(uint64_t) * count, deps, sizeof(resource_dependency_t) * total);
+}
+
+int
+sourced_read_dependencies_batch_reply(socket_t* sock, size_t size, size_t* deps_count, size_t count_capacity,
+                                      resource_dependency_t* deps, size_t capacity, uint64_t* total) {
+	uint64_t localcount[SOURCED_BATCH_MAX];
+	uint64_t count = 0;
+	*total = 0;
+	int ret = sourced_read_batch_reply(sock, &size, localcount, sizeof(uint64_t), SOURCED_BATCH_MAX, &count);
+	if ((ret < 0) || (count > SOURCED_BATCH_MAX))
+		return -1;
+
+	uint64_t deps_total = 0;
+	for (size_t idx = 0; idx < count; ++idx) {
+		if (idx < count_capacity)
+			deps_count[idx] = (size_t)localcount[idx];
+		deps_total += localcount[idx];
+	}
+	if (size != deps_total * sizeof(resource_dependency_t)) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Invalid dependencies batch reply size"));
+		sourced_read_skip(sock, size);
+		return -1;
+	}
+
+	size_t limit = (deps_total < capacity) ? (size_t)deps_total : capacity;
+	if (sourced_read_full(sock, deps, sizeof(resource_dependency_t) * limit) != sizeof(resource_dependency_t) * limit)
+		return -1;
+	if (!sourced_read_skip(sock, sizeof(resource_dependency_t) * ((size_t)deps_total - limit)))
+		return -1;
+
+	*total = deps_total;
+	return 0;
+}
+
+int
+sourced_write_hello(socket_t* sock, uint32_t request, uint32_t features) {
+	sourced_hello_t msg = {
+	    SOURCED_HELLO, (uint32_t)(sizeof(uint32_t) * 2), request, 0, SOURCED_PROTOCOL_VERSION, features};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg))
+		return 0;
+	return -1;
+}
+
+int
+sourced_write_hello_reply(socket_t* sock, uint32_t request, uint32_t features) {
+	sourced_message_t msg = {SOURCED_HELLO_RESULT, (uint32_t)sizeof(sourced_hello_result_t), request, 0};
+	sourced_hello_result_t reply = {SOURCED_OK, 0, SOURCED_PROTOCOL_VERSION, features};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+		if (socket_write(sock, &reply, sizeof(reply)) == sizeof(reply))
+			return 0;
+	}
+	return -1;
+}
+
+int
+sourced_read_hello_reply(socket_t* sock, size_t size, sourced_hello_result_t* result) {
+	if (size != sizeof(sourced_hello_result_t))
+		return -1;
+	size_t read = socket_read(sock, result, size);
+	if (read == size)
+		return 0;
+
+	log_warnf(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL,
+	          STRING_CONST("Read partial hello reply: %" PRIsize " of %" PRIsize), read, size);
+	return -1;
+}
+
+int
+sourced_write_manifest(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count, uint64_t platform,
+                       uint64_t since, uuid_t after) {
+	if (count > SOURCED_BATCH_MAX)
+		return -1;
+	const size_t header_size = sizeof(sourced_manifest_t) - sizeof(sourced_message_t);
+	size_t payload_size = sizeof(uuid_t) * count;
+	sourced_manifest_t msg = {SOURCED_MANIFEST, (uint32_t)(header_size + payload_size), request, 0, platform, since,
+	                          after, (uint32_t)count, 0};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+		if (!payload_size || (socket_write(sock, uuids, payload_size) == payload_size))
+			return 0;
+	}
+	return -1;
+}
+
+int
+sourced_write_manifest_reply(socket_t* sock, uint32_t request, uint32_t flags, uint64_t token, size_t count) {
+	const size_t header_size = sizeof(sourced_manifest_result_t);
+	size_t payload_size = sizeof(resource_signature_t) * count;
+	sourced_message_t msg = {SOURCED_MANIFEST_RESULT, (uint32_t)(header_size + payload_size), request, 0};
+	sourced_manifest_result_t reply = {SOURCED_OK, flags, token, count};
+	if (socket_write(sock, &msg, sizeof(msg)) == sizeof(msg)) {
+		if (socket_write(sock, &reply, header_size) == header_size)
+			return 0;
+	}
+	return -1;
+}
+
+int
+sourced_write_manifest_entries(socket_t* sock, const resource_signature_t* signatures, size_t count) {
+	size_t size = sizeof(resource_signature_t) * count;
+	if (socket_write(sock, signatures, size) == size)
+		return 0;
+	return -1;
+}
+
+int
+sourced_read_manifest_reply(socket_t* sock, size_t size, resource_signature_t* signatures, size_t capacity,
+                            uint64_t* count, uint64_t* token, uint32_t* flags) {
+	sourced_manifest_result_t reply;
+	*count = 0;
+	*token = 0;
+	*flags = 0;
+	if ((size < sizeof(reply)) || (sourced_read_full(sock, &reply, sizeof(reply)) != sizeof(reply))) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read partial manifest reply header"));
+		return -1;
+	}
+	size -= sizeof(reply);
+	if (reply.result != SOURCED_OK)
+		return sourced_read_skip(sock, size) ? 0 : -1;
+	if ((reply.count > (size / sizeof(resource_signature_t))) || (size != reply.count * sizeof(resource_signature_t))) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Invalid manifest reply size"));
+		return -1;
+	}
+
+	size_t limit = (reply.count < capacity) ? (size_t)reply.count : capacity;
+	size_t store_size = limit * sizeof(resource_signature_t);
+	if (sourced_read_full(sock, signatures, store_size) != store_size) {
+		log_warn(HASH_RESOURCE, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Read partial manifest reply"));
+		return -1;
+	}
+	if (!sourced_read_skip(sock, size - store_size))
+		return -1;
+	*count = reply.count;
+	*token = reply.token;
+	*flags = reply.flags;
+	return 0;
+}
+
+void
+sourced_change_log_initialize(sourced_change_log_t* log, uint32_t session, size_t capacity) {
+	memset(log, 0, sizeof(sourced_change_log_t));
+	log->capacity = (capacity > 1) ? capacity : 2;
+	log->session = session;
+}
+
+void
+sourced_change_log_finalize(sourced_change_log_t* log) {
+	array_deallocate(log->changes);
+	memset(log, 0, sizeof(sourced_change_log_t));
+}
+
+void
+sourced_change_log_record(sourced_change_log_t* log, uuid_t uuid) {
+	// Keep only the latest change of each resource
+	size_t count = array_size(log->changes);
+	for (size_t ichange = 0; ichange < count; ++ichange) {
+		if (uuid_equal(log->changes[ichange].uuid, uuid)) {
+			array_erase_ordered_safe(log->changes, ichange);
+			--count;
+			break;
+		}
+	}
+
+	sourced_change_entry_t change = {uuid, ++log->sequence};
+	array_push(log->changes, change);
+
+	if (count >= log->capacity) {
+		size_t drop = log->capacity / 2;
+		log->dropped = log->changes[drop - 1].sequence;
+		memmove(log->changes, log->changes + drop, sizeof(sourced_change_entry_t) * (count + 1 - drop));
+		array_resize(log->changes, count + 1 - drop);
+	}
+}
+
+uint64_t
+sourced_change_log_token(const sourced_change_log_t* log) {
+	return ((uint64_t)log->session << 32) | (uint64_t)log->sequence;
+}
+
+bool
+sourced_change_log_since(const sourced_change_log_t* log, uint64_t since, uuid_t** uuids) {
+	uint32_t sequence = (uint32_t)since;
+	if (!since || ((uint32_t)(since >> 32) != log->session) || (sequence > log->sequence) ||
+	    (sequence < log->dropped))
+		return false;
+	for (size_t ichange = 0, count = array_size(log->changes); ichange < count; ++ichange) {
+		if (log->changes[ichange].sequence > sequence)
+			array_push(*uuids, log->changes[ichange].uuid);
+	}
+	return true;
+}
+
+static int
+sourced_uuid_compare(const void* lhs, const void* rhs) {
+	const uuid_t* first = lhs;
+	const uuid_t* second = rhs;
+	if (first->word[0] != second->word[0])
+		return (first->word[0] < second->word[0]) ? -1 : 1;
+	if (first->word[1] != second->word[1])
+		return (first->word[1] < second->word[1]) ? -1 : 1;
+	return 0;
+}
+
+bool
+sourced_manifest_part(uuid_t** uuids, uuid_t after) {
+	size_t count = array_size(*uuids);
+	if (!count)
+		return false;
+	qsort(*uuids, count, sizeof(uuid_t), sourced_uuid_compare);
+	size_t first = 0;
+	while ((first < count) && (sourced_uuid_compare(*uuids + first, &after) <= 0))
+		++first;
+	size_t part = count - first;
+	if (part > SOURCED_MANIFEST_REPLY_MAX)
+		part = SOURCED_MANIFEST_REPLY_MAX;
+	if (first)
+		memmove(*uuids, *uuids + first, sizeof(uuid_t) * part);
+	array_resize(*uuids, part);
+	return (first + part) < count;
+}
@@ -22,7 +22,37 @@
 #include <foundation/types.h>
 #include <network/types.h>
 
-#define SOURCED_PROTOCOL_VERSION 1
+#define SOURCED_PROTOCOL_VERSION 7
+
+//! Maximum number of resources in a batch message
+#define SOURCED_BATCH_MAX 1024
+
+//! Feature flag negotiated in hello messages, replies may be compressed
+#define SOURCED_FEATURE_COMPRESSION 1
+
+//! Message flag, the payload is a uint64 uncompressed size followed by framed compressed chunks
+#define SOURCED_FLAG_COMPRESSED 1
+
+//! Minimum payload size to compress when compression has been negotiated
+#define SOURCED_COMPRESS_MIN_SIZE 256
+
+//! Read reply flag, the reply only holds changes made after the timestamp given in the read message
+#define SOURCED_READ_FLAG_DELTA 1
+
+//! Manifest reply flag, the manifest holds all requested resources and not only those changed since the token
+#define SOURCED_MANIFEST_FLAG_COMPLETE 1
+
+//! Manifest reply flag, the manifest of all resources was cut short, request the rest after the last UUID
+#define SOURCED_MANIFEST_FLAG_PARTIAL 2
+
+//! Number of manifest entries computed and written to the socket at a time
+#define SOURCED_MANIFEST_CHUNK 256
+
+//! Maximum number of entries in a manifest of all resources, bounding the work done per reply
+#define SOURCED_MANIFEST_REPLY_MAX 1024
+
+//! Maximum number of changes kept in a service change log, tokens older than the log get a complete manifest
+#define SOURCED_CHANGE_LOG_MAX (64 * 1024)
 
 enum sourced_message_id {
 	SOURCED_LOOKUP = 1,
@@ -62,10 +92,25 @@ enum sourced_message_id {
 	SOURCED_NOTIFY_CREATE,
 	SOURCED_NOTIFY_MODIFY,
 	SOURCED_NOTIFY_DEPENDS,
-	SOURCED_NOTIFY_DELETE
+	SOURCED_NOTIFY_DELETE,
+
+	SOURCED_LOOKUP_BATCH,
+	SOURCED_LOOKUP_BATCH_RESULT,
+
+	SOURCED_HASH_BATCH,
+	SOURCED_HASH_BATCH_RESULT,
+
+	SOURCED_DEPENDENCIES_BATCH,
+	SOURCED_DEPENDENCIES_BATCH_RESULT,
+
+	SOURCED_HELLO,
+	SOURCED_HELLO_RESULT,
+
+	SOURCED_MANIFEST,
+	SOURCED_MANIFEST_RESULT
 };
 
-enum sourced_result_id { SOURCED_OK = 0, SOURCED_FAILED };
+enum sourced_result_id { SOURCED_OK = 0, SOURCED_FAILED, SOURCED_NOT_MODIFIED };
 
 typedef enum sourced_message_id sourced_message_id;
 typedef enum sourced_result_id sourced_result_id;
@@ -97,10 +142,23 @@ typedef struct sourced_read_blob_t sourced_read_blob_t;
 typedef struct sourced_read_blob_reply_t sourced_read_blob_reply_t;
 typedef struct sourced_delete_result_t sourced_delete_result_t;
 typedef struct sourced_notify_t sourced_notify_t;
-
+typedef struct sourced_batch_t sourced_batch_t;
+typedef struct sourced_lookup_batch_result_t sourced_lookup_batch_result_t;
+typedef struct sourced_hash_batch_result_t sourced_hash_batch_result_t;
+typedef struct sourced_dependencies_batch_result_t sourced_dependencies_batch_result_t;
+typedef struct sourced_hello_t sourced_hello_t;
+typedef struct sourced_hello_result_t sourced_hello_result_t;
+typedef struct sourced_manifest_t sourced_manifest_t;
+typedef struct sourced_manifest_result_t sourced_manifest_result_t;
+typedef struct sourced_change_entry_t sourced_change_entry_t;
+typedef struct sourced_change_log_t sourced_change_log_t;
+
+//! Replies carry the request ID of the message they reply to, notifications have request ID 0
 #define SOURCED_DECLARE_MESSAGE \
 	uint32_t id;                \
-	uint32_t size
+	uint32_t size;              \
+	uint32_t request;           \
+	uint32_t flags
 
 #define SOURCED_DECLARE_REPLY \
 	uint32_t result;          \
@@ -189,9 +247,15 @@ struct sourced_get_result_t {
 	char payload[];
 };
 
+/*! Read all changes of a resource source. A client holding an earlier read passes the source
+hash and latest change timestamp of it, the service replies with SOURCED_NOT_MODIFIED if the hash
+is unchanged or otherwise only with the changes made after the timestamp. A null hash and zero
+timestamp reads all changes */
 struct sourced_read_t {
 	SOURCED_DECLARE_MESSAGE;
 	uuid_t uuid;
+	blake3_hash_t hash;
+	tick_t since;
 };
 
 struct sourced_read_result_t {
@@ -276,65 +340,254 @@ struct sourced_notify_t {
 	uint64_t token;
 };
 
+//! Batch message, followed by the resource UUIDs for hash and dependencies batches, or
+//! by the path lengths as uint32_t values followed by the path strings for lookup batches
+struct sourced_batch_t {
+	SOURCED_DECLARE_MESSAGE;
+	uint64_t platform;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct sourced_lookup_batch_result_t {
+	SOURCED_DECLARE_REPLY;
+	uint64_t count;
+	resource_signature_t signatures[FOUNDATION_FLEXIBLE_ARRAY];
+};
+
+struct sourced_hash_batch_result_t {
+	SOURCED_DECLARE_REPLY;
+	uint64_t count;
+	blake3_hash_t hashes[FOUNDATION_FLEXIBLE_ARRAY];
+};
+
+//! Number of dependencies for each resource, followed by all dependencies in resource order
+struct sourced_dependencies_batch_result_t {
+	SOURCED_DECLARE_REPLY;
+	uint64_t count;
+	uint64_t deps_count[FOUNDATION_FLEXIBLE_ARRAY];
+};
+
+//! Sent by clients on connect, with request ID 0, to negotiate optional features
+struct sourced_hello_t {
+	SOURCED_DECLARE_MESSAGE;
+	uint32_t version;
+	uint32_t features;
+};
+
+//! Features enabled for the connection, the subset of requested features supported by the service
+struct sourced_hello_result_t {
+	SOURCED_DECLARE_REPLY;
+	uint32_t version;
+	uint32_t features;
+};
+
+/*! Request the source hashes of a set of resources, followed by count resource UUIDs, at most
+SOURCED_BATCH_MAX. A zero count requests all resources in the source tree, ordered by UUID and
+starting after the given UUID, at most SOURCED_MANIFEST_REPLY_MAX per reply. A nonzero since token
+from an earlier manifest reply limits the manifest to resources changed after it was sent */
+struct sourced_manifest_t {
+	SOURCED_DECLARE_MESSAGE;
+	uint64_t platform;
+	uint64_t since;
+	uuid_t after;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+/*! Manifest of resource UUIDs and source hashes, null hash for resources which no longer exist.
+Entries are written in chunks as they are computed. The token is passed as since in a later
+request, the SOURCED_MANIFEST_FLAG_COMPLETE flag is set if changes since the token were not
+known and the manifest holds all requested resources */
+struct sourced_manifest_result_t {
+	SOURCED_DECLARE_REPLY;
+	uint64_t token;
+	uint64_t count;
+	resource_signature_t signatures[FOUNDATION_FLEXIBLE_ARRAY];
+};
+
+//! Resource changed at a sequence number in a change log
+struct sourced_change_entry_t {
+	uuid_t uuid;
+	uint32_t sequence;
+};
+
+/*! Change log used by a service to answer manifest requests with a since token. Holds the latest
+change of each resource in sequence order, the oldest half is dropped when the log is full */
+struct sourced_change_log_t {
+	//! Array of changes
+	sourced_change_entry_t* changes;
+	//! Maximum number of changes kept
+	size_t capacity;
+	//! Sequence number of the latest change
+	uint32_t sequence;
+	//! Highest sequence number dropped from the log
+	uint32_t dropped;
+	//! Session identifier in the high bits of tokens, tokens from an earlier session are never current
+	uint32_t session;
+};
+
 int
-sourced_write_lookup(socket_t* sock, const char* path, size_t length);
+sourced_write_lookup(socket_t* sock, uint32_t request, const char* path, size_t length);
 
 int
-sourced_write_lookup_reply(socket_t* sock, uuid_t uuid, blake3_hash_t hash);
+sourced_write_lookup_reply(socket_t* sock, uint32_t request, uuid_t uuid, blake3_hash_t hash);
 
 int
 sourced_read_lookup_reply(socket_t* sock, size_t size, sourced_lookup_result_t* result);
 
 int
-sourced_write_read(socket_t* sock, uuid_t uuid);
+sourced_write_read(socket_t* sock, uint32_t request, uuid_t uuid, blake3_hash_t hash, tick_t since);
+
+//! Write a read reply with the changes of the source made at or after the given timestamp, all changes if zero
+int
+sourced_write_read_reply(socket_t* sock, uint32_t request, resource_source_t* source, blake3_hash_t hash,
+                         tick_t since, uint32_t features);
 
+//! Write a read reply telling the client the source hash matches the hash given in the read message
 int
-sourced_write_read_reply(socket_t* sock, resource_source_t* source, blake3_hash_t hash);
+sourced_write_read_not_modified_reply(socket_t* sock, uint32_t request, blake3_hash_t hash);
 
+//! Read a read reply, result is allocated and must be deallocated by the caller
 int
-sourced_read_read_reply(socket_t* sock, size_t size, sourced_read_result_t* result);
+sourced_read_read_reply(socket_t* sock, size_t size, uint32_t flags, sourced_read_result_t** result,
+                        size_t* result_size);
 
 int
-sourced_write_hash(socket_t* sock, uuid_t uuid, uint64_t platform);
+sourced_write_hash(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform);
 
 int
-sourced_write_hash_reply(socket_t* sock, blake3_hash_t hash);
+sourced_write_hash_reply(socket_t* sock, uint32_t request, blake3_hash_t hash);
 
 int
 sourced_read_hash_reply(socket_t* sock, size_t size, sourced_hash_result_t* result);
 
 int
-sourced_write_dependencies(socket_t* sock, uuid_t uuid, uint64_t platform);
+sourced_write_dependencies(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform);
 
 int
-sourced_write_dependencies_reply(socket_t* sock, resource_dependency_t* deps, size_t deps_count);
+sourced_write_dependencies_reply(socket_t* sock, uint32_t request, resource_dependency_t* deps, size_t deps_count);
 
 int
 sourced_read_dependencies_reply(socket_t* sock, size_t size, resource_dependency_t* deps, size_t capacity,
                                 uint64_t* count);
 
 int
-sourced_write_reverse_dependencies(socket_t* sock, uuid_t uuid, uint64_t platform);
+sourced_write_reverse_dependencies(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform);
 
 int
-sourced_write_reverse_dependencies_reply(socket_t* sock, resource_dependency_t* deps, size_t deps_count);
+sourced_write_reverse_dependencies_reply(socket_t* sock, uint32_t request, resource_dependency_t* deps,
+                                         size_t deps_count);
 
 int
 sourced_read_reverse_dependencies_reply(socket_t* sock, size_t size, resource_dependency_t* deps, size_t capacity,
                                         uint64_t* count);
 
 int
-sourced_write_read_blob(socket_t* sock, uuid_t uuid, uint64_t platform, hash_t key);
+sourced_write_read_blob(socket_t* sock, uint32_t request, uuid_t uuid, uint64_t platform, hash_t key);
 
 int
-sourced_write_read_blob_reply(socket_t* sock, hash_t checksum, void* store, size_t size);
+sourced_write_read_blob_reply(socket_t* sock, uint32_t request, hash_t checksum, void* store, size_t size,
+                              uint32_t features);
 
 int
-sourced_read_read_blob_reply(socket_t* sock, size_t size, sourced_read_blob_reply_t* reply, void* store,
-                             size_t capacity);
+sourced_read_read_blob_reply(socket_t* sock, size_t size, uint32_t flags, sourced_read_blob_reply_t* reply,
+                             void* store, size_t capacity);
 
 int
 sourced_write_notify(socket_t* sock, sourced_message_id id, uuid_t uuid, uint64_t platform, hash_t token);
 
 int
 sourced_read_notify(socket_t* sock, size_t size, sourced_notify_t* notify);
+
+int
+sourced_write_lookup_batch(socket_t* sock, uint32_t request, const string_const_t* paths, size_t count);
+
+int
+sourced_write_lookup_batch_reply(socket_t* sock, uint32_t request, const resource_signature_t* signatures,
+                                 size_t count);
+
+int
+sourced_read_lookup_batch_reply(socket_t* sock, size_t size, resource_signature_t* signatures, size_t capacity,
+                                uint64_t* count);
+
+int
+sourced_write_hash_batch(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count, uint64_t platform);
+
+int
+sourced_write_hash_batch_reply(socket_t* sock, uint32_t request, const blake3_hash_t* hashes, size_t count);
+
+int
+sourced_read_hash_batch_reply(socket_t* sock, size_t size, blake3_hash_t* hashes, size_t capacity, uint64_t* count);
+
+int
+sourced_write_dependencies_batch(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count,
+                                 uint64_t platform);
+
+int
+sourced_write_dependencies_batch_reply(socket_t* sock, uint32_t request, const uint64_t* deps_count, size_t count,
+                                       const resource_dependency_t* deps);
+
+int
+sourced_read_dependencies_batch_reply(socket_t* sock, size_t size, size_t* deps_count, size_t count_capacity,
+                                      resource_dependency_t* deps, size_t capacity, uint64_t* total);
+
+int
+sourced_write_hello(socket_t* sock, uint32_t request, uint32_t features);
+
+int
+sourced_write_hello_reply(socket_t* sock, uint32_t request, uint32_t features);
+
+int
+sourced_read_hello_reply(socket_t* sock, size_t size, sourced_hello_result_t* result);
+
+int
+sourced_write_manifest(socket_t* sock, uint32_t request, const uuid_t* uuids, size_t count, uint64_t platform,
+                       uint64_t since, uuid_t after);
+
+//! Write the manifest reply header, the count signatures must follow with sourced_write_manifest_entries
+int
+sourced_write_manifest_reply(socket_t* sock, uint32_t request, uint32_t flags, uint64_t token, size_t count);
+
+int
+sourced_write_manifest_entries(socket_t* sock, const resource_signature_t* signatures, size_t count);
+
+//! Read a manifest reply, entries exceeding capacity are discarded
+int
+sourced_read_manifest_reply(socket_t* sock, size_t size, resource_signature_t* signatures, size_t capacity,
+                            uint64_t* count, uint64_t* token, uint32_t* flags);
+
+/*! Initialize a change log
+\param log Change log
+\param session Nonzero session identifier, should differ between runs of the service
+\param capacity Maximum number of changes kept, SOURCED_CHANGE_LOG_MAX for services */
+void
+sourced_change_log_initialize(sourced_change_log_t* log, uint32_t session, size_t capacity);
+
+//! Finalize a change log
+void
+sourced_change_log_finalize(sourced_change_log_t* log);
+
+//! Record a change of a resource, replacing any earlier change of the same resource
+void
+sourced_change_log_record(sourced_change_log_t* log, uuid_t uuid);
+
+//! Token of the latest change, passed in manifest replies
+uint64_t
+sourced_change_log_token(const sourced_change_log_t* log);
+
+/*! Collect the resources changed after the given token
+\param log Change log
+\param since Token from an earlier manifest reply
+\param uuids Array receiving the changed resources
+\return true if changes since the token are known, false if a complete manifest is needed */
+bool
+sourced_change_log_since(const sourced_change_log_t* log, uint64_t since, uuid_t** uuids);
+
+/*! Cut a manifest of all resources to at most SOURCED_MANIFEST_REPLY_MAX resources following the
+given UUID, in UUID order, so a large source tree is hashed over several requests
+\param uuids Array of resources, sorted and cut in place
+\param after Last resource of the previous part, null UUID for the first part
+\return true if resources were cut from the end and the manifest is partial */
+bool
+sourced_manifest_part(uuid_t** uuids, uuid_t after);
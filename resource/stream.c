@@ -17,13 +17,379 @@
  */
 
 #include <resource/resource.h>
+#include <resource/internal.h>
 
 #include <foundation/foundation.h>
 
+typedef struct resource_stream_job_t resource_stream_job_t;
+typedef struct resource_stream_prefetch_t resource_stream_prefetch_t;
+typedef struct resource_range_stream_t resource_range_stream_t;
+
+struct resource_stream_job_t {
+	void (*execute)(void*);
+	void* arg;
+};
+
+struct resource_stream_async_t {
+	uuid_t uuid;
+	uint64_t platform;
+	bool dynamic;
+	resource_stream_async_fn callback;
+	void* data;
+	stream_t* stream;
+	atomic32_t done;
+	atomic32_t ref;
+	semaphore_t signal;
+};
+
+struct resource_stream_prefetch_t {
+	uuid_t uuid;
+	uint64_t platform;
+	stream_t* stream;
+	size_t size;
+};
+
+FOUNDATION_ALIGNED_STRUCT(resource_range_stream_t, 8) {
+	FOUNDATION_DECLARE_STREAM;
+	stream_t* stream;
+	size_t offset;
+	size_t size;
+	size_t position;
+};
+
+static stream_vtable_t resource_range_stream_vtable;
+static thread_t* resource_stream_workers;
+static size_t resource_stream_workers_count;
+static resource_stream_job_t* resource_stream_jobs;
+//! Index of the next job to run, jobs before it have been taken and are compacted away in bulk
+static size_t resource_stream_jobs_head;
+static mutex_t* resource_stream_jobs_lock;
+static semaphore_t resource_stream_jobs_signal;
+static resource_stream_prefetch_t* resource_stream_prefetched;
+static mutex_t* resource_stream_prefetch_lock;
+//! Total size of prefetched data held in memory and the limit before the oldest are evicted
+static size_t resource_stream_prefetch_size;
+static size_t resource_stream_prefetch_limit;
+//! Size limit of a single prefetched resource held in memory
+static size_t resource_stream_prefetch_resource_limit;
+//! Incremented on each resource event, prefetches spanning an event are not stored
+static uint32_t resource_stream_prefetch_generation;
+
+static void*
+resource_stream_worker(void* arg) {
+	FOUNDATION_UNUSED(arg);
+	while (semaphore_wait(&resource_stream_jobs_signal)) {
+		resource_stream_job_t job;
+		bool has_job = false;
+
+		mutex_lock(resource_stream_jobs_lock);
+		size_t queued = array_size(resource_stream_jobs);
+		if (resource_stream_jobs_head < queued) {
+			job = resource_stream_jobs[resource_stream_jobs_head++];
+			has_job = true;
+			if (resource_stream_jobs_head == queued) {
+				array_clear(resource_stream_jobs);
+				resource_stream_jobs_head = 0;
+			} else if (resource_stream_jobs_head >= (queued / 2)) {
+				// Queue never running empty, move the remaining jobs to the front once half are taken
+				size_t remain = queued - resource_stream_jobs_head;
+				memmove(resource_stream_jobs, resource_stream_jobs + resource_stream_jobs_head,
+				        sizeof(resource_stream_job_t) * remain);
+				array_resize(resource_stream_jobs, remain);
+				resource_stream_jobs_head = 0;
+			}
+		}
+		mutex_unlock(resource_stream_jobs_lock);
+
+		// Signal without a queued job means terminate
+		if (!has_job)
+			break;
+
+		job.execute(job.arg);
+	}
+	return nullptr;
+}
+
+static void
+resource_stream_queue(void (*execute)(void*), void* arg) {
+	if (!resource_stream_workers_count) {
+		execute(arg);
+		return;
+	}
+
+	resource_stream_job_t job = {execute, arg};
+	mutex_lock(resource_stream_jobs_lock);
+	array_push(resource_stream_jobs, job);
+	mutex_unlock(resource_stream_jobs_lock);
+
+	semaphore_post(&resource_stream_jobs_signal);
+}
+
+static size_t
+resource_range_stream_read(stream_t* rawstream, void* buffer, size_t size) {
+	resource_range_stream_t* stream = (resource_range_stream_t*)rawstream;
+	if (size > (stream->size - stream->position))
+		size = stream->size - stream->position;
+	size_t read = size ? stream_read(stream->stream, buffer, size) : 0;
+	stream->position += read;
+	return read;
+}
+
+static bool
+resource_range_stream_eos(stream_t* rawstream) {
+	resource_range_stream_t* stream = (resource_range_stream_t*)rawstream;
+	return (stream->position >= stream->size) || stream_eos(stream->stream);
+}
+
+static size_t
+resource_range_stream_size(stream_t* stream) {
+	return ((resource_range_stream_t*)stream)->size;
+}
+
+static void
+resource_range_stream_seek(stream_t* rawstream, ssize_t offset, stream_seek_mode_t direction) {
+	resource_range_stream_t* stream = (resource_range_stream_t*)rawstream;
+	ssize_t position = offset;
+	if (direction == STREAM_SEEK_CURRENT)
+		position = (ssize_t)stream->position + offset;
+	else if (direction == STREAM_SEEK_END)
+		position = (ssize_t)stream->size + offset;
+	if (position < 0)
+		position = 0;
+	else if ((size_t)position > stream->size)
+		position = (ssize_t)stream->size;
+	stream_seek(stream->stream, (ssize_t)(stream->offset + (size_t)position), STREAM_SEEK_BEGIN);
+	stream->position = (size_t)position;
+}
+
+static size_t
+resource_range_stream_tell(stream_t* stream) {
+	return ((resource_range_stream_t*)stream)->position;
+}
+
+static tick_t
+resource_range_stream_last_modified(const stream_t* stream) {
+	return stream_last_modified(((const resource_range_stream_t*)stream)->stream);
+}
+
+static size_t
+resource_range_stream_available_read(stream_t* rawstream) {
+	resource_range_stream_t* stream = (resource_range_stream_t*)rawstream;
+	size_t available = stream_available_read(stream->stream);
+	size_t remain = stream->size - stream->position;
+	return (available < remain) ? available : remain;
+}
+
+static void
+resource_range_stream_finalize(stream_t* rawstream) {
+	resource_range_stream_t* stream = (resource_range_stream_t*)rawstream;
+	stream_deallocate(stream->stream);
+	stream->stream = nullptr;
+}
+
+static stream_t*
+resource_range_stream_allocate(stream_t* source, size_t offset, size_t size) {
+	size_t total = stream_size(source);
+	if (offset > total)
+		offset = total;
+	if (size > (total - offset))
+		size = total - offset;
+
+	if (source->sequential) {
+		char buffer[1024];
+		size_t skip = offset;
+		while (skip && !stream_eos(source)) {
+			size_t read = stream_read(source, buffer, (skip < sizeof(buffer)) ? skip : sizeof(buffer));
+			if (!read)
+				break;
+			skip -= read;
+		}
+	} else {
+		stream_seek(source, (ssize_t)offset, STREAM_SEEK_BEGIN);
+	}
+
+	resource_range_stream_t* stream = memory_allocate(HASH_RESOURCE, sizeof(resource_range_stream_t), 8,
+	                                                  MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	stream_initialize((stream_t*)stream, source->byteorder);
+
+	stream->type = STREAMTYPE_CUSTOM;
+	stream->sequential = source->sequential;
+	stream->mode = STREAM_IN | STREAM_BINARY;
+	stream->vtable = &resource_range_stream_vtable;
+	stream->path = string_clone(STRING_ARGS(source->path));
+	stream->stream = source;
+	stream->offset = offset;
+	stream->size = size;
+	stream->position = 0;
+
+	return (stream_t*)stream;
+}
+
+int
+resource_stream_initialize(void) {
+	memset(&resource_range_stream_vtable, 0, sizeof(resource_range_stream_vtable));
+	resource_range_stream_vtable.read = resource_range_stream_read;
+	resource_range_stream_vtable.eos = resource_range_stream_eos;
+	resource_range_stream_vtable.size = resource_range_stream_size;
+	resource_range_stream_vtable.seek = resource_range_stream_seek;
+	resource_range_stream_vtable.tell = resource_range_stream_tell;
+	resource_range_stream_vtable.lastmod = resource_range_stream_last_modified;
+	resource_range_stream_vtable.available_read = resource_range_stream_available_read;
+	resource_range_stream_vtable.finalize = resource_range_stream_finalize;
+
+	unsigned int threads = resource_module_config().stream_worker_threads;
+	if (!threads)
+		threads = RESOURCE_STREAM_WORKER_THREADS;
+
+	resource_stream_jobs_lock = mutex_allocate(STRING_CONST("resource-stream-jobs"));
+	resource_stream_prefetch_lock = mutex_allocate(STRING_CONST("resource-stream-prefetch"));
+	resource_stream_prefetch_limit = resource_module_config().stream_prefetch_limit;
+	if (!resource_stream_prefetch_limit)
+		resource_stream_prefetch_limit = RESOURCE_STREAM_PREFETCH_LIMIT;
+	resource_stream_prefetch_resource_limit = resource_module_config().stream_prefetch_resource_limit;
+	if (!resource_stream_prefetch_resource_limit)
+		resource_stream_prefetch_resource_limit = RESOURCE_STREAM_PREFETCH_RESOURCE_LIMIT;
+	if (resource_stream_prefetch_resource_limit > resource_stream_prefetch_limit)
+		resource_stream_prefetch_resource_limit = resource_stream_prefetch_limit;
+	semaphore_initialize(&resource_stream_jobs_signal, 0);
+
+	resource_stream_workers = memory_allocate(HASH_RESOURCE, sizeof(thread_t) * threads, 0, MEMORY_PERSISTENT);
+	for (unsigned int ithread = 0; ithread < threads; ++ithread) {
+		thread_initialize(resource_stream_workers + ithread, resource_stream_worker, nullptr,
+		                  STRING_CONST("resource-stream"), THREAD_PRIORITY_NORMAL, 0);
+		thread_start(resource_stream_workers + ithread);
+	}
+	resource_stream_workers_count = threads;
+
+	return 0;
+}
+
+void
+resource_stream_finalize(void) {
+	size_t ithread;
+	size_t threads = resource_stream_workers_count;
+
+	// Queued jobs are drained before the workers pick up the terminate signals
+	for (ithread = 0; ithread < threads; ++ithread)
+		semaphore_post(&resource_stream_jobs_signal);
+	for (ithread = 0; ithread < threads; ++ithread)
+		thread_finalize(resource_stream_workers + ithread);
+
+	resource_stream_workers_count = 0;
+	memory_deallocate(resource_stream_workers);
+	array_deallocate(resource_stream_jobs);
+	resource_stream_jobs_head = 0;
+	mutex_deallocate(resource_stream_jobs_lock);
+	semaphore_finalize(&resource_stream_jobs_signal);
+
+	for (size_t ipre = 0, presize = array_size(resource_stream_prefetched); ipre < presize; ++ipre)
+		stream_deallocate(resource_stream_prefetched[ipre].stream);
+	array_deallocate(resource_stream_prefetched);
+	mutex_deallocate(resource_stream_prefetch_lock);
+
+	resource_stream_prefetched = nullptr;
+	resource_stream_prefetch_lock = nullptr;
+	resource_stream_prefetch_size = 0;
+	resource_stream_workers = nullptr;
+	resource_stream_jobs = nullptr;
+	resource_stream_jobs_lock = nullptr;
+}
+
+static stream_t*
+resource_stream_take_prefetched(const uuid_t res, uint64_t platform) {
+	stream_t* stream = nullptr;
+	if (!resource_stream_prefetch_lock)
+		return stream;
+	mutex_lock(resource_stream_prefetch_lock);
+	for (size_t ipre = 0, presize = array_size(resource_stream_prefetched); ipre < presize; ++ipre) {
+		if (uuid_equal(resource_stream_prefetched[ipre].uuid, res) &&
+		    (resource_stream_prefetched[ipre].platform == platform)) {
+			stream = resource_stream_prefetched[ipre].stream;
+			resource_stream_prefetch_size -= resource_stream_prefetched[ipre].size;
+			array_erase_ordered_safe(resource_stream_prefetched, ipre);
+			break;
+		}
+	}
+	mutex_unlock(resource_stream_prefetch_lock);
+	return stream;
+}
+
+static uint32_t
+resource_stream_prefetch_current_generation(void) {
+	mutex_lock(resource_stream_prefetch_lock);
+	uint32_t generation = resource_stream_prefetch_generation;
+	mutex_unlock(resource_stream_prefetch_lock);
+	return generation;
+}
+
+//! Store a prefetched stream, taking ownership. Oldest entries are evicted to stay within the size
+//! limit, and the stream is discarded if a resource event was posted since the given generation
+static void
+resource_stream_store_prefetched(const uuid_t res, uint64_t platform, stream_t* stream, size_t size,
+                                 uint32_t generation) {
+	stream_t** evicted = nullptr;
+	resource_stream_prefetch_t prefetch = {res, platform, stream, size};
+	mutex_lock(resource_stream_prefetch_lock);
+	if ((generation == resource_stream_prefetch_generation) && (size <= resource_stream_prefetch_limit)) {
+		while (array_size(resource_stream_prefetched) &&
+		       (resource_stream_prefetch_size + size > resource_stream_prefetch_limit)) {
+			array_push(evicted, resource_stream_prefetched[0].stream);
+			resource_stream_prefetch_size -= resource_stream_prefetched[0].size;
+			array_erase_ordered_safe(resource_stream_prefetched, 0);
+		}
+		array_push(resource_stream_prefetched, prefetch);
+		resource_stream_prefetch_size += size;
+	} else {
+		array_push(evicted, stream);
+	}
+	mutex_unlock(resource_stream_prefetch_lock);
+	for (size_t ievict = 0, esize = array_size(evicted); ievict < esize; ++ievict)
+		stream_deallocate(evicted[ievict]);
+	array_deallocate(evicted);
+}
+
+void
+resource_stream_invalidate(const uuid_t res) {
+	stream_t** dropped = nullptr;
+	if (!resource_stream_prefetch_lock)
+		return;
+	mutex_lock(resource_stream_prefetch_lock);
+	++resource_stream_prefetch_generation;
+	for (size_t ipre = 0; ipre < array_size(resource_stream_prefetched);) {
+		if (uuid_equal(resource_stream_prefetched[ipre].uuid, res)) {
+			array_push(dropped, resource_stream_prefetched[ipre].stream);
+			resource_stream_prefetch_size -= resource_stream_prefetched[ipre].size;
+			array_erase_ordered_safe(resource_stream_prefetched, ipre);
+		} else {
+			++ipre;
+		}
+	}
+	mutex_unlock(resource_stream_prefetch_lock);
+	for (size_t idrop = 0, dsize = array_size(dropped); idrop < dsize; ++idrop)
+		stream_deallocate(dropped[idrop]);
+	array_deallocate(dropped);
+}
+
 stream_t*
 resource_stream_open_static(const uuid_t res, uint64_t platform) {
 	stream_t* stream;
 
+	stream = resource_stream_take_prefetched(res, platform);
+	if (stream)
+		return stream;
+
+	// Deploy mode, resources are read only and answered straight from the manifest
+	if (resource_local_manifest_is_loaded()) {
+		stream = resource_local_manifest_open_static(res, platform);
+		if (!stream) {
+			string_const_t uuidstr = string_from_uuid_static(res);
+			log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+			          STRING_CONST("Unable to open static stream for resource: %.*s (platform 0x%" PRIx64 ")"),
+			          STRING_FORMAT(uuidstr), platform);
+		}
+		return stream;
+	}
+
 	stream = resource_remote_open_static(res, platform);
 	if (stream)
 		return stream;
@@ -59,6 +425,17 @@ stream_t*
 resource_stream_open_dynamic(const uuid_t res, uint64_t platform) {
 	stream_t* stream;
 
+	if (resource_local_manifest_is_loaded()) {
+		stream = resource_local_manifest_open_dynamic(res, platform);
+		if (!stream) {
+			string_const_t uuidstr = string_from_uuid_static(res);
+			log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+			          STRING_CONST("Unable to open dynamic stream for resource: %.*s (platform 0x%" PRIx64 ")"),
+			          STRING_FORMAT(uuidstr), platform);
+		}
+		return stream;
+	}
+
 	stream = resource_remote_open_dynamic(res, platform);
 	if (stream)
 		return stream;
@@ -96,6 +473,162 @@ resource_stream_open_dynamic(const uuid_t res, uint64_t platform) {
 	return 0;
 }
 
+stream_t*
+resource_stream_open_dynamic_range(const uuid_t res, uint64_t platform, size_t offset, size_t size) {
+	stream_t* stream;
+
+	// Only the requested range is transferred from a remote compiled service
+	stream = resource_remote_open_dynamic_range(res, platform, offset, size);
+	if (stream)
+		return stream;
+
+	stream = resource_stream_open_dynamic(res, platform);
+	if (!stream)
+		return nullptr;
+
+	return resource_range_stream_allocate(stream, offset, size);
+}
+
+static void
+resource_stream_async_execute(void* arg) {
+	resource_stream_async_t* async = arg;
+	stream_t* stream = async->dynamic ? resource_stream_open_dynamic(async->uuid, async->platform) :
+	                                    resource_stream_open_static(async->uuid, async->platform);
+	if (async->callback) {
+		async->callback(async, stream, async->data);
+		stream = nullptr;
+	}
+	async->stream = stream;
+	atomic_store32(&async->done, 1, memory_order_release);
+	semaphore_post(&async->signal);
+	resource_stream_async_release(async);
+}
+
+static resource_stream_async_t*
+resource_stream_open_async(const uuid_t res, uint64_t platform, bool dynamic, resource_stream_async_fn callback,
+                           void* data) {
+	resource_stream_async_t* async =
+	    memory_allocate(HASH_RESOURCE, sizeof(resource_stream_async_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	async->uuid = res;
+	async->platform = platform;
+	async->dynamic = dynamic;
+	async->callback = callback;
+	async->data = data;
+	semaphore_initialize(&async->signal, 0);
+	// One reference for the caller and one for the worker
+	atomic_store32(&async->ref, 2, memory_order_release);
+	resource_stream_queue(resource_stream_async_execute, async);
+	return async;
+}
+
+resource_stream_async_t*
+resource_stream_open_static_async(const uuid_t res, uint64_t platform, resource_stream_async_fn callback,
+                                  void* data) {
+	return resource_stream_open_async(res, platform, false, callback, data);
+}
+
+resource_stream_async_t*
+resource_stream_open_dynamic_async(const uuid_t res, uint64_t platform, resource_stream_async_fn callback,
+                                   void* data) {
+	return resource_stream_open_async(res, platform, true, callback, data);
+}
+
+bool
+resource_stream_async_is_done(resource_stream_async_t* async) {
+	return async ? (atomic_load32(&async->done, memory_order_acquire) != 0) : true;
+}
+
+stream_t*
+resource_stream_async_wait(resource_stream_async_t* async) {
+	if (!async)
+		return nullptr;
+	semaphore_wait(&async->signal);
+	stream_t* stream = async->stream;
+	async->stream = nullptr;
+	resource_stream_async_release(async);
+	return stream;
+}
+
+void
+resource_stream_async_release(resource_stream_async_t* async) {
+	if (!async)
+		return;
+	if (atomic_decr32(&async->ref, memory_order_acq_rel) == 0) {
+		if (async->stream)
+			stream_deallocate(async->stream);
+		semaphore_finalize(&async->signal);
+		memory_deallocate(async);
+	}
+}
+
+static void
+resource_stream_prefetch_execute(void* arg) {
+	resource_dependency_t* resource = arg;
+	const uuid_t res = resource->uuid;
+	const uint64_t platform = resource->platform;
+
+	if (resource_local_manifest_is_loaded()) {
+		resource_local_prefetch(res, platform);
+		memory_deallocate(resource);
+		return;
+	}
+
+	if (resource_remote_compiled_is_available()) {
+		uint32_t generation = resource_stream_prefetch_current_generation();
+		stream_t* remote = resource_remote_open_static(res, platform);
+		if (remote) {
+			// Remote compiled streams are bound to the connection, read the data to memory unless too large.
+			// Data of a larger resource is read through to the remote compiled cache when the stream is
+			// deallocated, if one is set, and the later open is answered from the cached copy
+			size_t size = stream_size(remote);
+			if (size > resource_stream_prefetch_resource_limit) {
+				stream_deallocate(remote);
+				memory_deallocate(resource);
+				return;
+			}
+			void* buffer = memory_allocate(HASH_RESOURCE, size ? size : 1, 0, MEMORY_PERSISTENT);
+			size_t read = stream_read(remote, buffer, size);
+			stream_deallocate(remote);
+			if (read == size)
+				resource_stream_store_prefetched(
+				    res, platform, buffer_stream_allocate(buffer, STREAM_IN | STREAM_BINARY, size, size, true, false),
+				    size, generation);
+			else
+				memory_deallocate(buffer);
+			memory_deallocate(resource);
+			return;
+		}
+	}
+
+	if (resource_autoimport_need_update(res, platform)) {
+		string_const_t uuidstr = string_from_uuid_static(res);
+		log_debugf(HASH_RESOURCE, STRING_CONST("Reimporting resource %.*s (platform 0x%" PRIx64 ") (prefetch)"),
+		           STRING_FORMAT(uuidstr), platform);
+		resource_autoimport(res);
+	}
+
+	if (resource_compile_need_update(res, platform)) {
+		string_const_t uuidstr = string_from_uuid_static(res);
+		log_debugf(HASH_RESOURCE, STRING_CONST("Recompiling resource %.*s (platform 0x%" PRIx64 ") (prefetch)"),
+		           STRING_FORMAT(uuidstr), platform);
+		resource_compile(res, platform);
+	}
+
+	resource_local_prefetch(res, platform);
+
+	memory_deallocate(resource);
+}
+
+void
+resource_stream_prefetch(const resource_dependency_t* resources, size_t count) {
+	for (size_t ires = 0; ires < count; ++ires) {
+		resource_dependency_t* resource =
+		    memory_allocate(HASH_RESOURCE, sizeof(resource_dependency_t), 0, MEMORY_PERSISTENT);
+		*resource = resources[ires];
+		resource_stream_queue(resource_stream_prefetch_execute, resource);
+	}
+}
+
 string_t
 resource_stream_make_path(char* buffer, size_t capacity, const char* base, size_t base_length, const uuid_t res) {
 	string_const_t uuidstr = string_from_uuid_static(res);
@@ -105,16 +638,32 @@ resource_stream_make_path(char* buffer, size_t capacity, const char* base, size_
 
 void
 resource_stream_write_header(stream_t* stream, const resource_header_t header) {
+	// Compression flag describes how the data is stored and is only set here
+	bool compress = resource_local_stream_compressible(stream);
+	uint32_t flags = header.flags & ~(RESOURCE_HEADER_FORMAT_MASK | RESOURCE_HEADERFLAG_COMPRESSED);
+	if (compress)
+		flags |= RESOURCE_HEADERFLAG_COMPRESSED;
 	stream_write_uint64(stream, header.type);
+	stream_write_uint32(stream, RESOURCE_HEADER_FORMAT | flags);
 	stream_write_uint32(stream, header.version);
 	stream_write(stream, header.source_hash.data, BLAKE3_HASH_LENGTH);
+	if (compress)
+		resource_local_stream_compress(stream);
 }
 
 resource_header_t
 resource_stream_read_header(stream_t* stream) {
 	resource_header_t header;
 	header.type = stream_read_uint64(stream);
-	header.version = stream_read_uint32(stream);
+	uint32_t word = stream_read_uint32(stream);
+	if ((word & RESOURCE_HEADER_FORMAT_MASK) == RESOURCE_HEADER_FORMAT) {
+		header.flags = word & ~RESOURCE_HEADER_FORMAT_MASK;
+		header.version = stream_read_uint32(stream);
+	} else {
+		// Original layout without flags, the word is the version
+		header.flags = 0;
+		header.version = word;
+	}
 	stream_read(stream, header.source_hash.data, BLAKE3_HASH_LENGTH);
 	return header;
 }
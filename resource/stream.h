@@ -23,21 +23,101 @@
 
 #include <resource/types.h>
 
-/*! The stream returned must be deallocated before calling any other resource
-stream using function, such as loading another resource */
+/*! Streams from a remote compiled service occupy a connection to the service until read
+or deallocated, do not keep more streams open at once than there are remote connections */
 RESOURCE_API stream_t*
 resource_stream_open_static(const uuid_t res, uint64_t platform);
 
-/*! The stream returned must be deallocated before calling any other resource
-stream using function, such as loading another resource */
+/*! Streams from a remote compiled service occupy a connection to the service until read
+or deallocated, do not keep more streams open at once than there are remote connections */
 RESOURCE_API stream_t*
 resource_stream_open_dynamic(const uuid_t res, uint64_t platform);
 
+/*! Open a byte range of the dynamic part of a resource. The returned stream is limited to the
+range, with offsets and size relative to the start of the range. The range is clamped to the
+size of the dynamic data. When using a remote compiled service only the range is transferred
+\param res Resource UUID
+\param platform Resource platform
+\param offset Offset of range in dynamic data
+\param size Size of range
+\return Stream of range, null if failed */
+RESOURCE_API stream_t*
+resource_stream_open_dynamic_range(const uuid_t res, uint64_t platform, size_t offset, size_t size);
+
+/*! Open the static part of a resource asynchronously on a resource stream worker thread.
+If a callback is given it is called from the worker thread once the open completes and
+takes ownership of the stream (which is null if the open failed). The returned handle must
+be released exactly once, with either resource_stream_async_wait or resource_stream_async_release.
+The same restrictions on remote compiled streams as for resource_stream_open_static apply
+\param res Resource UUID
+\param platform Resource platform
+\param callback Optional completion callback
+\param data Data passed to callback
+\return Handle for the asynchronous request */
+RESOURCE_API resource_stream_async_t*
+resource_stream_open_static_async(const uuid_t res, uint64_t platform, resource_stream_async_fn callback,
+                                  void* data);
+
+/*! Open the dynamic part of a resource asynchronously, see resource_stream_open_static_async
+\param res Resource UUID
+\param platform Resource platform
+\param callback Optional completion callback
+\param data Data passed to callback
+\return Handle for the asynchronous request */
+RESOURCE_API resource_stream_async_t*
+resource_stream_open_dynamic_async(const uuid_t res, uint64_t platform, resource_stream_async_fn callback,
+                                   void* data);
+
+/*! Query if an asynchronous request has completed
+\param async Handle for asynchronous request
+\return true if completed, false if still pending */
+RESOURCE_API bool
+resource_stream_async_is_done(resource_stream_async_t* async);
+
+/*! Wait for an asynchronous request to complete and release the handle. The handle is
+invalid once this returns and must not be waited on or released again, a second wait would
+block forever on a request that may already have been deallocated
+\param async Handle for asynchronous request
+\return Opened stream, null if the open failed or the stream was passed to the completion callback */
+RESOURCE_API stream_t*
+resource_stream_async_wait(resource_stream_async_t* async);
+
+/*! Release the handle for an asynchronous request without waiting for completion. If the
+request has no callback the stream will be deallocated once the open completes. The handle is
+invalid once released, a handle already released by resource_stream_async_wait must not be
+released again
+\param async Handle for asynchronous request */
+RESOURCE_API void
+resource_stream_async_release(resource_stream_async_t* async);
+
+/*! Prefetch a list of resources on the resource stream worker threads. Local resources are
+checked for required reimport and recompile and the compiled files are read ahead into the
+page cache. If a remote compiled service is connected the static parts are requested ahead of
+time and held in memory until opened with resource_stream_open_static, up to the configured
+stream_prefetch_limit bytes in total and stream_prefetch_resource_limit bytes for each resource. Larger
+resources are only stored in the remote compiled cache, if one is set. Held data is dropped when a
+resource event is posted for the resource
+\param resources Resources to prefetch
+\param count Number of resources */
+RESOURCE_API void
+resource_stream_prefetch(const resource_dependency_t* resources, size_t count);
+
 RESOURCE_API string_t
 resource_stream_make_path(char* buffer, size_t capacity, const char* base, size_t base_length, const uuid_t res);
 
+/*! Write a resource header. The header is written as the type, a flags word holding the
+header format identifier and the flags, the version and the source hash. The flags of the
+given header are written except RESOURCE_HEADERFLAG_COMPRESSED, which is set by the library if
+the data following the header is compressed. Headers written by earlier versions of the
+library have no flags word and are still readable, but cannot be read by those versions
+\param stream Stream
+\param header Header */
 RESOURCE_API void
 resource_stream_write_header(stream_t* stream, const resource_header_t header);
 
+/*! Read a resource header. Headers in the original layout without a flags word, identified
+by the lack of a header format identifier following the type, are read with zero flags
+\param stream Stream
+\return Header */
 RESOURCE_API resource_header_t
 resource_stream_read_header(stream_t* stream);
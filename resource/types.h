@@ -45,6 +45,14 @@ typedef enum resource_event_id {
 #define RESOURCE_SOURCEFLAG_VALUE 1
 #define RESOURCE_SOURCEFLAG_BLOB 2
 
+//! Header flag set by the library when the data following the header is compressed
+#define RESOURCE_HEADERFLAG_COMPRESSED 1
+
+//! Format identifier stored in the high bits of the header flags word, headers without it use the
+//! original layout without flags
+#define RESOURCE_HEADER_FORMAT 0x52480000U
+#define RESOURCE_HEADER_FORMAT_MASK 0xFFFF0000U
+
 typedef struct resource_config_t resource_config_t;
 typedef union resource_change_value_t resource_change_value_t;
 typedef struct resource_change_t resource_change_t;
@@ -58,12 +66,17 @@ typedef struct resource_platform_t resource_platform_t;
 typedef struct resource_header_t resource_header_t;
 typedef struct resource_signature_t resource_signature_t;
 typedef struct resource_dependency_t resource_dependency_t;
+typedef struct resource_stream_async_t resource_stream_async_t;
+typedef struct resource_bundle_t resource_bundle_t;
+typedef struct resource_bundle_entry_t resource_bundle_entry_t;
 
 typedef int (*resource_import_fn)(stream_t*, const uuid_t);
 typedef int (*resource_compile_fn)(const uuid_t, uint64_t, resource_source_t*, const blake3_hash_t, const char*,
                                    size_t);
 typedef resource_change_t* (*resource_source_map_reduce_fn)(resource_change_t*, resource_change_t*, void*);
 typedef int (*resource_source_map_iterate_fn)(resource_change_t*, void*);
+typedef void (*resource_stream_async_fn)(resource_stream_async_t*, stream_t*, void*);
+typedef void (*resource_bundle_read_fn)(const resource_bundle_t*, const uuid_t, void*, size_t, void*);
 
 /*! Resource library configuration */
 struct resource_config_t {
@@ -77,6 +90,24 @@ struct resource_config_t {
 	bool enable_local_cache;
 	/*! Enable use of remote compile daemon for managing compiled resources and bundles */
 	bool enable_remote_compiled;
+	/*! Number of worker threads servicing asynchronous stream requests, 0 for default */
+	unsigned int stream_worker_threads;
+	/*! Maximum total size in bytes of prefetched remote resources held in memory waiting to be
+	opened, oldest are evicted first, 0 for default */
+	size_t stream_prefetch_limit;
+	/*! Maximum size in bytes of a single prefetched remote resource held in memory, larger resources
+	are only read through to the remote compiled cache if one is set, 0 for default */
+	size_t stream_prefetch_resource_limit;
+	/*! Enable compression of compiled resources written to local cache */
+	bool enable_local_compression;
+	/*! Timeout in milliseconds waiting for data on remote compiled resource streams, 0 for default */
+	unsigned int remote_stream_timeout;
+	/*! Number of connections to the remote compile daemon, bounding the number of concurrently
+	open remote streams, 0 for default */
+	unsigned int remote_compiled_connections;
+	/*! Timeout in milliseconds waiting for the reply to a remote call before falling back to local
+	sources, 0 for default */
+	unsigned int remote_call_timeout;
 };
 
 /*! Decomposed platform specification */
@@ -188,6 +219,48 @@ struct resource_header_t {
 	uint32_t version;
 	/*! Source hash */
 	blake3_hash_t source_hash;
+	/*! Flags (RESOURCE_HEADERFLAG_*), the low 16 bits are available */
+	uint32_t flags;
+};
+
+/*! Table of contents entry for a resource stored in a bundle. Offsets of static data are
+relative to the start of the bundle static data block, offsets of dynamic data relative
+to the start of the bundle dynamic data file */
+struct resource_bundle_entry_t {
+	/*! Resource UUID */
+	uuid_t uuid;
+	/*! Type hash */
+	hash_t type;
+	/*! Offset of static data */
+	uint64_t static_offset;
+	/*! Size of static data */
+	uint64_t static_size;
+	/*! Offset of dynamic data */
+	uint64_t dynamic_offset;
+	/*! Size of dynamic data, 0 if resource has no dynamic data */
+	uint64_t dynamic_size;
+	/*! Source hash */
+	blake3_hash_t source_hash;
+};
+
+/*! Loaded static part of a bundle */
+struct resource_bundle_t {
+	/*! Bundle UUID */
+	uuid_t uuid;
+	/*! Bundle platform */
+	uint64_t platform;
+	/*! Number of resources */
+	size_t count;
+	/*! Table of contents, sorted by resource UUID */
+	const resource_bundle_entry_t* entries;
+	/*! Static data block */
+	const void* data;
+	/*! Size of static data block */
+	size_t data_size;
+	/*! Memory buffer holding table of contents and static data */
+	void* buffer;
+	/*! Stream of dynamic data, owned by the bundle I/O thread */
+	stream_t* dynamic;
 };
 
 /*! Signature for a resource source file */
@@ -197,6 +197,16 @@ main_initialize(void) {
 #if BUILD_MONOLITHIC
 extern int
 test_source_run(void);
+extern int
+test_remote_run(void);
+extern int
+test_compress_run(void);
+extern int
+test_local_run(void);
+extern int
+test_bundle_run(void);
+extern int
+test_compiled_run(void);
 typedef int (*test_run_fn)(void);
 
 static void*
@@ -278,7 +288,8 @@ main_run(void* main_arg) {
 
 #if BUILD_MONOLITHIC
 
-	test_run_fn tests[] = {test_source_run, 0};
+	test_run_fn tests[] = {test_source_run, test_remote_run, test_compress_run, test_local_run, test_bundle_run,
+	                        test_compiled_run, 0};
 
 #if FOUNDATION_PLATFORM_ANDROID
 
@@ -0,0 +1,400 @@
+/* main.c  -  Resource bundle test  -  Public Domain  -  2013 Mattias Jansson
+ *
+ * This library provides a cross-platform foundation library in C11 providing basic support
+ * data types and functions to write applications and games in a platform-independent fashion.
+ * The latest source code is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without
+ * any restrictions.
+ */
+
+#include <foundation/foundation.h>
+#include <resource/resource.h>
+#include <test/test.h>
+
+#define TEST_BUNDLE_PLATFORM 0x1234
+#define TEST_BUNDLE_SIZE 4096
+#define TEST_BUNDLE_RESOURCES 3
+
+static application_t
+test_bundle_application(void) {
+	application_t app;
+	memset(&app, 0, sizeof(app));
+	app.name = string_const(STRING_CONST("Resource bundle tests"));
+	app.short_name = string_const(STRING_CONST("test_bundle"));
+	app.company = string_const(STRING_CONST(""));
+	app.flags = APPLICATION_UTILITY;
+	app.exception_handler = test_exception_handler;
+	return app;
+}
+
+static memory_system_t
+test_bundle_memory_system(void) {
+	return memory_system_malloc();
+}
+
+static foundation_config_t
+test_bundle_config(void) {
+	foundation_config_t config;
+	memset(&config, 0, sizeof(config));
+	return config;
+}
+
+static int
+test_bundle_initialize(void) {
+	resource_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.enable_local_cache = true;
+	return resource_module_initialize(config);
+}
+
+static void
+test_bundle_finalize(void) {
+	resource_module_finalize();
+}
+
+static void
+test_bundle_event(event_t* event) {
+	resource_event_handle(event);
+}
+
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+
+// Resources stored in the bundles, the second resource has no dynamic data
+static uuid_t test_bundle_uuids[TEST_BUNDLE_RESOURCES];
+static uint8_t test_bundle_static[TEST_BUNDLE_RESOURCES][TEST_BUNDLE_SIZE];
+static uint8_t test_bundle_dynamic[TEST_BUNDLE_RESOURCES][TEST_BUNDLE_SIZE];
+
+// Create an empty local path holding the compiled resources to bundle
+static string_t
+test_bundle_path_allocate(void) {
+	string_const_t tmp = environment_temporary_directory();
+	string_const_t name = string_from_uuid_static(uuid_generate_random());
+	string_t path = path_allocate_concat(STRING_ARGS(tmp), STRING_ARGS(name));
+	fs_make_directory(STRING_ARGS(path));
+	resource_local_clear_paths();
+	resource_local_add_path(STRING_ARGS(path));
+
+	for (size_t ires = 0; ires < TEST_BUNDLE_RESOURCES; ++ires) {
+		test_bundle_uuids[ires] = uuid_generate_random();
+		for (size_t ibyte = 0; ibyte < TEST_BUNDLE_SIZE; ++ibyte) {
+			test_bundle_static[ires][ibyte] = (uint8_t)(ibyte + ires);
+			test_bundle_dynamic[ires][ibyte] = (uint8_t)((ibyte * 3) + ires);
+		}
+
+		stream_t* stream = resource_local_create_static(test_bundle_uuids[ires], TEST_BUNDLE_PLATFORM);
+		resource_header_t header;
+		memset(&header, 0, sizeof(header));
+		header.type = HASH_TEST;
+		header.version = 1;
+		header.source_hash.data[0] = (uint8_t)(ires + 1);
+		resource_stream_write_header(stream, header);
+		stream_write(stream, test_bundle_static[ires], TEST_BUNDLE_SIZE);
+		stream_deallocate(stream);
+
+		if (ires != 1) {
+			stream = resource_local_create_dynamic(test_bundle_uuids[ires], TEST_BUNDLE_PLATFORM);
+			stream_write(stream, test_bundle_dynamic[ires], TEST_BUNDLE_SIZE);
+			stream_deallocate(stream);
+		}
+	}
+
+	return path;
+}
+
+static void
+test_bundle_path_deallocate(string_t path) {
+	resource_local_clear_paths();
+	fs_remove_directory(STRING_ARGS(path));
+	string_deallocate(path.str);
+}
+
+// State of an asynchronous read, order is the sequence number of the completion
+struct test_bundle_read_t {
+	atomic32_t done;
+	int32_t order;
+	size_t size;
+	resource_bundle_t** deallocate;
+	uint8_t buffer[TEST_BUNDLE_SIZE];
+};
+
+typedef struct test_bundle_read_t test_bundle_read_t;
+
+static atomic32_t test_bundle_read_order;
+static atomic32_t test_bundle_block_entered;
+static semaphore_t test_bundle_block_signal;
+
+static void
+test_bundle_read_callback(const resource_bundle_t* bundle, const uuid_t uuid, void* buffer, size_t size,
+                          void* data) {
+	FOUNDATION_UNUSED(bundle);
+	FOUNDATION_UNUSED(uuid);
+	FOUNDATION_UNUSED(buffer);
+	test_bundle_read_t* read = data;
+	read->size = size;
+	read->order = atomic_incr32(&test_bundle_read_order, memory_order_relaxed);
+	if (read->deallocate && *read->deallocate) {
+		// Only the first callback of the batch deallocates, later callbacks get the stale pointer
+		resource_bundle_t* deallocate = *read->deallocate;
+		*read->deallocate = nullptr;
+		resource_bundle_deallocate(deallocate);
+	}
+	atomic_store32(&read->done, 1, memory_order_release);
+}
+
+// Hold the I/O thread in a callback until signalled, so following reads are queued
+static void
+test_bundle_block_callback(const resource_bundle_t* bundle, const uuid_t uuid, void* buffer, size_t size,
+                           void* data) {
+	atomic_store32(&test_bundle_block_entered, 1, memory_order_release);
+	semaphore_wait(&test_bundle_block_signal);
+	test_bundle_read_callback(bundle, uuid, buffer, size, data);
+}
+
+static bool
+test_bundle_read_wait(test_bundle_read_t* read) {
+	for (int iwait = 0; iwait < 5000; ++iwait) {
+		if (atomic_load32(&read->done, memory_order_acquire))
+			return true;
+		thread_sleep(1);
+	}
+	return false;
+}
+
+static bool
+test_bundle_block(resource_bundle_t* bundle, test_bundle_read_t* read) {
+	atomic_store32(&test_bundle_block_entered, 0, memory_order_release);
+	if (!resource_bundle_read_async(bundle, test_bundle_uuids[0], 0, 16, read->buffer, 0, test_bundle_block_callback,
+	                                read))
+		return false;
+	for (int iwait = 0; iwait < 5000; ++iwait) {
+		if (atomic_load32(&test_bundle_block_entered, memory_order_acquire))
+			return true;
+		thread_sleep(1);
+	}
+	return false;
+}
+
+#endif
+
+DECLARE_TEST(bundle, write) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	uint8_t verify[TEST_BUNDLE_SIZE];
+	string_t path = test_bundle_path_allocate();
+	uuid_t bundle_uuid = uuid_generate_random();
+
+	EXPECT_TRUE(resource_bundle_write(bundle_uuid, TEST_BUNDLE_PLATFORM, test_bundle_uuids, TEST_BUNDLE_RESOURCES));
+
+	resource_bundle_t* bundle = resource_bundle_load(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	EXPECT_PTRNE(bundle, nullptr);
+	EXPECT_TRUE(uuid_equal(bundle->uuid, bundle_uuid));
+	EXPECT_UINTEQ(bundle->platform, TEST_BUNDLE_PLATFORM);
+	EXPECT_SIZEEQ(bundle->count, TEST_BUNDLE_RESOURCES);
+
+	stream_t* dynamic = resource_bundle_stream(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	EXPECT_PTRNE(dynamic, nullptr);
+
+	uint64_t last_offset = 0;
+	for (size_t ires = 0; ires < TEST_BUNDLE_RESOURCES; ++ires) {
+		const resource_bundle_entry_t* entry = resource_bundle_lookup(bundle, test_bundle_uuids[ires]);
+		EXPECT_PTRNE(entry, nullptr);
+		EXPECT_TRUE(uuid_equal(entry->uuid, test_bundle_uuids[ires]));
+		EXPECT_UINTEQ(entry->type, HASH_TEST);
+		EXPECT_UINTEQ(entry->source_hash.data[0], ires + 1);
+
+		// Static data is stored in the given order
+		if (ires)
+			EXPECT_UINTGT(entry->static_offset, last_offset);
+		last_offset = entry->static_offset;
+
+		stream_t* stream = resource_bundle_open_static(bundle, test_bundle_uuids[ires]);
+		EXPECT_PTRNE(stream, nullptr);
+		resource_header_t header = resource_stream_read_header(stream);
+		EXPECT_UINTEQ(header.type, HASH_TEST);
+		EXPECT_UINTEQ(header.version, 1);
+		EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), TEST_BUNDLE_SIZE);
+		EXPECT_INTEQ(memcmp(verify, test_bundle_static[ires], TEST_BUNDLE_SIZE), 0);
+		EXPECT_TRUE(stream_eos(stream));
+		stream_deallocate(stream);
+
+		if (ires == 1) {
+			EXPECT_UINTEQ(entry->dynamic_size, 0);
+			continue;
+		}
+		EXPECT_UINTEQ(entry->dynamic_size, TEST_BUNDLE_SIZE);
+		stream_seek(dynamic, (ssize_t)entry->dynamic_offset, STREAM_SEEK_BEGIN);
+		EXPECT_SIZEEQ(stream_read(dynamic, verify, TEST_BUNDLE_SIZE), TEST_BUNDLE_SIZE);
+		EXPECT_INTEQ(memcmp(verify, test_bundle_dynamic[ires], TEST_BUNDLE_SIZE), 0);
+	}
+	stream_deallocate(dynamic);
+
+	EXPECT_PTREQ(resource_bundle_lookup(bundle, uuid_generate_random()), nullptr);
+	EXPECT_PTREQ(resource_bundle_open_static(bundle, uuid_generate_random()), nullptr);
+	resource_bundle_deallocate(bundle);
+
+	// Bundle with a missing resource is not written
+	uuid_t resources[2] = {test_bundle_uuids[0], uuid_generate_random()};
+	uuid_t missing_uuid = uuid_generate_random();
+	EXPECT_FALSE(resource_bundle_write(missing_uuid, TEST_BUNDLE_PLATFORM, resources, 2));
+	EXPECT_PTREQ(resource_bundle_load(missing_uuid, TEST_BUNDLE_PLATFORM), nullptr);
+
+	test_bundle_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(bundle, build) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	string_t path = test_bundle_path_allocate();
+	uuid_t bundle_uuid = uuid_generate_random();
+
+	// Resources reached from several roots are stored once
+	uuid_t roots[4] = {test_bundle_uuids[2], test_bundle_uuids[0], test_bundle_uuids[2], test_bundle_uuids[0]};
+	EXPECT_TRUE(resource_bundle_build(bundle_uuid, TEST_BUNDLE_PLATFORM, roots, 4));
+
+	resource_bundle_t* bundle = resource_bundle_load(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	EXPECT_PTRNE(bundle, nullptr);
+	EXPECT_SIZEEQ(bundle->count, 2);
+	const resource_bundle_entry_t* first = resource_bundle_lookup(bundle, test_bundle_uuids[2]);
+	const resource_bundle_entry_t* second = resource_bundle_lookup(bundle, test_bundle_uuids[0]);
+	EXPECT_PTRNE(first, nullptr);
+	EXPECT_PTRNE(second, nullptr);
+	EXPECT_PTREQ(resource_bundle_lookup(bundle, test_bundle_uuids[1]), nullptr);
+
+	// Stored in the order first reached, with dynamic data laid out in the same order
+	EXPECT_UINTLT(first->static_offset, second->static_offset);
+	EXPECT_UINTLT(first->dynamic_offset, second->dynamic_offset);
+	resource_bundle_deallocate(bundle);
+
+	test_bundle_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(bundle, read_async) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	static test_bundle_read_t reads[8];
+	string_t path = test_bundle_path_allocate();
+	uuid_t bundle_uuid = uuid_generate_random();
+	semaphore_initialize(&test_bundle_block_signal, 0);
+
+	EXPECT_TRUE(resource_bundle_write(bundle_uuid, TEST_BUNDLE_PLATFORM, test_bundle_uuids, TEST_BUNDLE_RESOURCES));
+	resource_bundle_t* bundle = resource_bundle_load(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	EXPECT_PTRNE(bundle, nullptr);
+
+	// Reads are relative to the resource dynamic data and clamped to it
+	memset(reads, 0, sizeof(reads));
+	EXPECT_TRUE(resource_bundle_read_async(bundle, test_bundle_uuids[2], 100, 200, reads[0].buffer, 0,
+	                                       test_bundle_read_callback, reads));
+	EXPECT_TRUE(resource_bundle_read_async(bundle, test_bundle_uuids[0], TEST_BUNDLE_SIZE - 96, 1000,
+	                                       reads[1].buffer, 0, test_bundle_read_callback, reads + 1));
+	EXPECT_TRUE(test_bundle_read_wait(reads));
+	EXPECT_TRUE(test_bundle_read_wait(reads + 1));
+	EXPECT_SIZEEQ(reads[0].size, 200);
+	EXPECT_INTEQ(memcmp(reads[0].buffer, test_bundle_dynamic[2] + 100, 200), 0);
+	EXPECT_SIZEEQ(reads[1].size, 96);
+	EXPECT_INTEQ(memcmp(reads[1].buffer, test_bundle_dynamic[0] + TEST_BUNDLE_SIZE - 96, 96), 0);
+
+	EXPECT_FALSE(resource_bundle_read_async(bundle, test_bundle_uuids[0], TEST_BUNDLE_SIZE + 1, 10, reads[0].buffer,
+	                                        0, test_bundle_read_callback, reads));
+	EXPECT_FALSE(resource_bundle_read_async(bundle, uuid_generate_random(), 0, 10, reads[0].buffer, 0,
+	                                        test_bundle_read_callback, reads));
+
+	// Higher priority reads are served first, adjacent reads of the same priority are merged
+	memset(reads, 0, sizeof(reads));
+	EXPECT_TRUE(test_bundle_block(bundle, reads));
+	EXPECT_TRUE(resource_bundle_read_async(bundle, test_bundle_uuids[0], 0, 1024, reads[1].buffer, 0,
+	                                       test_bundle_read_callback, reads + 1));
+	EXPECT_TRUE(resource_bundle_read_async(bundle, test_bundle_uuids[2], 0, 1024, reads[2].buffer, 10,
+	                                       test_bundle_read_callback, reads + 2));
+	EXPECT_TRUE(resource_bundle_read_async(bundle, test_bundle_uuids[2], 1024, 1024, reads[3].buffer, 10,
+	                                       test_bundle_read_callback, reads + 3));
+	semaphore_post(&test_bundle_block_signal);
+	for (size_t iread = 0; iread < 4; ++iread)
+		EXPECT_TRUE(test_bundle_read_wait(reads + iread));
+	EXPECT_INTLT(reads[2].order, reads[1].order);
+	EXPECT_INTLT(reads[3].order, reads[1].order);
+	EXPECT_SIZEEQ(reads[2].size, 1024);
+	EXPECT_SIZEEQ(reads[3].size, 1024);
+	EXPECT_INTEQ(memcmp(reads[2].buffer, test_bundle_dynamic[2], 1024), 0);
+	EXPECT_INTEQ(memcmp(reads[3].buffer, test_bundle_dynamic[2] + 1024, 1024), 0);
+	EXPECT_INTEQ(memcmp(reads[1].buffer, test_bundle_dynamic[0], 1024), 0);
+
+	// Deallocating a bundle completes its queued reads as failed before returning
+	resource_bundle_t* other = resource_bundle_load(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	EXPECT_PTRNE(other, nullptr);
+	memset(reads, 0, sizeof(reads));
+	EXPECT_TRUE(test_bundle_block(bundle, reads));
+	for (size_t iread = 1; iread < 8; ++iread) {
+		reads[iread].size = 1;
+		EXPECT_TRUE(resource_bundle_read_async(other, test_bundle_uuids[0], iread * 16, 16, reads[iread].buffer,
+		                                       (int)iread, test_bundle_read_callback, reads + iread));
+	}
+	resource_bundle_deallocate(other);
+	for (size_t iread = 1; iread < 8; ++iread) {
+		EXPECT_TRUE(atomic_load32(&reads[iread].done, memory_order_acquire));
+		EXPECT_SIZEEQ(reads[iread].size, 0);
+	}
+	semaphore_post(&test_bundle_block_signal);
+	EXPECT_TRUE(test_bundle_read_wait(reads));
+
+	// Callback may deallocate the bundle, other reads of the same batch are still completed
+	memset(reads, 0, sizeof(reads));
+	EXPECT_TRUE(test_bundle_block(bundle, reads));
+	other = resource_bundle_load(bundle_uuid, TEST_BUNDLE_PLATFORM);
+	for (size_t iread = 1; iread < 4; ++iread) {
+		reads[iread].deallocate = &other;
+		EXPECT_TRUE(resource_bundle_read_async(other, test_bundle_uuids[2], iread * 16, 16, reads[iread].buffer, 0,
+		                                       test_bundle_read_callback, reads + iread));
+	}
+	semaphore_post(&test_bundle_block_signal);
+	EXPECT_TRUE(test_bundle_read_wait(reads));
+	for (size_t iread = 1; iread < 4; ++iread) {
+		EXPECT_TRUE(test_bundle_read_wait(reads + iread));
+		EXPECT_SIZEEQ(reads[iread].size, 16);
+		EXPECT_INTEQ(memcmp(reads[iread].buffer, test_bundle_dynamic[2] + (iread * 16), 16), 0);
+	}
+	EXPECT_PTREQ(other, nullptr);
+
+	resource_bundle_deallocate(bundle);
+	semaphore_finalize(&test_bundle_block_signal);
+	test_bundle_path_deallocate(path);
+#endif
+	return 0;
+}
+
+static void
+test_bundle_declare(void) {
+	ADD_TEST(bundle, write);
+	ADD_TEST(bundle, build);
+	ADD_TEST(bundle, read_async);
+}
+
+static test_suite_t test_bundle_suite = {test_bundle_application, test_bundle_memory_system, test_bundle_config,
+                                         test_bundle_declare,     test_bundle_initialize,    test_bundle_finalize,
+                                         test_bundle_event};
+
+#if BUILD_MONOLITHIC
+
+int
+test_bundle_run(void);
+
+int
+test_bundle_run(void) {
+	test_suite = test_bundle_suite;
+	return test_run_all();
+}
+
+#else
+
+test_suite_t
+test_suite_define(void);
+
+test_suite_t
+test_suite_define(void) {
+	return test_bundle_suite;
+}
+
+#endif
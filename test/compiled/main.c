@@ -0,0 +1,1061 @@
+/* main.c  -  Resource compiled test  -  Public Domain  -  2013 Mattias Jansson
+ *
+ * This library provides a cross-platform foundation library in C11 providing basic support
+ * data types and functions to write applications and games in a platform-independent fashion.
+ * The latest source code is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without
+ * any restrictions.
+ */
+
+#include <foundation/foundation.h>
+#include <network/network.h>
+#include <blake3/blake3.h>
+#include <resource/resource.h>
+#include <resource/compiled.h>
+#include <test/test.h>
+
+#define TEST_COMPILED_SIZE (RESOURCE_REMOTE_STREAM_BUFFER_SIZE * 3 + 1234)
+#define TEST_COMPILED_TIMEOUT 500
+#define TEST_COMPILED_STALL_SIZE 1000
+#define TEST_COMPILED_CLIENTS 8
+#define TEST_COMPILED_BUNDLE_ROOTS 4
+#define TEST_COMPILED_BUNDLE_DATA_SIZE 64
+
+static application_t
+test_compiled_application(void) {
+	application_t app;
+	memset(&app, 0, sizeof(app));
+	app.name = string_const(STRING_CONST("Resource compiled tests"));
+	app.short_name = string_const(STRING_CONST("test_compiled"));
+	app.company = string_const(STRING_CONST(""));
+	app.flags = APPLICATION_UTILITY;
+	app.exception_handler = test_exception_handler;
+	return app;
+}
+
+static memory_system_t
+test_compiled_memory_system(void) {
+	return memory_system_malloc();
+}
+
+static foundation_config_t
+test_compiled_config(void) {
+	foundation_config_t config;
+	memset(&config, 0, sizeof(config));
+	return config;
+}
+
+static int
+test_compiled_module_initialize(unsigned int connections, size_t prefetch_resource_limit) {
+	resource_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.enable_remote_compiled = true;
+	config.remote_compiled_connections = connections;
+	config.remote_stream_timeout = TEST_COMPILED_TIMEOUT;
+	// Single worker runs queued stream jobs in order, an open queued after a prefetch runs after it
+	config.stream_worker_threads = 1;
+	config.stream_prefetch_resource_limit = prefetch_resource_limit;
+	return resource_module_initialize(config);
+}
+
+static int
+test_compiled_initialize(void) {
+	network_config_t network_config;
+	memset(&network_config, 0, sizeof(network_config));
+	if (network_module_initialize(network_config) < 0)
+		return -1;
+
+	// Single connection so consecutive opens share the connection and must leave it in sync
+	return test_compiled_module_initialize(1, 0);
+}
+
+static void
+test_compiled_finalize(void) {
+	resource_module_finalize();
+	network_module_finalize();
+}
+
+static void
+test_compiled_event(event_t* event) {
+	resource_event_handle(event);
+}
+
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+
+static atomic32_t test_compiled_terminate;
+static atomic32_t test_compiled_features;
+static atomic32_t test_compiled_stall;
+static atomic32_t test_compiled_version;
+static atomic32_t test_compiled_opens;
+static atomic32_t test_compiled_corrupt;
+static atomic32_t test_compiled_not_modified;
+static atomic32_t test_compiled_path_length;
+static atomic32_t test_compiled_drop;
+static atomic32_t test_compiled_accepted;
+static atomic32_t test_compiled_bundles;
+static atomic32_t test_compiled_ranges;
+//! Number of bytes of dynamic data sent in replies to range opens
+static atomic32_t test_compiled_range_sent;
+//! Number of opens served by each accepted connection, in accept order
+static atomic32_t test_compiled_client_opens[TEST_COMPILED_CLIENTS];
+
+// Path of a file handed over instead of sending data, set while the server is idle
+static char test_compiled_path[BUILD_MAX_PATHLEN];
+
+typedef struct test_compiled_client_t test_compiled_client_t;
+
+//! Accepted connection served by its own thread, with buffers used by that thread only
+struct test_compiled_client_t {
+	thread_t thread;
+	socket_t* sock;
+	size_t index;
+	uint32_t features;
+	uint8_t send[TEST_COMPILED_SIZE];
+	uint8_t frame[RESOURCE_COMPRESS_CHUNK_SIZE + (sizeof(uint32_t) * 2)];
+};
+
+// Compiled data of each version has runs of repeated bytes that compress and a part that does not
+static void
+test_compiled_fill(uint8_t* buffer, int32_t version) {
+	uint32_t state = (uint32_t)version * 2654435761U;
+	for (size_t ibyte = 0; ibyte < TEST_COMPILED_SIZE; ++ibyte) {
+		state = (state * 1103515245U) + 12345U;
+		if ((ibyte / RESOURCE_REMOTE_STREAM_BUFFER_SIZE) == 2)
+			buffer[ibyte] = (uint8_t)(state >> 16);
+		else
+			buffer[ibyte] = (uint8_t)((ibyte / 64) + (size_t)version);
+	}
+}
+
+static blake3_hash_t
+test_compiled_source_hash(int32_t version) {
+	blake3_hash_t hash;
+	memset(&hash, 0, sizeof(hash));
+	memcpy(hash.data, &version, sizeof(version));
+	hash.data[sizeof(hash.data) - 1] = 0xFF;
+	return hash;
+}
+
+static bool
+test_compiled_read(socket_t* sock, void* buffer, size_t size) {
+	size_t total = 0;
+	while (total < size) {
+		size_t read = socket_read(sock, pointer_offset(buffer, total), size - total);
+		if (!read) {
+			if (socket_state(sock) != SOCKETSTATE_CONNECTED)
+				return false;
+			thread_yield();
+		}
+		total += read;
+	}
+	return true;
+}
+
+static bool
+test_compiled_write(socket_t* sock, const void* buffer, size_t size) {
+	size_t total = 0;
+	while (total < size) {
+		size_t wrote = socket_write(sock, pointer_offset_const(buffer, total), size - total);
+		if (!wrote) {
+			if (socket_state(sock) != SOCKETSTATE_CONNECTED)
+				return false;
+			thread_yield();
+		}
+		total += wrote;
+	}
+	return true;
+}
+
+// Send the data of the current version, in framed chunks if compression was negotiated, unless the
+// client already holds it
+static int
+test_compiled_serve_open(test_compiled_client_t* client, compiled_message_t msg) {
+	socket_t* sock = client->sock;
+	uint32_t features = client->features;
+	struct {
+		uuid_t uuid;
+		uint64_t platform;
+		blake3_hash_t source_hash;
+	} open;
+	if ((msg.size != sizeof(open)) || !test_compiled_read(sock, &open, sizeof(open)))
+		return -1;
+	// Connection dropped without a reply, the client must reconnect and send the open again
+	if (atomic_cas32(&test_compiled_drop, 0, 1, memory_order_acq_rel, memory_order_relaxed))
+		return -1;
+	atomic_incr32(&test_compiled_opens, memory_order_relaxed);
+	atomic_incr32(&test_compiled_client_opens[client->index], memory_order_relaxed);
+
+	int32_t version = atomic_load32(&test_compiled_version, memory_order_acquire);
+	blake3_hash_t hash = test_compiled_source_hash(version);
+	if (blake3_hash_equal(open.source_hash, hash)) {
+		// Client copy is current, no data is sent
+		atomic_incr32(&test_compiled_not_modified, memory_order_relaxed);
+		compiled_message_id id =
+		    (msg.id == COMPILED_OPEN_STATIC) ? COMPILED_OPEN_STATIC_RESULT : COMPILED_OPEN_DYNAMIC_RESULT;
+		return compiled_write_open_not_modified_reply(sock, id, msg.request, hash);
+	}
+	size_t path_length = (size_t)atomic_load32(&test_compiled_path_length, memory_order_acquire);
+	if (path_length && (features & COMPILED_FEATURE_PATH)) {
+		// Hand over the file by path, the client checks it against the reply
+		size_t size = (size_t)fs_size(test_compiled_path, path_length);
+		int ret = (msg.id == COMPILED_OPEN_STATIC) ?
+		              compiled_write_open_static_reply(sock, msg.request, true, COMPILED_FLAG_PATH, size, hash) :
+		              compiled_write_open_dynamic_reply(sock, msg.request, true, COMPILED_FLAG_PATH, size, hash);
+		if (ret < 0)
+			return -1;
+		return compiled_write_open_path(sock, test_compiled_path, path_length);
+	}
+	uint32_t flags = (features & COMPILED_FEATURE_COMPRESSION) ? COMPILED_FLAG_FRAMED : 0;
+	int ret = (msg.id == COMPILED_OPEN_STATIC) ?
+	              compiled_write_open_static_reply(sock, msg.request, true, flags, TEST_COMPILED_SIZE, hash) :
+	              compiled_write_open_dynamic_reply(sock, msg.request, true, flags, TEST_COMPILED_SIZE, hash);
+	if (ret < 0)
+		return -1;
+
+	test_compiled_fill(client->send, version);
+	if (atomic_load32(&test_compiled_stall, memory_order_acquire)) {
+		// Send the start of the data and then nothing until released, the client must time out
+		test_compiled_write(sock, client->send, TEST_COMPILED_STALL_SIZE);
+		while (atomic_load32(&test_compiled_stall, memory_order_acquire) &&
+		       !atomic_load32(&test_compiled_terminate, memory_order_acquire))
+			thread_sleep(10);
+		return -1;
+	}
+	if (!flags)
+		return test_compiled_write(sock, client->send, TEST_COMPILED_SIZE) ? 0 : -1;
+
+	for (size_t offset = 0; offset < TEST_COMPILED_SIZE; offset += RESOURCE_COMPRESS_CHUNK_SIZE) {
+		size_t chunk = TEST_COMPILED_SIZE - offset;
+		if (chunk > RESOURCE_COMPRESS_CHUNK_SIZE)
+			chunk = RESOURCE_COMPRESS_CHUNK_SIZE;
+		size_t framed = resource_compress_chunk(client->send + offset, chunk, client->frame, sizeof(client->frame));
+		if (offset && atomic_load32(&test_compiled_corrupt, memory_order_acquire)) {
+			// Chunk larger than the client receive buffer
+			uint32_t frame[2] = {16, RESOURCE_REMOTE_STREAM_BUFFER_SIZE + 1};
+			test_compiled_write(sock, frame, sizeof(frame));
+			return -1;
+		}
+		if (!framed || !test_compiled_write(sock, client->frame, framed))
+			return -1;
+	}
+	return 0;
+}
+
+// Send only the requested window of the data of the current version, failing ranges starting past the end
+static int
+test_compiled_serve_range(test_compiled_client_t* client, compiled_message_t msg) {
+	socket_t* sock = client->sock;
+	struct {
+		uuid_t uuid;
+		uint64_t platform;
+		uint64_t offset;
+		uint64_t range;
+	} open;
+	if ((msg.size != sizeof(open)) || !test_compiled_read(sock, &open, sizeof(open)))
+		return -1;
+	atomic_incr32(&test_compiled_ranges, memory_order_relaxed);
+	if (open.offset > TEST_COMPILED_SIZE)
+		return compiled_write_open_dynamic_range_reply(sock, msg.request, false, 0);
+
+	size_t size = (size_t)open.range;
+	if (size > (TEST_COMPILED_SIZE - (size_t)open.offset))
+		size = TEST_COMPILED_SIZE - (size_t)open.offset;
+	test_compiled_fill(client->send, atomic_load32(&test_compiled_version, memory_order_acquire));
+	if (compiled_write_open_dynamic_range_reply(sock, msg.request, true, size) < 0)
+		return -1;
+	atomic_add32(&test_compiled_range_sent, (int32_t)size, memory_order_relaxed);
+	return test_compiled_write(sock, client->send + open.offset, size) ? 0 : -1;
+}
+
+/* Reply with a bundle holding a block of static data filled with the low byte of the UUID for each
+root. Roots are given in UUID order and the table of contents is written in the same order */
+static int
+test_compiled_serve_bundle(test_compiled_client_t* client, compiled_message_t msg) {
+	socket_t* sock = client->sock;
+	uint8_t block[TEST_COMPILED_BUNDLE_DATA_SIZE];
+	uuid_t roots[TEST_COMPILED_BUNDLE_ROOTS];
+	struct {
+		uuid_t bundle;
+		uint64_t platform;
+	} open;
+	size_t count = (msg.size >= sizeof(open)) ? ((msg.size - sizeof(open)) / sizeof(uuid_t)) : 0;
+	if ((msg.size != sizeof(open) + (sizeof(uuid_t) * count)) || (count > TEST_COMPILED_BUNDLE_ROOTS) ||
+	    !test_compiled_read(sock, &open, sizeof(open)) || !test_compiled_read(sock, roots, sizeof(uuid_t) * count))
+		return -1;
+	atomic_incr32(&test_compiled_bundles, memory_order_relaxed);
+	if (!count)
+		return compiled_write_open_bundle_reply(sock, msg.request, false, 0, 0);
+
+	stream_t* stream =
+	    buffer_stream_allocate(client->send, STREAM_OUT | STREAM_BINARY, 0, sizeof(client->send), false, false);
+	resource_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = hash(STRING_CONST("bundle"));
+	header.version = 1;
+	resource_stream_write_header(stream, header);
+	stream_write_uint32(stream, (uint32_t)count);
+	stream_write_uint32(stream, 0);
+	for (size_t iroot = 0; iroot < count; ++iroot) {
+		resource_bundle_entry_t entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.uuid = roots[iroot];
+		entry.type = HASH_TEST;
+		entry.static_offset = iroot * TEST_COMPILED_BUNDLE_DATA_SIZE;
+		entry.static_size = TEST_COMPILED_BUNDLE_DATA_SIZE;
+		entry.source_hash = test_compiled_source_hash(1);
+		stream_write(stream, &entry, sizeof(entry));
+	}
+	for (size_t iroot = 0; iroot < count; ++iroot) {
+		memset(block, (int)(roots[iroot].word[0] & 0xFF), sizeof(block));
+		stream_write(stream, block, sizeof(block));
+	}
+	size_t size = (size_t)stream_tell(stream);
+	stream_deallocate(stream);
+
+	if (compiled_write_open_bundle_reply(sock, msg.request, true, 0, size) < 0)
+		return -1;
+	return test_compiled_write(sock, client->send, size) ? 0 : -1;
+}
+
+static void*
+test_compiled_serve_client(void* arg) {
+	test_compiled_client_t* client = arg;
+	socket_t* sock = client->sock;
+	compiled_message_t msg;
+	while (test_compiled_read(sock, &msg, sizeof(msg))) {
+		if (msg.id == COMPILED_HELLO) {
+			uint32_t hello[2];
+			if ((msg.size != sizeof(hello)) || !test_compiled_read(sock, hello, sizeof(hello)))
+				break;
+			client->features = hello[1] & (uint32_t)atomic_load32(&test_compiled_features, memory_order_acquire);
+			if (compiled_write_hello_reply(sock, msg.request, client->features) < 0)
+				break;
+			continue;
+		}
+		if (msg.id == COMPILED_OPEN_DYNAMIC_RANGE) {
+			if (test_compiled_serve_range(client, msg) < 0)
+				break;
+			continue;
+		}
+		if (msg.id == COMPILED_OPEN_BUNDLE) {
+			if (test_compiled_serve_bundle(client, msg) < 0)
+				break;
+			continue;
+		}
+		if ((msg.id != COMPILED_OPEN_STATIC) && (msg.id != COMPILED_OPEN_DYNAMIC))
+			break;
+		if (test_compiled_serve_open(client, msg) < 0)
+			break;
+	}
+	socket_close(sock);
+	return nullptr;
+}
+
+// Serve each accepted connection on its own thread so several connections can be open at once
+static void*
+test_compiled_server(void* arg) {
+	socket_t* listener = arg;
+	test_compiled_client_t* clients[TEST_COMPILED_CLIENTS];
+	size_t count = 0;
+	while (!atomic_load32(&test_compiled_terminate, memory_order_acquire)) {
+		socket_t* sock = tcp_socket_accept(listener, 100);
+		if (!sock)
+			continue;
+		if (count == TEST_COMPILED_CLIENTS) {
+			socket_deallocate(sock);
+			continue;
+		}
+		socket_set_blocking(sock, true);
+		test_compiled_client_t* client =
+		    memory_allocate(HASH_TEST, sizeof(test_compiled_client_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+		client->sock = sock;
+		client->index = count;
+		clients[count++] = client;
+		atomic_incr32(&test_compiled_accepted, memory_order_release);
+		thread_initialize(&client->thread, test_compiled_serve_client, client, STRING_CONST("compiled-client"),
+		                  THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&client->thread);
+	}
+	for (size_t iclient = 0; iclient < count; ++iclient) {
+		thread_finalize(&clients[iclient]->thread);
+		socket_deallocate(clients[iclient]->sock);
+		memory_deallocate(clients[iclient]);
+	}
+	return nullptr;
+}
+
+static socket_t*
+test_compiled_listen(thread_t* server, uint32_t features) {
+	network_address_ipv4_t ipv4_addr;
+	network_address_t* address = network_address_ipv4_initialize(&ipv4_addr);
+	network_address_ip_set_port(address, 0);
+	socket_t* listener = tcp_socket_allocate();
+	if (!socket_bind(listener, address) || !tcp_socket_listen(listener)) {
+		socket_deallocate(listener);
+		return nullptr;
+	}
+
+	atomic_store32(&test_compiled_terminate, 0, memory_order_release);
+	atomic_store32(&test_compiled_features, (int32_t)features, memory_order_release);
+	atomic_store32(&test_compiled_stall, 0, memory_order_release);
+	atomic_store32(&test_compiled_version, 1, memory_order_release);
+	atomic_store32(&test_compiled_opens, 0, memory_order_release);
+	atomic_store32(&test_compiled_corrupt, 0, memory_order_release);
+	atomic_store32(&test_compiled_not_modified, 0, memory_order_release);
+	atomic_store32(&test_compiled_path_length, 0, memory_order_release);
+	atomic_store32(&test_compiled_drop, 0, memory_order_release);
+	atomic_store32(&test_compiled_accepted, 0, memory_order_release);
+	atomic_store32(&test_compiled_bundles, 0, memory_order_release);
+	atomic_store32(&test_compiled_ranges, 0, memory_order_release);
+	atomic_store32(&test_compiled_range_sent, 0, memory_order_release);
+	for (size_t iclient = 0; iclient < TEST_COMPILED_CLIENTS; ++iclient)
+		atomic_store32(&test_compiled_client_opens[iclient], 0, memory_order_release);
+	thread_initialize(server, test_compiled_server, listener, STRING_CONST("compiled-server"), THREAD_PRIORITY_NORMAL,
+	                  0);
+	thread_start(server);
+
+	char buffer[64];
+	string_t url = string_format(buffer, sizeof(buffer), STRING_CONST("localhost:%u"),
+	                             network_address_ip_port(socket_address_local(listener)));
+	resource_remote_compiled_connect(STRING_ARGS(url));
+
+	return listener;
+}
+
+static void
+test_compiled_close(thread_t* server, socket_t* listener) {
+	resource_remote_compiled_disconnect();
+	atomic_store32(&test_compiled_terminate, 1, memory_order_release);
+	thread_finalize(server);
+	socket_deallocate(listener);
+}
+
+// Read the stream with small reads served from the receive buffer and large reads past it
+static size_t
+test_compiled_stream_read(stream_t* stream, uint8_t* buffer, size_t size) {
+	const size_t reads[] = {1, 100, RESOURCE_REMOTE_STREAM_BUFFER_SIZE + 10, 4000};
+	size_t total = 0;
+	for (size_t iread = 0; total < size; ++iread) {
+		size_t want = reads[(iread < 3) ? iread : 3];
+		if (want > size - total)
+			want = size - total;
+		size_t read = stream_read(stream, buffer + total, want);
+		total += read;
+		if (read != want)
+			break;
+	}
+	return total;
+}
+
+static bool
+test_compiled_verify(stream_t* stream, int32_t version) {
+	static uint8_t expect[TEST_COMPILED_SIZE];
+	static uint8_t data[TEST_COMPILED_SIZE + 16];
+	if (!stream || (stream_size(stream) != TEST_COMPILED_SIZE))
+		return false;
+	test_compiled_fill(expect, version);
+	size_t read = test_compiled_stream_read(stream, data, TEST_COMPILED_SIZE);
+	// Reads never go past the end of the stream
+	bool valid = (read == TEST_COMPILED_SIZE) && (stream_read(stream, data + read, 16) == 0) && stream_eos(stream);
+	return valid && !memcmp(data, expect, TEST_COMPILED_SIZE);
+}
+
+// Create an empty directory in the temporary directory and make it the cache of remote compiled resources
+static string_t
+test_compiled_cache_allocate(void) {
+	string_const_t tmp = environment_temporary_directory();
+	string_const_t name = string_from_uuid_static(uuid_generate_random());
+	string_t path = path_allocate_concat(STRING_ARGS(tmp), STRING_ARGS(name));
+	fs_make_directory(STRING_ARGS(path));
+	resource_remote_compiled_set_cache_path(STRING_ARGS(path));
+	return path;
+}
+
+static void
+test_compiled_cache_deallocate(string_t path) {
+	resource_remote_compiled_set_cache_path(nullptr, 0);
+	fs_remove_directory(STRING_ARGS(path));
+	string_deallocate(path.str);
+}
+
+// Count cached copies, or files being written if temporary is set
+static size_t
+test_compiled_cache_files(string_t path, bool temporary) {
+	string_t* files = fs_matching_files(STRING_ARGS(path), STRING_CONST("^.*$"), true);
+	size_t count = 0;
+	for (size_t ifile = 0, fsize = array_size(files); ifile < fsize; ++ifile) {
+		if (string_ends_with(STRING_ARGS(files[ifile]), STRING_CONST(".tmp")) == temporary)
+			++count;
+	}
+	string_array_deallocate(files);
+	return count;
+}
+
+// Check the cached copy of the given version, <cache>/<uuid>/<platform>.<source hash>[.blob]
+static bool
+test_compiled_cache_has(string_t path, uuid_t uuid, uint64_t platform, int32_t version, bool dynamic) {
+	static uint8_t expect[TEST_COMPILED_SIZE];
+	static uint8_t data[TEST_COMPILED_SIZE];
+	char buffer[BUILD_MAX_PATHLEN];
+	char hashbuffer[BLAKE3_HASH_STRING_LENGTH + 1];
+	string_const_t platformstr = string_from_uint_static(platform, true, 0, '0');
+	string_const_t hashstr =
+	    string_from_blake3_hash(test_compiled_source_hash(version), hashbuffer, sizeof(hashbuffer));
+	string_t file = resource_stream_make_path(buffer, sizeof(buffer), STRING_ARGS(path), uuid);
+	file = path_append(STRING_ARGS(file), sizeof(buffer), STRING_ARGS(platformstr));
+	file = string_append(STRING_ARGS(file), sizeof(buffer), STRING_CONST("."));
+	file = string_append(STRING_ARGS(file), sizeof(buffer), STRING_ARGS(hashstr));
+	if (dynamic)
+		file = string_append(STRING_ARGS(file), sizeof(buffer), STRING_CONST(".blob"));
+
+	stream_t* stream = stream_open(STRING_ARGS(file), STREAM_IN | STREAM_BINARY);
+	if (!stream)
+		return false;
+	test_compiled_fill(expect, version);
+	bool valid = (stream_size(stream) == TEST_COMPILED_SIZE) &&
+	             (stream_read(stream, data, TEST_COMPILED_SIZE) == TEST_COMPILED_SIZE) &&
+	             !memcmp(data, expect, TEST_COMPILED_SIZE);
+	stream_deallocate(stream);
+	return valid;
+}
+
+// Write a static resource file with a header of the given version followed by the compiled data
+static bool
+test_compiled_write_static(const char* path, size_t length, int32_t version) {
+	static uint8_t data[TEST_COMPILED_SIZE];
+	string_const_t directory = path_directory_name(path, length);
+	fs_make_directory(STRING_ARGS(directory));
+	stream_t* stream = stream_open(path, length, STREAM_OUT | STREAM_BINARY | STREAM_CREATE | STREAM_TRUNCATE);
+	if (!stream)
+		return false;
+	resource_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = HASH_TEST;
+	header.version = 1;
+	header.source_hash = test_compiled_source_hash(version);
+	resource_stream_write_header(stream, header);
+	test_compiled_fill(data, version);
+	stream_write(stream, data, TEST_COMPILED_SIZE);
+	stream_deallocate(stream);
+	return true;
+}
+
+// Hand over the given path in replies to opens
+static void
+test_compiled_set_path(const char* path, size_t length) {
+	string_copy(test_compiled_path, sizeof(test_compiled_path), path, length);
+	atomic_store32(&test_compiled_path_length, (int32_t)length, memory_order_release);
+}
+
+static bool
+test_compiled_verify_static(stream_t* stream, int32_t version) {
+	static uint8_t expect[TEST_COMPILED_SIZE];
+	static uint8_t data[TEST_COMPILED_SIZE];
+	if (!stream)
+		return false;
+	resource_header_t header = resource_stream_read_header(stream);
+	test_compiled_fill(expect, version);
+	return (header.type == HASH_TEST) && blake3_hash_equal(header.source_hash, test_compiled_source_hash(version)) &&
+	       (stream_read(stream, data, TEST_COMPILED_SIZE) == TEST_COMPILED_SIZE) &&
+	       !memcmp(data, expect, TEST_COMPILED_SIZE);
+}
+
+#endif
+
+DECLARE_TEST(compiled, stream) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	uint8_t partial[100];
+
+	socket_t* listener = test_compiled_listen(&server, 0);
+	EXPECT_PTRNE(listener, nullptr);
+
+	stream_t* stream = resource_remote_open_static(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+
+	// Unread data is skipped when the stream is deallocated, the connection stays in sync
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, partial, sizeof(partial)), sizeof(partial));
+	stream_deallocate(stream);
+
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 3);
+
+	test_compiled_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, timeout) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	static uint8_t data[TEST_COMPILED_SIZE];
+
+	socket_t* listener = test_compiled_listen(&server, 0);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Read of a stalled stream returns what was received once the timeout expires
+	atomic_store32(&test_compiled_stall, 1, memory_order_release);
+	stream_t* stream = resource_remote_open_static(uuid_generate_random(), 0);
+	EXPECT_PTRNE(stream, nullptr);
+	tick_t start = time_system();
+	size_t read = stream_read(stream, data, sizeof(data));
+	tick_t elapsed = time_system() - start;
+	EXPECT_SIZEEQ(read, TEST_COMPILED_STALL_SIZE);
+	EXPECT_INTGE((int)elapsed, TEST_COMPILED_TIMEOUT - 10);
+	EXPECT_TRUE(stream_eos(stream));
+	stream_deallocate(stream);
+	atomic_store32(&test_compiled_stall, 0, memory_order_release);
+
+	test_compiled_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, framed) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	uint8_t partial[100];
+	static uint8_t data[TEST_COMPILED_SIZE];
+
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Compressed and stored chunks are decoded to the original data
+	stream_t* stream = resource_remote_open_static(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+
+	// Remaining chunks are skipped when the stream is deallocated, the connection stays in sync
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, partial, sizeof(partial)), sizeof(partial));
+	stream_deallocate(stream);
+
+	atomic_store32(&test_compiled_version, 2, memory_order_release);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 3);
+
+	// Invalid chunk ends the stream after the data decoded so far
+	atomic_store32(&test_compiled_corrupt, 1, memory_order_release);
+	stream = resource_remote_open_static(uuid, 0);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, data, sizeof(data)), RESOURCE_COMPRESS_CHUNK_SIZE);
+	EXPECT_TRUE(stream_eos(stream));
+	stream_deallocate(stream);
+
+	test_compiled_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, cache) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	uint8_t partial[100];
+	static uint8_t data[TEST_COMPILED_SIZE];
+
+	string_t path = test_compiled_cache_allocate();
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Copy is written while the stream is read and published once complete
+	stream_t* stream = resource_remote_open_static(uuid, 0);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, partial, sizeof(partial)), sizeof(partial));
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, true), 1);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, false), 0);
+	stream_deallocate(stream);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, true), 0);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, false), 1);
+	EXPECT_TRUE(test_compiled_cache_has(path, uuid, 0, 1, false));
+
+	// Static and dynamic data of the same version are kept side by side
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, false), 2);
+	EXPECT_TRUE(test_compiled_cache_has(path, uuid, 0, 1, true));
+
+	// New version replaces all copies of older versions for the platform, other platforms are kept
+	stream = resource_remote_open_static(uuid, 1);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	atomic_store32(&test_compiled_version, 2, memory_order_release);
+	stream = resource_remote_open_static(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, false), 2);
+	EXPECT_TRUE(test_compiled_cache_has(path, uuid, 0, 2, false));
+	EXPECT_FALSE(test_compiled_cache_has(path, uuid, 0, 1, true));
+	EXPECT_TRUE(test_compiled_cache_has(path, uuid, 1, 1, false));
+
+	// Copy of a stream that failed is discarded
+	atomic_store32(&test_compiled_version, 3, memory_order_release);
+	atomic_store32(&test_compiled_stall, 1, memory_order_release);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZELT(stream_read(stream, data, sizeof(data)), TEST_COMPILED_SIZE);
+	stream_deallocate(stream);
+	atomic_store32(&test_compiled_stall, 0, memory_order_release);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, true), 0);
+	EXPECT_SIZEEQ(test_compiled_cache_files(path, false), 2);
+	EXPECT_FALSE(test_compiled_cache_has(path, uuid, 0, 3, true));
+
+	test_compiled_close(&server, listener);
+	test_compiled_cache_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, not_modified) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+
+	string_t path = test_compiled_cache_allocate();
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	stream_t* stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 0);
+
+	// Current cached copy is opened without any data being sent
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 1);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 2);
+
+	// Changed source sends the new version, which is then current
+	atomic_store32(&test_compiled_version, 2, memory_order_release);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 1);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 2);
+
+	// Copy held for another platform is not used
+	stream = resource_remote_open_dynamic(uuid, 1);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 2);
+
+	// Without a cache every open sends the data
+	resource_remote_compiled_set_cache_path(nullptr, 0);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 2));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 2);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 6);
+
+	test_compiled_close(&server, listener);
+	test_compiled_cache_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, path) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	char buffer[BUILD_MAX_PATHLEN];
+
+	// Paths are only accepted within the cache, which must be set before connecting
+	string_t path = test_compiled_cache_allocate();
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_PATH);
+	EXPECT_PTRNE(listener, nullptr);
+
+	string_t file = path_concat(buffer, sizeof(buffer), STRING_ARGS(path), STRING_CONST("handover/static"));
+	EXPECT_TRUE(test_compiled_write_static(STRING_ARGS(file), 1));
+	test_compiled_set_path(STRING_ARGS(file));
+
+	// File in the cache with the expected source hash is opened without any data being sent
+	stream_t* stream = resource_remote_open_static(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify_static(stream, 1));
+	stream_deallocate(stream);
+
+	// Source hash of the header not matching the reply is rejected
+	atomic_store32(&test_compiled_version, 2, memory_order_release);
+	EXPECT_PTREQ(resource_remote_open_static(uuid, 0), nullptr);
+	atomic_store32(&test_compiled_version, 1, memory_order_release);
+
+	// Paths outside the cache are rejected, also when escaping it through parent references
+	string_const_t tmp = environment_temporary_directory();
+	string_const_t name = string_from_uuid_static(uuid_generate_random());
+	char outsidebuffer[BUILD_MAX_PATHLEN];
+	string_t outside = path_concat(outsidebuffer, sizeof(outsidebuffer), STRING_ARGS(tmp), STRING_ARGS(name));
+	EXPECT_TRUE(test_compiled_write_static(STRING_ARGS(outside), 1));
+	test_compiled_set_path(STRING_ARGS(outside));
+	EXPECT_PTREQ(resource_remote_open_static(uuid, 0), nullptr);
+
+	file =
+	    string_format(buffer, sizeof(buffer), STRING_CONST("%.*s/../%.*s"), STRING_FORMAT(path), STRING_FORMAT(name));
+	test_compiled_set_path(STRING_ARGS(file));
+	EXPECT_PTREQ(resource_remote_open_static(uuid, 0), nullptr);
+	fs_remove_file(STRING_ARGS(outside));
+
+	test_compiled_close(&server, listener);
+	test_compiled_cache_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, connections) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	uint8_t partial[100];
+
+	// Several connections so streams can be open at the same time
+	resource_module_finalize();
+	EXPECT_INTEQ(test_compiled_module_initialize(2, 0), 0);
+
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Open stream holds its connection until read, the second stream is opened on the other connection
+	stream_t* first = resource_remote_open_static(uuid, 0);
+	EXPECT_PTRNE(first, nullptr);
+	EXPECT_SIZEEQ(stream_read(first, partial, sizeof(partial)), sizeof(partial));
+	stream_t* second = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(second, 1));
+	stream_deallocate(second);
+	stream_deallocate(first);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_accepted, memory_order_acquire), 2);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_client_opens[0], memory_order_acquire), 1);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_client_opens[1], memory_order_acquire), 1);
+
+	// Connection dropped without a reply is connected again and the open is sent again
+	atomic_store32(&test_compiled_drop, 1, memory_order_release);
+	stream_t* stream = resource_remote_open_static(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_drop, memory_order_acquire), 0);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_accepted, memory_order_acquire), 3);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_client_opens[2], memory_order_acquire), 1);
+
+	// Both connections are used again after the reconnect
+	first = resource_remote_open_static(uuid, 0);
+	EXPECT_PTRNE(first, nullptr);
+	EXPECT_SIZEEQ(stream_read(first, partial, sizeof(partial)), sizeof(partial));
+	second = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(second, 1));
+	stream_deallocate(second);
+	stream_deallocate(first);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 5);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_accepted, memory_order_acquire), 3);
+
+	test_compiled_close(&server, listener);
+
+	resource_module_finalize();
+	EXPECT_INTEQ(test_compiled_module_initialize(1, 0), 0);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, prefetch) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	resource_dependency_t prefetch;
+	prefetch.uuid = uuid_generate_random();
+	prefetch.platform = 0;
+
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Prefetched data is held in memory and the open is answered without a request
+	resource_stream_prefetch(&prefetch, 1);
+	resource_stream_async_t* async = resource_stream_open_static_async(prefetch.uuid, 0, nullptr, nullptr);
+	stream_t* stream = resource_stream_async_wait(async);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 1);
+
+	test_compiled_close(&server, listener);
+
+	// Resource larger than the limit is not held in memory, only read through to the cache
+	resource_module_finalize();
+	EXPECT_INTEQ(test_compiled_module_initialize(1, TEST_COMPILED_SIZE - 1), 0);
+	string_t path = test_compiled_cache_allocate();
+	listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	resource_stream_prefetch(&prefetch, 1);
+	async = resource_stream_open_static_async(prefetch.uuid, 0, nullptr, nullptr);
+	stream = resource_stream_async_wait(async);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 2);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_not_modified, memory_order_acquire), 1);
+
+	test_compiled_close(&server, listener);
+	test_compiled_cache_deallocate(path);
+
+	resource_module_finalize();
+	EXPECT_INTEQ(test_compiled_module_initialize(1, 0), 0);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, bundle) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t bundle = uuid_generate_random();
+	uuid_t roots[TEST_COMPILED_BUNDLE_ROOTS];
+	uint8_t data[TEST_COMPILED_BUNDLE_DATA_SIZE + 16];
+
+	// Roots in UUID order with distinct low bytes identifying the data of each
+	for (size_t iroot = 0; iroot < TEST_COMPILED_BUNDLE_ROOTS; ++iroot) {
+		roots[iroot] = uuid_generate_random();
+		roots[iroot].word[0] = iroot + 1;
+	}
+
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Table of contents and all static data are transferred in a single reply
+	resource_bundle_t* fetched = resource_bundle_fetch(bundle, 0, roots, TEST_COMPILED_BUNDLE_ROOTS);
+	EXPECT_PTRNE(fetched, nullptr);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_bundles, memory_order_acquire), 1);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 0);
+	for (size_t iroot = 0; iroot < TEST_COMPILED_BUNDLE_ROOTS; ++iroot) {
+		const resource_bundle_entry_t* entry = resource_bundle_lookup(fetched, roots[iroot]);
+		EXPECT_PTRNE(entry, nullptr);
+		EXPECT_UINTEQ(entry->type, HASH_TEST);
+		EXPECT_TRUE(blake3_hash_equal(entry->source_hash, test_compiled_source_hash(1)));
+		stream_t* stream = resource_bundle_open_static(fetched, roots[iroot]);
+		EXPECT_PTRNE(stream, nullptr);
+		EXPECT_SIZEEQ(stream_read(stream, data, sizeof(data)), TEST_COMPILED_BUNDLE_DATA_SIZE);
+		stream_deallocate(stream);
+		for (size_t ibyte = 0; ibyte < TEST_COMPILED_BUNDLE_DATA_SIZE; ++ibyte)
+			EXPECT_INTEQ(data[ibyte], (int)(iroot + 1));
+	}
+	EXPECT_PTREQ(resource_bundle_lookup(fetched, uuid_generate_random()), nullptr);
+	resource_bundle_deallocate(fetched);
+
+	// Connection stays in sync after the transfer
+	stream_t* stream = resource_remote_open_static(roots[0], 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+
+	// Bundle not available from the service falls back to loading a built bundle, which is not valid
+	EXPECT_PTREQ(resource_bundle_fetch(bundle, 0, roots, 0), nullptr);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_bundles, memory_order_acquire), 2);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 2);
+
+	test_compiled_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(compiled, range) {
+#if RESOURCE_ENABLE_REMOTE_COMPILED
+	thread_t server;
+	uuid_t uuid = uuid_generate_random();
+	uint8_t partial[100];
+	static uint8_t expect[TEST_COMPILED_SIZE];
+	static uint8_t data[TEST_COMPILED_SIZE];
+
+	socket_t* listener = test_compiled_listen(&server, COMPILED_FEATURE_COMPRESSION);
+	EXPECT_PTRNE(listener, nullptr);
+	test_compiled_fill(expect, 1);
+
+	// Only the requested window of the dynamic data is transferred
+	stream_t* stream = resource_stream_open_dynamic_range(uuid, 0, 1000, 5000);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), 5000);
+	EXPECT_SIZEEQ(stream_read(stream, data, sizeof(data)), 5000);
+	EXPECT_TRUE(stream_eos(stream));
+	EXPECT_INTEQ(memcmp(data, expect + 1000, 5000), 0);
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_range_sent, memory_order_acquire), 5000);
+
+	// Range past the end of the data is clamped to the end
+	stream = resource_stream_open_dynamic_range(uuid, 0, TEST_COMPILED_SIZE - 100, 1000);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, data, sizeof(data)), 100);
+	EXPECT_INTEQ(memcmp(data, expect + TEST_COMPILED_SIZE - 100, 100), 0);
+	stream_deallocate(stream);
+
+	// Range starting at the end is empty
+	stream = resource_stream_open_dynamic_range(uuid, 0, TEST_COMPILED_SIZE, 1000);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), 0);
+	EXPECT_SIZEEQ(stream_read(stream, data, sizeof(data)), 0);
+	stream_deallocate(stream);
+
+	// Unread data of a range is skipped when the stream is deallocated, the connection stays in sync
+	stream = resource_stream_open_dynamic_range(uuid, 0, 0, TEST_COMPILED_SIZE);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, partial, sizeof(partial)), sizeof(partial));
+	stream_deallocate(stream);
+	stream = resource_remote_open_dynamic(uuid, 0);
+	EXPECT_TRUE(test_compiled_verify(stream, 1));
+	stream_deallocate(stream);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_ranges, memory_order_acquire), 4);
+	EXPECT_INTEQ(atomic_load32(&test_compiled_opens, memory_order_acquire), 1);
+
+	test_compiled_close(&server, listener);
+#endif
+	return 0;
+}
+
+static void
+test_compiled_declare(void) {
+	ADD_TEST(compiled, stream);
+	ADD_TEST(compiled, timeout);
+	ADD_TEST(compiled, framed);
+	ADD_TEST(compiled, cache);
+	ADD_TEST(compiled, not_modified);
+	ADD_TEST(compiled, path);
+	ADD_TEST(compiled, connections);
+	ADD_TEST(compiled, prefetch);
+	ADD_TEST(compiled, bundle);
+	ADD_TEST(compiled, range);
+}
+
+static test_suite_t test_compiled_suite = {test_compiled_application, test_compiled_memory_system,
+                                           test_compiled_config,      test_compiled_declare,
+                                           test_compiled_initialize,  test_compiled_finalize,
+                                           test_compiled_event};
+
+#if BUILD_MONOLITHIC
+
+int
+test_compiled_run(void);
+
+int
+test_compiled_run(void) {
+	test_suite = test_compiled_suite;
+	return test_run_all();
+}
+
+#else
+
+test_suite_t
+test_suite_define(void);
+
+test_suite_t
+test_suite_define(void) {
+	return test_compiled_suite;
+}
+
+#endif
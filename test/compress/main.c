@@ -0,0 +1,449 @@
+/* main.c  -  Resource compress test  -  Public Domain  -  2013 Mattias Jansson
+ *
+ * This library provides a cross-platform foundation library in C11 providing basic support
+ * data types and functions to write applications and games in a platform-independent fashion.
+ * The latest source code is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without
+ * any restrictions.
+ */
+
+#include <foundation/foundation.h>
+#include <resource/resource.h>
+#include <test/test.h>
+
+//! Container header size, magic, chunk size, uncompressed size and index offset
+#define TEST_COMPRESS_HEADER_SIZE 24
+
+static application_t
+test_compress_application(void) {
+	application_t app;
+	memset(&app, 0, sizeof(app));
+	app.name = string_const(STRING_CONST("Resource compress tests"));
+	app.short_name = string_const(STRING_CONST("test_compress"));
+	app.company = string_const(STRING_CONST(""));
+	app.flags = APPLICATION_UTILITY;
+	app.exception_handler = test_exception_handler;
+	return app;
+}
+
+static memory_system_t
+test_compress_memory_system(void) {
+	return memory_system_malloc();
+}
+
+static foundation_config_t
+test_compress_config(void) {
+	foundation_config_t config;
+	memset(&config, 0, sizeof(config));
+	return config;
+}
+
+static int
+test_compress_initialize(void) {
+	resource_config_t config;
+	memset(&config, 0, sizeof(config));
+	return resource_module_initialize(config);
+}
+
+static void
+test_compress_finalize(void) {
+	resource_module_finalize();
+}
+
+static void
+test_compress_event(event_t* event) {
+	resource_event_handle(event);
+}
+
+// Data with repeated runs which compresses well
+static void*
+test_compress_data(size_t size) {
+	uint8_t* data = memory_allocate(HASH_TEST, size ? size : 1, 0, MEMORY_PERSISTENT);
+	for (size_t ibyte = 0; ibyte < size; ++ibyte)
+		data[ibyte] = (uint8_t)((ibyte / 64) % 23);
+	return data;
+}
+
+// Random data which does not compress
+static void*
+test_compress_random(size_t size) {
+	uint8_t* data = memory_allocate(HASH_TEST, size ? size : 1, 0, MEMORY_PERSISTENT);
+	for (size_t ibyte = 0; ibyte < size; ++ibyte)
+		data[ibyte] = (uint8_t)random32();
+	return data;
+}
+
+static size_t
+test_compress_capacity(size_t size) {
+	size_t chunks = (size / RESOURCE_COMPRESS_CHUNK_SIZE) + 1;
+	return TEST_COMPRESS_HEADER_SIZE + resource_compress_bound(size) + (chunks * 24);
+}
+
+// Compress data through a compressing stream into a buffer, returns buffer
+static void*
+test_compress_write(const void* data, size_t size, size_t capacity) {
+	void* buffer = memory_allocate(HASH_TEST, capacity, 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	stream_t* target = buffer_stream_allocate(buffer, STREAM_OUT | STREAM_BINARY, 0, capacity, false, false);
+	stream_t* stream = resource_compress_stream_allocate(target);
+	// Write in uneven pieces to cross chunk boundaries within a write
+	size_t written = 0;
+	while (written < size) {
+		size_t piece = (size - written < 10007) ? (size - written) : 10007;
+		if (stream_write(stream, pointer_offset_const(data, written), piece) != piece)
+			break;
+		written += piece;
+	}
+	stream_deallocate(stream);
+	return buffer;
+}
+
+static stream_t*
+test_compress_open(void* buffer, size_t capacity) {
+	stream_t* source = buffer_stream_allocate(buffer, STREAM_IN | STREAM_BINARY, capacity, capacity, false, false);
+	stream_t* stream = resource_decompress_stream_allocate(source, nullptr, 0);
+	if (!stream)
+		stream_deallocate(source);
+	return stream;
+}
+
+static int
+test_compress_roundtrip(const void* data, size_t size) {
+	size_t capacity = test_compress_capacity(size);
+	void* buffer = test_compress_write(data, size, capacity);
+	void* verify = memory_allocate(HASH_TEST, size + 1, 0, MEMORY_PERSISTENT);
+
+	stream_t* stream = test_compress_open(buffer, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), size);
+	EXPECT_SIZEEQ(stream_read(stream, verify, size + 1), size);
+	EXPECT_TRUE(stream_eos(stream));
+	EXPECT_INTEQ(memcmp(data, verify, size), 0);
+	stream_deallocate(stream);
+
+	memory_deallocate(verify);
+	memory_deallocate(buffer);
+	return 0;
+}
+
+DECLARE_TEST(compress, block) {
+	size_t size = 100000;
+	uint8_t* data = test_compress_data(size);
+	size_t capacity = resource_compress_bound(size);
+	uint8_t* compressed = memory_allocate(HASH_TEST, capacity, 0, MEMORY_PERSISTENT);
+	uint8_t* verify = memory_allocate(HASH_TEST, size, 0, MEMORY_PERSISTENT);
+
+	// Empty input is a single empty literal run
+	EXPECT_SIZEEQ(resource_compress_block(data, 0, compressed, capacity), 1);
+	EXPECT_SIZEEQ(resource_decompress_block(compressed, 1, verify, size), 0);
+
+	size_t compressed_size = resource_compress_block(data, size, compressed, capacity);
+	EXPECT_SIZEGT(compressed_size, 0);
+	EXPECT_SIZELT(compressed_size, size / 4);
+	EXPECT_SIZEEQ(resource_decompress_block(compressed, compressed_size, verify, size), size);
+	EXPECT_INTEQ(memcmp(data, verify, size), 0);
+
+	// Destination too small for the compressed or decompressed data
+	EXPECT_SIZEEQ(resource_compress_block(data, size, compressed, compressed_size - 1), 0);
+	EXPECT_SIZEEQ(resource_decompress_block(compressed, compressed_size, verify, size - 1), 0);
+
+	// Truncated data, cut at a sequence boundary or within the final literals
+	EXPECT_SIZENE(resource_decompress_block(compressed, compressed_size / 2, verify, size), size);
+	EXPECT_SIZEEQ(resource_decompress_block(compressed, compressed_size - 3, verify, size), 0);
+
+	// Match offset reaching before the start of the output
+	uint8_t corrupt[] = {0x10, 'a', 0x10, 0x00, 0x00};
+	EXPECT_SIZEEQ(resource_decompress_block(corrupt, sizeof(corrupt), verify, size), 0);
+	corrupt[2] = 0;
+	EXPECT_SIZEEQ(resource_decompress_block(corrupt, sizeof(corrupt), verify, size), 0);
+
+	// Literal length past the end of the data
+	uint8_t overrun[] = {0xF0, 0xFF, 0xFF};
+	EXPECT_SIZEEQ(resource_decompress_block(overrun, sizeof(overrun), verify, size), 0);
+
+	memory_deallocate(verify);
+	memory_deallocate(compressed);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, chunk) {
+	size_t size = RESOURCE_COMPRESS_CHUNK_SIZE;
+	uint8_t* data = test_compress_data(size + 1);
+	uint8_t* noise = test_compress_random(size);
+	size_t capacity = size + 16;
+	uint8_t* chunk = memory_allocate(HASH_TEST, capacity, 0, MEMORY_PERSISTENT);
+	uint8_t* verify = memory_allocate(HASH_TEST, size, 0, MEMORY_PERSISTENT);
+	uint32_t header[2];
+
+	// A full chunk compresses, frame header holds compressed and uncompressed size
+	size_t framed = resource_compress_chunk(data, size, chunk, capacity);
+	EXPECT_SIZEGT(framed, sizeof(header));
+	EXPECT_SIZELT(framed, size);
+	memcpy(header, chunk, sizeof(header));
+	EXPECT_UINTEQ(header[0], framed - sizeof(header));
+	EXPECT_UINTEQ(header[1], size);
+	EXPECT_SIZEEQ(resource_decompress_block(chunk + sizeof(header), header[0], verify, size), size);
+	EXPECT_INTEQ(memcmp(data, verify, size), 0);
+
+	// Corrupt or truncated frames fail to decompress
+	EXPECT_SIZEEQ(resource_decompress_block(chunk + sizeof(header), header[0] - 3, verify, size), 0);
+	chunk[sizeof(header)] = 0x0F;
+	EXPECT_SIZEEQ(resource_decompress_block(chunk + sizeof(header), header[0], verify, size), 0);
+
+	// Incompressible data is stored as is with equal sizes
+	framed = resource_compress_chunk(noise, size, chunk, capacity);
+	EXPECT_SIZEEQ(framed, size + sizeof(header));
+	memcpy(header, chunk, sizeof(header));
+	EXPECT_UINTEQ(header[0], size);
+	EXPECT_UINTEQ(header[1], size);
+	EXPECT_INTEQ(memcmp(chunk + sizeof(header), noise, size), 0);
+
+	// Empty chunk
+	framed = resource_compress_chunk(data, 0, chunk, capacity);
+	EXPECT_SIZEEQ(framed, sizeof(header));
+
+	// Too large chunk or too small destination
+	EXPECT_SIZEEQ(resource_compress_chunk(data, size + 1, chunk, capacity), 0);
+	EXPECT_SIZEEQ(resource_compress_chunk(data, size, chunk, size + sizeof(header) - 1), 0);
+
+	memory_deallocate(verify);
+	memory_deallocate(chunk);
+	memory_deallocate(noise);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, stream) {
+	size_t size = (RESOURCE_COMPRESS_CHUNK_SIZE * 3) + (RESOURCE_COMPRESS_CHUNK_SIZE / 2);
+	uint8_t* data = test_compress_data(size);
+	uint8_t* noise = test_compress_random(size);
+
+	// Empty input
+	EXPECT_INTEQ(test_compress_roundtrip(data, 0), 0);
+	// Less than a chunk
+	EXPECT_INTEQ(test_compress_roundtrip(data, 1000), 0);
+	// Exactly one chunk
+	EXPECT_INTEQ(test_compress_roundtrip(data, RESOURCE_COMPRESS_CHUNK_SIZE), 0);
+	// Multiple chunks, last one partial
+	EXPECT_INTEQ(test_compress_roundtrip(data, size), 0);
+	// Incompressible chunks
+	EXPECT_INTEQ(test_compress_roundtrip(noise, size), 0);
+
+	memory_deallocate(noise);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, seek) {
+	size_t size = (RESOURCE_COMPRESS_CHUNK_SIZE * 3) + (RESOURCE_COMPRESS_CHUNK_SIZE / 2);
+	uint8_t* data = test_compress_data(size);
+	size_t capacity = test_compress_capacity(size);
+	void* buffer = test_compress_write(data, size, capacity);
+	uint8_t verify[256];
+
+	stream_t* stream = test_compress_open(buffer, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_FALSE(stream_is_sequential(stream));
+
+	// Backward and forward through the chunk index, reads crossing chunk boundaries
+	size_t offsets[] = {RESOURCE_COMPRESS_CHUNK_SIZE * 3 + 17, RESOURCE_COMPRESS_CHUNK_SIZE - 100, 5,
+	                    RESOURCE_COMPRESS_CHUNK_SIZE * 2 - 128, size - sizeof(verify)};
+	for (size_t ioffset = 0; ioffset < sizeof(offsets) / sizeof(offsets[0]); ++ioffset) {
+		stream_seek(stream, (ssize_t)offsets[ioffset], STREAM_SEEK_BEGIN);
+		EXPECT_SIZEEQ(stream_tell(stream), offsets[ioffset]);
+		EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), sizeof(verify));
+		EXPECT_INTEQ(memcmp(data + offsets[ioffset], verify, sizeof(verify)), 0);
+	}
+	EXPECT_TRUE(stream_eos(stream));
+
+	stream_seek(stream, -(ssize_t)sizeof(verify), STREAM_SEEK_CURRENT);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), sizeof(verify));
+	EXPECT_INTEQ(memcmp(data + size - sizeof(verify), verify, sizeof(verify)), 0);
+
+	// Seeking past the end is clamped
+	stream_seek(stream, 10, STREAM_SEEK_END);
+	EXPECT_SIZEEQ(stream_tell(stream), size);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 0);
+
+	stream_deallocate(stream);
+	memory_deallocate(buffer);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, corrupt) {
+	size_t size = RESOURCE_COMPRESS_CHUNK_SIZE * 2;
+	uint8_t* data = test_compress_data(size);
+	uint8_t* verify = memory_allocate(HASH_TEST, size, 0, MEMORY_PERSISTENT);
+	size_t capacity = test_compress_capacity(size);
+	uint8_t* buffer = test_compress_write(data, size, capacity);
+
+	// Data which is not compressed is not wrapped and the source is left to the caller
+	stream_t* source = buffer_stream_allocate(data, STREAM_IN | STREAM_BINARY, size, size, false, false);
+	EXPECT_PTREQ(resource_decompress_stream_allocate(source, nullptr, 0), nullptr);
+	stream_deallocate(source);
+
+	// Corrupt size in the frame of the second chunk, the first chunk is still readable
+	uint64_t index_offset;
+	uint64_t second_chunk;
+	memcpy(&index_offset, buffer + 16, sizeof(index_offset));
+	memcpy(&second_chunk, buffer + index_offset + sizeof(uint64_t), sizeof(second_chunk));
+	uint32_t raw_size = RESOURCE_COMPRESS_CHUNK_SIZE * 2;
+	memcpy(buffer + second_chunk + sizeof(uint32_t), &raw_size, sizeof(raw_size));
+
+	stream_t* stream = test_compress_open(buffer, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, verify, size), RESOURCE_COMPRESS_CHUNK_SIZE);
+	EXPECT_INTEQ(memcmp(data, verify, RESOURCE_COMPRESS_CHUNK_SIZE), 0);
+	stream_deallocate(stream);
+
+	// Truncated frame of the first chunk
+	uint32_t compressed_size;
+	memcpy(&compressed_size, buffer + TEST_COMPRESS_HEADER_SIZE, sizeof(compressed_size));
+	compressed_size -= 3;
+	memcpy(buffer + TEST_COMPRESS_HEADER_SIZE, &compressed_size, sizeof(compressed_size));
+
+	stream = test_compress_open(buffer, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, verify, size), 0);
+	stream_deallocate(stream);
+
+	memory_deallocate(buffer);
+	memory_deallocate(verify);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, header) {
+	size_t size = RESOURCE_COMPRESS_CHUNK_SIZE * 2;
+	uint8_t* data = test_compress_data(size);
+	size_t capacity = test_compress_capacity(size);
+	uint8_t* buffer = test_compress_write(data, size, capacity);
+	uint8_t* corrupt = memory_allocate(HASH_TEST, capacity, 0, MEMORY_PERSISTENT);
+	uint64_t index_offset;
+	memcpy(&index_offset, buffer + 16, sizeof(index_offset));
+
+	// Header values are untrusted, containers with invalid values are rejected
+	uint32_t chunk_sizes[] = {0, RESOURCE_COMPRESS_CHUNK_SIZE + 1, 0xFFFFFFFFU};
+	for (size_t isize = 0; isize < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); ++isize) {
+		memcpy(corrupt, buffer, capacity);
+		memcpy(corrupt + 4, chunk_sizes + isize, sizeof(uint32_t));
+		EXPECT_PTREQ(test_compress_open(corrupt, capacity), nullptr);
+	}
+
+	// Index outside the container, or too small for the chunk count of the uncompressed size
+	uint64_t index_offsets[] = {8, capacity - 4, capacity + 1, 0xFFFFFFFFFFFFFFF0ULL};
+	for (size_t ioffset = 0; ioffset < sizeof(index_offsets) / sizeof(index_offsets[0]); ++ioffset) {
+		memcpy(corrupt, buffer, capacity);
+		memcpy(corrupt + 16, index_offsets + ioffset, sizeof(uint64_t));
+		EXPECT_PTREQ(test_compress_open(corrupt, capacity), nullptr);
+	}
+	uint64_t raw_sizes[] = {(uint64_t)capacity * RESOURCE_COMPRESS_CHUNK_SIZE, 0xFFFFFFFFFFFFFFFFULL};
+	for (size_t iraw = 0; iraw < sizeof(raw_sizes) / sizeof(raw_sizes[0]); ++iraw) {
+		memcpy(corrupt, buffer, capacity);
+		memcpy(corrupt + 8, raw_sizes + iraw, sizeof(uint64_t));
+		EXPECT_PTREQ(test_compress_open(corrupt, capacity), nullptr);
+	}
+
+	// Chunk offset in the index pointing into the header or past the index
+	uint64_t chunk_offsets[] = {0, index_offset, capacity * 2};
+	for (size_t ichunk = 0; ichunk < sizeof(chunk_offsets) / sizeof(chunk_offsets[0]); ++ichunk) {
+		memcpy(corrupt, buffer, capacity);
+		memcpy(corrupt + index_offset + sizeof(uint64_t), chunk_offsets + ichunk, sizeof(uint64_t));
+		EXPECT_PTREQ(test_compress_open(corrupt, capacity), nullptr);
+	}
+
+	// Unmodified container is still accepted
+	memcpy(corrupt, buffer, capacity);
+	stream_t* stream = test_compress_open(corrupt, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), size);
+	stream_deallocate(stream);
+
+	memory_deallocate(corrupt);
+	memory_deallocate(buffer);
+	memory_deallocate(data);
+	return 0;
+}
+
+DECLARE_TEST(compress, patch) {
+	size_t size = (RESOURCE_COMPRESS_CHUNK_SIZE * 2) + 1000;
+	uint8_t* data = test_compress_data(size);
+	size_t capacity = test_compress_capacity(size);
+	void* buffer = memory_allocate(HASH_TEST, capacity, 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	uint8_t* verify = memory_allocate(HASH_TEST, size, 0, MEMORY_PERSISTENT);
+
+	// Placeholder written first and patched by seeking back once the rest has been written,
+	// in a chunk which has been followed by more data
+	stream_t* target = buffer_stream_allocate(buffer, STREAM_OUT | STREAM_BINARY, 0, capacity, false, false);
+	stream_t* stream = resource_compress_stream_allocate(target);
+	uint32_t placeholder = 0;
+	uint32_t patch = 0xdeadbeef;
+	size_t patch_offset = RESOURCE_COMPRESS_CHUNK_SIZE / 2;
+	EXPECT_SIZEEQ(stream_write(stream, data, patch_offset), patch_offset);
+	EXPECT_SIZEEQ(stream_write(stream, &placeholder, sizeof(placeholder)), sizeof(placeholder));
+	size_t rest = size - patch_offset - sizeof(placeholder);
+	EXPECT_SIZEEQ(stream_write(stream, data + patch_offset + sizeof(placeholder), rest), rest);
+	EXPECT_SIZEEQ(stream_tell(stream), size);
+	stream_seek(stream, (ssize_t)patch_offset, STREAM_SEEK_BEGIN);
+	EXPECT_SIZEEQ(stream_tell(stream), patch_offset);
+	EXPECT_SIZEEQ(stream_write(stream, &patch, sizeof(patch)), sizeof(patch));
+	stream_seek(stream, 0, STREAM_SEEK_END);
+	EXPECT_SIZEEQ(stream_tell(stream), size);
+	EXPECT_SIZEEQ(stream_size(stream), size);
+	stream_deallocate(stream);
+
+	memcpy(data + patch_offset, &patch, sizeof(patch));
+	stream = test_compress_open(buffer, capacity);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_read(stream, verify, size), size);
+	EXPECT_INTEQ(memcmp(data, verify, size), 0);
+	stream_deallocate(stream);
+
+	memory_deallocate(verify);
+	memory_deallocate(buffer);
+	memory_deallocate(data);
+	return 0;
+}
+
+static void
+test_compress_declare(void) {
+	ADD_TEST(compress, block);
+	ADD_TEST(compress, chunk);
+	ADD_TEST(compress, stream);
+	ADD_TEST(compress, seek);
+	ADD_TEST(compress, corrupt);
+	ADD_TEST(compress, header);
+	ADD_TEST(compress, patch);
+}
+
+static test_suite_t test_compress_suite = {test_compress_application, test_compress_memory_system,
+                                           test_compress_config,      test_compress_declare,
+                                           test_compress_initialize,  test_compress_finalize,
+                                           test_compress_event};
+
+#if BUILD_MONOLITHIC
+
+int
+test_compress_run(void);
+
+int
+test_compress_run(void) {
+	test_suite = test_compress_suite;
+	return test_run_all();
+}
+
+#else
+
+test_suite_t
+test_suite_define(void);
+
+test_suite_t
+test_suite_define(void) {
+	return test_compress_suite;
+}
+
+#endif
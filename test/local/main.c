@@ -0,0 +1,523 @@
+/* main.c  -  Resource local test  -  Public Domain  -  2013 Mattias Jansson
+ *
+ * This library provides a cross-platform foundation library in C11 providing basic support
+ * data types and functions to write applications and games in a platform-independent fashion.
+ * The latest source code is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without
+ * any restrictions.
+ */
+
+#include <foundation/foundation.h>
+#include <resource/resource.h>
+#include <test/test.h>
+
+#define TEST_LOCAL_PLATFORM 0x1234
+#define TEST_LOCAL_SIZE 4096
+
+static application_t
+test_local_application(void) {
+	application_t app;
+	memset(&app, 0, sizeof(app));
+	app.name = string_const(STRING_CONST("Resource local tests"));
+	app.short_name = string_const(STRING_CONST("test_local"));
+	app.company = string_const(STRING_CONST(""));
+	app.flags = APPLICATION_UTILITY;
+	app.exception_handler = test_exception_handler;
+	return app;
+}
+
+static memory_system_t
+test_local_memory_system(void) {
+	return memory_system_malloc();
+}
+
+static foundation_config_t
+test_local_config(void) {
+	foundation_config_t config;
+	memset(&config, 0, sizeof(config));
+	return config;
+}
+
+static int
+test_local_initialize(void) {
+	resource_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.enable_local_cache = true;
+	return resource_module_initialize(config);
+}
+
+static void
+test_local_finalize(void) {
+	resource_module_finalize();
+}
+
+static void
+test_local_event(event_t* event) {
+	resource_event_handle(event);
+}
+
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+
+// Create an empty directory in the temporary directory and make it the only local path
+static string_t
+test_local_path_allocate(void) {
+	string_const_t tmp = environment_temporary_directory();
+	string_const_t name = string_from_uuid_static(uuid_generate_random());
+	string_t path = path_allocate_concat(STRING_ARGS(tmp), STRING_ARGS(name));
+	fs_make_directory(STRING_ARGS(path));
+	resource_local_clear_paths();
+	resource_local_add_path(STRING_ARGS(path));
+	return path;
+}
+
+static void
+test_local_path_deallocate(string_t path) {
+	resource_local_clear_paths();
+	fs_remove_directory(STRING_ARGS(path));
+	string_deallocate(path.str);
+}
+
+static void
+test_local_fill(void* buffer, size_t size, unsigned int seed) {
+	uint8_t* data = buffer;
+	for (size_t ibyte = 0; ibyte < size; ++ibyte)
+		data[ibyte] = (uint8_t)((ibyte * 7) + seed);
+}
+
+// Create the static part with a header and the given data, published when deallocated
+static stream_t*
+test_local_create_static(const uuid_t uuid, const void* data, size_t size) {
+	stream_t* stream = resource_local_create_static(uuid, TEST_LOCAL_PLATFORM);
+	if (!stream)
+		return nullptr;
+	resource_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = HASH_TEST;
+	header.version = 1;
+	resource_stream_write_header(stream, header);
+	stream_write(stream, data, size);
+	return stream;
+}
+
+static stream_t*
+test_local_create_dynamic(const uuid_t uuid, const void* data, size_t size) {
+	stream_t* stream = resource_local_create_dynamic(uuid, TEST_LOCAL_PLATFORM);
+	if (stream)
+		stream_write(stream, data, size);
+	return stream;
+}
+
+// Read the static part and compare the data following the header
+static bool
+test_local_verify_static(stream_t* stream, const void* data, size_t size) {
+	uint8_t verify[TEST_LOCAL_SIZE];
+	if (!stream || (size > sizeof(verify)))
+		return false;
+	resource_header_t header = resource_stream_read_header(stream);
+	if ((header.type != HASH_TEST) || (header.version != 1))
+		return false;
+	return (stream_read(stream, verify, size) == size) && !memcmp(verify, data, size);
+}
+
+static bool
+test_local_verify_dynamic(stream_t* stream, const void* data, size_t size) {
+	uint8_t verify[TEST_LOCAL_SIZE];
+	if (!stream || (size > sizeof(verify)))
+		return false;
+	return (stream_size(stream) == size) && (stream_read(stream, verify, size) == size) &&
+	       !memcmp(verify, data, size);
+}
+
+struct test_local_async_t {
+	atomic32_t done;
+	stream_t* stream;
+};
+
+typedef struct test_local_async_t test_local_async_t;
+
+static void
+test_local_async_callback(resource_stream_async_t* async, stream_t* stream, void* data) {
+	FOUNDATION_UNUSED(async);
+	test_local_async_t* result = data;
+	result->stream = stream;
+	atomic_store32(&result->done, 1, memory_order_release);
+}
+
+static bool
+test_local_async_wait(test_local_async_t* result) {
+	for (int iwait = 0; iwait < 5000; ++iwait) {
+		if (atomic_load32(&result->done, memory_order_acquire))
+			return true;
+		thread_sleep(1);
+	}
+	return false;
+}
+
+static size_t
+test_local_temporary_files(string_t path) {
+	string_t* files = fs_matching_files(STRING_ARGS(path), STRING_CONST("^.*\\.tmp$"), true);
+	size_t count = array_size(files);
+	string_array_deallocate(files);
+	return count;
+}
+
+#endif
+
+DECLARE_TEST(local, publish) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	uint8_t data[TEST_LOCAL_SIZE];
+	uint8_t replaced[TEST_LOCAL_SIZE];
+	string_t path = test_local_path_allocate();
+	uuid_t uuid = uuid_generate_random();
+	test_local_fill(data, sizeof(data), 1);
+	test_local_fill(replaced, sizeof(replaced), 2);
+
+	// Data is not visible until the stream is deallocated
+	stream_t* stream = test_local_create_static(uuid, data, sizeof(data));
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_PTREQ(resource_local_open_static(uuid, TEST_LOCAL_PLATFORM), nullptr);
+	EXPECT_SIZEEQ(test_local_temporary_files(path), 1);
+	stream_deallocate(stream);
+	EXPECT_SIZEEQ(test_local_temporary_files(path), 0);
+
+	stream = resource_local_open_static(uuid, TEST_LOCAL_PLATFORM);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+
+	// Readers of a replaced resource see the complete old data until the new data is published
+	stream_t* writer = test_local_create_static(uuid, replaced, sizeof(replaced) / 2);
+	EXPECT_PTRNE(writer, nullptr);
+	stream = resource_local_open_static(uuid, TEST_LOCAL_PLATFORM);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+	stream_write(writer, replaced + (sizeof(replaced) / 2), sizeof(replaced) / 2);
+	stream_deallocate(writer);
+
+	stream = resource_local_open_static(uuid, TEST_LOCAL_PLATFORM);
+	EXPECT_TRUE(test_local_verify_static(stream, replaced, sizeof(replaced)));
+	stream_deallocate(stream);
+
+	// Static and dynamic data in a publish scope are held back until the scope ends
+	uuid = uuid_generate_random();
+	resource_local_publish_begin(uuid, TEST_LOCAL_PLATFORM);
+	resource_local_publish_begin(uuid, TEST_LOCAL_PLATFORM);
+	stream_deallocate(test_local_create_static(uuid, data, sizeof(data)));
+	stream_deallocate(test_local_create_dynamic(uuid, replaced, sizeof(replaced)));
+	EXPECT_PTREQ(resource_local_open_static(uuid, TEST_LOCAL_PLATFORM), nullptr);
+	EXPECT_PTREQ(resource_local_open_dynamic(uuid, TEST_LOCAL_PLATFORM), nullptr);
+
+	// Nested scopes publish when the outermost scope ends
+	resource_local_publish_end(uuid, TEST_LOCAL_PLATFORM, true);
+	EXPECT_PTREQ(resource_local_open_static(uuid, TEST_LOCAL_PLATFORM), nullptr);
+	resource_local_publish_end(uuid, TEST_LOCAL_PLATFORM, true);
+
+	stream = resource_local_open_static(uuid, TEST_LOCAL_PLATFORM);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+	stream = resource_local_open_dynamic(uuid, TEST_LOCAL_PLATFORM);
+	EXPECT_TRUE(test_local_verify_dynamic(stream, replaced, sizeof(replaced)));
+	stream_deallocate(stream);
+
+	// Discarded scope publishes nothing and leaves no temporary files
+	uuid = uuid_generate_random();
+	resource_local_publish_begin(uuid, TEST_LOCAL_PLATFORM);
+	stream_deallocate(test_local_create_static(uuid, data, sizeof(data)));
+	stream_deallocate(test_local_create_dynamic(uuid, data, sizeof(data)));
+	EXPECT_SIZEEQ(test_local_temporary_files(path), 2);
+	resource_local_publish_end(uuid, TEST_LOCAL_PLATFORM, false);
+	EXPECT_PTREQ(resource_local_open_static(uuid, TEST_LOCAL_PLATFORM), nullptr);
+	EXPECT_PTREQ(resource_local_open_dynamic(uuid, TEST_LOCAL_PLATFORM), nullptr);
+	EXPECT_SIZEEQ(test_local_temporary_files(path), 0);
+
+	test_local_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(local, async) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	uint8_t data[TEST_LOCAL_SIZE];
+	test_local_async_t result;
+	string_t path = test_local_path_allocate();
+	uuid_t uuid = uuid_generate_random();
+	test_local_fill(data, sizeof(data), 3);
+
+	stream_deallocate(test_local_create_static(uuid, data, sizeof(data)));
+	stream_deallocate(test_local_create_dynamic(uuid, data, sizeof(data)));
+
+	// Wait for completion and take the stream
+	resource_stream_async_t* async = resource_stream_open_static_async(uuid, TEST_LOCAL_PLATFORM, nullptr, nullptr);
+	EXPECT_PTRNE(async, nullptr);
+	stream_t* stream = resource_stream_async_wait(async);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+
+	// Poll for completion before waiting
+	async = resource_stream_open_dynamic_async(uuid, TEST_LOCAL_PLATFORM, nullptr, nullptr);
+	for (int iwait = 0; (iwait < 5000) && !resource_stream_async_is_done(async); ++iwait)
+		thread_sleep(1);
+	EXPECT_TRUE(resource_stream_async_is_done(async));
+	stream = resource_stream_async_wait(async);
+	EXPECT_TRUE(test_local_verify_dynamic(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+
+	// Callback takes ownership of the stream, the handle can be released before completion
+	memset(&result, 0, sizeof(result));
+	async = resource_stream_open_dynamic_async(uuid, TEST_LOCAL_PLATFORM, test_local_async_callback, &result);
+	resource_stream_async_release(async);
+	EXPECT_TRUE(test_local_async_wait(&result));
+	EXPECT_TRUE(test_local_verify_dynamic(result.stream, data, sizeof(data)));
+	stream_deallocate(result.stream);
+
+	// Waiting on a handle with a callback returns no stream
+	memset(&result, 0, sizeof(result));
+	async = resource_stream_open_static_async(uuid, TEST_LOCAL_PLATFORM, test_local_async_callback, &result);
+	EXPECT_PTREQ(resource_stream_async_wait(async), nullptr);
+	EXPECT_TRUE(atomic_load32(&result.done, memory_order_acquire));
+	EXPECT_TRUE(test_local_verify_static(result.stream, data, sizeof(data)));
+	stream_deallocate(result.stream);
+
+	// Failed opens complete with a null stream
+	memset(&result, 0, sizeof(result));
+	uuid_t missing = uuid_generate_random();
+	async = resource_stream_open_static_async(missing, TEST_LOCAL_PLATFORM, nullptr, nullptr);
+	EXPECT_PTREQ(resource_stream_async_wait(async), nullptr);
+	async = resource_stream_open_dynamic_async(missing, TEST_LOCAL_PLATFORM, test_local_async_callback, &result);
+	resource_stream_async_release(async);
+	EXPECT_TRUE(test_local_async_wait(&result));
+	EXPECT_PTREQ(result.stream, nullptr);
+
+	// Released handle without callback deallocates the stream once opened
+	resource_stream_async_release(resource_stream_open_static_async(uuid, TEST_LOCAL_PLATFORM, nullptr, nullptr));
+
+	test_local_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(local, range) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	uint8_t data[TEST_LOCAL_SIZE];
+	uint8_t verify[TEST_LOCAL_SIZE];
+	string_t path = test_local_path_allocate();
+	uuid_t uuid = uuid_generate_random();
+	test_local_fill(data, sizeof(data), 4);
+
+	stream_deallocate(test_local_create_dynamic(uuid, data, sizeof(data)));
+
+	// Range within the data, offsets are relative to the range
+	stream_t* stream = resource_stream_open_dynamic_range(uuid, TEST_LOCAL_PLATFORM, 100, 200);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), 200);
+	EXPECT_SIZEEQ(stream_tell(stream), 0);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 200);
+	EXPECT_INTEQ(memcmp(verify, data + 100, 200), 0);
+	EXPECT_TRUE(stream_eos(stream));
+
+	stream_seek(stream, 50, STREAM_SEEK_BEGIN);
+	EXPECT_SIZEEQ(stream_read(stream, verify, 10), 10);
+	EXPECT_INTEQ(memcmp(verify, data + 150, 10), 0);
+	stream_seek(stream, -20, STREAM_SEEK_END);
+	EXPECT_SIZEEQ(stream_tell(stream), 180);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 20);
+	EXPECT_INTEQ(memcmp(verify, data + 280, 20), 0);
+
+	// Seeks are clamped to the range
+	stream_seek(stream, 1000, STREAM_SEEK_BEGIN);
+	EXPECT_SIZEEQ(stream_tell(stream), 200);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 0);
+	stream_seek(stream, -1000, STREAM_SEEK_CURRENT);
+	EXPECT_SIZEEQ(stream_tell(stream), 0);
+	EXPECT_SIZEEQ(stream_read(stream, verify, 4), 4);
+	EXPECT_INTEQ(memcmp(verify, data + 100, 4), 0);
+	stream_deallocate(stream);
+
+	// Range past the end of the data is clamped to the data
+	stream = resource_stream_open_dynamic_range(uuid, TEST_LOCAL_PLATFORM, sizeof(data) - 96, 1000);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), 96);
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 96);
+	EXPECT_INTEQ(memcmp(verify, data + sizeof(data) - 96, 96), 0);
+	stream_deallocate(stream);
+
+	// Range starting past the end of the data is empty
+	stream = resource_stream_open_dynamic_range(uuid, TEST_LOCAL_PLATFORM, sizeof(data) + 10, 100);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_SIZEEQ(stream_size(stream), 0);
+	EXPECT_TRUE(stream_eos(stream));
+	EXPECT_SIZEEQ(stream_read(stream, verify, sizeof(verify)), 0);
+	stream_deallocate(stream);
+
+	// Whole data
+	stream = resource_stream_open_dynamic_range(uuid, TEST_LOCAL_PLATFORM, 0, (size_t)-1);
+	EXPECT_PTRNE(stream, nullptr);
+	EXPECT_TRUE(test_local_verify_dynamic(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+
+	EXPECT_PTREQ(resource_stream_open_dynamic_range(uuid_generate_random(), TEST_LOCAL_PLATFORM, 0, 10), nullptr);
+
+	test_local_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(local, manifest) {
+#if RESOURCE_ENABLE_LOCAL_CACHE && RESOURCE_ENABLE_LOCAL_SOURCE
+	uint8_t data[TEST_LOCAL_SIZE];
+	uint8_t generic[TEST_LOCAL_SIZE];
+	char buffer[BUILD_MAX_PATHLEN];
+	string_t path = test_local_path_allocate();
+	uuid_t uuid = uuid_generate_random();
+	uuid_t generic_uuid = uuid_generate_random();
+	uint64_t platform = TEST_LOCAL_PLATFORM;
+	test_local_fill(data, sizeof(data), 5);
+	test_local_fill(generic, sizeof(generic), 6);
+
+	stream_deallocate(test_local_create_static(uuid, data, sizeof(data)));
+	stream_deallocate(test_local_create_dynamic(uuid, generic, sizeof(generic)));
+
+	// Resource stored for all platforms only, resolved for the requested platform in the manifest
+	stream_t* stream = resource_local_create_static(generic_uuid, 0);
+	resource_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = HASH_TEST;
+	header.version = 1;
+	resource_stream_write_header(stream, header);
+	stream_write(stream, generic, sizeof(generic));
+	stream_deallocate(stream);
+
+	EXPECT_FALSE(resource_local_manifest_is_loaded());
+	EXPECT_TRUE(resource_local_manifest_write(STRING_ARGS(path), &platform, 1));
+	string_t manifest_path =
+	    path_concat(buffer, sizeof(buffer), STRING_ARGS(path), STRING_CONST(RESOURCE_LOCAL_MANIFEST));
+	EXPECT_TRUE(fs_is_file(STRING_ARGS(manifest_path)));
+	EXPECT_TRUE(resource_local_manifest_load(STRING_ARGS(manifest_path)));
+	EXPECT_TRUE(resource_local_manifest_is_loaded());
+
+	stream = resource_local_manifest_open_static(uuid, platform);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+	stream = resource_local_manifest_open_dynamic(uuid, platform);
+	EXPECT_TRUE(test_local_verify_dynamic(stream, generic, sizeof(generic)));
+	stream_deallocate(stream);
+	stream = resource_local_manifest_open_static(generic_uuid, platform);
+	EXPECT_TRUE(test_local_verify_static(stream, generic, sizeof(generic)));
+	stream_deallocate(stream);
+	EXPECT_PTREQ(resource_local_manifest_open_dynamic(generic_uuid, platform), nullptr);
+
+	// Stream opens are answered from the manifest while loaded
+	stream = resource_stream_open_static(uuid, platform);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+	stream = resource_stream_open_dynamic(uuid, platform);
+	EXPECT_TRUE(test_local_verify_dynamic(stream, generic, sizeof(generic)));
+	stream_deallocate(stream);
+
+	// Resources not in the manifest fall back to searching the local paths
+	uuid_t added = uuid_generate_random();
+	stream_deallocate(test_local_create_static(added, data, sizeof(data)));
+	stream = resource_local_manifest_open_static(added, platform);
+	EXPECT_TRUE(test_local_verify_static(stream, data, sizeof(data)));
+	stream_deallocate(stream);
+	EXPECT_PTREQ(resource_local_manifest_open_static(uuid_generate_random(), platform), nullptr);
+
+	// Invalid manifest fails to load and keeps the loaded manifest
+	stream = stream_open(STRING_ARGS(manifest_path), STREAM_OUT | STREAM_TRUNCATE | STREAM_BINARY);
+	stream_write_uint32(stream, 0x12345678U);
+	stream_write_uint32(stream, 1);
+	stream_deallocate(stream);
+	EXPECT_FALSE(resource_local_manifest_load(STRING_ARGS(manifest_path)));
+	EXPECT_TRUE(resource_local_manifest_is_loaded());
+
+	resource_local_manifest_unload();
+	EXPECT_FALSE(resource_local_manifest_is_loaded());
+
+	test_local_path_deallocate(path);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(local, header) {
+	uint8_t buffer[128];
+	resource_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.type = HASH_TEST;
+	header.version = 3;
+	header.source_hash.data[0] = 0x42;
+	header.flags = 0x10 | RESOURCE_HEADERFLAG_COMPRESSED;
+
+	// Caller flags are kept, the compression flag is only set for compressed data
+	stream_t* stream = buffer_stream_allocate(buffer, STREAM_OUT | STREAM_BINARY, 0, sizeof(buffer), false, false);
+	resource_stream_write_header(stream, header);
+	stream_write_uint32(stream, 0x1234);
+	size_t size = stream_tell(stream);
+	stream_deallocate(stream);
+
+	stream = buffer_stream_allocate(buffer, STREAM_IN | STREAM_BINARY, size, sizeof(buffer), false, false);
+	resource_header_t read = resource_stream_read_header(stream);
+	EXPECT_TRUE(read.type == HASH_TEST);
+	EXPECT_UINTEQ(read.version, 3);
+	EXPECT_UINTEQ(read.flags, 0x10);
+	EXPECT_INTEQ(memcmp(read.source_hash.data, header.source_hash.data, BLAKE3_HASH_LENGTH), 0);
+	EXPECT_UINTEQ(stream_read_uint32(stream), 0x1234);
+	stream_deallocate(stream);
+
+	// Original layout without the flags word is still readable
+	stream = buffer_stream_allocate(buffer, STREAM_OUT | STREAM_BINARY, 0, sizeof(buffer), false, false);
+	stream_write_uint64(stream, HASH_TEST);
+	stream_write_uint32(stream, 3);
+	stream_write(stream, header.source_hash.data, BLAKE3_HASH_LENGTH);
+	stream_write_uint32(stream, 0x1234);
+	size = stream_tell(stream);
+	stream_deallocate(stream);
+
+	stream = buffer_stream_allocate(buffer, STREAM_IN | STREAM_BINARY, size, sizeof(buffer), false, false);
+	read = resource_stream_read_header(stream);
+	EXPECT_TRUE(read.type == HASH_TEST);
+	EXPECT_UINTEQ(read.version, 3);
+	EXPECT_UINTEQ(read.flags, 0);
+	EXPECT_INTEQ(memcmp(read.source_hash.data, header.source_hash.data, BLAKE3_HASH_LENGTH), 0);
+	EXPECT_UINTEQ(stream_read_uint32(stream), 0x1234);
+	stream_deallocate(stream);
+
+	return 0;
+}
+
+static void
+test_local_declare(void) {
+	ADD_TEST(local, publish);
+	ADD_TEST(local, async);
+	ADD_TEST(local, range);
+	ADD_TEST(local, manifest);
+	ADD_TEST(local, header);
+}
+
+static test_suite_t test_local_suite = {test_local_application, test_local_memory_system, test_local_config,
+                                        test_local_declare,     test_local_initialize,    test_local_finalize,
+                                        test_local_event};
+
+#if BUILD_MONOLITHIC
+
+int
+test_local_run(void);
+
+int
+test_local_run(void) {
+	test_suite = test_local_suite;
+	return test_run_all();
+}
+
+#else
+
+test_suite_t
+test_suite_define(void);
+
+test_suite_t
+test_suite_define(void) {
+	return test_local_suite;
+}
+
+#endif
@@ -0,0 +1,1037 @@
+/* main.c  -  Resource remote test  -  Public Domain  -  2013 Mattias Jansson
+ *
+ * This library provides a cross-platform foundation library in C11 providing basic support
+ * data types and functions to write applications and games in a platform-independent fashion.
+ * The latest source code is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without
+ * any restrictions.
+ */
+
+#include <foundation/foundation.h>
+#include <network/network.h>
+#include <resource/resource.h>
+#include <resource/sourced.h>
+#include <test/test.h>
+
+#define TEST_REMOTE_THREADS 16
+#define TEST_REMOTE_CALLS 512
+#define TEST_REMOTE_TIMEOUT 1000
+#define TEST_REMOTE_TREE_SIZE 2500
+
+static application_t
+test_remote_application(void) {
+	application_t app;
+	memset(&app, 0, sizeof(app));
+	app.name = string_const(STRING_CONST("Resource remote tests"));
+	app.short_name = string_const(STRING_CONST("test_remote"));
+	app.company = string_const(STRING_CONST(""));
+	app.flags = APPLICATION_UTILITY;
+	app.exception_handler = test_exception_handler;
+	return app;
+}
+
+static memory_system_t
+test_remote_memory_system(void) {
+	return memory_system_malloc();
+}
+
+static foundation_config_t
+test_remote_config(void) {
+	foundation_config_t config;
+	memset(&config, 0, sizeof(config));
+	return config;
+}
+
+static int
+test_remote_initialize(void) {
+	network_config_t network_config;
+	memset(&network_config, 0, sizeof(network_config));
+	if (network_module_initialize(network_config) < 0)
+		return -1;
+
+	resource_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.enable_remote_sourced = true;
+	config.remote_call_timeout = TEST_REMOTE_TIMEOUT;
+	return resource_module_initialize(config);
+}
+
+static void
+test_remote_finalize(void) {
+	resource_module_finalize();
+	network_module_finalize();
+}
+
+static void
+test_remote_event(event_t* event) {
+	resource_event_handle(event);
+}
+
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+
+static atomic32_t test_remote_terminate;
+static atomic32_t test_remote_stop;
+static atomic32_t test_remote_mismatch;
+static atomic32_t test_remote_failed;
+static atomic32_t test_remote_hang;
+static atomic32_t test_remote_revision;
+static atomic32_t test_remote_full_reads;
+static atomic32_t test_remote_delta_reads;
+static atomic32_t test_remote_unmodified_reads;
+static atomic32_t test_remote_hash_requests;
+static atomic32_t test_remote_dependency_requests;
+static atomic32_t test_remote_batch_requests;
+static atomic32_t test_remote_compression;
+static atomicptr_t test_remote_client;
+
+// Replies are derived from the request so callers can verify they got their own answer
+static blake3_hash_t
+test_remote_hash(uuid_t uuid, uint64_t platform) {
+	blake3_hash_t hash;
+	memset(&hash, 0, sizeof(hash));
+	memcpy(hash.data, &uuid, sizeof(uuid));
+	memcpy(hash.data + sizeof(uuid), &platform, sizeof(platform));
+	return hash;
+}
+
+static size_t
+test_remote_dependencies(uuid_t uuid, uint64_t platform, resource_dependency_t* deps) {
+	size_t count = (size_t)(uuid.word[0] % 7) + 1;
+	for (size_t idep = 0; idep < count; ++idep) {
+		deps[idep].uuid = uuid;
+		deps[idep].uuid.word[1] += idep;
+		deps[idep].platform = platform;
+	}
+	return count;
+}
+
+static bool
+test_remote_read(socket_t* sock, void* buffer, size_t size) {
+	size_t total = 0;
+	while (total < size) {
+		size_t read = socket_read(sock, pointer_offset(buffer, total), size - total);
+		if (!read) {
+			if (socket_state(sock) != SOCKETSTATE_CONNECTED)
+				return false;
+			thread_yield();
+		}
+		total += read;
+	}
+	return true;
+}
+
+// Key set again in each revision from the second, replacing the previous value of it
+#define TEST_REMOTE_LATEST_KEY ((hash_t)0x10000)
+
+/*! Source of the read resource holds one change per revision, each at its own timestamp, and from
+the second revision the latest key set to the revision after the other changes */
+static int
+test_remote_serve_read(socket_t* sock, uint32_t request, uuid_t uuid, blake3_hash_t known, tick_t since,
+                       uint32_t features) {
+	int32_t revision = atomic_load32(&test_remote_revision, memory_order_acquire);
+	blake3_hash_t hash = test_remote_hash(uuid, (uint64_t)revision);
+	if (blake3_hash_equal(hash, known)) {
+		atomic_incr32(&test_remote_unmodified_reads, memory_order_relaxed);
+		return sourced_write_read_not_modified_reply(sock, request, hash);
+	}
+
+	if (blake3_hash_is_null(known))
+		since = 0;
+	atomic_incr32(since ? &test_remote_delta_reads : &test_remote_full_reads, memory_order_relaxed);
+
+	resource_source_t source;
+	resource_source_initialize(&source);
+	for (int32_t ichange = 0; ichange < revision; ++ichange) {
+		char buffer[32];
+		string_t value = string_format(buffer, sizeof(buffer), STRING_CONST("value%d"), ichange);
+		resource_source_set(&source, ((tick_t)ichange + 1) * 2, (hash_t)ichange + 1, 0, STRING_ARGS(value));
+	}
+	for (int32_t ilatest = 2; ilatest <= revision; ++ilatest) {
+		char buffer[32];
+		string_t value = string_format(buffer, sizeof(buffer), STRING_CONST("latest%d"), ilatest);
+		resource_source_set(&source, ((tick_t)ilatest * 2) + 1, TEST_REMOTE_LATEST_KEY, 0, STRING_ARGS(value));
+	}
+	int ret = sourced_write_read_reply(sock, request, &source, hash, since, features);
+	resource_source_finalize(&source);
+	return ret;
+}
+
+// Resources of the source tree served in manifests of all resources, in UUID order
+static uuid_t
+test_remote_tree_uuid(size_t index) {
+	uuid_t uuid;
+	uuid.word[0] = (uint64_t)index + 1;
+	uuid.word[1] = 0;
+	return uuid;
+}
+
+// Manifest token is the since token plus one, complete if no since token was given
+static int
+test_remote_serve_manifest(socket_t* sock, uint32_t request, size_t size) {
+	struct {
+		uint64_t platform;
+		uint64_t since;
+		uuid_t after;
+		uint32_t count;
+		uint32_t reserved;
+	} header;
+	uuid_t uuids[16];
+	if ((size < sizeof(header)) || !test_remote_read(sock, &header, sizeof(header)) ||
+	    (header.count > (sizeof(uuids) / sizeof(uuids[0]))) || (size != sizeof(header) + sizeof(uuid_t) * header.count))
+		return -1;
+	if (header.count && !test_remote_read(sock, uuids, sizeof(uuid_t) * header.count))
+		return -1;
+
+	uint32_t flags = header.since ? 0 : SOURCED_MANIFEST_FLAG_COMPLETE;
+	size_t first = 0;
+	size_t count = header.count;
+	if (!header.count) {
+		// Whole tree is sent in parts following the last resource of the previous part
+		first = (size_t)header.after.word[0];
+		count = TEST_REMOTE_TREE_SIZE - first;
+		if (count > SOURCED_MANIFEST_REPLY_MAX) {
+			count = SOURCED_MANIFEST_REPLY_MAX;
+			flags |= SOURCED_MANIFEST_FLAG_PARTIAL;
+		}
+	}
+	if (sourced_write_manifest_reply(sock, request, flags, header.since + 1, count) < 0)
+		return -1;
+	for (size_t iuuid = 0; iuuid < count; ++iuuid) {
+		uuid_t uuid = header.count ? uuids[iuuid] : test_remote_tree_uuid(first + iuuid);
+		resource_signature_t signature = {uuid, test_remote_hash(uuid, header.platform)};
+		if (sourced_write_manifest_entries(sock, &signature, 1) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+// Batch replies are built from the same functions as the single query replies
+static int
+test_remote_serve_batch(socket_t* sock, sourced_message_t msg) {
+	struct {
+		uint64_t platform;
+		uint32_t count;
+		uint32_t reserved;
+	} header;
+	if ((msg.size < sizeof(header)) || !test_remote_read(sock, &header, sizeof(header)) ||
+	    (header.count > SOURCED_BATCH_MAX) || (msg.size != sizeof(header) + sizeof(uuid_t) * header.count))
+		return -1;
+	uuid_t* uuids = memory_allocate(HASH_TEST, sizeof(uuid_t) * (header.count + 1), 0, MEMORY_PERSISTENT);
+	if (!test_remote_read(sock, uuids, sizeof(uuid_t) * header.count)) {
+		memory_deallocate(uuids);
+		return -1;
+	}
+	atomic_incr32(&test_remote_batch_requests, memory_order_relaxed);
+
+	int ret;
+	if (msg.id == SOURCED_HASH_BATCH) {
+		blake3_hash_t* hashes =
+		    memory_allocate(HASH_TEST, sizeof(blake3_hash_t) * (header.count + 1), 0, MEMORY_PERSISTENT);
+		for (uint32_t iuuid = 0; iuuid < header.count; ++iuuid)
+			hashes[iuuid] = test_remote_hash(uuids[iuuid], header.platform);
+		ret = sourced_write_hash_batch_reply(sock, msg.request, hashes, header.count);
+		memory_deallocate(hashes);
+	} else {
+		uint64_t* deps_count = memory_allocate(HASH_TEST, sizeof(uint64_t) * (header.count + 1), 0, MEMORY_PERSISTENT);
+		resource_dependency_t* deps = memory_allocate(
+		    HASH_TEST, sizeof(resource_dependency_t) * 8 * (header.count + 1), 0, MEMORY_PERSISTENT);
+		size_t total = 0;
+		for (uint32_t iuuid = 0; iuuid < header.count; ++iuuid) {
+			deps_count[iuuid] = test_remote_dependencies(uuids[iuuid], header.platform, deps + total);
+			total += (size_t)deps_count[iuuid];
+		}
+		ret = sourced_write_dependencies_batch_reply(sock, msg.request, deps_count, header.count, deps);
+		memory_deallocate(deps);
+		memory_deallocate(deps_count);
+	}
+	memory_deallocate(uuids);
+	return ret;
+}
+
+static bool
+test_remote_source_has(resource_source_t* source, int32_t ichange) {
+	char buffer[32];
+	string_t value = string_format(buffer, sizeof(buffer), STRING_CONST("value%d"), ichange);
+	resource_change_t* change = resource_source_get(source, (hash_t)ichange + 1, 0);
+	return change && string_equal(STRING_ARGS(change->value.value), STRING_ARGS(value));
+}
+
+static bool
+test_remote_source_latest(resource_source_t* source, int32_t revision) {
+	char buffer[32];
+	string_t value = string_format(buffer, sizeof(buffer), STRING_CONST("latest%d"), revision);
+	resource_change_t* change = resource_source_get(source, TEST_REMOTE_LATEST_KEY, 0);
+	return change && string_equal(STRING_ARGS(change->value.value), STRING_ARGS(value));
+}
+
+static size_t
+test_remote_source_count(resource_source_t* source) {
+	size_t count = 0;
+	for (resource_change_block_t* block = &source->first; block; block = block->next)
+		count += block->used;
+	return count;
+}
+
+static void
+test_remote_serve_client(socket_t* sock) {
+	sourced_message_t msg;
+	uint32_t features = 0;
+	while (test_remote_read(sock, &msg, sizeof(msg))) {
+		if (msg.id == SOURCED_HELLO) {
+			// Only compression is supported, and only if enabled by the test
+			uint32_t hello[2];
+			if ((msg.size != sizeof(hello)) || !test_remote_read(sock, hello, sizeof(hello)))
+				break;
+			if (atomic_load32(&test_remote_compression, memory_order_acquire))
+				features = hello[1] & SOURCED_FEATURE_COMPRESSION;
+			if (sourced_write_hello_reply(sock, msg.request, features) < 0)
+				break;
+			continue;
+		}
+		if (msg.id == SOURCED_READ) {
+			struct {
+				uuid_t uuid;
+				blake3_hash_t hash;
+				tick_t since;
+			} readmsg;
+			if ((msg.size != sizeof(readmsg)) || !test_remote_read(sock, &readmsg, sizeof(readmsg)) ||
+			    (test_remote_serve_read(sock, msg.request, readmsg.uuid, readmsg.hash, readmsg.since, features) < 0))
+				break;
+			continue;
+		}
+		if (msg.id == SOURCED_MANIFEST) {
+			if (test_remote_serve_manifest(sock, msg.request, msg.size) < 0)
+				break;
+			continue;
+		}
+		if ((msg.id == SOURCED_HASH_BATCH) || (msg.id == SOURCED_DEPENDENCIES_BATCH)) {
+			if (test_remote_serve_batch(sock, msg) < 0)
+				break;
+			continue;
+		}
+		struct {
+			uuid_t uuid;
+			uint64_t platform;
+		} payload;
+		if (((msg.id != SOURCED_HASH) && (msg.id != SOURCED_DEPENDENCIES)) || (msg.size != sizeof(payload)))
+			break;
+		if (!test_remote_read(sock, &payload, sizeof(payload)))
+			break;
+		atomic_incr32((msg.id == SOURCED_HASH) ? &test_remote_hash_requests : &test_remote_dependency_requests,
+		              memory_order_relaxed);
+		// Simulate a hung service by never replying
+		if (atomic_load32(&test_remote_hang, memory_order_acquire))
+			continue;
+		int ret;
+		if (msg.id == SOURCED_HASH) {
+			ret = sourced_write_hash_reply(sock, msg.request, test_remote_hash(payload.uuid, payload.platform));
+		} else {
+			resource_dependency_t deps[8];
+			size_t count = test_remote_dependencies(payload.uuid, payload.platform, deps);
+			ret = sourced_write_dependencies_reply(sock, msg.request, deps, count);
+		}
+		if (ret < 0)
+			break;
+	}
+}
+
+static void*
+test_remote_server(void* arg) {
+	socket_t* listener = arg;
+	while (!atomic_load32(&test_remote_terminate, memory_order_acquire)) {
+		socket_t* sock = tcp_socket_accept(listener, 100);
+		if (sock) {
+			socket_set_blocking(sock, true);
+			atomic_store_ptr(&test_remote_client, sock, memory_order_release);
+			test_remote_serve_client(sock);
+			atomic_store_ptr(&test_remote_client, nullptr, memory_order_release);
+			socket_deallocate(sock);
+		}
+	}
+	return nullptr;
+}
+
+static void*
+test_remote_caller(void* arg) {
+	resource_dependency_t deps[8];
+	resource_dependency_t expect[8];
+	FOUNDATION_UNUSED(arg);
+	for (size_t icall = 0; icall < TEST_REMOTE_CALLS; ++icall) {
+		if (atomic_load32(&test_remote_stop, memory_order_acquire))
+			break;
+		uuid_t uuid = uuid_generate_random();
+		uint64_t platform = random64();
+		if (icall % 2) {
+			blake3_hash_t hash = resource_remote_sourced_hash(uuid, platform);
+			if (blake3_hash_is_null(hash))
+				atomic_incr32(&test_remote_failed, memory_order_relaxed);
+			else if (!blake3_hash_equal(hash, test_remote_hash(uuid, platform)))
+				atomic_incr32(&test_remote_mismatch, memory_order_relaxed);
+		} else {
+			size_t count = resource_remote_sourced_dependencies(uuid, platform, deps, 8);
+			size_t expect_count = test_remote_dependencies(uuid, platform, expect);
+			if (!count)
+				atomic_incr32(&test_remote_failed, memory_order_relaxed);
+			else if ((count != expect_count) || memcmp(deps, expect, sizeof(resource_dependency_t) * count))
+				atomic_incr32(&test_remote_mismatch, memory_order_relaxed);
+		}
+	}
+	return nullptr;
+}
+
+static socket_t*
+test_remote_listen(thread_t* server) {
+	network_address_ipv4_t ipv4_addr;
+	network_address_t* address = network_address_ipv4_initialize(&ipv4_addr);
+	network_address_ip_set_port(address, 0);
+	socket_t* listener = tcp_socket_allocate();
+	if (!socket_bind(listener, address) || !tcp_socket_listen(listener)) {
+		socket_deallocate(listener);
+		return nullptr;
+	}
+
+	atomic_store32(&test_remote_terminate, 0, memory_order_release);
+	thread_initialize(server, test_remote_server, listener, STRING_CONST("sourced-server"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(server);
+
+	char buffer[64];
+	string_t url = string_format(buffer, sizeof(buffer), STRING_CONST("localhost:%u"),
+	                             network_address_ip_port(socket_address_local(listener)));
+	resource_remote_sourced_connect(STRING_ARGS(url));
+
+	return listener;
+}
+
+/*! Push a notify to the connected client. Replies are read in order after the notify, so a
+completed call made afterwards guarantees the client has processed the notify. The sync call
+is a hash request counted as any other, for a resource in another cache slot than the notified one */
+static bool
+test_remote_notify(sourced_message_id id, uuid_t uuid, uint64_t platform) {
+	socket_t* sock = atomic_load_ptr(&test_remote_client, memory_order_acquire);
+	if (!sock || (sourced_write_notify(sock, id, uuid, platform, 0) < 0))
+		return false;
+	uuid_t sync = uuid;
+	sync.word[0] ^= 1;
+	return !blake3_hash_is_null(resource_remote_sourced_hash(sync, platform));
+}
+
+static void
+test_remote_close(thread_t* server, socket_t* listener) {
+	resource_remote_sourced_disconnect();
+	atomic_store32(&test_remote_terminate, 1, memory_order_release);
+	thread_finalize(server);
+	socket_deallocate(listener);
+}
+
+#endif
+
+DECLARE_TEST(remote, concurrent) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	thread_t callers[TEST_REMOTE_THREADS];
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	atomic_store32(&test_remote_stop, 0, memory_order_release);
+	atomic_store32(&test_remote_mismatch, 0, memory_order_release);
+	atomic_store32(&test_remote_failed, 0, memory_order_release);
+
+	for (size_t ithread = 0; ithread < TEST_REMOTE_THREADS; ++ithread) {
+		thread_initialize(&callers[ithread], test_remote_caller, nullptr, STRING_CONST("caller"),
+		                  THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&callers[ithread]);
+	}
+	for (size_t ithread = 0; ithread < TEST_REMOTE_THREADS; ++ithread)
+		thread_finalize(&callers[ithread]);
+
+	test_remote_close(&server, listener);
+
+	// Every caller must get its own reply
+	EXPECT_INTEQ(atomic_load32(&test_remote_mismatch, memory_order_acquire), 0);
+	EXPECT_INTEQ(atomic_load32(&test_remote_failed, memory_order_acquire), 0);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, disconnect) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	thread_t callers[TEST_REMOTE_THREADS];
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	atomic_store32(&test_remote_stop, 0, memory_order_release);
+	atomic_store32(&test_remote_mismatch, 0, memory_order_release);
+	atomic_store32(&test_remote_failed, 0, memory_order_release);
+
+	for (size_t ithread = 0; ithread < TEST_REMOTE_THREADS; ++ithread) {
+		thread_initialize(&callers[ithread], test_remote_caller, nullptr, STRING_CONST("caller"),
+		                  THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&callers[ithread]);
+	}
+
+	// Disconnect with calls in flight, pending calls must fail and not block
+	thread_sleep(50);
+	resource_remote_sourced_disconnect();
+
+	atomic_store32(&test_remote_stop, 1, memory_order_release);
+	for (size_t ithread = 0; ithread < TEST_REMOTE_THREADS; ++ithread)
+		thread_finalize(&callers[ithread]);
+
+	test_remote_close(&server, listener);
+
+	// Calls may fail but must never get another caller's reply
+	EXPECT_INTEQ(atomic_load32(&test_remote_mismatch, memory_order_acquire), 0);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, unix_url) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	// Unix domain socket transport is not supported and must not be resolved as a host name
+	resource_remote_sourced_connect(STRING_CONST("unix:///tmp/sourced.sock"));
+	EXPECT_FALSE(resource_remote_sourced_is_connected());
+	resource_remote_sourced_disconnect();
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, deadline) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+
+	atomic_store32(&test_remote_hang, 1, memory_order_release);
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+	EXPECT_TRUE(resource_remote_sourced_is_available());
+
+	// Call must fail when the deadline expires instead of blocking
+	uuid_t uuid = uuid_generate_random();
+	tick_t start = time_system();
+	blake3_hash_t hash = resource_remote_sourced_hash(uuid, 0);
+	tick_t elapsed = time_system() - start;
+	EXPECT_TRUE(blake3_hash_is_null(hash));
+	EXPECT_INTGE((int)elapsed, TEST_REMOTE_TIMEOUT - 10);
+
+	// Remote is bypassed after timing out, calls fail without waiting
+	EXPECT_FALSE(resource_remote_sourced_is_available());
+	start = time_system();
+	hash = resource_remote_sourced_hash(uuid, 0);
+	elapsed = time_system() - start;
+	EXPECT_TRUE(blake3_hash_is_null(hash));
+	EXPECT_INTLT((int)elapsed, TEST_REMOTE_TIMEOUT);
+
+	atomic_store32(&test_remote_hang, 0, memory_order_release);
+	test_remote_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, read) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+
+	atomic_store32(&test_remote_revision, 1, memory_order_release);
+	atomic_store32(&test_remote_full_reads, 0, memory_order_release);
+	atomic_store32(&test_remote_delta_reads, 0, memory_order_release);
+	atomic_store32(&test_remote_unmodified_reads, 0, memory_order_release);
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	uuid_t uuid = uuid_generate_random();
+	resource_source_t source;
+
+	// First read fetches all changes
+	resource_source_initialize(&source);
+	EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+	EXPECT_TRUE(test_remote_source_has(&source, 0));
+	resource_source_finalize(&source);
+	EXPECT_INTEQ(atomic_load32(&test_remote_full_reads, memory_order_acquire), 1);
+
+	// Unchanged source is served from the cached read
+	resource_source_initialize(&source);
+	EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+	EXPECT_TRUE(test_remote_source_has(&source, 0));
+	resource_source_finalize(&source);
+	EXPECT_INTEQ(atomic_load32(&test_remote_unmodified_reads, memory_order_acquire), 1);
+
+	// Changed source only transfers the new changes, merged with the cached read
+	atomic_store32(&test_remote_revision, 2, memory_order_release);
+	resource_source_initialize(&source);
+	EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+	EXPECT_TRUE(test_remote_source_has(&source, 0));
+	EXPECT_TRUE(test_remote_source_has(&source, 1));
+	EXPECT_TRUE(test_remote_source_latest(&source, 2));
+	EXPECT_SIZEEQ(test_remote_source_count(&source), 3);
+	resource_source_finalize(&source);
+	EXPECT_INTEQ(atomic_load32(&test_remote_delta_reads, memory_order_acquire), 1);
+	EXPECT_INTEQ(atomic_load32(&test_remote_full_reads, memory_order_acquire), 1);
+
+	// Further deltas neither repeat the change at the since timestamp nor keep replaced values,
+	// each key is held once in the cached read
+	for (int32_t revision = 3; revision <= 5; ++revision) {
+		atomic_store32(&test_remote_revision, revision, memory_order_release);
+		resource_source_initialize(&source);
+		EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+		for (int32_t ichange = 0; ichange < revision; ++ichange)
+			EXPECT_TRUE(test_remote_source_has(&source, ichange));
+		EXPECT_TRUE(test_remote_source_latest(&source, revision));
+		EXPECT_SIZEEQ(test_remote_source_count(&source), (size_t)revision + 1);
+		resource_source_finalize(&source);
+	}
+	EXPECT_INTEQ(atomic_load32(&test_remote_delta_reads, memory_order_acquire), 4);
+	EXPECT_INTEQ(atomic_load32(&test_remote_full_reads, memory_order_acquire), 1);
+
+	test_remote_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, read_compressed) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+
+	// Replies of many changes are large enough to be sent compressed
+	atomic_store32(&test_remote_compression, 1, memory_order_release);
+	atomic_store32(&test_remote_revision, 64, memory_order_release);
+	atomic_store32(&test_remote_full_reads, 0, memory_order_release);
+	atomic_store32(&test_remote_delta_reads, 0, memory_order_release);
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	uuid_t uuid = uuid_generate_random();
+	resource_source_t source;
+
+	resource_source_initialize(&source);
+	EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+	for (int32_t ichange = 0; ichange < 64; ++ichange)
+		EXPECT_TRUE(test_remote_source_has(&source, ichange));
+	resource_source_finalize(&source);
+	EXPECT_INTEQ(atomic_load32(&test_remote_full_reads, memory_order_acquire), 1);
+
+	// Compressed delta is merged with the cached read
+	atomic_store32(&test_remote_revision, 128, memory_order_release);
+	resource_source_initialize(&source);
+	EXPECT_TRUE(resource_remote_sourced_read(&source, uuid));
+	for (int32_t ichange = 0; ichange < 128; ++ichange)
+		EXPECT_TRUE(test_remote_source_has(&source, ichange));
+	resource_source_finalize(&source);
+	EXPECT_INTEQ(atomic_load32(&test_remote_delta_reads, memory_order_acquire), 1);
+	EXPECT_INTEQ(atomic_load32(&test_remote_full_reads, memory_order_acquire), 1);
+
+	test_remote_close(&server, listener);
+	atomic_store32(&test_remote_compression, 0, memory_order_release);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, manifest) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	uuid_t uuids[8];
+	resource_signature_t signatures[8];
+	uint64_t token = 0;
+	bool complete = false;
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	for (size_t iuuid = 0; iuuid < 8; ++iuuid)
+		uuids[iuuid] = uuid_generate_random();
+	uint64_t platform = random64();
+
+	// First manifest is complete and returns a token for the next one
+	size_t count = resource_remote_sourced_manifest(uuids, 8, platform, 0, signatures, 8, &token, &complete);
+	EXPECT_SIZEEQ(count, 8);
+	EXPECT_UINTEQ(token, 1);
+	EXPECT_TRUE(complete);
+	for (size_t iuuid = 0; iuuid < 8; ++iuuid) {
+		EXPECT_TRUE(uuid_equal(signatures[iuuid].uuid, uuids[iuuid]));
+		EXPECT_TRUE(blake3_hash_equal(signatures[iuuid].hash, test_remote_hash(uuids[iuuid], platform)));
+	}
+
+	// Manifest since the token, entries beyond capacity are discarded
+	memset(signatures, 0, sizeof(signatures));
+	count = resource_remote_sourced_manifest(uuids, 8, platform, token, signatures, 4, &token, &complete);
+	EXPECT_SIZEEQ(count, 8);
+	EXPECT_UINTEQ(token, 2);
+	EXPECT_FALSE(complete);
+	EXPECT_TRUE(blake3_hash_equal(signatures[3].hash, test_remote_hash(uuids[3], platform)));
+	EXPECT_TRUE(blake3_hash_is_null(signatures[4].hash));
+
+	// Hashes from the manifest are answered from the cache without a request to the service
+	atomic_store32(&test_remote_hash_requests, 0, memory_order_release);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuids[5], platform),
+	                              test_remote_hash(uuids[5], platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 0);
+
+	test_remote_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, manifest_parts) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	uint64_t token = 0;
+	bool complete = false;
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Manifest of the whole tree is received in parts and stored in order
+	size_t capacity = TEST_REMOTE_TREE_SIZE + 16;
+	resource_signature_t* signatures = memory_allocate(HASH_TEST, sizeof(resource_signature_t) * capacity, 0,
+	                                                   MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	uint64_t platform = random64();
+	size_t count = resource_remote_sourced_manifest(nullptr, 0, platform, 0, signatures, capacity, &token, &complete);
+	EXPECT_SIZEEQ(count, TEST_REMOTE_TREE_SIZE);
+	EXPECT_UINTEQ(token, 1);
+	EXPECT_TRUE(complete);
+	for (size_t iuuid = 0; iuuid < TEST_REMOTE_TREE_SIZE; ++iuuid) {
+		uuid_t uuid = test_remote_tree_uuid(iuuid);
+		EXPECT_TRUE(uuid_equal(signatures[iuuid].uuid, uuid));
+		EXPECT_TRUE(blake3_hash_equal(signatures[iuuid].hash, test_remote_hash(uuid, platform)));
+	}
+
+	// Total count is reported when the destination is smaller than the tree
+	memset(signatures, 0, sizeof(resource_signature_t) * capacity);
+	count = resource_remote_sourced_manifest(nullptr, 0, platform, 0, signatures, 10, &token, &complete);
+	EXPECT_SIZEEQ(count, TEST_REMOTE_TREE_SIZE);
+	EXPECT_TRUE(uuid_equal(signatures[9].uuid, test_remote_tree_uuid(9)));
+	EXPECT_TRUE(uuid_is_null(signatures[10].uuid));
+
+	memory_deallocate(signatures);
+	test_remote_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, metadata_cache) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	resource_dependency_t deps[8];
+	resource_dependency_t expect[8];
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Resource depending on itself and three other resources
+	uuid_t uuid = uuid_generate_random();
+	uuid.word[0] = uuid.word[0] - (uuid.word[0] % 7) + 3;
+	uint64_t platform = random64();
+	size_t expect_count = test_remote_dependencies(uuid, platform, expect);
+	atomic_store32(&test_remote_hash_requests, 0, memory_order_release);
+	atomic_store32(&test_remote_dependency_requests, 0, memory_order_release);
+
+	// Repeated queries are answered from the cache
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuid, platform), test_remote_hash(uuid, platform)));
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuid, platform), test_remote_hash(uuid, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 1);
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(uuid, platform, deps, 8), expect_count);
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(uuid, platform, deps, 8), expect_count);
+	EXPECT_INTEQ(memcmp(deps, expect, sizeof(resource_dependency_t) * expect_count), 0);
+	EXPECT_INTEQ(atomic_load32(&test_remote_dependency_requests, memory_order_acquire), 1);
+
+	// Modify of a dependency invalidates the hash since it includes dependency hashes, dependencies are kept
+	uuid_t other = uuid;
+	other.word[1] += 2;
+	EXPECT_TRUE(test_remote_notify(SOURCED_NOTIFY_MODIFY, other, platform));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 2);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuid, platform), test_remote_hash(uuid, platform)));
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuid, platform), test_remote_hash(uuid, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 3);
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(uuid, platform, deps, 8), expect_count);
+	EXPECT_INTEQ(atomic_load32(&test_remote_dependency_requests, memory_order_acquire), 1);
+
+	// Changed dependencies of the resource drops its cached dependencies
+	EXPECT_TRUE(test_remote_notify(SOURCED_NOTIFY_DEPENDS, uuid, platform));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 4);
+	memset(deps, 0, sizeof(deps));
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(uuid, platform, deps, 8), expect_count);
+	EXPECT_INTEQ(memcmp(deps, expect, sizeof(resource_dependency_t) * expect_count), 0);
+	EXPECT_INTEQ(atomic_load32(&test_remote_dependency_requests, memory_order_acquire), 2);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuid, platform), test_remote_hash(uuid, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 5);
+
+	// Cached dependencies report the total count when the destination is smaller
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(uuid, platform, deps, 0), expect_count);
+	EXPECT_INTEQ(atomic_load32(&test_remote_dependency_requests, memory_order_acquire), 2);
+
+	// Resource depending only on itself keeps the hash on modify of another resource, in another cache
+	// slot than the resource synchronizing the notify
+	uuid_t leaf = other;
+	leaf.word[0] += 4;
+	EXPECT_SIZEEQ(resource_remote_sourced_dependencies(leaf, platform, deps, 8), 1);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(leaf, platform), test_remote_hash(leaf, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 6);
+	EXPECT_TRUE(test_remote_notify(SOURCED_NOTIFY_MODIFY, other, platform));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 7);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(leaf, platform), test_remote_hash(leaf, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 7);
+
+	// Modify of the resource itself drops the hash
+	EXPECT_TRUE(test_remote_notify(SOURCED_NOTIFY_MODIFY, leaf, platform));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 8);
+	EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(leaf, platform), test_remote_hash(leaf, platform)));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 9);
+
+	test_remote_close(&server, listener);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, batch) {
+#if RESOURCE_ENABLE_REMOTE_SOURCED
+	thread_t server;
+	uuid_t uuids[32];
+	blake3_hash_t hashes[32];
+	size_t deps_count[32];
+	resource_dependency_t deps[32 * 8];
+	resource_dependency_t single[8];
+
+	socket_t* listener = test_remote_listen(&server);
+	EXPECT_PTRNE(listener, nullptr);
+
+	// Resources in separate metadata cache slots so no cached hash is evicted during the test
+	uuid_t base = uuid_generate_random();
+	for (size_t iuuid = 0; iuuid < 32; ++iuuid) {
+		uuids[iuuid] = base;
+		uuids[iuuid].word[0] ^= iuuid;
+	}
+	uint64_t platform = random64();
+	atomic_store32(&test_remote_hash_requests, 0, memory_order_release);
+	atomic_store32(&test_remote_dependency_requests, 0, memory_order_release);
+	atomic_store32(&test_remote_batch_requests, 0, memory_order_release);
+
+	// Batch replies match the single queries, in resource order
+	EXPECT_SIZEEQ(resource_remote_sourced_hash_batch(uuids, 32, platform, hashes), 32);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 1);
+	size_t total = 0;
+	EXPECT_INTEQ(resource_remote_sourced_dependencies_batch(uuids, 32, platform, deps_count, deps, 32 * 8, &total), 0);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 2);
+	size_t offset = 0;
+	for (size_t iuuid = 0; iuuid < 32; ++iuuid) {
+		EXPECT_TRUE(blake3_hash_equal(hashes[iuuid], test_remote_hash(uuids[iuuid], platform)));
+		size_t count = resource_remote_sourced_dependencies(uuids[iuuid], platform, single, 8);
+		EXPECT_SIZEEQ(deps_count[iuuid], count);
+		EXPECT_INTEQ(memcmp(deps + offset, single, sizeof(resource_dependency_t) * count), 0);
+		offset += count;
+	}
+	EXPECT_SIZEEQ(total, offset);
+	EXPECT_INTEQ(atomic_load32(&test_remote_dependency_requests, memory_order_acquire), 32);
+
+	// Hashes fetched in the batch are cached for single queries
+	for (size_t iuuid = 0; iuuid < 32; ++iuuid)
+		EXPECT_TRUE(blake3_hash_equal(resource_remote_sourced_hash(uuids[iuuid], platform), hashes[iuuid]));
+	EXPECT_INTEQ(atomic_load32(&test_remote_hash_requests, memory_order_acquire), 0);
+
+	// Cached hashes are not requested again, a batch of only cached resources makes no request
+	memset(hashes, 0, sizeof(hashes));
+	EXPECT_SIZEEQ(resource_remote_sourced_hash_batch(uuids, 32, platform, hashes), 32);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 2);
+	EXPECT_TRUE(blake3_hash_equal(hashes[31], test_remote_hash(uuids[31], platform)));
+	uuids[7].word[0] ^= 32;
+	EXPECT_SIZEEQ(resource_remote_sourced_hash_batch(uuids, 32, platform, hashes), 32);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 3);
+	EXPECT_TRUE(blake3_hash_equal(hashes[7], test_remote_hash(uuids[7], platform)));
+	EXPECT_TRUE(blake3_hash_equal(hashes[8], test_remote_hash(uuids[8], platform)));
+
+	// Dependencies beyond the destination capacity are discarded but counted
+	memset(deps, 0, sizeof(deps));
+	size_t partial = 0;
+	EXPECT_INTEQ(resource_remote_sourced_dependencies_batch(uuids, 32, platform, deps_count, deps, 4, &partial), 0);
+	EXPECT_SIZEEQ(partial, total);
+	EXPECT_TRUE(uuid_is_null(deps[4].uuid));
+
+	// Batches larger than the maximum request size are split
+	size_t large = SOURCED_BATCH_MAX + 10;
+	uuid_t* many = memory_allocate(HASH_TEST, sizeof(uuid_t) * large, 0, MEMORY_PERSISTENT);
+	blake3_hash_t* many_hashes = memory_allocate(HASH_TEST, sizeof(blake3_hash_t) * large, 0, MEMORY_PERSISTENT);
+	for (size_t iuuid = 0; iuuid < large; ++iuuid)
+		many[iuuid] = uuid_generate_random();
+	atomic_store32(&test_remote_batch_requests, 0, memory_order_release);
+	EXPECT_SIZEEQ(resource_remote_sourced_hash_batch(many, large, platform, many_hashes), large);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 2);
+	EXPECT_TRUE(blake3_hash_equal(many_hashes[large - 1], test_remote_hash(many[large - 1], platform)));
+
+	// Dependencies of split batches follow each other in resource order, counted past the destination capacity
+	size_t* many_count = memory_allocate(HASH_TEST, sizeof(size_t) * large, 0, MEMORY_PERSISTENT);
+	size_t many_total = 0;
+	memset(deps, 0, sizeof(deps));
+	EXPECT_INTEQ(
+	    resource_remote_sourced_dependencies_batch(many, large, platform, many_count, deps, 32 * 8, &many_total), 0);
+	EXPECT_INTEQ(atomic_load32(&test_remote_batch_requests, memory_order_acquire), 4);
+	offset = 0;
+	for (size_t iuuid = 0; iuuid < large; ++iuuid) {
+		if (offset + many_count[iuuid] > 32 * 8)
+			break;
+		size_t count = resource_remote_sourced_dependencies(many[iuuid], platform, single, 8);
+		EXPECT_SIZEEQ(many_count[iuuid], count);
+		EXPECT_INTEQ(memcmp(deps + offset, single, sizeof(resource_dependency_t) * count), 0);
+		offset += count;
+	}
+	size_t many_sum = 0;
+	for (size_t iuuid = 0; iuuid < large; ++iuuid)
+		many_sum += many_count[iuuid];
+	EXPECT_SIZEEQ(many_total, many_sum);
+	memory_deallocate(many_count);
+	memory_deallocate(many_hashes);
+	memory_deallocate(many);
+
+	test_remote_close(&server, listener);
+
+	// A failed request is reported separately from an empty result
+	EXPECT_INTLT(resource_remote_sourced_dependencies_batch(uuids, 32, platform, deps_count, deps, 32 * 8, &total), 0);
+	EXPECT_SIZEEQ(total, 0);
+#endif
+	return 0;
+}
+
+DECLARE_TEST(remote, change_log) {
+	sourced_change_log_t log;
+	uuid_t uuids[8];
+	uuid_t* changed = nullptr;
+
+	for (size_t iuuid = 0; iuuid < 8; ++iuuid)
+		uuids[iuuid] = uuid_generate_random();
+
+	sourced_change_log_initialize(&log, 0x1234, 8);
+	uint64_t token = sourced_change_log_token(&log);
+	EXPECT_UINTEQ(token, 0x1234ULL << 32);
+
+	// Zero token has no known changes and needs a complete manifest
+	EXPECT_FALSE(sourced_change_log_since(&log, 0, &changed));
+
+	// Changes are collected in order, a resource changed again is only listed at its latest change
+	sourced_change_log_record(&log, uuids[0]);
+	sourced_change_log_record(&log, uuids[1]);
+	sourced_change_log_record(&log, uuids[0]);
+	EXPECT_UINTEQ(sourced_change_log_token(&log), token + 3);
+	EXPECT_TRUE(sourced_change_log_since(&log, token, &changed));
+	EXPECT_SIZEEQ(array_size(changed), 2);
+	EXPECT_TRUE(uuid_equal(changed[0], uuids[1]));
+	EXPECT_TRUE(uuid_equal(changed[1], uuids[0]));
+	array_clear(changed);
+
+	// Current token has no changes
+	EXPECT_TRUE(sourced_change_log_since(&log, sourced_change_log_token(&log), &changed));
+	EXPECT_SIZEEQ(array_size(changed), 0);
+
+	// Tokens from another session or ahead of the log are not current
+	EXPECT_FALSE(sourced_change_log_since(&log, (0x4321ULL << 32) | 1, &changed));
+	EXPECT_FALSE(sourced_change_log_since(&log, sourced_change_log_token(&log) + 1, &changed));
+
+	// Filling the log drops the oldest half, tokens older than the log need a complete manifest
+	for (size_t iuuid = 2; iuuid < 8; ++iuuid)
+		sourced_change_log_record(&log, uuids[iuuid]);
+	EXPECT_SIZEEQ(array_size(log.changes), 8);
+	EXPECT_UINTEQ(log.dropped, 0);
+	uint64_t full = sourced_change_log_token(&log);
+	sourced_change_log_record(&log, uuid_generate_random());
+	EXPECT_SIZEEQ(array_size(log.changes), 5);
+	EXPECT_UINTEQ(log.dropped, 5);
+	EXPECT_FALSE(sourced_change_log_since(&log, token, &changed));
+	EXPECT_FALSE(sourced_change_log_since(&log, token + 4, &changed));
+	EXPECT_TRUE(sourced_change_log_since(&log, token + 5, &changed));
+	EXPECT_SIZEEQ(array_size(changed), 5);
+	array_clear(changed);
+	EXPECT_TRUE(sourced_change_log_since(&log, full, &changed));
+	EXPECT_SIZEEQ(array_size(changed), 1);
+
+	array_deallocate(changed);
+	sourced_change_log_finalize(&log);
+	return 0;
+}
+
+DECLARE_TEST(remote, manifest_part) {
+	uuid_t* uuids = nullptr;
+	size_t total = SOURCED_MANIFEST_REPLY_MAX * 2 + 10;
+
+	// Unordered resources are sorted and cut to the maximum reply size
+	for (size_t iuuid = 0; iuuid < total; ++iuuid) {
+		uuid_t uuid = test_remote_tree_uuid(total - iuuid - 1);
+		array_push(uuids, uuid);
+	}
+	EXPECT_TRUE(sourced_manifest_part(&uuids, uuid_null()));
+	EXPECT_SIZEEQ(array_size(uuids), SOURCED_MANIFEST_REPLY_MAX);
+	for (size_t iuuid = 0; iuuid < SOURCED_MANIFEST_REPLY_MAX; ++iuuid)
+		EXPECT_TRUE(uuid_equal(uuids[iuuid], test_remote_tree_uuid(iuuid)));
+	array_clear(uuids);
+
+	// Following parts start after the given resource, the last part is not partial
+	for (size_t iuuid = 0; iuuid < total; ++iuuid) {
+		uuid_t uuid = test_remote_tree_uuid(iuuid);
+		array_push(uuids, uuid);
+	}
+	EXPECT_TRUE(sourced_manifest_part(&uuids, test_remote_tree_uuid(SOURCED_MANIFEST_REPLY_MAX - 1)));
+	EXPECT_SIZEEQ(array_size(uuids), SOURCED_MANIFEST_REPLY_MAX);
+	EXPECT_TRUE(uuid_equal(uuids[0], test_remote_tree_uuid(SOURCED_MANIFEST_REPLY_MAX)));
+	array_clear(uuids);
+
+	for (size_t iuuid = 0; iuuid < total; ++iuuid) {
+		uuid_t uuid = test_remote_tree_uuid(iuuid);
+		array_push(uuids, uuid);
+	}
+	EXPECT_FALSE(sourced_manifest_part(&uuids, test_remote_tree_uuid(SOURCED_MANIFEST_REPLY_MAX * 2 - 1)));
+	EXPECT_SIZEEQ(array_size(uuids), 10);
+	EXPECT_TRUE(uuid_equal(uuids[9], test_remote_tree_uuid(total - 1)));
+
+	// Nothing is left after the last resource
+	EXPECT_FALSE(sourced_manifest_part(&uuids, test_remote_tree_uuid(total - 1)));
+	EXPECT_SIZEEQ(array_size(uuids), 0);
+
+	array_deallocate(uuids);
+	return 0;
+}
+
+static void
+test_remote_declare(void) {
+	ADD_TEST(remote, concurrent);
+	ADD_TEST(remote, disconnect);
+	ADD_TEST(remote, unix_url);
+	ADD_TEST(remote, deadline);
+	ADD_TEST(remote, read);
+	ADD_TEST(remote, read_compressed);
+	ADD_TEST(remote, manifest);
+	ADD_TEST(remote, manifest_parts);
+	ADD_TEST(remote, metadata_cache);
+	ADD_TEST(remote, batch);
+	ADD_TEST(remote, change_log);
+	ADD_TEST(remote, manifest_part);
+}
+
+static test_suite_t test_remote_suite = {test_remote_application, test_remote_memory_system, test_remote_config,
+                                         test_remote_declare,     test_remote_initialize,    test_remote_finalize,
+                                         test_remote_event};
+
+#if BUILD_MONOLITHIC
+
+int
+test_remote_run(void);
+
+int
+test_remote_run(void) {
+	test_suite = test_remote_suite;
+	return test_run_all();
+}
+
+#else
+
+test_suite_t
+test_suite_define(void);
+
+test_suite_t
+test_suite_define(void) {
+	return test_remote_suite;
+}
+
+#endif
@@ -0,0 +1,24 @@
+/* errorcodes.h  -  Resource library  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform resource I/O library in C11 providing
+ * basic resource loading, saving and streaming functionality for projects based
+ * on our foundation library.
+ *
+ * The latest source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/resource_lib
+ *
+ * The foundation library source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any restrictions.
+ *
+ */
+
+#pragma once
+
+// Error codes returned by bundle tool
+#define BUNDLE_RESULT_OK 0
+#define BUNDLE_RESULT_INVALID_ARGUMENT -1
+#define BUNDLE_RESULT_UNABLE_TO_BUILD -2
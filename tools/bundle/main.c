@@ -0,0 +1,252 @@
+/* main.c  -  Resource library  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform resource I/O library in C11 providing
+ * basic resource loading, saving and streaming functionality for projects based
+ * on our foundation library.
+ *
+ * The latest source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/resource_lib
+ *
+ * The foundation library source code maintained by Mattias Jansson is always available at
+ *
+ * https://github.com/mjansson/foundation_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any restrictions.
+ *
+ */
+
+#include <foundation/foundation.h>
+#include <network/network.h>
+#include <resource/resource.h>
+
+#include "errorcodes.h"
+
+typedef struct {
+	bool display_help;
+	string_const_t source_path;
+	string_const_t* config_files;
+	string_const_t remote_sourced;
+	string_const_t local_path;
+	uuid_t bundle;
+	uuid_t* roots;
+	uint64_t platform;
+} bundle_input_t;
+
+static bundle_input_t input;
+
+static bundle_input_t
+bundle_parse_command_line(const string_const_t* cmdline);
+
+static void
+bundle_parse_config(const char* path, size_t path_size, const char* buffer, size_t size, const json_token_t* tokens,
+                    size_t numtokens);
+
+static void
+bundle_print_usage(void);
+
+int
+main_initialize(void) {
+	int ret = 0;
+	application_t application;
+	foundation_config_t foundation_config;
+	network_config_t network_config;
+	resource_config_t resource_config;
+
+	memset(&foundation_config, 0, sizeof(foundation_config));
+	memset(&network_config, 0, sizeof(network_config));
+	memset(&resource_config, 0, sizeof(resource_config));
+
+	memset(&application, 0, sizeof(application));
+	application.name = string_const(STRING_CONST("bundle"));
+	application.short_name = string_const(STRING_CONST("bundle"));
+	application.company = string_const(STRING_CONST(""));
+	application.flags = APPLICATION_UTILITY;
+
+	log_enable_prefix(false);
+	log_set_suppress(0, ERRORLEVEL_WARNING);
+
+	if ((ret = foundation_initialize(memory_system_malloc(), application, foundation_config)) < 0)
+		return ret;
+	if ((ret = network_module_initialize(network_config)) < 0)
+		return ret;
+
+	input = bundle_parse_command_line(environment_command_line());
+
+	resource_config.enable_local_source = (input.remote_sourced.length == 0);
+	resource_config.enable_remote_sourced = true;
+	resource_config.enable_local_cache = true;
+
+	if ((ret = resource_module_initialize(resource_config)) < 0)
+		return ret;
+
+	log_set_suppress(HASH_RESOURCE, ERRORLEVEL_INFO);
+
+	return 0;
+}
+
+int
+main_run(void* main_arg) {
+	int result = BUNDLE_RESULT_OK;
+
+	FOUNDATION_UNUSED(main_arg);
+
+	for (size_t cfgfile = 0, fsize = array_size(input.config_files); cfgfile < fsize; ++cfgfile)
+		sjson_parse_path(STRING_ARGS(input.config_files[cfgfile]), bundle_parse_config);
+
+	if (input.source_path.length)
+		resource_source_set_path(STRING_ARGS(input.source_path));
+
+	if (input.local_path.length)
+		resource_local_add_path(STRING_ARGS(input.local_path));
+
+	if (input.remote_sourced.length)
+		resource_remote_sourced_connect(STRING_ARGS(input.remote_sourced));
+
+	if (!input.display_help) {
+		if (!resource_source_path().length && !input.remote_sourced.length) {
+			log_errorf(HASH_RESOURCE, ERROR_INVALID_VALUE, STRING_CONST("No source path given"));
+			input.display_help = true;
+		} else if (!array_size(resource_local_paths())) {
+			log_errorf(HASH_RESOURCE, ERROR_INVALID_VALUE, STRING_CONST("No local path given"));
+			input.display_help = true;
+		} else if (uuid_is_null(input.bundle)) {
+			log_errorf(HASH_RESOURCE, ERROR_INVALID_VALUE, STRING_CONST("No bundle UUID given"));
+			input.display_help = true;
+		} else if (!array_size(input.roots)) {
+			log_errorf(HASH_RESOURCE, ERROR_INVALID_VALUE, STRING_CONST("No root resources given"));
+			input.display_help = true;
+		}
+	}
+
+	if (input.display_help) {
+		bundle_print_usage();
+		result = BUNDLE_RESULT_INVALID_ARGUMENT;
+		goto exit;
+	}
+
+	if (!resource_bundle_build(input.bundle, input.platform, input.roots, array_size(input.roots))) {
+		string_const_t uuidstr = string_from_uuid_static(input.bundle);
+		log_errorf(HASH_RESOURCE, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to build bundle: %.*s"),
+		           STRING_FORMAT(uuidstr));
+		result = BUNDLE_RESULT_UNABLE_TO_BUILD;
+	}
+
+exit:
+
+	resource_remote_sourced_disconnect();
+
+	array_deallocate(input.config_files);
+	array_deallocate(input.roots);
+
+	return result;
+}
+
+void
+main_finalize(void) {
+	resource_module_finalize();
+	network_module_finalize();
+	foundation_finalize();
+}
+
+static void
+bundle_parse_config(const char* path, size_t path_size, const char* buffer, size_t size, const json_token_t* tokens,
+                    size_t numtokens) {
+	resource_module_parse_config(path, path_size, buffer, size, tokens, numtokens);
+}
+
+static uuid_t
+bundle_parse_uuid(const string_const_t value) {
+	uuid_t uuid = string_to_uuid(STRING_ARGS(value));
+	if (uuid_is_null(uuid))
+		log_warnf(HASH_RESOURCE, WARNING_INVALID_VALUE, STRING_CONST("Invalid UUID: %.*s"), STRING_FORMAT(value));
+	return uuid;
+}
+
+static bundle_input_t
+bundle_parse_command_line(const string_const_t* cmdline) {
+	bundle_input_t in;
+	size_t arg, asize;
+
+	error_context_push(STRING_CONST("parse command line"), STRING_CONST(""));
+	memset(&in, 0, sizeof(in));
+
+	for (arg = 1, asize = array_size(cmdline); arg < asize; ++arg) {
+		if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--help")))
+			in.display_help = true;
+		else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--source"))) {
+			if (arg < asize - 1)
+				in.source_path = cmdline[++arg];
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--config"))) {
+			if (arg < asize - 1)
+				array_push(in.config_files, cmdline[++arg]);
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--remote"))) {
+			if (arg < asize - 1)
+				in.remote_sourced = cmdline[++arg];
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--local"))) {
+			if (arg < asize - 1)
+				in.local_path = cmdline[++arg];
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--bundle"))) {
+			if (arg < asize - 1)
+				in.bundle = bundle_parse_uuid(cmdline[++arg]);
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--root"))) {
+			if (arg < asize - 1) {
+				uuid_t root = bundle_parse_uuid(cmdline[++arg]);
+				if (!uuid_is_null(root))
+					array_push(in.roots, root);
+			}
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--platform"))) {
+			if (arg < asize - 1) {
+				bool hex = false;
+				string_const_t value = cmdline[++arg];
+				if ((value.length > 2) && string_equal(value.str, 2, STRING_CONST("0x"))) {
+					value.str += 2;
+					value.length -= 2;
+					hex = true;
+				} else if (string_find_first_not_of(STRING_ARGS(cmdline[arg]), STRING_CONST("0123456789"), 0) !=
+				           STRING_NPOS) {
+					hex = true;
+				}
+				in.platform = string_to_uint64(STRING_ARGS(value), hex);
+			}
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--debug"))) {
+			log_set_suppress(0, ERRORLEVEL_NONE);
+			log_set_suppress(HASH_NETWORK, ERRORLEVEL_NONE);
+			log_set_suppress(HASH_RESOURCE, ERRORLEVEL_NONE);
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--")))
+			break;  // Stop parsing cmdline options
+		else {
+			// Unknown argument, display help
+			in.display_help = true;
+		}
+	}
+	error_context_pop();
+
+	return in;
+}
+
+static void
+bundle_print_usage(void) {
+	const error_level_t saved_level = log_suppress(0);
+	log_set_suppress(0, ERRORLEVEL_DEBUG);
+	log_info(0, STRING_CONST(
+	                "bundle usage:\n"
+	                "  bundle --bundle <uuid> --root <uuid> ... [--platform <id>]\n"
+	                "         [--source <path>] [--config <path>] [--remote <url>] [--local <path>]\n"
+	                "         [--debug] [--help] [--]\n"
+	                "    Required arguments:\n"
+	                "      --bundle <uuid>              Bundle UUID\n"
+	                "      --root <uuid>                Root resource UUID, repeatable. The bundle holds the\n"
+	                "                                   roots and all resources they depend on\n"
+	                "    Optional arguments:\n"
+	                "      --platform <id>              Platform specifier\n"
+	                "      --source <path>              Operate on resource file source structure given by <path>\n"
+	                "      --config <path>              Read and parse config file given by <path>\n"
+	                "                                   Loads all .json/.sjson files in <path> if it is a directory\n"
+	                "      --remote <url>               Connect to remote sourced service specified by <url>\n"
+	                "      --local <path>               Write bundle to local compiled resource path <path>\n"
+	                "      --debug                      Enable debug output\n"
+	                "      --help                       Display this help message\n"
+	                "      --                           Stop processing command line arguments"));
+	log_set_suppress(0, saved_level);
+}
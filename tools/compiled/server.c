@@ -21,6 +21,7 @@
 #include <resource/sourced.h>
 #include <resource/compiled.h>
 #include <network/network.h>
+#include <blake3/blake3.h>
 
 #include "server.h"
 
@@ -39,23 +40,77 @@ struct server_message_t {
 
 typedef struct server_message_t server_message_t;
 
+struct server_client_t {
+	socket_t* sock;
+	//! Request ID of a message header stashed in the socket while waiting for the payload
+	uint32_t request;
+	//! Features negotiated with the client in a hello message
+	uint32_t features;
+};
+
+typedef struct server_client_t server_client_t;
+
+//! Poll timeout in milliseconds while bundle builds are running
+#define SERVER_BUILD_POLL_TIMEOUT 10
+
+//! Bundle build running on a worker thread, the reply is written by the serve thread when done
+struct server_bundle_build_t {
+	thread_t thread;
+	//! Client socket, null if the client disconnected while the build was running
+	socket_t* sock;
+	uint32_t request;
+	uint32_t features;
+	uuid_t bundle;
+	uint64_t platform;
+	//! Message payload holding the root resource UUIDs
+	void* buffer;
+	size_t count;
+	bool success;
+	atomic32_t done;
+};
+
+typedef struct server_bundle_build_t server_bundle_build_t;
+
+//! Builds in progress, only accessed by the serve thread
+static server_bundle_build_t** server_bundle_builds;
+//! Builds write the same local files, run one at a time
+static mutex_t* server_bundle_build_lock;
+
 static void*
 server_serve(void* arg);
 
 static int
-server_handle(socket_t* sock);
+server_handle(server_client_t* client);
+
+static int
+server_handle_hello(server_client_t* client, uint32_t request, size_t msgsize);
+
+static int
+server_handle_open_static(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features);
+
+static int
+server_handle_open_dynamic(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features);
 
 static int
-server_handle_open_static(socket_t* sock, size_t msgsize);
+server_handle_open_dynamic_range(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_handle_open_dynamic(socket_t* sock, size_t msgsize);
+server_handle_open_bundle(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features);
 
 static int
-server_write_stream_to_socket(stream_t* stream, socket_t* sock);
+server_write_stream_to_socket(stream_t* stream, socket_t* sock, size_t size, bool framed);
+
+static void
+server_complete_bundle_builds(server_client_t* clients, network_poll_t* poll, bool wait);
+
+static void
+server_cancel_bundle_builds(socket_t* sock);
+
+static void
+server_disconnect(server_client_t* clients, network_poll_t* poll, socket_t* sock);
 
 static int
-server_broadcast_notify(socket_t** sockets, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token);
+server_broadcast_notify(server_client_t* clients, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token);
 
 void
 server_run(unsigned int port) {
@@ -206,19 +261,24 @@ server_serve(void* arg) {
 	socket_t* control_socket = local_sockets + 1;
 	const network_address_t* local_addr;
 	network_poll_event_t events[64];
-	socket_t** clients = nullptr;
+	server_client_t* clients = nullptr;
 
 	if (socket_fd(control_socket) == NETWORK_SOCKET_INVALID)
 		return nullptr;
 
 	network_poll_t* poll = network_poll_allocate(512);
+	server_bundle_build_lock = mutex_allocate(STRING_CONST("bundle-build"));
 
 	local_addr = socket_address_local(control_source);
 	network_poll_add_socket(poll, control_socket);
 
 	while (!terminate) {
 		size_t ievt;
-		size_t count = network_poll(poll, events, sizeof(events) / sizeof(events[0]), NETWORK_TIMEOUT_INFINITE);
+		// Wake up regularly while builds are running to reply to the clients once done. Replies
+		// are written before polling as a failed write disconnects the client
+		server_complete_bundle_builds(clients, poll, false);
+		unsigned int timeout = array_size(server_bundle_builds) ? SERVER_BUILD_POLL_TIMEOUT : NETWORK_TIMEOUT_INFINITE;
+		size_t count = network_poll(poll, events, sizeof(events) / sizeof(events[0]), timeout);
 		if (!count)
 			continue;
 
@@ -235,13 +295,17 @@ server_serve(void* arg) {
 				}
 				socket_t* sock;
 				switch (message.message) {
-					case SERVER_MESSAGE_CONNECTION:
+					case SERVER_MESSAGE_CONNECTION: {
+						server_client_t client = {message.data, 0, 0};
 						sock = message.data;
 						sock->id = array_size(clients);
 						socket_set_blocking(sock, false);
+						// Replies are written in several small parts, send each without delay
+						tcp_socket_set_delay(sock, false);
 						network_poll_add_socket(poll, sock);
-						array_push(clients, sock);
+						array_push(clients, client);
 						break;
+					}
 
 					case SERVER_MESSAGE_BROADCAST_NOTIFY:
 						server_broadcast_notify(clients, message.id, message.uuid, message.platform, message.token);
@@ -251,7 +315,7 @@ server_serve(void* arg) {
 				socket_t* sock = events[ievt].socket;
 				bool disconnect = false;
 				if (events[ievt].event == NETWORKEVENT_DATAIN) {
-					if (server_handle(sock) < 0)
+					if (server_handle(clients + sock->id) < 0)
 						disconnect = true;
 				} else if (events[ievt].event == NETWORKEVENT_ERROR) {
 					log_info(HASH_RESOURCE, STRING_CONST("Socket error, closing connection"));
@@ -260,26 +324,42 @@ server_serve(void* arg) {
 					log_info(HASH_RESOURCE, STRING_CONST("Socket disconnected"));
 					disconnect = true;
 				}
-				if (disconnect) {
-					unsigned int client = sock->id;
-					array_erase(clients, client);  // Swap with last, patch up swapped client
-					if (array_size(clients) > client)
-						clients[client]->id = client;
-					network_poll_remove_socket(poll, sock);
-					socket_deallocate(sock);
-				}
+				if (disconnect)
+					server_disconnect(clients, poll, sock);
 			}
 		}
 	}
 
+	// Clients are not replied to on termination, wait for running builds to finish
+	for (size_t iclient = 0, csize = array_size(clients); iclient < csize; ++iclient)
+		server_cancel_bundle_builds(clients[iclient].sock);
+	server_complete_bundle_builds(clients, poll, true);
+	array_deallocate(server_bundle_builds);
+	mutex_deallocate(server_bundle_build_lock);
+	server_bundle_builds = nullptr;
+	server_bundle_build_lock = nullptr;
+
 	network_poll_deallocate(poll);
+	array_deallocate(clients);
 
 	return nullptr;
 }
 
+static void
+server_disconnect(server_client_t* clients, network_poll_t* poll, socket_t* sock) {
+	server_cancel_bundle_builds(sock);
+	unsigned int client = sock->id;
+	array_erase(clients, client);  // Swap with last, patch up swapped client
+	if (array_size(clients) > client)
+		clients[client].sock->id = client;
+	network_poll_remove_socket(poll, sock);
+	socket_deallocate(sock);
+}
+
 static int
-server_handle(socket_t* sock) {
-	compiled_message_t msg = {(uint32_t)sock->data.header.id, (uint32_t)sock->data.header.size};
+server_handle(server_client_t* client) {
+	socket_t* sock = client->sock;
+	compiled_message_t msg = {(uint32_t)sock->data.header.id, (uint32_t)sock->data.header.size, client->request, 0};
 
 	sock->data.header.id = 0;
 
@@ -294,11 +374,20 @@ server_handle(socket_t* sock) {
 		}
 	}
 
+	// Keep request ID in case the handler stashes the header to wait for the payload
+	client->request = msg.request;
+
 	switch (msg.id) {
+		case COMPILED_HELLO:
+			return server_handle_hello(client, msg.request, msg.size);
 		case COMPILED_OPEN_STATIC:
-			return server_handle_open_static(sock, msg.size);
+			return server_handle_open_static(sock, msg.request, msg.size, client->features);
 		case COMPILED_OPEN_DYNAMIC:
-			return server_handle_open_dynamic(sock, msg.size);
+			return server_handle_open_dynamic(sock, msg.request, msg.size, client->features);
+		case COMPILED_OPEN_DYNAMIC_RANGE:
+			return server_handle_open_dynamic_range(sock, msg.request, msg.size);
+		case COMPILED_OPEN_BUNDLE:
+			return server_handle_open_bundle(sock, msg.request, msg.size, client->features);
 
 		case COMPILED_OPEN_STATIC_RESULT:
 		case COMPILED_OPEN_DYNAMIC_RESULT:
@@ -310,8 +399,49 @@ server_handle(socket_t* sock) {
 }
 
 static int
-server_handle_open_static(socket_t* sock, size_t msgsize) {
-	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t);
+server_handle_hello(server_client_t* client, uint32_t request, size_t msgsize) {
+	socket_t* sock = client->sock;
+	size_t expected_size = sizeof(uint32_t) * 2;
+	if (msgsize != expected_size)
+		return -1;
+
+	compiled_hello_t hello;
+	size_t read = socket_read(sock, &hello.version, expected_size);
+	if (read == expected_size) {
+		client->features = hello.features & (COMPILED_FEATURE_COMPRESSION | COMPILED_FEATURE_PATH);
+		log_infof(HASH_RESOURCE, STRING_CONST("Client hello, protocol version %u, features 0x%x"), hello.version,
+		          client->features);
+		return compiled_write_hello_reply(sock, request, client->features);
+	}
+	if (read != 0) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read partial hello message: %" PRIsize " of %" PRIsize), read, msgsize);
+		return -1;
+	}
+
+	sock->data.header.id = COMPILED_HELLO;
+	sock->data.header.size = msgsize;
+	return 0;
+}
+
+//! Stream flags for data sent to a client, uncompressed data is framed and compressed if negotiated
+static uint32_t
+server_stream_flags(bool compressed, uint32_t features) {
+	if (compressed)
+		return COMPILED_FLAG_COMPRESSED;
+	return (features & COMPILED_FEATURE_COMPRESSION) ? COMPILED_FLAG_FRAMED : 0;
+}
+
+//! Path of the file holding the stream data if it can be handed over to the client instead of sent
+static string_const_t
+server_stream_local_path(stream_t* stream, uint32_t features) {
+	if (!(features & COMPILED_FEATURE_PATH) || (stream->type != STREAMTYPE_FILE) || stream_tell(stream))
+		return string_null();
+	return stream_path(stream);
+}
+
+static int
+server_handle_open_static(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features) {
+	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t) + sizeof(blake3_hash_t);
 	if (msgsize != expected_size)
 		return -1;
 
@@ -321,12 +451,31 @@ server_handle_open_static(socket_t* sock, size_t msgsize) {
 		int ret = -1;
 		string_const_t uuidstr = string_from_uuid_static(readmsg.uuid);
 		log_infof(HASH_RESOURCE, STRING_CONST("Perform read of static resource: %.*s"), STRING_FORMAT(uuidstr));
+		// Hash is taken before opening so the data sent is never older than the reported hash
+		blake3_hash_t source_hash = resource_source_hash(readmsg.uuid, readmsg.platform);
+		if (!blake3_hash_is_null(source_hash) && blake3_hash_equal(source_hash, readmsg.source_hash)) {
+			log_info(HASH_RESOURCE, STRING_CONST("  client copy is current, not modified"));
+			return compiled_write_open_not_modified_reply(sock, COMPILED_OPEN_STATIC_RESULT, request, source_hash);
+		}
 		stream_t* stream = resource_stream_open_static(readmsg.uuid, readmsg.platform);
 		if (stream) {
-			compiled_write_open_static_reply(sock, true, stream_size(stream));
-			ret = server_write_stream_to_socket(stream, sock);
+			// Pass compressed data through as is and let the client decompress it
+			bool compressed = false;
+			stream = resource_decompress_stream_detach(stream, &compressed);
+			size_t size = stream_size(stream);
+			string_const_t path = server_stream_local_path(stream, features);
+			if (path.length) {
+				uint32_t flags = COMPILED_FLAG_PATH | (compressed ? COMPILED_FLAG_COMPRESSED : 0);
+				compiled_write_open_static_reply(sock, request, true, flags, size, source_hash);
+				ret = compiled_write_open_path(sock, STRING_ARGS(path));
+				stream_deallocate(stream);
+			} else {
+				uint32_t flags = server_stream_flags(compressed, features);
+				compiled_write_open_static_reply(sock, request, true, flags, size, source_hash);
+				ret = server_write_stream_to_socket(stream, sock, size, (flags & COMPILED_FLAG_FRAMED) != 0);
+			}
 		} else {
-			compiled_write_open_static_reply(sock, false, 0);
+			compiled_write_open_static_reply(sock, request, false, 0, 0, blake3_hash_null());
 		}
 		return ret;
 	}
@@ -342,8 +491,8 @@ server_handle_open_static(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_handle_open_dynamic(socket_t* sock, size_t msgsize) {
-	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t);
+server_handle_open_dynamic(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features) {
+	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t) + sizeof(blake3_hash_t);
 	if (msgsize != expected_size)
 		return -1;
 
@@ -353,12 +502,31 @@ server_handle_open_dynamic(socket_t* sock, size_t msgsize) {
 		int ret = -1;
 		string_const_t uuidstr = string_from_uuid_static(readmsg.uuid);
 		log_infof(HASH_RESOURCE, STRING_CONST("Perform read of dynamic resource: %.*s"), STRING_FORMAT(uuidstr));
+		// Hash is taken before opening so the data sent is never older than the reported hash
+		blake3_hash_t source_hash = resource_source_hash(readmsg.uuid, readmsg.platform);
+		if (!blake3_hash_is_null(source_hash) && blake3_hash_equal(source_hash, readmsg.source_hash)) {
+			log_info(HASH_RESOURCE, STRING_CONST("  client copy is current, not modified"));
+			return compiled_write_open_not_modified_reply(sock, COMPILED_OPEN_DYNAMIC_RESULT, request, source_hash);
+		}
 		stream_t* stream = resource_stream_open_dynamic(readmsg.uuid, readmsg.platform);
 		if (stream) {
-			compiled_write_open_dynamic_reply(sock, true, stream_size(stream));
-			ret = server_write_stream_to_socket(stream, sock);
+			// Pass compressed data through as is and let the client decompress it
+			bool compressed = false;
+			stream = resource_decompress_stream_detach(stream, &compressed);
+			size_t size = stream_size(stream);
+			string_const_t path = server_stream_local_path(stream, features);
+			if (path.length) {
+				uint32_t flags = COMPILED_FLAG_PATH | (compressed ? COMPILED_FLAG_COMPRESSED : 0);
+				compiled_write_open_dynamic_reply(sock, request, true, flags, size, source_hash);
+				ret = compiled_write_open_path(sock, STRING_ARGS(path));
+				stream_deallocate(stream);
+			} else {
+				uint32_t flags = server_stream_flags(compressed, features);
+				compiled_write_open_dynamic_reply(sock, request, true, flags, size, source_hash);
+				ret = server_write_stream_to_socket(stream, sock, size, (flags & COMPILED_FLAG_FRAMED) != 0);
+			}
 		} else {
-			compiled_write_open_dynamic_reply(sock, false, 0);
+			compiled_write_open_dynamic_reply(sock, request, false, 0, 0, blake3_hash_null());
 		}
 		return ret;
 	}
@@ -374,44 +542,221 @@ server_handle_open_dynamic(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_write_stream_to_socket(stream_t* stream, socket_t* sock) {
+server_handle_open_dynamic_range(socket_t* sock, uint32_t request, size_t msgsize) {
+	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t) * 3;
+	if (msgsize != expected_size)
+		return -1;
+
+	compiled_open_dynamic_range_t readmsg;
+	size_t read = socket_read(sock, &readmsg.uuid, expected_size);
+	if (read == expected_size) {
+		int ret = -1;
+		string_const_t uuidstr = string_from_uuid_static(readmsg.uuid);
+		log_infof(HASH_RESOURCE,
+		          STRING_CONST("Perform read of dynamic resource range: %.*s (%" PRIu64 ", %" PRIu64 ")"),
+		          STRING_FORMAT(uuidstr), readmsg.offset, readmsg.range);
+		stream_t* stream = resource_stream_open_dynamic(readmsg.uuid, readmsg.platform);
+		size_t total = stream ? stream_size(stream) : 0;
+		if (stream && (readmsg.offset <= total)) {
+			size_t size = (size_t)readmsg.range;
+			if (size > (total - readmsg.offset))
+				size = total - (size_t)readmsg.offset;
+			stream_seek(stream, (ssize_t)readmsg.offset, STREAM_SEEK_BEGIN);
+			compiled_write_open_dynamic_range_reply(sock, request, true, size);
+			ret = server_write_stream_to_socket(stream, sock, size, false);
+		} else {
+			if (stream)
+				stream_deallocate(stream);
+			compiled_write_open_dynamic_range_reply(sock, request, false, 0);
+			ret = 0;
+		}
+		return ret;
+	}
+	if (read != 0) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read partial open dynamic range message: %" PRIsize " of %" PRIsize),
+		          read, msgsize);
+		return -1;
+	}
+
+	sock->data.header.id = COMPILED_OPEN_DYNAMIC_RANGE;
+	sock->data.header.size = msgsize;
+	return 0;
+}
+
+//! Reply to an open bundle request with the last built bundle
+static int
+server_write_bundle(socket_t* sock, uint32_t request, uint32_t features, const uuid_t bundle, uint64_t platform,
+                    bool built) {
+	stream_t* stream = built ? resource_local_open_static(bundle, platform) : nullptr;
+	if (stream) {
+		bool compressed = false;
+		stream = resource_decompress_stream_detach(stream, &compressed);
+		size_t size = stream_size(stream);
+		uint32_t flags = server_stream_flags(compressed, features);
+		compiled_write_open_bundle_reply(sock, request, true, flags, size);
+		return server_write_stream_to_socket(stream, sock, size, (flags & COMPILED_FLAG_FRAMED) != 0);
+	}
+	compiled_write_open_bundle_reply(sock, request, false, 0, 0);
+	return 0;
+}
+
+static void*
+server_bundle_build_thread(void* arg) {
+	server_bundle_build_t* build = arg;
+	const uuid_t* roots = pointer_offset_const(build->buffer, sizeof(uuid_t) + sizeof(uint64_t));
+	mutex_lock(server_bundle_build_lock);
+	build->success = resource_bundle_build(build->bundle, build->platform, roots, build->count);
+	mutex_unlock(server_bundle_build_lock);
+	atomic_store32(&build->done, 1, memory_order_release);
+	return nullptr;
+}
+
+//! Reply to the clients of finished builds, or of all builds after waiting for them if wait is set
+static void
+server_complete_bundle_builds(server_client_t* clients, network_poll_t* poll, bool wait) {
+	for (size_t ibuild = 0; ibuild < array_size(server_bundle_builds);) {
+		server_bundle_build_t* build = server_bundle_builds[ibuild];
+		if (!wait && !atomic_load32(&build->done, memory_order_acquire)) {
+			++ibuild;
+			continue;
+		}
+		thread_finalize(&build->thread);
+		array_erase_ordered_safe(server_bundle_builds, ibuild);
+		socket_t* sock = build->sock;
+		if (sock && (server_write_bundle(sock, build->request, build->features, build->bundle, build->platform,
+		                                 build->success) < 0))
+			server_disconnect(clients, poll, sock);
+		memory_deallocate(build->buffer);
+		memory_deallocate(build);
+	}
+}
+
+//! Drop the client of running builds, the result is discarded when the build is done
+static void
+server_cancel_bundle_builds(socket_t* sock) {
+	for (size_t ibuild = 0, bsize = array_size(server_bundle_builds); ibuild < bsize; ++ibuild) {
+		if (server_bundle_builds[ibuild]->sock == sock)
+			server_bundle_builds[ibuild]->sock = nullptr;
+	}
+}
+
+static int
+server_handle_open_bundle(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features) {
+	size_t header_size = sizeof(uuid_t) + sizeof(uint64_t);
+	if ((msgsize < header_size) || (((msgsize - header_size) % sizeof(uuid_t)) != 0) ||
+	    (((msgsize - header_size) / sizeof(uuid_t)) > COMPILED_BUNDLE_ROOTS_MAX))
+		return -1;
+
+	void* buffer = memory_allocate(HASH_RESOURCE, msgsize, 8, MEMORY_PERSISTENT);
+	size_t read = socket_read(sock, buffer, msgsize);
+	if (read == msgsize) {
+		compiled_open_bundle_t readmsg;
+		memcpy(&readmsg.bundle, buffer, header_size);
+		size_t count = (msgsize - header_size) / sizeof(uuid_t);
+
+		string_const_t uuidstr = string_from_uuid_static(readmsg.bundle);
+		log_infof(HASH_RESOURCE, STRING_CONST("Perform build of bundle: %.*s (%" PRIsize " roots)"),
+		          STRING_FORMAT(uuidstr), count);
+
+		// Serve the last built bundle if no roots are given
+		if (!count) {
+			memory_deallocate(buffer);
+			return server_write_bundle(sock, request, features, readmsg.bundle, readmsg.platform, true);
+		}
+
+		// Build on a worker thread to keep serving other requests meanwhile, the serve
+		// thread writes the reply once the build is done
+		server_bundle_build_t* build = memory_allocate(HASH_RESOURCE, sizeof(server_bundle_build_t), 0,
+		                                               MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+		build->sock = sock;
+		build->request = request;
+		build->features = features;
+		build->bundle = readmsg.bundle;
+		build->platform = readmsg.platform;
+		build->buffer = buffer;
+		build->count = count;
+		atomic_store32(&build->done, 0, memory_order_release);
+		thread_initialize(&build->thread, server_bundle_build_thread, build, STRING_CONST("bundle-build"),
+		                  THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&build->thread);
+		array_push(server_bundle_builds, build);
+		return 0;
+	}
+	memory_deallocate(buffer);
+	if (read != 0) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read partial open bundle message: %" PRIsize " of %" PRIsize), read,
+		          msgsize);
+		return -1;
+	}
+
+	sock->data.header.id = COMPILED_OPEN_BUNDLE;
+	sock->data.header.size = msgsize;
+	return 0;
+}
+
+static int
+server_write_stream_to_socket(stream_t* stream, socket_t* sock, size_t size, bool framed) {
 	int ret = 0;
 	size_t written = 0;
-	const size_t capacity = 4096;
+	// Framed data is read, compressed and written one chunk at a time
+	const size_t capacity = framed ? RESOURCE_COMPRESS_CHUNK_SIZE : 4096;
+	const size_t frame_capacity = capacity + (sizeof(uint32_t) * 2);
 	char* buffer = memory_allocate(HASH_RESOURCE, capacity, 0, MEMORY_PERSISTENT);
-	while (!stream_eos(stream)) {
-		size_t read = stream_read(stream, buffer, capacity);
-		if (read) {
-			size_t total = 0;
-			do {
-				size_t want_write = read - total;
-				size_t wrote = socket_write(sock, pointer_offset(buffer, total), want_write);
-				if (wrote != want_write) {
-					if (socket_state(sock) != SOCKETSTATE_CONNECTED) {
-						ret = -1;
-						break;
-					}
-					thread_yield();
+	char* frame = framed ? memory_allocate(HASH_RESOURCE, frame_capacity, 0, MEMORY_PERSISTENT) : nullptr;
+	while (written < size) {
+		size_t want_read = size - written;
+		if (want_read > capacity)
+			want_read = capacity;
+		size_t read = stream_read(stream, buffer, want_read);
+		if (!read) {
+			// Size was already sent in the reply, the client can only resync by reconnecting
+			log_warnf(HASH_RESOURCE, WARNING_RESOURCE,
+			          STRING_CONST("Short read of resource stream: %" PRIsize " of %" PRIsize ", closing connection"),
+			          written, size);
+			ret = -1;
+			break;
+		}
+		const char* data = buffer;
+		size_t data_size = read;
+		if (framed) {
+			data_size = resource_compress_chunk(buffer, read, frame, frame_capacity);
+			data = frame;
+			if (!data_size) {
+				ret = -1;
+				break;
+			}
+		}
+		size_t total = 0;
+		do {
+			size_t want_write = data_size - total;
+			size_t wrote = socket_write(sock, pointer_offset_const(data, total), want_write);
+			if (wrote != want_write) {
+				if (socket_state(sock) != SOCKETSTATE_CONNECTED) {
+					ret = -1;
+					break;
 				}
-				total += wrote;
-			} while (total != read);
+				thread_yield();
+			}
+			total += wrote;
+		} while (total != data_size);
 
-			if (total == read)
-				ret = 0;
-			written += total;
-		}
+		if (total != data_size)
+			break;
+		written += read;
 	}
+	memory_deallocate(frame);
 	memory_deallocate(buffer);
 	stream_deallocate(stream);
 
-	log_infof(HASH_RESOURCE, STRING_CONST("Wrote resource stream data: %" PRIsize " (%d)"), written, ret);
+	log_infof(HASH_RESOURCE, STRING_CONST("Wrote resource stream data: %" PRIsize "%s (%d)"), written,
+	          framed ? " framed" : "", ret);
 
 	return ret;
 }
 
 static int
-server_broadcast_notify(socket_t** sockets, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token) {
-	for (size_t isock = 0, send = array_size(sockets); isock < send; ++isock)
-		compiled_write_notify(sockets[isock], msg, uuid, platform, token);
+server_broadcast_notify(server_client_t* clients, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token) {
+	for (size_t iclient = 0, send = array_size(clients); iclient < send; ++iclient)
+		compiled_write_notify(clients[iclient].sock, msg, uuid, platform, token);
 	return 0;
 }
@@ -37,6 +37,7 @@ typedef struct {
 	uuid_t uuid;
 	blake3_hash_t hash;
 	string_t lookup_path;
+	string_const_t manifest_path;
 	uint64_t platform;
 	resource_op_t* op;
 	bool collapse;
@@ -183,6 +184,17 @@ resource_run(void* arg) {
 	tick_t tick;
 	void* blobdata;
 
+	if (input->manifest_path.length && !input->display_help) {
+		const uint64_t platforms[] = {input->platform};
+		if (!resource_local_manifest_write(STRING_ARGS(input->manifest_path), platforms,
+		                                   sizeof(platforms) / sizeof(platforms[0])))
+			result = RESOURCE_RESULT_UNABLE_TO_OPEN_OUTPUT_FILE;
+		if (uuid_is_null(input->uuid) && !input->lookup_path.length) {
+			resource_source_initialize(&source);
+			goto exit;
+		}
+	}
+
 	bool lookup_done = false;
 	if (uuid_is_null(input->uuid) && input->lookup_path.length) {
 		resource_signature_t sig = resource_import_lookup(STRING_ARGS(input->lookup_path));
@@ -374,6 +386,9 @@ resource_parse_command_line(const string_const_t* cmdline) {
 				log_debugf(HASH_RESOURCE, STRING_CONST("Lookup path: %.*s"), STRING_FORMAT(cleanpath));
 				input.lookup_path = string_clone(STRING_ARGS(cleanpath));
 			}
+		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--manifest"))) {
+			if (arg < asize - 1)
+				input.manifest_path = cmdline[++arg];
 		} else if (string_equal(STRING_ARGS(cmdline[arg]), STRING_CONST("--platform"))) {
 			if (arg < asize - 1) {
 				bool hex = false;
@@ -445,7 +460,7 @@ resource_print_usage(void) {
 	log_info(0,
 	         STRING_CONST("resource usage:\n"
 	                      "  resource [--source <path>] [--config <path>] [--remote <url>]\n"
-	                      "           [--uuid <uuid>] [--lookup <path>]\n"
+	                      "           [--uuid <uuid>] [--lookup <path>] [--manifest <path>]\n"
 	                      "           [--set <key> <value>] [--blob <key> <file>] [--unset <key>]\n"
 	                      "           [--platform <id>]\n"
 	                      "           [--collapse] [--clearblobs]\n"
@@ -459,6 +474,8 @@ resource_print_usage(void) {
 	                      "      --uuid <uuid>          Resource UUID\n"
 	                      "      --lookup <path>        Resource UUID by lookup of source path <path>\n"
 	                      "                             (UUID will be printed to stdout if no other command)\n"
+	                      "      --manifest <path>      Write manifest of compiled resources in local path <path>\n"
+	                      "                             resolving resources for the given platform\n"
 	                      "    Repeatable command arguments:\n"
 	                      "      --set <key> <value>    Set <key> to <value> in resource\n"
 	                      "      --blob <key> <value>   Set <key> to blob read from <file> in resource\n"
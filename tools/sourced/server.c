@@ -39,29 +39,57 @@ struct server_message_t {
 
 typedef struct server_message_t server_message_t;
 
+struct server_client_t {
+	socket_t* sock;
+	//! Request ID of a message header stashed in the socket while waiting for the payload
+	uint32_t request;
+	//! Features negotiated with the client in a hello message
+	uint32_t features;
+};
+
+typedef struct server_client_t server_client_t;
+
+//! Change log answering manifest requests with a since token, only accessed by the serve thread
+static sourced_change_log_t server_changes;
+
 static void*
 server_serve(void* arg);
 
 static int
-server_handle(socket_t* sock);
+server_handle(server_client_t* client);
+
+static int
+server_handle_lookup(socket_t* sock, uint32_t request, size_t msgsize);
+
+static int
+server_handle_hello(server_client_t* client, uint32_t request, size_t msgsize);
+
+static int
+server_handle_read(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features);
+
+static int
+server_handle_hash(socket_t* sock, uint32_t request, size_t msgsize);
+
+static int
+server_handle_dependencies(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_handle_lookup(socket_t* sock, size_t msgsize);
+server_handle_read_blob(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features);
 
 static int
-server_handle_read(socket_t* sock, size_t msgsize);
+server_handle_lookup_batch(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_handle_hash(socket_t* sock, size_t msgsize);
+server_handle_hash_batch(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_handle_dependencies(socket_t* sock, size_t msgsize);
+server_handle_dependencies_batch(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_handle_read_blob(socket_t* sock, size_t msgsize);
+server_handle_manifest(socket_t* sock, uint32_t request, size_t msgsize);
 
 static int
-server_broadcast_notify(socket_t** sockets, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token);
+server_broadcast_notify(server_client_t* clients, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token);
 
 void
 server_run(unsigned int port) {
@@ -212,13 +240,15 @@ server_serve(void* arg) {
 	socket_t* control_socket = local_sockets + 1;
 	const network_address_t* local_addr;
 	network_poll_event_t events[64];
-	socket_t** clients = nullptr;
+	server_client_t* clients = nullptr;
 
 	if (socket_fd(control_socket) == NETWORK_SOCKET_INVALID)
 		return nullptr;
 
 	network_poll_t* poll = network_poll_allocate(512);
 
+	sourced_change_log_initialize(&server_changes, random32_range(1, 0xFFFFFFFF), SOURCED_CHANGE_LOG_MAX);
+
 	local_addr = socket_address_local(control_source);
 	network_poll_add_socket(poll, control_socket);
 
@@ -241,15 +271,20 @@ server_serve(void* arg) {
 				}
 				socket_t* sock;
 				switch (message.message) {
-					case SERVER_MESSAGE_CONNECTION:
+					case SERVER_MESSAGE_CONNECTION: {
+						server_client_t client = {message.data, 0, 0};
 						sock = message.data;
 						sock->id = array_size(clients);
 						socket_set_blocking(sock, false);
+						// Replies are written in several small parts, send each without delay
+						tcp_socket_set_delay(sock, false);
 						network_poll_add_socket(poll, sock);
-						array_push(clients, sock);
+						array_push(clients, client);
 						break;
+					}
 
 					case SERVER_MESSAGE_BROADCAST_NOTIFY:
+						sourced_change_log_record(&server_changes, message.uuid);
 						server_broadcast_notify(clients, message.id, message.uuid, message.platform, message.token);
 						break;
 				}
@@ -257,7 +292,7 @@ server_serve(void* arg) {
 				socket_t* sock = events[ievt].socket;
 				bool disconnect = false;
 				if (events[ievt].event == NETWORKEVENT_DATAIN) {
-					if (server_handle(sock) < 0)
+					if (server_handle(clients + sock->id) < 0)
 						disconnect = true;
 				} else if (events[ievt].event == NETWORKEVENT_ERROR) {
 					log_info(HASH_RESOURCE, STRING_CONST("Socket error, closing connection"));
@@ -270,7 +305,7 @@ server_serve(void* arg) {
 					unsigned int client = sock->id;
 					array_erase(clients, client);  // Swap with last, patch up swapped client
 					if (array_size(clients) > client)
-						clients[client]->id = client;
+						clients[client].sock->id = client;
 					network_poll_remove_socket(poll, sock);
 					socket_deallocate(sock);
 				}
@@ -279,13 +314,16 @@ server_serve(void* arg) {
 	}
 
 	network_poll_deallocate(poll);
+	array_deallocate(clients);
+	sourced_change_log_finalize(&server_changes);
 
 	return nullptr;
 }
 
 static int
-server_handle(socket_t* sock) {
-	sourced_message_t msg = {(uint32_t)sock->data.header.id, (uint32_t)sock->data.header.size};
+server_handle(server_client_t* client) {
+	socket_t* sock = client->sock;
+	sourced_message_t msg = {(uint32_t)sock->data.header.id, (uint32_t)sock->data.header.size, client->request, 0};
 
 	sock->data.header.id = 0;
 
@@ -300,21 +338,39 @@ server_handle(socket_t* sock) {
 		}
 	}
 
+	// Keep request ID in case the handler stashes the header to wait for the payload
+	client->request = msg.request;
+
 	switch (msg.id) {
+		case SOURCED_HELLO:
+			return server_handle_hello(client, msg.request, msg.size);
+
 		case SOURCED_LOOKUP:
-			return server_handle_lookup(sock, msg.size);
+			return server_handle_lookup(sock, msg.request, msg.size);
 
 		case SOURCED_READ:
-			return server_handle_read(sock, msg.size);
+			return server_handle_read(sock, msg.request, msg.size, client->features);
 
 		case SOURCED_HASH:
-			return server_handle_hash(sock, msg.size);
+			return server_handle_hash(sock, msg.request, msg.size);
 
 		case SOURCED_DEPENDENCIES:
-			return server_handle_dependencies(sock, msg.size);
+			return server_handle_dependencies(sock, msg.request, msg.size);
 
 		case SOURCED_READ_BLOB:
-			return server_handle_read_blob(sock, msg.size);
+			return server_handle_read_blob(sock, msg.request, msg.size, client->features);
+
+		case SOURCED_LOOKUP_BATCH:
+			return server_handle_lookup_batch(sock, msg.request, msg.size);
+
+		case SOURCED_HASH_BATCH:
+			return server_handle_hash_batch(sock, msg.request, msg.size);
+
+		case SOURCED_DEPENDENCIES_BATCH:
+			return server_handle_dependencies_batch(sock, msg.request, msg.size);
+
+		case SOURCED_MANIFEST:
+			return server_handle_manifest(sock, msg.request, msg.size);
 
 		case SOURCED_REVERSE_LOOKUP:
 
@@ -342,6 +398,11 @@ server_handle(socket_t* sock) {
 		case SOURCED_NOTIFY_MODIFY:
 		case SOURCED_NOTIFY_DEPENDS:
 		case SOURCED_NOTIFY_DELETE:
+		case SOURCED_LOOKUP_BATCH_RESULT:
+		case SOURCED_HASH_BATCH_RESULT:
+		case SOURCED_DEPENDENCIES_BATCH_RESULT:
+		case SOURCED_HELLO_RESULT:
+		case SOURCED_MANIFEST_RESULT:
 		default:
 			break;
 	}
@@ -349,23 +410,30 @@ server_handle(socket_t* sock) {
 	return -1;
 }
 
+static resource_signature_t
+server_lookup(const char* str, size_t length) {
+	char buffer[BUILD_MAX_PATHLEN];
+	memcpy(buffer, str, length);
+	string_t path = path_clean(buffer, length, BUILD_MAX_PATHLEN);
+	if (!path_is_absolute(buffer, length)) {
+		string_const_t base_path = resource_import_base_path();
+		path = path_prepend(STRING_ARGS(path), BUILD_MAX_PATHLEN, STRING_ARGS(base_path));
+		path = path_absolute(STRING_ARGS(path), BUILD_MAX_PATHLEN);
+	}
+	log_infof(HASH_RESOURCE, STRING_CONST("Perform lookup of resource: %.*s"), STRING_FORMAT(path));
+	return resource_import_lookup(STRING_ARGS(path));
+}
+
 static int
-server_handle_lookup(socket_t* sock, size_t msgsize) {
+server_handle_lookup(socket_t* sock, uint32_t request, size_t msgsize) {
 	if (msgsize > BUILD_MAX_PATHLEN)
 		return -1;
 
 	char buffer[BUILD_MAX_PATHLEN];
 	size_t read = socket_read(sock, buffer, msgsize);
 	if (read == msgsize) {
-		string_t path = path_clean(buffer, msgsize, BUILD_MAX_PATHLEN);
-		if (!path_is_absolute(buffer, msgsize)) {
-			string_const_t base_path = resource_import_base_path();
-			path = path_prepend(STRING_ARGS(path), BUILD_MAX_PATHLEN, STRING_ARGS(base_path));
-			path = path_absolute(STRING_ARGS(path), BUILD_MAX_PATHLEN);
-		}
-		log_infof(HASH_RESOURCE, STRING_CONST("Perform lookup of resource: %.*s"), STRING_FORMAT(path));
-		resource_signature_t sig = resource_import_lookup(STRING_ARGS(path));
-		return sourced_write_lookup_reply(sock, sig.uuid, sig.hash);
+		resource_signature_t sig = server_lookup(buffer, msgsize);
+		return sourced_write_lookup_reply(sock, request, sig.uuid, sig.hash);
 	}
 	if (read != 0) {
 		log_infof(HASH_RESOURCE, STRING_CONST("Read partial lookup message: %" PRIsize " of %" PRIsize), read, msgsize);
@@ -378,8 +446,33 @@ server_handle_lookup(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_handle_read(socket_t* sock, size_t msgsize) {
-	size_t expected_size = sizeof(uuid_t);
+server_handle_hello(server_client_t* client, uint32_t request, size_t msgsize) {
+	socket_t* sock = client->sock;
+	size_t expected_size = sizeof(uint32_t) * 2;
+	if (msgsize != expected_size)
+		return -1;
+
+	sourced_hello_t hello;
+	size_t read = socket_read(sock, &hello.version, expected_size);
+	if (read == expected_size) {
+		client->features = hello.features & SOURCED_FEATURE_COMPRESSION;
+		log_infof(HASH_RESOURCE, STRING_CONST("Client hello, protocol version %u, features 0x%x"), hello.version,
+		          client->features);
+		return sourced_write_hello_reply(sock, request, client->features);
+	}
+	if (read != 0) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read partial hello message: %" PRIsize " of %" PRIsize), read, msgsize);
+		return -1;
+	}
+
+	sock->data.header.id = SOURCED_HELLO;
+	sock->data.header.size = msgsize;
+	return 0;
+}
+
+static int
+server_handle_read(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features) {
+	size_t expected_size = sizeof(uuid_t) + sizeof(blake3_hash_t) + sizeof(tick_t);
 	if (msgsize != expected_size)
 		return -1;
 
@@ -387,20 +480,28 @@ server_handle_read(socket_t* sock, size_t msgsize) {
 	size_t read = socket_read(sock, &readmsg.uuid, expected_size);
 	if (read == expected_size) {
 		int ret;
-		resource_source_t source;
 		string_const_t uuidstr = string_from_uuid_static(readmsg.uuid);
-		resource_source_initialize(&source);
 		log_infof(HASH_RESOURCE, STRING_CONST("Perform read of resource: %.*s"), STRING_FORMAT(uuidstr));
 		if (resource_autoimport_need_update(readmsg.uuid, 0)) {
 			uuidstr = string_from_uuid_static(readmsg.uuid);
 			log_debugf(HASH_RESOURCE, STRING_CONST("Reimporting resource %.*s (read)"), STRING_FORMAT(uuidstr));
 			resource_autoimport(readmsg.uuid);
 		}
+		blake3_hash_t hash = resource_source_hash(readmsg.uuid, 0);
+		if (!blake3_hash_is_null(hash) && blake3_hash_equal(hash, readmsg.hash)) {
+			ret = sourced_write_read_not_modified_reply(sock, request, hash);
+			log_infof(HASH_RESOURCE, STRING_CONST("  resource not modified, wrote reply"));
+			return ret;
+		}
+		// Client copy is stale, send changes made since its latest change
+		tick_t since = !blake3_hash_is_null(readmsg.hash) ? readmsg.since : 0;
+		resource_source_t source;
+		resource_source_initialize(&source);
 		if (resource_source_read(&source, readmsg.uuid)) {
-			ret = sourced_write_read_reply(sock, &source, resource_source_hash(readmsg.uuid, 0));
+			ret = sourced_write_read_reply(sock, request, &source, hash, since, features);
 			log_infof(HASH_RESOURCE, STRING_CONST("  read resource successfully, wrote reply"));
 		} else {
-			ret = sourced_write_read_reply(sock, nullptr, blake3_hash_null());
+			ret = sourced_write_read_reply(sock, request, nullptr, blake3_hash_null(), 0, features);
 			log_infof(HASH_RESOURCE, STRING_CONST("  failed reading resource, wrote reply"));
 		}
 		resource_source_finalize(&source);
@@ -417,7 +518,7 @@ server_handle_read(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_handle_hash(socket_t* sock, size_t msgsize) {
+server_handle_hash(socket_t* sock, uint32_t request, size_t msgsize) {
 	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t);
 	if (msgsize != expected_size)
 		return -1;
@@ -431,7 +532,7 @@ server_handle_hash(socket_t* sock, size_t msgsize) {
 			resource_autoimport(hashmsg.uuid);
 		}
 		blake3_hash_t hash = resource_source_hash(hashmsg.uuid, hashmsg.platform);
-		return sourced_write_hash_reply(sock, hash);
+		return sourced_write_hash_reply(sock, request, hash);
 	}
 	if (read != 0) {
 		log_infof(HASH_RESOURCE, STRING_CONST("Read partial hash message: %" PRIsize " of %" PRIsize), read, msgsize);
@@ -444,7 +545,7 @@ server_handle_hash(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_handle_dependencies(socket_t* sock, size_t msgsize) {
+server_handle_dependencies(socket_t* sock, uint32_t request, size_t msgsize) {
 	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t);
 	if (msgsize != expected_size)
 		return -1;
@@ -461,7 +562,7 @@ server_handle_dependencies(socket_t* sock, size_t msgsize) {
 			deps = memory_allocate(HASH_RESOURCE, capacity * sizeof(resource_dependency_t), 0, MEMORY_PERSISTENT);
 			numdeps = resource_source_dependencies(depmsg.uuid, depmsg.platform, deps, capacity);
 		}
-		int ret = sourced_write_dependencies_reply(sock, deps, numdeps);
+		int ret = sourced_write_dependencies_reply(sock, request, deps, numdeps);
 		if (deps != localdeps)
 			memory_deallocate(deps);
 		return ret;
@@ -478,7 +579,7 @@ server_handle_dependencies(socket_t* sock, size_t msgsize) {
 }
 
 static int
-server_handle_read_blob(socket_t* sock, size_t msgsize) {
+server_handle_read_blob(socket_t* sock, uint32_t request, size_t msgsize, uint32_t features) {
 	size_t expected_size = sizeof(uuid_t) + sizeof(uint64_t) * 2;
 	if (msgsize != expected_size)
 		return -1;
@@ -504,9 +605,10 @@ server_handle_read_blob(socket_t* sock, size_t msgsize) {
 				void* blob = memory_allocate(HASH_RESOURCE, size, 0, MEMORY_PERSISTENT);
 				if (resource_source_read_blob(readmsg.uuid, readmsg.key, readmsg.platform,
 				                              blobchange->value.blob.checksum, blob, size))
-					ret = sourced_write_read_blob_reply(sock, blobchange->value.blob.checksum, blob, size);
+					ret = sourced_write_read_blob_reply(sock, request, blobchange->value.blob.checksum, blob, size,
+					                                    features);
 				else
-					ret = sourced_write_read_blob_reply(sock, 0, nullptr, 0);
+					ret = sourced_write_read_blob_reply(sock, request, 0, nullptr, 0, features);
 				memory_deallocate(blob);
 			}
 		}
@@ -524,9 +626,234 @@ server_handle_read_blob(socket_t* sock, size_t msgsize) {
 	return 0;
 }
 
+/*! Read a batch message. Batches are only read once the whole message is available, to
+avoid blocking the serve thread on a partially received payload
+\param sock Socket
+\param msgid Message ID
+\param msgsize Message size
+\param batch Batch header destination
+\param payload Payload destination, allocated by this function
+\return 1 if read, 0 if waiting for more data, <0 if error */
+static int
+server_read_batch(socket_t* sock, uint32_t msgid, size_t msgsize, sourced_batch_t* batch, void** payload) {
+	const size_t header_size = sizeof(sourced_batch_t) - sizeof(sourced_message_t);
+	const size_t max_size = header_size + (SOURCED_BATCH_MAX * (sizeof(uint32_t) + BUILD_MAX_PATHLEN));
+	if ((msgsize < header_size) || (msgsize > max_size))
+		return -1;
+
+	if (socket_available_read(sock) < msgsize) {
+		sock->data.header.id = msgid;
+		sock->data.header.size = msgsize;
+		return 0;
+	}
+
+	if (socket_read(sock, &batch->platform, header_size) != header_size)
+		return -1;
+	size_t payload_size = msgsize - header_size;
+	*payload = memory_allocate(HASH_RESOURCE, payload_size ? payload_size : 1, 0, MEMORY_PERSISTENT);
+	if ((socket_read(sock, *payload, payload_size) != payload_size) || (batch->count > SOURCED_BATCH_MAX)) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read invalid batch message: %" PRIsize " bytes"), msgsize);
+		memory_deallocate(*payload);
+		*payload = nullptr;
+		return -1;
+	}
+	return 1;
+}
+
+static int
+server_handle_lookup_batch(socket_t* sock, uint32_t request, size_t msgsize) {
+	sourced_batch_t batch;
+	void* payload = nullptr;
+	int ret = server_read_batch(sock, SOURCED_LOOKUP_BATCH, msgsize, &batch, &payload);
+	if (ret <= 0)
+		return ret;
+
+	const size_t header_size = sizeof(sourced_batch_t) - sizeof(sourced_message_t);
+	size_t payload_size = msgsize - header_size;
+	const uint32_t* length = payload;
+	const char* str = pointer_offset_const(payload, sizeof(uint32_t) * batch.count);
+	size_t offset = sizeof(uint32_t) * batch.count;
+	resource_signature_t* sigs = nullptr;
+	ret = -1;
+	if (offset <= payload_size) {
+		sigs = memory_allocate(HASH_RESOURCE, sizeof(resource_signature_t) * (batch.count + 1), 0, MEMORY_PERSISTENT);
+		uint32_t ipath = 0;
+		for (; ipath < batch.count; ++ipath) {
+			if ((length[ipath] > BUILD_MAX_PATHLEN) || (offset + length[ipath] > payload_size))
+				break;
+			sigs[ipath] = server_lookup(str, length[ipath]);
+			str += length[ipath];
+			offset += length[ipath];
+		}
+		if (ipath == batch.count)
+			ret = sourced_write_lookup_batch_reply(sock, request, sigs, batch.count);
+	}
+
+	memory_deallocate(sigs);
+	memory_deallocate(payload);
+	return ret;
+}
+
+static int
+server_handle_hash_batch(socket_t* sock, uint32_t request, size_t msgsize) {
+	sourced_batch_t batch;
+	void* payload = nullptr;
+	int ret = server_read_batch(sock, SOURCED_HASH_BATCH, msgsize, &batch, &payload);
+	if (ret <= 0)
+		return ret;
+
+	ret = -1;
+	const size_t header_size = sizeof(sourced_batch_t) - sizeof(sourced_message_t);
+	if (msgsize - header_size == sizeof(uuid_t) * batch.count) {
+		const uuid_t* uuids = payload;
+		blake3_hash_t* hashes =
+		    memory_allocate(HASH_RESOURCE, sizeof(blake3_hash_t) * (batch.count + 1), 0, MEMORY_PERSISTENT);
+		for (uint32_t iuuid = 0; iuuid < batch.count; ++iuuid) {
+			if (resource_autoimport_need_update(uuids[iuuid], batch.platform)) {
+				string_const_t uuidstr = string_from_uuid_static(uuids[iuuid]);
+				log_debugf(HASH_RESOURCE, STRING_CONST("Reimporting resource %.*s (read hash batch)"),
+				           STRING_FORMAT(uuidstr));
+				resource_autoimport(uuids[iuuid]);
+			}
+			hashes[iuuid] = resource_source_hash(uuids[iuuid], batch.platform);
+		}
+		ret = sourced_write_hash_batch_reply(sock, request, hashes, batch.count);
+		memory_deallocate(hashes);
+	}
+
+	memory_deallocate(payload);
+	return ret;
+}
+
+static int
+server_handle_dependencies_batch(socket_t* sock, uint32_t request, size_t msgsize) {
+	sourced_batch_t batch;
+	void* payload = nullptr;
+	int ret = server_read_batch(sock, SOURCED_DEPENDENCIES_BATCH, msgsize, &batch, &payload);
+	if (ret <= 0)
+		return ret;
+
+	ret = -1;
+	const size_t header_size = sizeof(sourced_batch_t) - sizeof(sourced_message_t);
+	if (msgsize - header_size == sizeof(uuid_t) * batch.count) {
+		const uuid_t* uuids = payload;
+		uint64_t* deps_count = memory_allocate(HASH_RESOURCE, sizeof(uint64_t) * (batch.count + 1), 0,
+		                                       MEMORY_PERSISTENT);
+		resource_dependency_t* deps = nullptr;
+		for (uint32_t iuuid = 0; iuuid < batch.count; ++iuuid) {
+			size_t base = array_size(deps);
+			size_t count = resource_source_dependencies_count(uuids[iuuid], batch.platform);
+			if (count) {
+				array_resize(deps, base + count);
+				size_t filled = resource_source_dependencies(uuids[iuuid], batch.platform, deps + base, count);
+				if (filled < count)
+					count = filled;
+				array_resize(deps, base + count);
+			}
+			deps_count[iuuid] = count;
+		}
+		ret = sourced_write_dependencies_batch_reply(sock, request, deps_count, batch.count, deps);
+		array_deallocate(deps);
+		memory_deallocate(deps_count);
+	}
+
+	memory_deallocate(payload);
+	return ret;
+}
+
+static int
+server_handle_manifest(socket_t* sock, uint32_t request, size_t msgsize) {
+	const size_t header_size = sizeof(sourced_manifest_t) - sizeof(sourced_message_t);
+	const size_t max_size = header_size + (SOURCED_BATCH_MAX * sizeof(uuid_t));
+	if ((msgsize < header_size) || (msgsize > max_size))
+		return -1;
+
+	if (socket_available_read(sock) < msgsize) {
+		sock->data.header.id = SOURCED_MANIFEST;
+		sock->data.header.size = msgsize;
+		return 0;
+	}
+
+	sourced_manifest_t manifest;
+	if (socket_read(sock, &manifest.platform, header_size) != header_size)
+		return -1;
+	if ((manifest.count > SOURCED_BATCH_MAX) || (msgsize - header_size != sizeof(uuid_t) * manifest.count)) {
+		log_infof(HASH_RESOURCE, STRING_CONST("Read invalid manifest message: %" PRIsize " bytes"), msgsize);
+		return -1;
+	}
+
+	uuid_t* requested = nullptr;
+	if (manifest.count) {
+		size_t payload_size = sizeof(uuid_t) * manifest.count;
+		array_resize(requested, manifest.count);
+		if (socket_read(sock, requested, payload_size) != payload_size) {
+			array_deallocate(requested);
+			return -1;
+		}
+	}
+
+	// Token is taken before hashing, changes made while hashing are in the next manifest
+	uint64_t token = sourced_change_log_token(&server_changes);
+	uint32_t flags = 0;
+	uuid_t* uuids = nullptr;
+	if (sourced_change_log_since(&server_changes, manifest.since, &uuids)) {
+		if (requested) {
+			uuid_t* changed = uuids;
+			uuids = nullptr;
+			for (size_t iuuid = 0, usize = array_size(requested); iuuid < usize; ++iuuid) {
+				for (size_t ichange = 0, csize = array_size(changed); ichange < csize; ++ichange) {
+					if (uuid_equal(requested[iuuid], changed[ichange])) {
+						array_push(uuids, requested[iuuid]);
+						break;
+					}
+				}
+			}
+			array_deallocate(changed);
+		}
+	} else {
+		flags |= SOURCED_MANIFEST_FLAG_COMPLETE;
+		if (requested) {
+			uuids = requested;
+			requested = nullptr;
+		} else {
+			uuids = resource_source_uuids();
+		}
+	}
+	array_deallocate(requested);
+
+	// Hashing all resources on the serve thread stalls other clients, reply in parts
+	if (!manifest.count && sourced_manifest_part(&uuids, manifest.after))
+		flags |= SOURCED_MANIFEST_FLAG_PARTIAL;
+
+	// Hash and write in chunks rather than building the whole manifest in memory
+	size_t count = array_size(uuids);
+	resource_signature_t chunk[SOURCED_MANIFEST_CHUNK];
+	int ret = sourced_write_manifest_reply(sock, request, flags, token, count);
+	for (size_t offset = 0; (ret >= 0) && (offset < count); offset += SOURCED_MANIFEST_CHUNK) {
+		size_t chunk_count = count - offset;
+		if (chunk_count > SOURCED_MANIFEST_CHUNK)
+			chunk_count = SOURCED_MANIFEST_CHUNK;
+		for (size_t ientry = 0; ientry < chunk_count; ++ientry) {
+			uuid_t uuid = uuids[offset + ientry];
+			if (resource_autoimport_need_update(uuid, manifest.platform)) {
+				string_const_t uuidstr = string_from_uuid_static(uuid);
+				log_debugf(HASH_RESOURCE, STRING_CONST("Reimporting resource %.*s (read manifest)"),
+				           STRING_FORMAT(uuidstr));
+				resource_autoimport(uuid);
+			}
+			chunk[ientry].uuid = uuid;
+			chunk[ientry].hash = resource_source_hash(uuid, manifest.platform);
+		}
+		ret = sourced_write_manifest_entries(sock, chunk, chunk_count);
+	}
+
+	array_deallocate(uuids);
+	return ret;
+}
+
 static int
-server_broadcast_notify(socket_t** sockets, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token) {
-	for (size_t isock = 0, send = array_size(sockets); isock < send; ++isock)
-		sourced_write_notify(sockets[isock], msg, uuid, platform, token);
+server_broadcast_notify(server_client_t* clients, unsigned int msg, uuid_t uuid, uint64_t platform, hash_t token) {
+	for (size_t iclient = 0, send = array_size(clients); iclient < send; ++iclient)
+		sourced_write_notify(clients[iclient].sock, msg, uuid, platform, token);
 	return 0;
 }